@@ -33,6 +33,7 @@ public:
 public:
 	CAnimChannelData ();
 	CAnimChannelData (const CAnimChannelData& v);
+	CAnimChannelData (CAnimChannelData&& v) = default;
 	~CAnimChannelData ();
 
 	CAnimChannelData& operator = (const CAnimChannelData &v) {
@@ -41,6 +42,7 @@ public:
 		this->pathType        = v.pathType;
 		return (*this);
 	}
+	CAnimChannelData& operator = (CAnimChannelData &&v) = default;
 
 	void clear ();
 };
@@ -65,6 +67,7 @@ public:
 public:
 	CAnimSamplerData ();
 	CAnimSamplerData (const CAnimSamplerData &v);
+	CAnimSamplerData (CAnimSamplerData&& v) = default;
 	~CAnimSamplerData ();
 
 	CAnimSamplerData& operator = (const CAnimSamplerData &v) {
@@ -73,6 +76,7 @@ public:
 		this->outputData        = v.outputData;
 		return (*this);
 	}
+	CAnimSamplerData& operator = (CAnimSamplerData &&v) = default;
 
 	void clear ();
 };
@@ -91,6 +95,7 @@ public:
 public:
 	CAnimationData ();
 	CAnimationData (const CAnimationData& v);
+	CAnimationData (CAnimationData&& v) = default;
 	~CAnimationData ();
 
     CAnimationData& operator = (const CAnimationData &v) {
@@ -99,6 +104,7 @@ public:
 		this->samplerData  = v.samplerData;
 		return (*this);
 	}
+	CAnimationData& operator = (CAnimationData &&v) = default;
 
 	void clear ();
 
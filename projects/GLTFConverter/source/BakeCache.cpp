@@ -0,0 +1,492 @@
+﻿/**
+ * テクスチャのベイク結果のキャッシュ.
+ */
+#include "BakeCache.h"
+#include "HashUtil.h"
+#include "Shade3DUtil.h"
+
+#include <fstream>
+#include <algorithm>
+#include <vector>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#if _WINDOWS
+#include <filesystem>
+#else
+#include <dirent.h>
+#include <utime.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#endif
+
+namespace {
+	// ディスクキャッシュのファイルの先頭のシグネチャ.
+	const char BAKE_CACHE_SIGNATURE[8] = { 'G', 'L', 'T', 'F', 'B', 'A', 'K', 'E' };
+
+	// ディスクキャッシュのフォルダ名 (テンポラリフォルダ内に作成).
+	const char* BAKE_CACHE_DIR_NAME = "Shade3D_GLTFConverter_bake";
+
+	// ディスクキャッシュのファイル名の接頭辞.
+	const char* BAKE_CACHE_FILE_PREFIX = "bake_";
+
+	// ディスクキャッシュの合計サイズの上限 (bytes).
+	// これを超えた場合は、最後に使用した日時が古いファイルから削除する.
+	const uint64_t BAKE_CACHE_MAX_TOTAL_BYTES = (uint64_t)2 * 1024 * 1024 * 1024;
+
+	// イメージのハッシュ値を計算する際に、一度に読み込む最大サイズ (bytes).
+	const size_t IMAGE_HASH_BAND_MAX_BYTES = 1024 * 1024;
+
+	/**
+	 * テンポラリフォルダのパスを取得 (末尾の区切り文字は含まない).
+	 * 取得できない場合は"".
+	 */
+	std::string getTempDirectory () {
+		const char* envNames[] = { "TMPDIR", "TEMP", "TMP" };
+		for (int i = 0; i < 3; ++i) {
+			const char* pPath = getenv(envNames[i]);
+			if (!pPath || pPath[0] == '\0') continue;
+			std::string path(pPath);
+			while (path.length() > 1 && (path[path.length() - 1] == '/' || path[path.length() - 1] == '\\')) {
+				path = path.substr(0, path.length() - 1);
+			}
+			return path;
+		}
+		return "";
+	}
+
+	/**
+	 * フォルダが存在しない場合は作成.
+	 */
+	bool createDirectory (const std::string& path) {
+		try {
+#if _WINDOWS
+			if (std::experimental::filesystem::exists(path)) return true;
+			return std::experimental::filesystem::create_directory(path);
+#else
+			struct stat st;
+			if (stat(path.c_str(), &st) == 0) return S_ISDIR(st.st_mode);
+			return (mkdir(path.c_str(), 0777) == 0);
+#endif
+		} catch (...) { }
+		return false;
+	}
+
+	/**
+	 * ファイルの更新日時を現在の日時にする.
+	 */
+	void touchFile (const std::string& path) {
+		try {
+#if _WINDOWS
+			std::experimental::filesystem::last_write_time(path, std::experimental::filesystem::file_time_type::clock::now());
+#else
+			utime(path.c_str(), NULL);
+#endif
+		} catch (...) { }
+	}
+
+	/**
+	 * ディスクキャッシュのフォルダ内のファイルの情報.
+	 */
+	class CCacheFileInfo
+	{
+	public:
+		std::string path;
+		uint64_t size;
+		int64_t modifiedTime;
+
+	public:
+		CCacheFileInfo () : size(0), modifiedTime(0) { }
+	};
+
+	/**
+	 * フォルダ内のディスクキャッシュのファイルを取得.
+	 */
+	void getCacheFiles (const std::string& dirPath, std::vector<CCacheFileInfo>& files) {
+		files.clear();
+		const std::string prefix(BAKE_CACHE_FILE_PREFIX);
+		try {
+#if _WINDOWS
+			namespace fs = std::experimental::filesystem;
+			for (fs::directory_iterator iter(dirPath), iterEnd; iter != iterEnd; ++iter) {
+				if (!fs::is_regular_file(iter->status())) continue;
+				const std::string fileName = iter->path().filename().string();
+				if (fileName.compare(0, prefix.length(), prefix) != 0) continue;
+				CCacheFileInfo info;
+				info.path         = iter->path().string();
+				info.size         = (uint64_t)fs::file_size(iter->path());
+				info.modifiedTime = (int64_t)fs::last_write_time(iter->path()).time_since_epoch().count();
+				files.push_back(info);
+			}
+#else
+			DIR* dir = opendir(dirPath.c_str());
+			if (!dir) return;
+			struct dirent* entry;
+			while ((entry = readdir(dir)) != NULL) {
+				const std::string fileName(entry->d_name);
+				if (fileName.compare(0, prefix.length(), prefix) != 0) continue;
+				CCacheFileInfo info;
+				info.path = dirPath + std::string("/") + fileName;
+				struct stat st;
+				if (stat(info.path.c_str(), &st) != 0 || !S_ISREG(st.st_mode)) continue;
+				info.size         = (uint64_t)st.st_size;
+				info.modifiedTime = (int64_t)st.st_mtime;
+				files.push_back(info);
+			}
+			closedir(dir);
+#endif
+		} catch (...) { }
+	}
+
+	//-----------------------------------------------------------.
+	// ディスクキャッシュの書き込み.
+	//-----------------------------------------------------------.
+	void writeInt (std::ofstream& ofs, const int v) {
+		ofs.write((const char *)&v, sizeof(int));
+	}
+	void writeFloat (std::ofstream& ofs, const float v) {
+		ofs.write((const char *)&v, sizeof(float));
+	}
+	void writeUInt64 (std::ofstream& ofs, const uint64_t v) {
+		ofs.write((const char *)&v, sizeof(uint64_t));
+	}
+	void writeString (std::ofstream& ofs, const std::string& str) {
+		writeInt(ofs, (int)str.length());
+		if (!str.empty()) ofs.write(str.c_str(), str.length());
+	}
+	void writeColor (std::ofstream& ofs, const sxsdk::rgb_class& col) {
+		writeFloat(ofs, col.red);
+		writeFloat(ofs, col.green);
+		writeFloat(ofs, col.blue);
+	}
+	void writeBakedImage (std::ofstream& ofs, const CBakedImageData& bakedImage) {
+		writeInt(ofs, bakedImage.hasImage ? 1 : 0);
+		writeString(ofs, bakedImage.name);
+		writeInt(ofs, bakedImage.texCoord);
+		writeInt(ofs, bakedImage.repeat.x);
+		writeInt(ofs, bakedImage.repeat.y);
+		writeColor(ofs, bakedImage.factor);
+
+		const CImageData& imageData = bakedImage.imageData;
+		writeInt(ofs, imageData.width);
+		writeInt(ofs, imageData.height);
+		writeUInt64(ofs, imageData.imageRGBAHash);
+		writeInt(ofs, (int)imageData.imageRGBAData.size());
+		if (!imageData.imageRGBAData.empty()) {
+			ofs.write((const char *)&(imageData.imageRGBAData[0]), imageData.imageRGBAData.size());
+		}
+
+		// タイル単位でベイクした場合の、png/jpegのバイト列.
+		writeString(ofs, imageData.mimeType);
+		writeUInt64(ofs, imageData.imageDatas.empty() ? 0 : HashUtil::calcHash64(imageData.imageDatas));
+		writeInt(ofs, (int)imageData.imageDatas.size());
+		if (!imageData.imageDatas.empty()) {
+			ofs.write((const char *)&(imageData.imageDatas[0]), imageData.imageDatas.size());
+		}
+	}
+
+	//-----------------------------------------------------------.
+	// ディスクキャッシュの読み込み.
+	//-----------------------------------------------------------.
+	bool readInt (std::ifstream& ifs, int& v) {
+		ifs.read((char *)&v, sizeof(int));
+		return ifs.good();
+	}
+	bool readFloat (std::ifstream& ifs, float& v) {
+		ifs.read((char *)&v, sizeof(float));
+		return ifs.good();
+	}
+	bool readUInt64 (std::ifstream& ifs, uint64_t& v) {
+		ifs.read((char *)&v, sizeof(uint64_t));
+		return ifs.good();
+	}
+	bool readString (std::ifstream& ifs, std::string& str) {
+		int len = 0;
+		if (!readInt(ifs, len) || len < 0 || len > 0x10000) return false;
+		str.assign((size_t)len, '\0');
+		if (len > 0) ifs.read(&(str[0]), len);
+		return ifs.good();
+	}
+	bool readColor (std::ifstream& ifs, sxsdk::rgb_class& col) {
+		return readFloat(ifs, col.red) && readFloat(ifs, col.green) && readFloat(ifs, col.blue);
+	}
+	bool readBakedImage (std::ifstream& ifs, CBakedImageData& bakedImage) {
+		bakedImage.clear();
+		int iDat = 0;
+		if (!readInt(ifs, iDat)) return false;
+		bakedImage.hasImage = iDat ? true : false;
+		if (!readString(ifs, bakedImage.name)) return false;
+		if (!readInt(ifs, bakedImage.texCoord)) return false;
+		if (!readInt(ifs, bakedImage.repeat.x) || !readInt(ifs, bakedImage.repeat.y)) return false;
+		if (!readColor(ifs, bakedImage.factor)) return false;
+
+		CImageData& imageData = bakedImage.imageData;
+		int dataSize = 0;
+		if (!readInt(ifs, imageData.width) || !readInt(ifs, imageData.height)) return false;
+		if (!readUInt64(ifs, imageData.imageRGBAHash)) return false;
+		if (!readInt(ifs, dataSize)) return false;
+		if (imageData.width < 0 || imageData.height < 0 || dataSize != imageData.width * imageData.height * 4) return false;
+		if (dataSize > 0) {
+			imageData.imageRGBAData.resize((size_t)dataSize);
+			ifs.read((char *)&(imageData.imageRGBAData[0]), dataSize);
+			if (!ifs.good()) return false;
+
+			// 内容が壊れていないか.
+			if (HashUtil::calcHash64(imageData.imageRGBAData) != imageData.imageRGBAHash) return false;
+		}
+
+		uint64_t imageDatasHash = 0;
+		if (!readString(ifs, imageData.mimeType)) return false;
+		if (!readUInt64(ifs, imageDatasHash)) return false;
+		if (!readInt(ifs, dataSize) || dataSize < 0) return false;
+		if (dataSize > 0) {
+			imageData.imageDatas.resize((size_t)dataSize);
+			ifs.read((char *)&(imageData.imageDatas[0]), dataSize);
+			if (!ifs.good()) return false;
+			if (HashUtil::calcHash64(imageData.imageDatas) != imageDatasHash) return false;
+		}
+		return true;
+	}
+}
+
+CBakeCache::CBakeCache () : m_useDiskCache(false)
+{
+}
+
+CBakeCache::~CBakeCache ()
+{
+}
+
+/**
+ * メモリ上のキャッシュをクリア.
+ */
+void CBakeCache::clear ()
+{
+	m_resultsMap.clear();
+	m_imageHashMap.clear();
+}
+
+/**
+ * イメージの内容のハッシュ値を取得 (サイズとマスターイメージ名を含む).
+ */
+uint64_t CBakeCache::getImageHash (sxsdk::scene_interface* scene, sxsdk::image_interface* image)
+{
+	if (!image) return 0;
+
+	sxsdk::master_image_class* masterImage = NULL;
+	try {
+		masterImage = Shade3DUtil::getMasterImageFromImage(scene, image);
+	} catch (...) { }
+	if (masterImage) {
+		std::map<sxsdk::master_image_class*, uint64_t>::const_iterator iter = m_imageHashMap.find(masterImage);
+		if (iter != m_imageHashMap.end()) return iter->second;
+	}
+
+	uint64_t hash = HASH64_SEED;
+	try {
+		if (!image->has_image()) return hash;
+		const int width  = image->get_size().x;
+		const int height = image->get_size().y;
+		hash = HashUtil::combineHash64(hash, (uint64_t)width);
+		hash = HashUtil::combineHash64(hash, (uint64_t)height);
+
+		if (width > 0 && height > 0) {
+			const int bandRows = std::max(1, std::min(height, (int)(IMAGE_HASH_BAND_MAX_BYTES / (sizeof(sx::rgba8_class) * (size_t)width))));
+			std::vector<sx::rgba8_class> lineCols;
+			lineCols.resize((size_t)width * (size_t)bandRows);
+			for (int y = 0; y < height; y += bandRows) {
+				const int rowsCou = std::min(bandRows, height - y);
+				image->get_pixels_rgba(0, y, width, rowsCou, &(lineCols[0]));
+				hash = HashUtil::calcHash64(&(lineCols[0]), sizeof(sx::rgba8_class) * (size_t)width * (size_t)rowsCou, hash);
+			}
+		}
+		if (masterImage) {
+			hash = HashUtil::calcHash64(std::string(masterImage->get_name()), hash);
+			m_imageHashMap[masterImage] = hash;
+		}
+	} catch (...) { }
+
+	return hash;
+}
+
+/**
+ * ベイク結果を検索.
+ */
+CBakeResultData* CBakeCache::find (const uint64_t key)
+{
+	std::map<uint64_t, CBakeResultData>::iterator iter = m_resultsMap.find(key);
+	if (iter != m_resultsMap.end()) return &(iter->second);
+
+	if (m_useDiskCache) {
+		CBakeResultData data;
+		if (m_loadDiskCache(key, data)) {
+			// 最近使用したものとして、更新日時を変更.
+			touchFile(m_getDiskCacheFilePath(key));
+
+			CBakeResultData& dstData = m_resultsMap[key];
+			dstData = std::move(data);
+			return &dstData;
+		}
+	}
+	return NULL;
+}
+
+/**
+ * ベイク結果を追加.
+ */
+CBakeResultData* CBakeCache::add (const uint64_t key, CBakeResultData&& data)
+{
+	if (m_useDiskCache) {
+		if (m_saveDiskCache(key, data)) m_trimDiskCache(m_getDiskCacheFilePath(key));
+	}
+
+	CBakeResultData& dstData = m_resultsMap[key];
+	dstData = std::move(data);
+	return &dstData;
+}
+
+/**
+ * ディスクキャッシュのフォルダのパスを取得.
+ */
+std::string CBakeCache::m_getDiskCacheDirectory () const
+{
+	const std::string tempPath = getTempDirectory();
+	if (tempPath == "") return "";
+	return tempPath + std::string("/") + std::string(BAKE_CACHE_DIR_NAME);
+}
+
+/**
+ * ディスクキャッシュのファイルパスを取得.
+ */
+std::string CBakeCache::m_getDiskCacheFilePath (const uint64_t key) const
+{
+	const std::string dirPath = m_getDiskCacheDirectory();
+	if (dirPath == "") return "";
+
+	char szStr[32];
+	sprintf(szStr, "%08x%08x", (unsigned int)(key >> 32), (unsigned int)(key & 0xffffffff));
+	return dirPath + std::string("/") + std::string(BAKE_CACHE_FILE_PREFIX) + std::string(szStr) + std::string(".dat");
+}
+
+/**
+ * ディスクキャッシュの合計サイズが上限を超えている場合は、更新日時が古いファイルから削除.
+ */
+void CBakeCache::m_trimDiskCache (const std::string& keepFilePath) const
+{
+	const std::string dirPath = m_getDiskCacheDirectory();
+	if (dirPath == "") return;
+
+	std::vector<CCacheFileInfo> files;
+	getCacheFiles(dirPath, files);
+
+	uint64_t totalSize = 0;
+	for (size_t i = 0; i < files.size(); ++i) totalSize += files[i].size;
+	if (totalSize <= BAKE_CACHE_MAX_TOTAL_BYTES) return;
+
+	std::sort(files.begin(), files.end(), [](const CCacheFileInfo& a, const CCacheFileInfo& b) { return a.modifiedTime < b.modifiedTime; });
+	for (size_t i = 0; i < files.size() && totalSize > BAKE_CACHE_MAX_TOTAL_BYTES; ++i) {
+		// 保存したばかりのファイルは残す.
+		if (files[i].path == keepFilePath) continue;
+		if (remove(files[i].path.c_str()) == 0) totalSize -= files[i].size;
+	}
+}
+
+/**
+ * ディスクキャッシュに保存.
+ */
+bool CBakeCache::m_saveDiskCache (const uint64_t key, const CBakeResultData& data) const
+{
+	const std::string filePath = m_getDiskCacheFilePath(key);
+	if (filePath == "") return false;
+	if (!createDirectory(m_getDiskCacheDirectory())) return false;
+
+	try {
+		// 書き込み途中のファイルが読み込まれないように、一時ファイルに書き込んでから名前を変更する.
+		const std::string tempFilePath = filePath + std::string(".tmp");
+		{
+			std::ofstream ofs(tempFilePath.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+			if (!ofs) return false;
+
+			ofs.write(BAKE_CACHE_SIGNATURE, sizeof(BAKE_CACHE_SIGNATURE));
+			writeInt(ofs, BAKE_CACHE_VERSION);
+			writeUInt64(ofs, key);
+
+			writeInt(ofs, data.bakeResult);
+			writeInt(ofs, (int)data.alphaModeType);
+			writeFloat(ofs, data.alphaCutoff);
+			writeFloat(ofs, data.transparency);
+			writeFloat(ofs, data.normalStrength);
+			writeInt(ofs, data.diffuseAlphaTrans ? 1 : 0);
+			writeInt(ofs, data.useOcclusionInMetallicRoughnessTexture ? 1 : 0);
+			writeColor(ofs, data.metallicFactor);
+			writeColor(ofs, data.roughnessFactor);
+
+			writeBakedImage(ofs, data.baseColor);
+			writeBakedImage(ofs, data.transmission);
+			writeBakedImage(ofs, data.normal);
+			writeBakedImage(ofs, data.emissive);
+			writeBakedImage(ofs, data.metallicRoughness);
+			writeBakedImage(ofs, data.occlusion);
+
+			if (!ofs.good()) {
+				ofs.close();
+				remove(tempFilePath.c_str());
+				return false;
+			}
+		}
+		remove(filePath.c_str());
+		return (rename(tempFilePath.c_str(), filePath.c_str()) == 0);
+
+	} catch (...) { }
+	return false;
+}
+
+/**
+ * ディスクキャッシュから読み込み.
+ */
+bool CBakeCache::m_loadDiskCache (const uint64_t key, CBakeResultData& data) const
+{
+	data.clear();
+	const std::string filePath = m_getDiskCacheFilePath(key);
+	if (filePath == "") return false;
+
+	try {
+		std::ifstream ifs(filePath.c_str(), std::ios::in | std::ios::binary);
+		if (!ifs) return false;
+
+		char signature[8];
+		ifs.read(signature, sizeof(signature));
+		if (!ifs.good() || memcmp(signature, BAKE_CACHE_SIGNATURE, sizeof(signature)) != 0) return false;
+
+		int version = 0;
+		uint64_t key2 = 0;
+		if (!readInt(ifs, version) || version != BAKE_CACHE_VERSION) return false;
+		if (!readUInt64(ifs, key2) || key2 != key) return false;
+
+		int iDat = 0;
+		if (!readInt(ifs, data.bakeResult)) return false;
+		if (!readInt(ifs, iDat)) return false;
+		data.alphaModeType = (GLTFConverter::alpha_mode_type)iDat;
+		if (!readFloat(ifs, data.alphaCutoff)) return false;
+		if (!readFloat(ifs, data.transparency)) return false;
+		if (!readFloat(ifs, data.normalStrength)) return false;
+		if (!readInt(ifs, iDat)) return false;
+		data.diffuseAlphaTrans = iDat ? true : false;
+		if (!readInt(ifs, iDat)) return false;
+		data.useOcclusionInMetallicRoughnessTexture = iDat ? true : false;
+		if (!readColor(ifs, data.metallicFactor)) return false;
+		if (!readColor(ifs, data.roughnessFactor)) return false;
+
+		if (!readBakedImage(ifs, data.baseColor)) return false;
+		if (!readBakedImage(ifs, data.transmission)) return false;
+		if (!readBakedImage(ifs, data.normal)) return false;
+		if (!readBakedImage(ifs, data.emissive)) return false;
+		if (!readBakedImage(ifs, data.metallicRoughness)) return false;
+		if (!readBakedImage(ifs, data.occlusion)) return false;
+		return true;
+
+	} catch (...) { }
+
+	data.clear();
+	return false;
+}
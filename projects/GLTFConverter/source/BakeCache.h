@@ -0,0 +1,168 @@
+﻿/**
+ * テクスチャのベイク結果のキャッシュ.
+ * マッピングレイヤの構成と参照するイメージの内容が同一の表面材質は、ベイクせずに前回の結果を使用する.
+ * エクスポート中はメモリ上に保持し、ディスクキャッシュを使用する場合はテンポラリフォルダに保存してエクスポート間で再利用する.
+ * ディスクキャッシュは合計サイズの上限を超えた場合、最後に使用した日時が古いものから削除する.
+ */
+#ifndef _BAKECACHE_H
+#define _BAKECACHE_H
+
+#include "GlobalHeader.h"
+#include "ImageData.h"
+
+#include <map>
+#include <string>
+#include <stdint.h>
+
+// ベイク処理の内容を変更した場合は、この値を更新して古いキャッシュを無効にすること.
+#define BAKE_CACHE_VERSION  3
+
+/**
+ * ベイクされた1つのイメージの情報.
+ */
+class CBakedImageData
+{
+public:
+	bool hasImage;						// イメージを持つか.
+	std::string name;					// イメージ名.
+	int texCoord;						// UV層番号.
+	sx::vec<int,2> repeat;				// 反復回数.
+	sxsdk::rgb_class factor;			// イメージの強度.
+	CImageData imageData;				// イメージ (RGBA、またはタイル単位でベイクした場合はpng/jpegのバイト列を格納).
+
+	int imageIndex;						// CSceneData::imagesに登録済みの場合のインデックス (エクスポート中のみ有効).
+
+public:
+	CBakedImageData () {
+		clear();
+	}
+
+	void clear () {
+		hasImage  = false;
+		name      = "";
+		texCoord  = 0;
+		repeat    = sx::vec<int,2>(1, 1);
+		factor    = sxsdk::rgb_class(1, 1, 1);
+		imageData.clear();
+		imageIndex = -1;
+	}
+};
+
+/**
+ * 1つの表面材質のベイク結果.
+ */
+class CBakeResultData
+{
+public:
+	int bakeResult;										// ベイクの結果 (CImagesBlend::IMAGE_BAKE_RESULT).
+
+	GLTFConverter::alpha_mode_type alphaModeType;		// AlphaModeの種類.
+	float alphaCutoff;									// AlphaCutoff値.
+	float transparency;									// 透明度.
+	float normalStrength;								// 法線の強さ.
+	bool diffuseAlphaTrans;								// Diffuseのアルファ透明を使用しているか.
+	bool useOcclusionInMetallicRoughnessTexture;		// OcclusionテクスチャをMetallic-Roughnessテクスチャにまとめているか.
+	sxsdk::rgb_class metallicFactor;					// Metallicの強度.
+	sxsdk::rgb_class roughnessFactor;					// Roughnessの強度.
+
+	CBakedImageData baseColor;							// BaseColor.
+	CBakedImageData transmission;						// Transmission.
+	CBakedImageData normal;								// Normal.
+	CBakedImageData emissive;							// Emissive.
+	CBakedImageData metallicRoughness;					// Metallic-Roughness (Occlusion).
+	CBakedImageData occlusion;							// Occlusion.
+
+public:
+	CBakeResultData () {
+		clear();
+	}
+
+	void clear () {
+		bakeResult = 0;
+		alphaModeType  = GLTFConverter::alpha_mode_opaque;
+		alphaCutoff    = 0.5f;
+		transparency   = 0.0f;
+		normalStrength = 1.0f;
+		diffuseAlphaTrans = false;
+		useOcclusionInMetallicRoughnessTexture = false;
+		metallicFactor  = sxsdk::rgb_class(0, 0, 0);
+		roughnessFactor = sxsdk::rgb_class(1, 1, 1);
+
+		baseColor.clear();
+		transmission.clear();
+		normal.clear();
+		emissive.clear();
+		metallicRoughness.clear();
+		occlusion.clear();
+	}
+};
+
+class CBakeCache
+{
+private:
+	std::map<uint64_t, CBakeResultData> m_resultsMap;						// ベイク結果のキー => ベイク結果.
+	std::map<sxsdk::master_image_class*, uint64_t> m_imageHashMap;		// マスターイメージ => イメージのハッシュ値.
+	bool m_useDiskCache;													// ディスクキャッシュを使用するか.
+
+	/**
+	 * ディスクキャッシュのフォルダのパスを取得.
+	 */
+	std::string m_getDiskCacheDirectory () const;
+
+	/**
+	 * ディスクキャッシュのファイルパスを取得.
+	 */
+	std::string m_getDiskCacheFilePath (const uint64_t key) const;
+
+	/**
+	 * ディスクキャッシュの合計サイズが上限を超えている場合は、更新日時が古いファイルから削除.
+	 * @param[in] keepFilePath  削除しないファイル (保存したばかりのファイル).
+	 */
+	void m_trimDiskCache (const std::string& keepFilePath) const;
+
+	/**
+	 * ディスクキャッシュに保存/読み込み.
+	 */
+	bool m_saveDiskCache (const uint64_t key, const CBakeResultData& data) const;
+	bool m_loadDiskCache (const uint64_t key, CBakeResultData& data) const;
+
+public:
+	CBakeCache ();
+	~CBakeCache ();
+
+	/**
+	 * メモリ上のキャッシュをクリア.
+	 */
+	void clear ();
+
+	/**
+	 * ディスクキャッシュを使用するか指定.
+	 */
+	void setUseDiskCache (const bool useDiskCache) { m_useDiskCache = useDiskCache; }
+	bool getUseDiskCache () const { return m_useDiskCache; }
+
+	/**
+	 * イメージの内容のハッシュ値を取得 (サイズとマスターイメージ名を含む).
+	 * マスターイメージが参照されている場合は、エクスポート中は計算結果を再利用する.
+	 * @param[in] scene  シーンクラス.
+	 * @param[in] image  イメージ.
+	 */
+	uint64_t getImageHash (sxsdk::scene_interface* scene, sxsdk::image_interface* image);
+
+	/**
+	 * ベイク結果を検索 (メモリ上になくディスクキャッシュにある場合は、読み込んでメモリ上に保持).
+	 * @param[in] key  ベイク結果のキー (CImagesBlend::calcBakeKeyで計算).
+	 * @return ベイク結果. 存在しない場合はNULL.
+	 */
+	CBakeResultData* find (const uint64_t key);
+
+	/**
+	 * ベイク結果を追加 (ディスクキャッシュを使用する場合は保存も行う).
+	 * @param[in] key   ベイク結果のキー.
+	 * @param[in] data  ベイク結果.
+	 * @return 格納したベイク結果.
+	 */
+	CBakeResultData* add (const uint64_t key, CBakeResultData&& data);
+};
+
+#endif
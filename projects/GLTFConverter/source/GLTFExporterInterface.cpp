@@ -8,12 +8,20 @@
 #include "Shade3DUtil.h"
 #include "StreamCtrl.h"
 #include "StringUtil.h"
+#include "HashUtil.h"
 #include "ImagesBlend.h"
 #include "MotionExternalAccess.h"
 #include "DOKIMaterialParam.h"
+#include "MeshOptimizer.h"
+#include "ThreadPool.h"
 
 #include <iostream>
 #include <map>
+#include <algorithm>
+#include <utility>
+#include <sstream>
+#include <iomanip>
+#include <functional>
 
 enum
 {
@@ -28,6 +36,9 @@ enum
 
 	dlg_output_bake_without_processing_textures_id = 501,	// テクスチャを加工せずにベイク.
 	dlg_output_separate_opacity_and_transmission_id = 502,	// 「不透明(Opacity)」と「透明(Transmission)」を分ける.
+	dlg_output_bake_disk_cache_id = 503,					// ベイク結果をディスクにキャッシュ.
+	dlg_output_bake_streaming_id = 504,						// テクスチャをタイル単位でベイク.
+	dlg_output_bake_memory_budget_id = 505,					// タイル単位でのベイクで使用するメモリの上限 (MB).
 
 	dlg_asset_title_id = 201,				// タイトル.
 	dlg_asset_author_id = 202,				// 制作者.
@@ -41,6 +52,18 @@ enum
 	dlg_output_textures_id = 401,					// エンジン別にテクスチャを別途出力.
 	dlg_output_textures_engine_type_id = 402,		// エンジンの種類.
 
+	dlg_png_compression_level_id = 601,		// pngの圧縮レベル.
+	dlg_jpeg_quality_id = 602,				// jpegの品質.
+
+	dlg_static_batching_id = 701,				// 静的なメッシュをマテリアルごとにまとめる.
+	dlg_static_batching_max_vertices_id = 702,	// まとめたメッシュの最大頂点数.
+	dlg_flatten_hierarchy_id = 703,				// 静的なノード階層を平坦化.
+
+	dlg_generate_lods_id = 801,					// LODを作成 (MSFT_lod).
+	dlg_lod_ratio_1_id = 802,					// LOD1の三角形数の割合 (%).
+	dlg_lod_ratio_2_id = 803,					// LOD2の三角形数の割合 (%).
+	dlg_lod_ratio_3_id = 804,					// LOD3の三角形数の割合 (%).
+
 };
 
 CGLTFExporterInterface::CGLTFExporterInterface (sxsdk::shade_interface& shade) : shade(shade)
@@ -97,6 +120,8 @@ void CGLTFExporterInterface::do_export (sxsdk::plugin_exporter_interface *plugin
 	m_currentDepth = 0;
 	m_sceneData.reset(new CSceneData());
 	m_warningCheck.clear();
+	m_bakeCache.clear();
+	m_bakeCache.setUseDiskCache(m_exportParam.useBakeDiskCache);
 
 	compointer<sxsdk::scene_interface> scene(shade.get_scene_interface());
 	try {
@@ -186,6 +211,9 @@ void CGLTFExporterInterface::clean_up (void *)
 {
 	if (!m_sceneData || (m_sceneData->filePath) == "") return;
 
+	// マテリアルの格納は完了しているため、ベイク結果のキャッシュは解放.
+	m_bakeCache.clear();
+
 	// ポリゴンメッシュのスキン情報より、スキン情報を格納.
 	m_setSkinsFromMeshes();
 
@@ -197,6 +225,36 @@ void CGLTFExporterInterface::clean_up (void *)
 		m_setAnimations();
 	}
 
+	// 静的なメッシュをマテリアルごとにまとめる.
+	if (m_exportParam.staticBatching) {
+		m_sceneData->batchStaticMeshes(m_exportParam.staticBatchingMaxVertices);
+	}
+
+	// 変換のみを持つ静的なノードを削除し、ノード階層を浅くする.
+	if (m_exportParam.flattenHierarchy) {
+		m_sceneData->flattenHierarchy();
+	}
+
+	// 内容が同一のメッシュ（複製された形状など）は、1つのメッシュを複数のノードで共有する.
+	m_sceneData->shareSameMeshes();
+
+	// 三角形数を削減したLODを作成 (MSFT_lod).
+	if (m_exportParam.generateLODs) {
+		std::vector<float> ratios;
+		for (int i = 0; i < 3; ++i) {
+			if (m_exportParam.lodRatios[i] > 0 && m_exportParam.lodRatios[i] < 100) ratios.push_back((float)m_exportParam.lodRatios[i] / 100.0f);
+		}
+		std::sort(ratios.begin(), ratios.end(), std::greater<float>());
+		ratios.erase(std::unique(ratios.begin(), ratios.end()), ratios.end());
+		m_sceneData->generateLODs(ratios);
+	}
+
+	// 法線マップを持つマテリアルの場合は、接線を計算して格納.
+	m_sceneData->generateTangents();
+
+	// 三角形と頂点の並びを、GPUの頂点キャッシュ向けに最適化.
+	m_optimizeMeshesVertexOrder();
+
 	// 警告のメッセージがある場合は表示.
 	m_warningCheck.outputWarningMessage(shade);
 
@@ -722,29 +780,7 @@ void CGLTFExporterInterface::end_polymesh (void *)
 
 	// 面積ゼロの面がある場合はカットしていく.
 	if (m_tempZeroMeshCount > 0) {
-		const int iCou = (int)m_currentMeshFaceUseList.size();
-		int iPos = (iCou - 1) * 3;
-		for (int i = iCou - 1; i >= 0; --i, iPos -= 3) {
-			if (!m_currentMeshFaceUseList[i]) {
-				for (int j = 2; j >= 0; --j) m_meshData.triangleIndices.erase(m_meshData.triangleIndices.begin() + iPos + j);
-				if (!m_meshData.triangleNormals.empty()) {
-					for (int j = 2; j >= 0; --j) m_meshData.triangleNormals.erase(m_meshData.triangleNormals.begin() + iPos + j);
-				}
-				if (!m_meshData.triangleUV0.empty()) {
-					for (int j = 2; j >= 0; --j) m_meshData.triangleUV0.erase(m_meshData.triangleUV0.begin() + iPos + j);
-				}
-				if (!m_meshData.triangleUV1.empty()) {
-					for (int j = 2; j >= 0; --j) m_meshData.triangleUV1.erase(m_meshData.triangleUV1.begin() + iPos + j);
-				}
-				if (!m_meshData.triangleColor0.empty()) {
-					for (int j = 2; j >= 0; --j) m_meshData.triangleColor0.erase(m_meshData.triangleColor0.begin() + iPos + j);
-				}
-				
-				if (!m_meshData.triangleFaceGroupIndex.empty()) {
-					m_meshData.triangleFaceGroupIndex.erase(m_meshData.triangleFaceGroupIndex.begin() + i);
-				}
-			}
-		}
+		m_meshData.removeTriangles(m_currentMeshFaceUseList);
 	}
 
 	m_meshData.optimize();
@@ -760,7 +796,7 @@ void CGLTFExporterInterface::end_polymesh (void *)
 			CMeshData& meshD = m_sceneData->getMeshData(meshIndex);
 			meshD.name        = m_meshData.name;
 			meshD.pMeshHandle = m_pCurrentShape->get_handle();
-			meshD.primitives.push_back(CPrimitiveData());
+			meshD.primitives.emplace_back();
 			CPrimitiveData& primitiveD = m_sceneData->getMeshData(meshIndex).primitives[0];
 			primitiveD.convert(m_meshData);
 
@@ -827,7 +863,7 @@ void CGLTFExporterInterface::m_setMorphTargets (sxsdk::shape_class* shape)
 	std::vector<sxsdk::vec3> vertices;
 	for (int i = 0; i < targetsCou; ++i) {
 		m_MorphTargetsAccess->getTargetName(i, szName);
-		m_meshData.morphTargets.morphTargetsData.push_back(COneMorphTargetData());
+		m_meshData.morphTargets.morphTargetsData.emplace_back();
 		COneMorphTargetData& dstMorphTargetD = m_meshData.morphTargets.morphTargetsData.back();
 		dstMorphTargetD.name = std::string(szName);
 		const int vCou = m_MorphTargetsAccess->getTargetVerticesCount(i);
@@ -868,6 +904,7 @@ void CGLTFExporterInterface::m_storeMeshesWithFaceGroup ()
 	CMeshData& meshD = m_sceneData->getMeshData(meshIndex);
 	meshD.name        = m_meshData.name;
 	meshD.pMeshHandle = m_pCurrentShape->get_handle();
+	meshD.primitives.reserve(primitivesCou);
 
 	for (int i = 0; i < primitivesCou; ++i) {
 		CPrimitiveData& primitiveD = primitivesDataList[i];
@@ -880,7 +917,7 @@ void CGLTFExporterInterface::m_storeMeshesWithFaceGroup ()
 			}
 		}
 
-		meshD.primitives.push_back(primitiveD);
+		meshD.primitives.push_back(std::move(primitiveD));
 	}
 
 	const int curNodeIndex = m_sceneData->getCurrentNodeIndex();
@@ -1051,6 +1088,22 @@ void CGLTFExporterInterface::load_dialog_data (sxsdk::dialog_interface &d,void *
 		item = &(d.get_dialog_item(dlg_output_separate_opacity_and_transmission_id));
 		item->set_bool(m_exportParam.separateOpacityAndTransmission);
 	}
+	{
+		sxsdk::dialog_item_class* item;
+		item = &(d.get_dialog_item(dlg_output_bake_disk_cache_id));
+		item->set_bool(m_exportParam.useBakeDiskCache);
+	}
+	{
+		sxsdk::dialog_item_class* item;
+		item = &(d.get_dialog_item(dlg_output_bake_streaming_id));
+		item->set_bool(m_exportParam.bakeStreaming);
+	}
+	{
+		sxsdk::dialog_item_class* item;
+		item = &(d.get_dialog_item(dlg_output_bake_memory_budget_id));
+		item->set_int(m_exportParam.bakeMemoryBudget);
+		item->set_enabled(m_exportParam.bakeStreaming);
+	}
 
 	{
 		sxsdk::dialog_item_class* item;
@@ -1107,6 +1160,46 @@ void CGLTFExporterInterface::load_dialog_data (sxsdk::dialog_interface &d,void *
 		item->set_selection((int)m_exportParam.engineType);
 		item->set_enabled(m_exportParam.outputAdditionalTextures);
 	}
+
+	{
+		sxsdk::dialog_item_class* item;
+		item = &(d.get_dialog_item(dlg_png_compression_level_id));
+		item->set_selection(m_exportParam.pngCompressionLevel);
+	}
+	{
+		sxsdk::dialog_item_class* item;
+		item = &(d.get_dialog_item(dlg_jpeg_quality_id));
+		item->set_int(m_exportParam.jpegQuality);
+	}
+
+	{
+		sxsdk::dialog_item_class* item;
+		item = &(d.get_dialog_item(dlg_static_batching_id));
+		item->set_bool(m_exportParam.staticBatching);
+	}
+	{
+		sxsdk::dialog_item_class* item;
+		item = &(d.get_dialog_item(dlg_static_batching_max_vertices_id));
+		item->set_int(m_exportParam.staticBatchingMaxVertices);
+		item->set_enabled(m_exportParam.staticBatching);
+	}
+	{
+		sxsdk::dialog_item_class* item;
+		item = &(d.get_dialog_item(dlg_flatten_hierarchy_id));
+		item->set_bool(m_exportParam.flattenHierarchy);
+	}
+
+	{
+		sxsdk::dialog_item_class* item;
+		item = &(d.get_dialog_item(dlg_generate_lods_id));
+		item->set_bool(m_exportParam.generateLODs);
+	}
+	for (int i = 0; i < 3; ++i) {
+		sxsdk::dialog_item_class* item;
+		item = &(d.get_dialog_item(dlg_lod_ratio_1_id + i));
+		item->set_int(m_exportParam.lodRatios[i]);
+		item->set_enabled(m_exportParam.generateLODs);
+	}
 }
 
 void CGLTFExporterInterface::save_dialog_data (sxsdk::dialog_interface &dialog,void *)
@@ -1174,6 +1267,20 @@ bool CGLTFExporterInterface::respond (sxsdk::dialog_interface &dialog, sxsdk::di
 		m_exportParam.separateOpacityAndTransmission = item.get_bool();
 		return true;
 	}
+	if (id == dlg_output_bake_disk_cache_id) {
+		m_exportParam.useBakeDiskCache = item.get_bool();
+		return true;
+	}
+	if (id == dlg_output_bake_streaming_id) {
+		m_exportParam.bakeStreaming = item.get_bool();
+		load_dialog_data(dialog);
+		return true;
+	}
+	if (id == dlg_output_bake_memory_budget_id) {
+		m_exportParam.bakeMemoryBudget = std::max(item.get_int(), 16);
+		load_dialog_data(dialog);
+		return true;
+	}
 
 	if (id == dlg_asset_title_id) {
 		m_exportParam.assetExtrasTitle = item.get_string();
@@ -1215,12 +1322,74 @@ bool CGLTFExporterInterface::respond (sxsdk::dialog_interface &dialog, sxsdk::di
 		return true;
 	}
 
+	if (id == dlg_png_compression_level_id) {
+		m_exportParam.pngCompressionLevel = item.get_selection();
+		return true;
+	}
+	if (id == dlg_jpeg_quality_id) {
+		m_exportParam.jpegQuality = std::min(std::max(item.get_int(), 1), 100);
+		load_dialog_data(dialog);
+		return true;
+	}
+
+	if (id == dlg_static_batching_id) {
+		m_exportParam.staticBatching = item.get_bool();
+		load_dialog_data(dialog);
+		return true;
+	}
+	if (id == dlg_static_batching_max_vertices_id) {
+		m_exportParam.staticBatchingMaxVertices = std::max(item.get_int(), 3);
+		load_dialog_data(dialog);
+		return true;
+	}
+	if (id == dlg_flatten_hierarchy_id) {
+		m_exportParam.flattenHierarchy = item.get_bool();
+		return true;
+	}
+
+	if (id == dlg_generate_lods_id) {
+		m_exportParam.generateLODs = item.get_bool();
+		load_dialog_data(dialog);
+		return true;
+	}
+	if (id == dlg_lod_ratio_1_id || id == dlg_lod_ratio_2_id || id == dlg_lod_ratio_3_id) {
+		m_exportParam.lodRatios[id - dlg_lod_ratio_1_id] = std::min(std::max(item.get_int(), 0), 99);
+		load_dialog_data(dialog);
+		return true;
+	}
+
 	return false;
 }
 
 
 /***********************************************************************/
 
+/**
+ * ベイクしたイメージをCSceneData::imagesに登録.
+ * 登録済みの場合(同一構成の表面材質)は、そのインデックスを返す.
+ */
+int CGLTFExporterInterface::m_addBakedImage (CBakedImageData& bakedImage, const std::string& imageName, const bool useImageSource, const std::string& materialName, const int imageMask)
+{
+	if (bakedImage.imageIndex >= 0) return bakedImage.imageIndex;
+
+	// RGBAはキャッシュには残さずに、CSceneData::imagesに移す.
+	CImageData imageData(std::move(bakedImage.imageData));
+	bakedImage.imageData.clear();
+	imageData.name = imageName;
+	if (useImageSource) m_setImageSourceData(imageData.name, imageData);
+	imageData.name = m_sceneData->getUniqueImageName(imageData.name);
+	imageData.materialName = materialName;
+	imageData.imageMask    = imageMask;
+
+	int imageIndex = m_sceneData->findSameImage(imageData);
+	if (imageIndex < 0) {
+		imageIndex = (int)m_sceneData->images.size();
+		m_sceneData->images.push_back(std::move(imageData));
+	}
+	bakedImage.imageIndex = imageIndex;
+	return imageIndex;
+}
+
 /**
  * Shade3Dのsurface情報をマテリアルとして格納.
  */
@@ -1232,14 +1401,34 @@ bool CGLTFExporterInterface::m_setMaterialData (sxsdk::surface_class* surface, C
 	materialData.name = m_sceneData->getUniqueMaterialName(smName);
 
 	// diffuse/reflection/roughness/glow/normalのイメージをあらかじめ合成する.
-	CImagesBlend imagesBlend(m_pScene, surface);
-	CImagesBlend::IMAGE_BAKE_RESULT blendResult = imagesBlend.blendImages(m_exportParam);		// 複数のマッピングレイヤのイメージを合成.
+	// 同一構成の表面材質がすでにベイク済みの場合は、キャッシュされた結果を使用.
+	// キーを計算できない場合は、キャッシュを使用せずにベイクする.
+	CBakeResultData* pBakeD = NULL;
+	CBakeResultData uncachedBakeD;
+	{
+		CImagesBlend imagesBlend(m_pScene, surface);
+		uint64_t bakeKey = 0;
+		const bool useCache = imagesBlend.calcBakeKey(m_exportParam, m_bakeCache, bakeKey);
+		if (useCache) pBakeD = m_bakeCache.find(bakeKey);
+		if (!pBakeD) {
+			CBakeResultData bakeD;
+			const CImagesBlend::IMAGE_BAKE_RESULT blendResult = imagesBlend.blendImages(m_exportParam);		// 複数のマッピングレイヤのイメージを合成.
+			imagesBlend.getBakeResult(blendResult, bakeD);
+			if (useCache) {
+				pBakeD = m_bakeCache.add(bakeKey, std::move(bakeD));
+			} else {
+				uncachedBakeD = std::move(bakeD);
+				pBakeD = &uncachedBakeD;
+			}
+		}
+	}
+	CBakeResultData& bakeD = *pBakeD;
 
-	if (blendResult == CImagesBlend::bake_error_mixed_uv_layer) {
+	if (bakeD.bakeResult == CImagesBlend::bake_error_mixed_uv_layer) {
 		const std::string str = std::string("[") + smName + std::string("] ") + std::string(m_pScene->gettext("bake_msg_error_mixed_uv_layer"));
 		m_pScene->message(str);
 	}
-	if (blendResult == CImagesBlend::bake_mixed_repeat) {
+	if (bakeD.bakeResult == CImagesBlend::bake_mixed_repeat) {
 		const std::string str = std::string("[") + smName + std::string("] ") + std::string(m_pScene->gettext("bake_msg_mixed_repeat"));
 		m_pScene->message(str);
 	}
@@ -1251,13 +1440,13 @@ bool CGLTFExporterInterface::m_setMaterialData (sxsdk::surface_class* surface, C
 	materialData.baseColorOpacity = 1.0f;
 	materialData.unlit           = false;
 
-	switch (imagesBlend.getAlphaModeType()) {
+	switch (bakeD.alphaModeType) {
 	case GLTFConverter::alpha_mode_opaque:
 		materialData.alphaMode = 1;
 		break;
 	case GLTFConverter::alpha_mode_mask:
 		materialData.alphaMode = 3;
-		materialData.alphaCutOff = imagesBlend.getAlphaCutoff();
+		materialData.alphaCutOff = bakeD.alphaCutoff;
 		break;
 	case GLTFConverter::alpha_mode_blend:
 		materialData.alphaMode = 2;
@@ -1301,36 +1490,21 @@ bool CGLTFExporterInterface::m_setMaterialData (sxsdk::surface_class* surface, C
 	// 不透明度テクスチャや透明度テクスチャが存在する場合は、baseColorTextureのAlpha要素に格納される.
 	//----------------------------------------------------.
 	{
-		const sxsdk::enums::mapping_type iType = sxsdk::enums::diffuse_mapping;
-		const sxsdk::rgb_class factor = imagesBlend.getImageFactor(iType);
-		if (imagesBlend.hasImage(iType)) {
-			materialData.baseColorFactor = factor;
+		CBakedImageData& bakedImage = bakeD.baseColor;
+		materialData.baseColorFactor = bakedImage.factor;
 
-			// 色をリニアにする.
-			if (m_exportParam.convertColorToLinear) {
-				MathUtil::convColorLinear(materialData.baseColorFactor.red, materialData.baseColorFactor.green, materialData.baseColorFactor.blue);
-			}
-
-			const bool useAlphaTrans = imagesBlend.getDiffuseAlphaTrans();		// DiffuseでAlpha成分に不透明度を使用している場合.
-
-			const sx::vec<int,2> repeatV = imagesBlend.getImageRepeat(iType);
-			materialData.baseColorTexScale = sxsdk::vec2(repeatV.x, repeatV.y);
-			materialData.baseColorTexCoord = imagesBlend.getTexCoord(iType);
+		// 色をリニアにする.
+		if (m_exportParam.convertColorToLinear) {
+			MathUtil::convColorLinear(materialData.baseColorFactor.red, materialData.baseColorFactor.green, materialData.baseColorFactor.blue);
+		}
 
-			sxsdk::image_interface* image = imagesBlend.getImage(iType);
-			CImageData imageData;
-			imageData.setCustomImage(image);
-			imageData.name = imagesBlend.getImageName(iType);
-			imageData.name = m_sceneData->getUniqueImageName(imageData.name);
-			imageData.materialName = materialData.name;
-			imageData.imageMask    = CImageData::gltf_image_mask_base_color;
+		if (bakedImage.hasImage) {
+			const bool useAlphaTrans = bakeD.diffuseAlphaTrans;		// DiffuseでAlpha成分に不透明度を使用している場合.
 
-			int imageIndex = m_sceneData->findSameImage(imageData);
-			if (imageIndex < 0) {
-				imageIndex = (int)m_sceneData->images.size();
-				m_sceneData->images.push_back(imageData);
-			}
+			materialData.baseColorTexScale = sxsdk::vec2(bakedImage.repeat.x, bakedImage.repeat.y);
+			materialData.baseColorTexCoord = bakedImage.texCoord;
 
+			const int imageIndex = m_addBakedImage(bakedImage, bakedImage.name, true, materialData.name, CImageData::gltf_image_mask_base_color);
 			if (imageIndex >= 0) {
 				materialData.baseColorImageIndex = imageIndex;
 
@@ -1342,13 +1516,6 @@ bool CGLTFExporterInterface::m_setMaterialData (sxsdk::surface_class* surface, C
 					}
 				}
 			}
-		} else {
-			materialData.baseColorFactor = factor;
-
-			// 色をリニアにする.
-			if (m_exportParam.convertColorToLinear) {
-				MathUtil::convColorLinear(materialData.baseColorFactor.red, materialData.baseColorFactor.green, materialData.baseColorFactor.blue);
-			}
 		}
 	}
 
@@ -1356,7 +1523,7 @@ bool CGLTFExporterInterface::m_setMaterialData (sxsdk::surface_class* surface, C
 	// 透明度を持つ場合.
 	//----------------------------------------------------.
 	if (!m_exportParam.separateOpacityAndTransmission) {
-		const float transparencyV = imagesBlend.getTransparency();
+		const float transparencyV = bakeD.transparency;
 		if (transparencyV > 0.01f) {
 			if (materialData.alphaMode == 1) {			// OPAQUEの場合.
 				materialData.alphaMode = 2;				// BLENDモードにする.
@@ -1366,30 +1533,14 @@ bool CGLTFExporterInterface::m_setMaterialData (sxsdk::surface_class* surface, C
 	} else {
 		// 「不透明(Opacity)」と「透明(Transmission)」を分ける場合.
 		materialData.baseColorOpacity = 1.0f;		// baseColorのAlpha値は1.0 固定.
-		materialData.transmissionFactor = imagesBlend.getTransparency();
+		materialData.transmissionFactor = bakeD.transparency;
 
 		if (materialData.transmissionFactor > 0.0f) {
-			const sxsdk::enums::mapping_type iType = sxsdk::enums::transparency_mapping;
-			if (imagesBlend.hasImage(iType)) {
-				sxsdk::image_interface* image = imagesBlend.getImage(iType);
-				CImageData imageData;
-				imageData.setCustomImage(image);
-				imageData.name = imagesBlend.getImageName(iType);
-				imageData.name = m_sceneData->getUniqueImageName(imageData.name);
-				imageData.materialName = materialData.name;
-				imageData.imageMask    = CImageData::gltf_image_mask_none;
-
-				int imageIndex = m_sceneData->findSameImage(imageData);
-				if (imageIndex < 0) {
-					imageIndex = (int)m_sceneData->images.size();
-					m_sceneData->images.push_back(imageData);
-				}
-				materialData.transmissionTextureIndex = imageIndex;
-
-				materialData.transmissionTexCoord = imagesBlend.getTexCoord(iType);
-
-				const sx::vec<int,2> repeatV = imagesBlend.getImageRepeat(iType);
-				materialData.transmissionTexScale = sxsdk::vec2(repeatV.x, repeatV.y);
+			CBakedImageData& bakedImage = bakeD.transmission;
+			if (bakedImage.hasImage) {
+				materialData.transmissionTextureIndex = m_addBakedImage(bakedImage, bakedImage.name, true, materialData.name, CImageData::gltf_image_mask_none);
+				materialData.transmissionTexCoord = bakedImage.texCoord;
+				materialData.transmissionTexScale = sxsdk::vec2(bakedImage.repeat.x, bakedImage.repeat.y);
 			}
 		}
 	}
@@ -1398,28 +1549,13 @@ bool CGLTFExporterInterface::m_setMaterialData (sxsdk::surface_class* surface, C
 	// 法線マップを格納.
 	//----------------------------------------------------.
 	{
-		const sxsdk::enums::mapping_type iType = sxsdk::enums::normal_mapping;
-		const sxsdk::rgb_class factor = imagesBlend.getImageFactor(iType);
-		materialData.normalStrength = imagesBlend.getNormalStrength();
-		if (imagesBlend.hasImage(iType)) {
-			const sx::vec<int,2> repeatV = imagesBlend.getImageRepeat(iType);
-			materialData.normalTexScale = sxsdk::vec2(repeatV.x, repeatV.y);
-			materialData.normalTexCoord = imagesBlend.getTexCoord(iType);
-
-			sxsdk::image_interface* image = imagesBlend.getImage(iType);
-			CImageData imageData;
-			imageData.setCustomImage(image);
-			imageData.name = imagesBlend.getImageName(iType);
-			imageData.name = m_sceneData->getUniqueImageName(imageData.name);
-			imageData.materialName = materialData.name;
-			imageData.imageMask    = CImageData::gltf_image_mask_normal;
-
-			int imageIndex = m_sceneData->findSameImage(imageData);
-			if (imageIndex < 0) {
-				imageIndex = (int)m_sceneData->images.size();
-				m_sceneData->images.push_back(imageData);
-			}
+		CBakedImageData& bakedImage = bakeD.normal;
+		materialData.normalStrength = bakeD.normalStrength;
+		if (bakedImage.hasImage) {
+			materialData.normalTexScale = sxsdk::vec2(bakedImage.repeat.x, bakedImage.repeat.y);
+			materialData.normalTexCoord = bakedImage.texCoord;
 
+			const int imageIndex = m_addBakedImage(bakedImage, bakedImage.name, true, materialData.name, CImageData::gltf_image_mask_normal);
 			if (imageIndex >= 0) {
 				materialData.normalImageIndex = imageIndex;
 			}
@@ -1430,28 +1566,13 @@ bool CGLTFExporterInterface::m_setMaterialData (sxsdk::surface_class* surface, C
 	// 発光を格納.
 	//----------------------------------------------------.
 	{
-		const sxsdk::enums::mapping_type iType = sxsdk::enums::glow_mapping;
-		const sxsdk::rgb_class factor = imagesBlend.getImageFactor(iType);
-		materialData.emissiveFactor = factor;
-		if (imagesBlend.hasImage(iType)) {
-			const sx::vec<int,2> repeatV = imagesBlend.getImageRepeat(iType);
-			materialData.emissiveTexScale = sxsdk::vec2(repeatV.x, repeatV.y);
-			materialData.emissiveTexCoord = imagesBlend.getTexCoord(iType);
-
-			sxsdk::image_interface* image = imagesBlend.getImage(iType);
-			CImageData imageData;
-			imageData.setCustomImage(image);
-			imageData.name = imagesBlend.getImageName(iType);
-			imageData.name = m_sceneData->getUniqueImageName(imageData.name);
-			imageData.materialName = materialData.name;
-			imageData.imageMask    = CImageData::gltf_image_mask_emissive;
-
-			int imageIndex = m_sceneData->findSameImage(imageData);
-			if (imageIndex < 0) {
-				imageIndex = (int)m_sceneData->images.size();
-				m_sceneData->images.push_back(imageData);
-			}
+		CBakedImageData& bakedImage = bakeD.emissive;
+		materialData.emissiveFactor = bakedImage.factor;
+		if (bakedImage.hasImage) {
+			materialData.emissiveTexScale = sxsdk::vec2(bakedImage.repeat.x, bakedImage.repeat.y);
+			materialData.emissiveTexCoord = bakedImage.texCoord;
 
+			const int imageIndex = m_addBakedImage(bakedImage, bakedImage.name, true, materialData.name, CImageData::gltf_image_mask_emissive);
 			if (imageIndex >= 0) {
 				materialData.emissiveImageIndex = imageIndex;
 			}
@@ -1467,44 +1588,30 @@ bool CGLTFExporterInterface::m_setMaterialData (sxsdk::surface_class* surface, C
 	// メタリックとラフネス(オクルージョン)を格納.
 	//----------------------------------------------------.
 	{
-		const sxsdk::rgb_class metallicFactor  = imagesBlend.getImageFactor(sxsdk::enums::reflection_mapping);
-		const sxsdk::rgb_class roughnessFactor = imagesBlend.getImageFactor(sxsdk::enums::roughness_mapping);
-		materialData.metallicFactor  = metallicFactor.red;
-		materialData.roughnessFactor = roughnessFactor.red;
-
-		const sx::vec<int,2> repeatV = imagesBlend.getImageRepeat(sxsdk::enums::reflection_mapping);
-		materialData.metallicRoughnessTexScale = sxsdk::vec2(repeatV.x, repeatV.y);
-		materialData.metallicRoughnessTexCoord = imagesBlend.getTexCoord(sxsdk::enums::reflection_mapping);
-
-		sxsdk::image_interface* metallicRoughnessImg = imagesBlend.getMetallicRoughnessImage();
-		if (metallicRoughnessImg) {
-			CImageData imageData;
-			imageData.setCustomImage(metallicRoughnessImg);
-			imageData.name = smName + std::string("_metallicRoughness");
-			imageData.name = m_sceneData->getUniqueImageName(imageData.name);
-			imageData.materialName = materialData.name;
-			imageData.imageMask    = CImageData::gltf_image_mask_metallic | CImageData::gltf_image_mask_roughness;
-
-			if (imagesBlend.getUseOcclusionInMetallicRoughnessTexture()) {
-				imageData.imageMask |= CImageData::gltf_image_mask_occlusion;
-			}
+		CBakedImageData& bakedImage = bakeD.metallicRoughness;
+		materialData.metallicFactor  = bakeD.metallicFactor.red;
+		materialData.roughnessFactor = bakeD.roughnessFactor.red;
+
+		materialData.metallicRoughnessTexScale = sxsdk::vec2(bakedImage.repeat.x, bakedImage.repeat.y);
+		materialData.metallicRoughnessTexCoord = bakedImage.texCoord;
 
-			int imageIndex = m_sceneData->findSameImage(imageData);
-			if (imageIndex < 0) {
-				imageIndex = (int)m_sceneData->images.size();
-				m_sceneData->images.push_back(imageData);
+		if (bakedImage.hasImage) {
+			int imageMask = CImageData::gltf_image_mask_metallic | CImageData::gltf_image_mask_roughness;
+			if (bakeD.useOcclusionInMetallicRoughnessTexture) {
+				imageMask |= CImageData::gltf_image_mask_occlusion;
 			}
 
+			const int imageIndex = m_addBakedImage(bakedImage, smName + std::string("_metallicRoughness"), false, materialData.name, imageMask);
 			if (imageIndex >= 0) {
 				materialData.metallicRoughnessImageIndex = imageIndex;
 			}
 
 			// OcclusionがmetalliRoughnessテクスチャの[R]に格納される場合.
-			if (imagesBlend.getUseOcclusionInMetallicRoughnessTexture()) {
+			if (bakeD.useOcclusionInMetallicRoughnessTexture) {
 				materialData.occlusionImageIndex = imageIndex;
 				materialData.occlusionTexCoord = materialData.metallicRoughnessTexCoord;
 				materialData.occlusionTexScale = materialData.metallicRoughnessTexScale;
-				materialData.occlusionStrength = imagesBlend.getImageFactor(MAPPING_TYPE_GLTF_OCCLUSION).red;
+				materialData.occlusionStrength = bakeD.occlusion.factor.red;
 			}
 		}
 	}
@@ -1512,30 +1619,14 @@ bool CGLTFExporterInterface::m_setMaterialData (sxsdk::surface_class* surface, C
 	//----------------------------------------------------.
 	// オクルージョンを格納.
 	//----------------------------------------------------.
-	if (!imagesBlend.getUseOcclusionInMetallicRoughnessTexture()) {
-		const sxsdk::enums::mapping_type iType = MAPPING_TYPE_GLTF_OCCLUSION;
-		const sxsdk::rgb_class factor = imagesBlend.getImageFactor(iType);
-
-		sxsdk::image_interface* image = imagesBlend.getImage(iType);
-		if (image) {
-			materialData.occlusionStrength = factor.red;
-			const sx::vec<int,2> repeatV = imagesBlend.getImageRepeat(iType);
-			materialData.occlusionTexScale = sxsdk::vec2(repeatV.x, repeatV.y);
-			materialData.occlusionTexCoord = imagesBlend.getTexCoord(iType);
-
-			CImageData imageData;
-			imageData.setCustomImage(image);
-			imageData.name = imagesBlend.getImageName(iType);
-			imageData.name = m_sceneData->getUniqueImageName(imageData.name);
-			imageData.materialName = materialData.name;
-			imageData.imageMask    = CImageData::gltf_image_mask_occlusion;
-
-			int imageIndex = m_sceneData->findSameImage(imageData);
-			if (imageIndex < 0) {
-				imageIndex = (int)m_sceneData->images.size();
-				m_sceneData->images.push_back(imageData);
-			}
-
+	if (!bakeD.useOcclusionInMetallicRoughnessTexture) {
+		CBakedImageData& bakedImage = bakeD.occlusion;
+		if (bakedImage.hasImage) {
+			materialData.occlusionStrength = bakedImage.factor.red;
+			materialData.occlusionTexScale = sxsdk::vec2(bakedImage.repeat.x, bakedImage.repeat.y);
+			materialData.occlusionTexCoord = bakedImage.texCoord;
+
+			const int imageIndex = m_addBakedImage(bakedImage, bakedImage.name, true, materialData.name, CImageData::gltf_image_mask_occlusion);
 			if (imageIndex >= 0) {
 				materialData.occlusionImageIndex = imageIndex;
 			}
@@ -1571,6 +1662,37 @@ bool CGLTFExporterInterface::m_setMaterialData (sxsdk::master_surface_class* mas
 	return false;
 }
 
+/**
+ * 合成後のイメージがインポート時の元画像と同一の場合、元のjpeg/pngのバイト列を格納.
+ * マスターイメージ名とRGBAのハッシュ値で、加工されていないかを判断する.
+ * @param[in]  masterImageName  参照しているマスターイメージ名.
+ * @param[out] imageData        setCustomImageで格納済みのイメージ情報.
+ */
+bool CGLTFExporterInterface::m_setImageSourceData (const std::string& masterImageName, CImageData& imageData)
+{
+	if (imageData.imageRGBAData.empty()) return false;
+
+	try {
+		sxsdk::shape_class* pMasterImageShape = Shade3DUtil::findMasterImageShape(m_pScene, masterImageName);
+		if (!pMasterImageShape) return false;
+
+		// サイズとハッシュ値のみを読み込んで比較.
+		CImageSourceData sourceD;
+		if (!StreamCtrl::loadImageSourceData(*pMasterImageShape, sourceD, false)) return false;
+		if (sourceD.width != imageData.width || sourceD.height != imageData.height) return false;
+		if (sourceD.pixelsHash != imageData.imageRGBAHash) return false;
+
+		if (!StreamCtrl::loadImageSourceData(*pMasterImageShape, sourceD, true)) return false;
+		if (HashUtil::calcHash64(sourceD.imageDatas) != sourceD.dataHash) return false;
+
+		imageData.mimeType   = sourceD.mimeType;
+		imageData.imageDatas = sourceD.imageDatas;
+		return true;
+
+	} catch (...) { }
+	return false;
+}
+
 /**
  * 指定の形状に割り当てられているマテリアル/イメージを格納.
  * @param[in] shape           対象形状.
@@ -1624,7 +1746,7 @@ int CGLTFExporterInterface::m_setMaterialCurrentShape (sxsdk::shape_class* shape
 		int materialIndex = m_sceneData->findSameMaterial(materialData);
 		if (materialIndex < 0) {
 			materialIndex = (int)m_sceneData->materials.size();
-			m_sceneData->materials.push_back(materialData);
+			m_sceneData->materials.push_back(std::move(materialData));
 		}
 
 		return materialIndex;
@@ -1822,7 +1944,7 @@ void CGLTFExporterInterface::m_setSkinsFromMeshes ()
 
 		skinData.meshIndex  = meshLoop;
 		skinData.skeletonID = skeletonID;
-		m_sceneData->skins.push_back(skinData);
+		m_sceneData->skins.push_back(std::move(skinData));
 
 		// skinで参照しているインデックスに置きかえる.
 		for (size_t primLoop = 0; primLoop < primCou; ++primLoop) {
@@ -1847,6 +1969,33 @@ void CGLTFExporterInterface::m_setSkinsFromMeshes ()
 	}
 }
 
+/**
+ * メッシュの三角形と頂点を、頂点キャッシュと頂点フェッチの効率が良くなるように並び替え.
+ */
+void CGLTFExporterInterface::m_optimizeMeshesVertexOrder ()
+{
+	const int meshesCou = (int)m_sceneData->meshes.size();
+	if (meshesCou == 0) return;
+
+	// メッシュごとに並列に処理.
+	std::vector<CVertexCacheStats> statsList(meshesCou);
+	CThreadPool::getInstance().parallelFor(meshesCou, [&](const int meshIndex) {
+		try {
+			MeshOptimizer::optimizeMeshVertexOrder(m_sceneData->meshes[meshIndex], statsList[meshIndex]);
+		} catch (...) { }
+	});
+
+	CVertexCacheStats stats;
+	for (int i = 0; i < meshesCou; ++i) stats.add(statsList[i]);
+	if (stats.trianglesCount == 0) return;
+
+	std::stringstream ss;
+	ss << std::fixed << std::setprecision(3);
+	ss << "Vertex cache optimization : ACMR " << stats.getACMRBefore() << " => " << stats.getACMRAfter();
+	ss << " / ATVR " << stats.getATVRBefore() << " => " << stats.getATVRAfter();
+	shade.message(ss.str());
+}
+
 /**
  * ボーンよりアニメーション情報を格納.
  */
@@ -1937,11 +2086,11 @@ void CGLTFExporterInterface::m_setAnimations ()
 
 			// 移動(offset)/回転要素をキーフレームとして格納.
 			const int transI = (int)m_sceneData->animations.channelData.size();
-			m_sceneData->animations.channelData.push_back(CAnimChannelData());
-			m_sceneData->animations.samplerData.push_back(CAnimSamplerData());
+			m_sceneData->animations.channelData.emplace_back();
+			m_sceneData->animations.samplerData.emplace_back();
 			const int rotationI = (int)m_sceneData->animations.channelData.size();
-			m_sceneData->animations.channelData.push_back(CAnimChannelData());
-			m_sceneData->animations.samplerData.push_back(CAnimSamplerData());
+			m_sceneData->animations.channelData.emplace_back();
+			m_sceneData->animations.samplerData.emplace_back();
 
 			CAnimChannelData& transChannelD    = m_sceneData->animations.channelData[transI];
 			CAnimSamplerData& transSamplerD    = m_sceneData->animations.samplerData[transI];
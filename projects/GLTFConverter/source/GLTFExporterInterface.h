@@ -11,6 +11,7 @@
 #include "MaterialData.h"
 #include "ImageData.h"
 #include "WarningCheck.h"
+#include "BakeCache.h"
 
 #include <string>
 #include <vector>
@@ -48,6 +49,7 @@ private:
 	bool m_isCurrentNurbs;						// カレント形状がNURBSの場合.
 
 	std::shared_ptr<CSceneData> m_sceneData;	// シーン情報の格納用.
+	CBakeCache m_bakeCache;						// テクスチャのベイク結果のキャッシュ.
 
 	CTempMeshData m_meshData;					// 1つのメッシュ情報の一時的な格納用.
 
@@ -263,6 +265,24 @@ private:
 	bool m_setMaterialData (sxsdk::surface_class* surface, CMaterialData& materialData, const std::string& smName);
 	bool m_setMaterialData (sxsdk::master_surface_class* master_surface, CMaterialData& materialData, const std::string& smName);
 
+	/**
+	 * 合成後のイメージがインポート時の元画像と同一の場合、元のjpeg/pngのバイト列を格納.
+	 * @param[in]  masterImageName  参照しているマスターイメージ名.
+	 * @param[out] imageData        setCustomImageで格納済みのイメージ情報.
+	 */
+	bool m_setImageSourceData (const std::string& masterImageName, CImageData& imageData);
+
+	/**
+	 * ベイクしたイメージをCSceneData::imagesに登録.
+	 * @param[in,out] bakedImage      ベイクしたイメージ (登録後はRGBAを解放し、インデックスを保持).
+	 * @param[in]     imageName       イメージ名.
+	 * @param[in]     useImageSource  インポート時の元画像と同一の場合に、元のバイト列を格納するか.
+	 * @param[in]     materialName    マテリアル名.
+	 * @param[in]     imageMask       イメージの用途 (CImageData::gltf_image_mask_xxx).
+	 * @return イメージ番号.
+	 */
+	int m_addBakedImage (CBakedImageData& bakedImage, const std::string& imageName, const bool useImageSource, const std::string& materialName, const int imageMask);
+
 	/**
 	 * 指定の形状に割り当てられているマテリアル/イメージを格納.
 	 * @param[in] shape           対象形状.
@@ -296,6 +316,12 @@ private:
 	 */
 	void m_setAnimations ();
 
+	/**
+	 * メッシュの三角形と頂点を、頂点キャッシュと頂点フェッチの効率が良くなるように並び替え.
+	 * 並び替え前後のACMR/ATVRをメッセージに出力する.
+	 */
+	void m_optimizeMeshesVertexOrder ();
+
 	/**
 	 * 形状のハンドルに対応するノード番号を取得.
 	 */
@@ -8,6 +8,7 @@
 #include "MathUtil.h"
 #include "StreamCtrl.h"
 #include "StringUtil.h"
+#include "HashUtil.h"
 #include "MotionExternalAccess.h"
 
 enum
@@ -15,6 +16,7 @@ enum
 	dlg_gamma_id = 101,							// ガンマ値.
 	dlg_import_animation_id = 102,				// アニメーションの読み込み.
 	dlg_convert_color_from_linear = 103,		// 色をリニアから変換.
+	dlg_keep_image_source_id = 104,				// 元の画像ファイルを保持.
 	dlg_mesh_import_normals_id = 201,			// 法線の読み込み.
 	dlg_mesh_angle_threshold_id = 202,			// 限界角度.
 	dlg_mesh_import_vertex_color_id = 203,		// 頂点カラーの読み込み.
@@ -26,6 +28,40 @@ namespace {
 	CImportDlgParam g_importParam;			// インポート時のパラメータ.
 }
 
+/**
+ * m_meshInstancePlanから、Shade3Dのシーンに形状を生成する.
+ * Shade3Dではリンクを使用せず、同じメッシュを参照するノードはマージ済みのメッシュ情報からそれぞれポリゴンメッシュを生成する.
+ */
+class CGLTFImporterInterface::CShadeMeshInstanceHost : public MeshInstancing::CMeshInstanceHost
+{
+private:
+	CGLTFImporterInterface* m_pImporter;
+	sxsdk::scene_interface* m_pScene;
+	CSceneData* m_pSceneData;
+
+public:
+	CShadeMeshInstanceHost (CGLTFImporterInterface* importer, sxsdk::scene_interface* scene, CSceneData* sceneData) : m_pImporter(importer), m_pScene(scene), m_pSceneData(sceneData) { }
+
+	virtual bool mergeMesh (const int meshIndex) {
+		return (m_pSceneData->getMeshData(meshIndex).getMergedPrimitives() != NULL);
+	}
+
+	virtual void releaseMergedMesh (const int meshIndex) {
+		m_pSceneData->getMeshData(meshIndex).clearMergedPrimitives();
+	}
+
+	virtual void* createNodeMesh (const int nodeIndex, const int meshIndex, const int) {
+		const CNodeData& nodeD = m_pSceneData->nodes[nodeIndex];
+		const sxsdk::mat4 m = (nodeD.childNodeIndex >= 0) ? sxsdk::mat4::identity : (m_pSceneData->getNodeMatrix(nodeIndex));
+		m_pImporter->m_createGLTFMesh(nodeD.name, m_pScene, m_pSceneData, meshIndex, m);
+		return m_pSceneData->getMeshData(meshIndex).pMeshHandle;
+	}
+
+	virtual void bindSkin (const int nodeIndex, const int, const int, void*) {
+		m_pImporter->m_setMeshSkin(m_pScene, m_pSceneData, nodeIndex);
+	}
+};
+
 CGLTFImporterInterface::CGLTFImporterInterface (sxsdk::shade_interface &shade) : shade(shade)
 {
 	m_MorphTargetsAccess = NULL;
@@ -231,6 +267,11 @@ void CGLTFImporterInterface::load_dialog_data (sxsdk::dialog_interface &d,void *
 		item = &(d.get_dialog_item(dlg_convert_color_from_linear));
 		item->set_bool(g_importParam.convertColorFromLinear);
 	}
+	{
+		sxsdk::dialog_item_class* item;
+		item = &(d.get_dialog_item(dlg_keep_image_source_id));
+		item->set_bool(g_importParam.keepImageSource);
+	}
 }
 
 void CGLTFImporterInterface::save_dialog_data (sxsdk::dialog_interface &dialog,void *)
@@ -277,6 +318,11 @@ bool CGLTFImporterInterface::respond (sxsdk::dialog_interface &dialog, sxsdk::di
 		return true;
 	}
 
+	if (id == dlg_keep_image_source_id) {
+		g_importParam.keepImageSource = item.get_bool();
+		return true;
+	}
+
 	return false;
 }
 
@@ -297,6 +343,19 @@ void CGLTFImporterInterface::m_createGLTFScene (sxsdk::scene_interface *scene, C
 
 	sxsdk::part_class& rootPart = scene->begin_part(sceneData->getFileName().c_str());
 
+	// メッシュごとに参照しているノードを調べる.
+	// 複数のノードで共有するメッシュは、プリミティブのマージを1回だけ行い、最後のノードの生成後に破棄する.
+	{
+		const size_t nodesCou = sceneData->nodes.size();
+		std::vector<int> nodeMeshIndices(nodesCou, -1);
+		std::vector<int> nodeSkinIndices(nodesCou, -1);
+		for (size_t i = 1; i < nodesCou; ++i) {		// ノードの0番目はルートとして新たに追加した要素.
+			nodeMeshIndices[i] = sceneData->nodes[i].meshIndex;
+			if (sceneData->nodes[i].skinIndex < (int)sceneData->skins.size()) nodeSkinIndices[i] = sceneData->nodes[i].skinIndex;
+		}
+		m_meshInstancePlan.init(nodeMeshIndices, nodeSkinIndices, (int)sceneData->meshes.size());
+	}
+
 	// シーン階層をたどってノードとメッシュ作成.
 	m_createGLTFNodeHierarchy(scene, sceneData, 0);
 
@@ -306,6 +365,13 @@ void CGLTFImporterInterface::m_createGLTFScene (sxsdk::scene_interface *scene, C
 	// スキンを割り当て.
 	m_setMeshSkins(scene, sceneData);
 
+	// マージしたメッシュ情報のキャッシュを破棄.
+	{
+		CShadeMeshInstanceHost host(this, scene, sceneData);
+		m_meshInstancePlan.releaseMergedMeshes(host);
+		m_meshInstancePlan.clear();
+	}
+
 	// ボーン調整.
 	m_adjustBones(&rootPart);
 
@@ -359,9 +425,9 @@ void CGLTFImporterInterface::m_createGLTFNodeHierarchy (sxsdk::scene_interface *
 			part2 = &(scene->begin_bone_joint(bonePos, bone_r, false, boneAxisDir, nodeD.name.c_str()));
 		}
 
-		// メッシュを生成.
-		sxsdk::mat4 m = (nodeD.childNodeIndex >= 0) ? sxsdk::mat4::identity : (sceneData->getNodeMatrix(nodeIndex));
-		m_createGLTFMesh(nodeD.name, scene, sceneData, nodeD.meshIndex, m);
+		// メッシュを生成 (マージはメッシュの最初の参照時のみ行う).
+		CShadeMeshInstanceHost host(this, scene, sceneData);
+		nodeD.pMeshHandle = m_meshInstancePlan.createNodeMesh(host, nodeIndex);
 
 		if (part2) {
 			scene->end_bone_joint();
@@ -424,17 +490,17 @@ bool CGLTFImporterInterface::m_createGLTFMesh (const std::string& name, sxsdk::s
 		importFlat = meshD.primitives[0].importFlat;
 	}
 
-	// プリミティブを1つにマージする.
-	CTempMeshData newMeshData;
-	if (!meshD.mergePrimitives(newMeshData)) return false;
-	newMeshData.name = name;
+	// プリミティブを1つにマージする (結果はメッシュごとにキャッシュされる).
+	const CTempMeshData* pMergedMeshData = meshD.getMergedPrimitives();
+	if (!pMergedMeshData) return false;
+	const CTempMeshData& newMeshData = *pMergedMeshData;
 
 	const int faceGroupCou = (int)newMeshData.faceGroupMaterialIndex.size();
 
 	bool errF = false;
 	{
 		// ポリゴンメッシュ形状を作成.
-		sxsdk::polygon_mesh_class& pMesh = scene->begin_polygon_mesh(newMeshData.name.c_str());
+		sxsdk::polygon_mesh_class& pMesh = scene->begin_polygon_mesh(name.c_str());
 		meshD.pMeshHandle = pMesh.get_handle();
 
 		// 頂点座標を格納。.
@@ -475,7 +541,7 @@ bool CGLTFImporterInterface::m_createGLTFMesh (const std::string& name, sxsdk::s
 
 		// 法線を読み込み（ベイク）.
 		if (g_importParam.meshImportNormals) {
-			if (!newMeshData.triangleNormals.empty()) {
+			if (newMeshData.hasNormals()) {
 				sxsdk::vec3 normals[4];
 				for (size_t i = 0, iPos = 0; i < triCou; ++i, iPos += 3) {
 					const int triIndex = triIndexList[i];
@@ -485,7 +551,7 @@ bool CGLTFImporterInterface::m_createGLTFMesh (const std::string& name, sxsdk::s
 						const int vCou = f.get_number_of_vertices();
 						if (vCou != 3) continue;
 						for (int j = 0; j < 3; ++j) {
-							normals[j] = normalize(sxsdk::vec3(sxsdk::vec4(newMeshData.triangleNormals[iPos + j], 0.0f) * matrix));
+							normals[j] = normalize(sxsdk::vec3(sxsdk::vec4(newMeshData.getNormal(iPos + j), 0.0f) * matrix));
 						}
 						f.set_normals(vCou, normals);
 					} catch (...) { }
@@ -494,7 +560,7 @@ bool CGLTFImporterInterface::m_createGLTFMesh (const std::string& name, sxsdk::s
 		}
 
 		// UV0を格納.
-		if (!newMeshData.triangleUV0.empty()) {
+		if (newMeshData.hasUV0()) {
 			const int uvIndex = pMesh.append_uv_layer();
 
 			int triIndices[3];
@@ -503,14 +569,14 @@ bool CGLTFImporterInterface::m_createGLTFMesh (const std::string& name, sxsdk::s
 				try {
 					sxsdk::face_class& f = pMesh.face(triIndexList[i]);
 					for (int j = 0; j < 3; ++j) {
-						f.set_face_uv(uvIndex, j, newMeshData.triangleUV0[iPos + j]);
+						f.set_face_uv(uvIndex, j, newMeshData.getUV0(iPos + j));
 					}
 				} catch (...) { }
 			}
 		}
 
 		// UV1を格納.
-		if (!newMeshData.triangleUV1.empty()) {
+		if (newMeshData.hasUV1()) {
 			const int uvIndex = pMesh.append_uv_layer();
 
 			int triIndices[3];
@@ -519,7 +585,7 @@ bool CGLTFImporterInterface::m_createGLTFMesh (const std::string& name, sxsdk::s
 				try {
 					sxsdk::face_class& f = pMesh.face(triIndexList[i]);
 					for (int j = 0; j < 3; ++j) {
-						f.set_face_uv(uvIndex, j, newMeshData.triangleUV1[iPos + j]);
+						f.set_face_uv(uvIndex, j, newMeshData.getUV1(iPos + j));
 					}
 				} catch (...) { }
 			}
@@ -528,7 +594,7 @@ bool CGLTFImporterInterface::m_createGLTFMesh (const std::string& name, sxsdk::s
 		// 頂点カラーを格納.
 		bool hasVertexColor = false;
 		if (g_importParam.meshImportVertexColor) {
-			if (!newMeshData.triangleColor0.empty()) {
+			if (newMeshData.hasColor0()) {
 				hasVertexColor = true;
 				const int vLayerIndex = pMesh.append_vertex_color_layer();;
 				sxsdk::vec4 col;
@@ -537,7 +603,7 @@ bool CGLTFImporterInterface::m_createGLTFMesh (const std::string& name, sxsdk::s
 					try {
 						sxsdk::face_class& f = pMesh.face(triIndexList[i]);
 						for (int j = 0; j < 3; ++j) {
-							col = newMeshData.triangleColor0[iPos + j];
+							col = newMeshData.getColor0(iPos + j);
 							// ノンリニアに変換.
 							if (g_importParam.convertColorFromLinear) {
 								MathUtil::convColorNonLinear(col.x, col.y, col.z);
@@ -689,6 +755,25 @@ void CGLTFImporterInterface::m_createGLTFImages (sxsdk::scene_interface *scene,
 			imageD.width  = image->get_size().x;
 			imageD.height = image->get_size().y;
 
+			// 元のjpeg/pngのバイト列をマスターイメージに保持.
+			// エクスポート時に画像が加工されていない場合は、これをそのまま出力する.
+			// shdファイルに画像がもう1つ格納されることになるため、指定がある場合のみ.
+			if (g_importParam.keepImageSource) {
+				CImageSourceData sourceD;
+				sourceD.mimeType = imageD.getImageDatasMimeType();
+				if (sourceD.mimeType != "") {
+					CImageData tempImageD;
+					tempImageD.setCustomImage(image);
+
+					sourceD.imageDatas = imageD.imageDatas;
+					sourceD.width      = tempImageD.width;
+					sourceD.height     = tempImageD.height;
+					sourceD.dataHash   = HashUtil::calcHash64(sourceD.imageDatas);
+					sourceD.pixelsHash = tempImageD.imageRGBAHash;
+					StreamCtrl::saveImageSourceData(masterImage, sourceD);
+				}
+			}
+
 			// ガンマの指定 (BaseColor/Emissiveのみ).
 			if ((imageD.imageMask & CImageData::gltf_image_mask_base_color) || (imageD.imageMask & CImageData::gltf_image_mask_emissive)) {
 				if (g_importParam.gamma == 1) {
@@ -1112,35 +1197,30 @@ void CGLTFImporterInterface::m_createGLTFMaterials (sxsdk::scene_interface *scen
  */
 void CGLTFImporterInterface::m_setMeshSkins (sxsdk::scene_interface *scene, CSceneData* sceneData)
 {
-	const size_t skinsCou = sceneData->skins.size();
-	const size_t meshsCou = sceneData->meshes.size();
-	if (skinsCou == 0) return;
+	if (sceneData->skins.empty()) return;
 
-	for (size_t meshLoop = 0; meshLoop < meshsCou; ++meshLoop) {
-		m_setMeshSkin(scene, sceneData, (int)meshLoop);
-	}
+	// スキンを持つノードごとに、生成したポリゴンメッシュに割り当てる.
+	CShadeMeshInstanceHost host(this, scene, sceneData);
+	m_meshInstancePlan.bindSkins(host);
 }
 
-void CGLTFImporterInterface::m_setMeshSkin (sxsdk::scene_interface *scene, CSceneData* sceneData, const int meshIndex)
+void CGLTFImporterInterface::m_setMeshSkin (sxsdk::scene_interface *scene, CSceneData* sceneData, const int nodeIndex)
 {
 	const size_t skinsCou = sceneData->skins.size();
 	if (skinsCou == 0) return;
 
-	const CMeshData& meshD = sceneData->meshes[meshIndex];
-	if (!meshD.pMeshHandle) return;
-	sxsdk::shape_class* meshShape = scene->get_shape_by_handle(meshD.pMeshHandle);
+	const CNodeData& nodeD = sceneData->nodes[nodeIndex];
+	if (nodeD.meshIndex < 0 || nodeD.meshIndex >= (int)sceneData->meshes.size()) return;
+	if (nodeD.skinIndex < 0 || nodeD.skinIndex >= (int)skinsCou) return;
+	const CSkinData& skinD = sceneData->skins[nodeD.skinIndex];
+
+	CMeshData& meshD = sceneData->meshes[nodeD.meshIndex];
+	if (!nodeD.pMeshHandle) return;
+	sxsdk::shape_class* meshShape = scene->get_shape_by_handle(nodeD.pMeshHandle);
 	if (!meshShape) return;
 	if (meshShape->get_type() != sxsdk::enums::polygon_mesh) return;
 	sxsdk::polygon_mesh_class& pMesh = meshShape->get_polygon_mesh();
 
-	// meshLoopに対応するノード番号を取得.
-	const int nodeIndex = m_findNodeFromMeshIndex(sceneData, meshIndex);
-	if (nodeIndex < 0) return;
-
-	const CNodeData& nodeD = sceneData->nodes[nodeIndex];
-	if (nodeD.skinIndex < 0) return;
-	const CSkinData& skinD = sceneData->skins[nodeD.skinIndex];
-
 	// 重複頂点を結合するか.
 	// これは、glTFで三角形の頂点インデックスがない状態でインポートした場合は最終的にマージをスキップする.
 	bool importFlat = false;
@@ -1164,9 +1244,10 @@ void CGLTFImporterInterface::m_setMeshSkin (sxsdk::scene_interface *scene, CScen
 		}
 	}
 
-	// プリミティブを1つにマージする.
-	CTempMeshData newMeshData;
-	if (!meshD.mergePrimitives(newMeshData)) return;
+	// プリミティブを1つにマージする (m_createGLTFMeshでのキャッシュを使用).
+	const CTempMeshData* pMergedMeshData = meshD.getMergedPrimitives();
+	if (!pMergedMeshData) return;
+	const CTempMeshData& newMeshData = *pMergedMeshData;
 	if (newMeshData.skinJoints.empty() || newMeshData.skinWeights.empty()) return;
 	if (newMeshData.skinJoints.size() != newMeshData.skinWeights.size()) return;
 
@@ -1223,24 +1304,6 @@ void CGLTFImporterInterface::m_setMeshSkin (sxsdk::scene_interface *scene, CScen
 	}
 }
 
-/**
- * メッシュ番号を参照しているノードを取得.
- * @return ノード番号.
- */
-int CGLTFImporterInterface::m_findNodeFromMeshIndex (CSceneData* sceneData, const int meshIndex)
-{
-	int nodeIndex = -1;
-	const size_t nodesCou = sceneData->nodes.size();
-	for (size_t i = 0; i < nodesCou; ++i) {
-		const CNodeData& nodeD = sceneData->nodes[i];
-		if (nodeD.meshIndex == meshIndex) {
-			nodeIndex = (int)i;
-			break;
-		}
-	}
-	return nodeIndex;
-}
-
 /**
  * 読み込んだ形状のルートから調べて、ボーンの場合に向きとボーンサイズを自動調整.
  */
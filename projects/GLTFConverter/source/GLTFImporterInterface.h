@@ -5,6 +5,7 @@
 #define _GLTFIMPORTERINTERFACE_H
 
 #include "GlobalHeader.h"
+#include "MeshInstancing.h"
 
 class CSceneData;
 class CNodeData;
@@ -21,6 +22,13 @@ private:
 
 	CMorphTargetsAccess* m_MorphTargetsAccess;	// Morph Targets情報をShade3Dに反映するクラス.
 
+	MeshInstancing::CMeshInstancePlan m_meshInstancePlan;	// 複数のノードから参照されるメッシュの管理.
+
+	/**
+	 * m_meshInstancePlanから、Shade3Dのシーンに形状を生成する.
+	 */
+	class CShadeMeshInstanceHost;
+
 private:
 	virtual sx::uuid_class get_uuid (void *) { return GLTF_IMPORTER_INTERFACE_ID; }
 	virtual int get_shade_version () const { return SHADE_BUILD_NUMBER; }
@@ -105,13 +113,7 @@ private:
 	 * 指定のMesh形状に対して、スキン情報を割り当て.
 	 */
 	void m_setMeshSkins (sxsdk::scene_interface *scene, CSceneData* sceneData);
-	void m_setMeshSkin (sxsdk::scene_interface *scene, CSceneData* sceneData, const int meshIndex);
-
-	/**
-	 * メッシュ番号を参照しているノードを取得.
-	 * @return ノード番号.
-	 */
-	int m_findNodeFromMeshIndex (CSceneData* sceneData, const int meshIndex);
+	void m_setMeshSkin (sxsdk::scene_interface *scene, CSceneData* sceneData, const int nodeIndex);
 
 	/**
 	 * 読み込んだ形状のルートから調べて、ボーンの場合に向きとボーンサイズを自動調整.
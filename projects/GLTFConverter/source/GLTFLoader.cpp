@@ -26,6 +26,7 @@
 #include <fstream>
 #include <sstream>
 #include <string>
+#include <utility>
 
 using namespace Microsoft::glTF;
 
@@ -98,6 +99,7 @@ namespace {
 			}
 		}
 
+		sceneData->meshes.reserve(sceneData->meshes.size() + meshesSize);
 		for (size_t i = 0; i < meshesSize; ++i) {
 			const int meshIndex = sceneData->appendNewMeshData();
 			CMeshData& dstMeshData = sceneData->getMeshData(meshIndex);
@@ -111,8 +113,9 @@ namespace {
 			const std::vector<float> morphTargetsWeights = mesh.weights;
 			int morphTargetsWeightOffset = 0;
 
+			dstMeshData.primitives.reserve(primitivesCou);
 			for (size_t primLoop = 0; primLoop < primitivesCou; ++primLoop) {
-				dstMeshData.primitives.push_back(CPrimitiveData());
+				dstMeshData.primitives.emplace_back();
 				CPrimitiveData& dstPrimitiveData = dstMeshData.primitives.back();
 
 				const MeshPrimitive& meshPrim = mesh.primitives[primLoop];
@@ -1073,8 +1076,9 @@ namespace {
 		const size_t imagesSize      = gltfDoc.images.Size();
 
 		// マテリアル情報を取得.
+		sceneData->materials.reserve(sceneData->materials.size() + materialsSize);
 		for (size_t i = 0; i < materialsSize; ++i) {
-			sceneData->materials.push_back(CMaterialData());
+			sceneData->materials.emplace_back();
 			CMaterialData& dstMaterialData = sceneData->materials.back();
 
 			const Material& material = gltfDoc.materials[i];
@@ -1336,8 +1340,9 @@ namespace {
 			}
 		}
 
+		sceneData->images.reserve(sceneData->images.size() + imagesSize);
 		for (size_t i = 0; i < imagesSize; ++i) {
-			sceneData->images.push_back(CImageData());
+			sceneData->images.emplace_back();
 			CImageData& dstImageData = sceneData->images.back();
 			std::string nameUTF8 = dstImageData.name;		// UTF8としてのファイル名.
 			const Image& image = gltfDoc.images[i];
@@ -1632,6 +1637,7 @@ namespace {
 
 		const size_t channelsCou = anim.channels.Size();
 		if (channelsCou > 0) {
+			dstAnimD.channelData.reserve(channelsCou);
 			for (size_t i = 0; i < channelsCou; ++i) {
 				const AnimationChannel& animChannel = anim.channels[i];
 				if (animChannel.samplerId == "" || animChannel.target.nodeId == "") continue;
@@ -1663,12 +1669,13 @@ namespace {
 				}
 				if (animC.pathType == CAnimChannelData::path_type_none) continue;
 
-				dstAnimD.channelData.push_back(animC);
+				dstAnimD.channelData.push_back(std::move(animC));
 			}
 		}
 
 		const size_t samplersCou = anim.samplers.Size();
 		if (samplersCou > 0) {
+			dstAnimD.samplerData.reserve(samplersCou);
 			for (size_t i = 0; i < samplersCou; ++i) {
 				const AnimationSampler& sampler = anim.samplers[i];
 
@@ -1741,7 +1748,7 @@ namespace {
 				} else {
 					samplerD.interpolationType = CAnimSamplerData::interpolation_type_smooth;
 				}
-				dstAnimD.samplerData.push_back(samplerD);
+				dstAnimD.samplerData.push_back(std::move(samplerD));
 			}
 		}
 	}
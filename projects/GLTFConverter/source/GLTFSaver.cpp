@@ -24,6 +24,7 @@
 #include <sstream>
 #include <string>
 #include <memory>
+#include <algorithm>
 #if _WINDOWS
 #include <filesystem>
 #else
@@ -39,6 +40,9 @@ using namespace Microsoft::glTF;
 #include "MathUtil.h"
 #include "Shade3DArray.h"
 #include "Shade3DUtil.h"
+#include "ImageEncoder.h"
+#include "ImageResampler.h"
+#include "ThreadPool.h"
 
 namespace {
 	std::string g_errorMessage = "";		// エラーメッセージの保持用.
@@ -50,23 +54,43 @@ namespace {
 		if (sceneData->nodes.empty()) return;
 		const float fMin = (float)(1e-4);
 
-		std::vector<int> childNodeIndex;
 		const size_t nodesCou = sceneData->nodes.size();
+
+		// ノードのid文字列.
+		std::vector<std::string> nodeIDs(nodesCou);
+		for (size_t i = 0; i < nodesCou; ++i) nodeIDs[i] = std::to_string(i);
+
+		// 親ノードごとの子ノードリストを作成 (子ノードはインデックス順).
+		// childrenOffset[i] - childrenOffset[i + 1]の範囲のchildrenListが、ノードiの子となる.
+		std::vector<int> childrenOffset(nodesCou + 1, 0);
+		std::vector<int> childrenList;
+		{
+			for (size_t i = 0; i < nodesCou; ++i) {
+				const int parentIndex = sceneData->nodes[i].parentNodeIndex;
+				if (parentIndex >= 0 && parentIndex < (int)nodesCou && parentIndex != (int)i) childrenOffset[parentIndex + 1]++;
+			}
+			for (size_t i = 0; i < nodesCou; ++i) childrenOffset[i + 1] += childrenOffset[i];
+
+			childrenList.resize(childrenOffset[nodesCou]);
+			std::vector<int> counts(childrenOffset.begin(), childrenOffset.end() - 1);
+			for (size_t i = 0; i < nodesCou; ++i) {
+				const int parentIndex = sceneData->nodes[i].parentNodeIndex;
+				if (parentIndex >= 0 && parentIndex < (int)nodesCou && parentIndex != (int)i) childrenList[counts[parentIndex]++] = (int)i;
+			}
+		}
+
 		for (size_t i = 0; i < nodesCou; ++i) {
 			const CNodeData& nodeD = sceneData->nodes[i];
 			Node gltfNode;
 			gltfNode.name = nodeD.name;
-			gltfNode.id   = std::to_string(i);
+			gltfNode.id   = nodeIDs[i];
 
 			// nodeDを親とする子ノードリストを取得.
-			childNodeIndex.clear();
-			for (size_t j = 0; j < nodesCou; ++j) {
-				if (i == j) continue;
-				const CNodeData& nodeD2 = sceneData->nodes[j];
-				if (nodeD2.parentNodeIndex == i) {
-					childNodeIndex.push_back(j);
-					gltfNode.children.push_back(std::to_string(j));
-				}
+			const int childStart = childrenOffset[i];
+			const int childEnd   = childrenOffset[i + 1];
+			gltfNode.children.reserve(childEnd - childStart);
+			for (int j = childStart; j < childEnd; ++j) {
+				gltfNode.children.push_back(nodeIDs[childrenList[j]]);
 			}
 
 			// glTFの仕様では、RTSに分解できる要素でないといけないので「せん断」は無視される。.
@@ -86,8 +110,28 @@ namespace {
 			// スキン情報を持つ場合.
 			if (nodeD.skinIndex >= 0) gltfNode.skinId = std::to_string(nodeD.skinIndex);
 
+			// LODを持つ場合 (MSFT_lod).
+			if (!nodeD.lodNodeIndices.empty()) {
+				std::string idsStr = "";
+				for (size_t j = 0; j < nodeD.lodNodeIndices.size(); ++j) {
+					if (j > 0) idsStr += ", ";
+					idsStr += std::to_string(nodeD.lodNodeIndices[j]);
+				}
+				gltfNode.extensions["MSFT_lod"] = std::string("{ \"ids\": [") + idsStr + std::string("] }");
+
+				if (nodeD.lodScreenCoverages.size() == nodeD.lodNodeIndices.size() + 1) {
+					std::string coveragesStr = "";
+					for (size_t j = 0; j < nodeD.lodScreenCoverages.size(); ++j) {
+						if (j > 0) coveragesStr += ", ";
+						coveragesStr += std::to_string(nodeD.lodScreenCoverages[j]);
+					}
+					gltfNode.extras = std::string("{ \"MSFT_screencoverage\": [") + coveragesStr + std::string("] }");
+				}
+				gltfDoc.extensionsUsed.insert("MSFT_lod");
+			}
+
 			try {
-				gltfDoc.nodes.Append(gltfNode);
+				gltfDoc.nodes.Append(std::move(gltfNode));
 			} catch (GLTFException e) { }
 		}
 
@@ -429,6 +473,7 @@ namespace {
 			// indices                 : 三角形の頂点インデックス.
 			// attributes - NORMAL     : 法線.
 			// attributes - POSITION   : 頂点位置.
+			// attributes - TANGENT    : 接線 (法線マップを持つ場合).
 			// attributes - TEXCOORD_0 : テクスチャのUV0.
 			// attributes - TEXCOORD_1 : テクスチャのUV0.
 			// attributes - COLOR_0    : 頂点カラー.
@@ -452,6 +497,9 @@ namespace {
 					if (!primitiveD0.vertices.empty()) {
 						meshPrimitive.attributes[ACCESSOR_POSITION]   = mesh.primitives[0].attributes[ACCESSOR_POSITION];
 					}
+					if (!primitiveD0.tangents.empty()) {
+						meshPrimitive.attributes[ACCESSOR_TANGENT]    = mesh.primitives[0].attributes[ACCESSOR_TANGENT];
+					}
 					if (!primitiveD0.uv0.empty()) {
 						meshPrimitive.attributes[ACCESSOR_TEXCOORD_0] = mesh.primitives[0].attributes[ACCESSOR_TEXCOORD_0];
 					}
@@ -471,6 +519,9 @@ namespace {
 				} else {
 					meshPrimitive.attributes[ACCESSOR_NORMAL] = std::to_string(accessorID++);
 					meshPrimitive.attributes[ACCESSOR_POSITION] = std::to_string(accessorID++);
+					if (!primitiveD.tangents.empty()) {
+						meshPrimitive.attributes[ACCESSOR_TANGENT] = std::to_string(accessorID++);
+					}
 					if (!primitiveD.uv0.empty()) {
 						meshPrimitive.attributes[ACCESSOR_TEXCOORD_0] = std::to_string(accessorID++);
 					}
@@ -521,7 +572,7 @@ namespace {
 
 				meshPrimitive.mode = MESH_TRIANGLES;		// (4) 三角形情報として格納.
 
-				mesh.primitives.push_back(meshPrimitive);
+				mesh.primitives.push_back(std::move(meshPrimitive));
 			}
 
 			// Morph Targetsのデフォルトウエイト値.
@@ -629,6 +680,23 @@ namespace {
 					accessorID++;
 				}
 
+				// tangentsAccessor.
+				if (!primitiveD.tangents.empty() && (primLoop == 0 || !shareVerticesMesh)) {
+					AccessorDesc acceDesc;
+					acceDesc.accessorType  = TYPE_VEC4;
+					acceDesc.componentType = COMPONENT_FLOAT;
+					acceDesc.byteOffset    = byteOffset;
+					acceDesc.normalized    = false;
+
+					const size_t byteLength = (sizeof(float) * 4) * primitiveD.tangents.size();
+
+					bufferBuilder->AddBufferView(gltfDoc.bufferViews.Get(accessorID).target);
+					bufferBuilder->AddAccessor(Shade3DArray::convert_vec4_to_float(primitiveD.tangents), acceDesc); 
+
+					byteOffset += byteLength;
+					accessorID++;
+				}
+
 				// uv0Accessor.
 				if (!primitiveD.uv0.empty() && (primLoop == 0 || !shareVerticesMesh)) {
 					AccessorDesc acceDesc;
@@ -1064,6 +1132,31 @@ namespace {
 					accessorID++;
 				}
 
+				// tangentsAccessor.
+				if (!primitiveD.tangents.empty() && (primLoop == 0 || !shareVerticesMesh)) {
+					Accessor acce;
+					acce.id             = std::to_string(accessorID);
+					acce.bufferViewId   = std::to_string(accessorID);
+					acce.type           = TYPE_VEC4;
+					acce.componentType  = COMPONENT_FLOAT;
+					acce.count          = primitiveD.tangents.size();
+					gltfDoc.accessors.Append(acce);
+
+					BufferView buffV;
+					buffV.id         = std::to_string(accessorID);
+					buffV.bufferId   = std::string("0");
+					buffV.byteOffset = byteOffset;
+					buffV.byteLength = (sizeof(float) * 4) * primitiveD.tangents.size();
+					buffV.target     = ARRAY_BUFFER;
+					gltfDoc.bufferViews.Append(buffV);
+
+					// バッファ情報として格納.
+					if (binWriter) binWriter->Write(gltfDoc.bufferViews[accessorID], &(primitiveD.tangents[0]), gltfDoc.accessors[accessorID]);
+
+					byteOffset += buffV.byteLength;
+					accessorID++;
+				}
+
 				// uv0Accessor.
 				if (!primitiveD.uv0.empty() && (primLoop == 0 || !shareVerticesMesh)) {
 					Accessor acce;
@@ -1454,23 +1547,166 @@ namespace {
 		}
 	}
 
+	/**
+	 * テクスチャのエンコード情報.
+	 */
+	class CTextureEncodeData
+	{
+	public:
+		int imageIndex;								// sceneData->imagesでのインデックス (-1の場合はイメージとして参照しない).
+		std::string fileName;						// 出力ファイル名.
+		std::string fileFullPath;					// 出力ファイルのフルパス.
+		bool jpeg;									// jpegの場合はtrue、pngの場合はfalse.
+		int width, height;							// 画像サイズ.
+		std::vector<unsigned char> rgbaData;		// エンコード用に取得したRGBA.
+		const unsigned char* pImageRGBAData;		// CImageData::imageRGBADataをそのまま参照する場合のポインタ.
+		std::vector<unsigned char> encodedData;		// エンコードしたjpeg/pngのバイト列.
+
+	public:
+		CTextureEncodeData () : imageIndex(-1), jpeg(false), width(0), height(0), pImageRGBAData(NULL) { }
+
+		/**
+		 * エンコードするRGBAを取得.
+		 */
+		const unsigned char* getRGBAData () const {
+			if (pImageRGBAData) return pImageRGBAData;
+			return rgbaData.empty() ? NULL : &(rgbaData[0]);
+		}
+	};
+
+	/**
+	 * 最大テクスチャサイズに収まるように、縦横比を維持したサイズを計算.
+	 */
+	sx::vec<int,2> calcTextureSize (const int srcWidth, const int srcHeight, const int maxTexSize) {
+		sx::vec<int,2> newSize(srcWidth, srcHeight);
+		if (srcWidth > maxTexSize && srcHeight <= maxTexSize) {
+			newSize.x = maxTexSize;
+			newSize.y = maxTexSize * srcHeight / srcWidth;
+		} else if (srcHeight > maxTexSize && srcWidth <= maxTexSize) {
+			newSize.y = maxTexSize;
+			newSize.x = maxTexSize * srcWidth / srcHeight;
+		} else if (srcWidth > maxTexSize && srcHeight > maxTexSize) {
+			if (srcWidth > srcHeight) {
+				newSize.x = maxTexSize;
+				newSize.y = maxTexSize * srcHeight / srcWidth;
+			} else {
+				newSize.y = maxTexSize;
+				newSize.x = maxTexSize * srcWidth / srcHeight;
+			}
+		}
+		return newSize;
+	}
+
+	/**
+	 * イメージのRGBAをエンコード用に取得.
+	 * Shade3DのAPIを使用するため、メインスレッドから呼ぶこと.
+	 * @param[in]  scene       シーンクラス.
+	 * @param[in]  imageD      イメージ情報.
+	 * @param[in]  maxTexSize  最大テクスチャサイズ.
+	 * @param[out] encD        エンコード情報.
+	 */
+	bool setTextureEncodeRGBA (sxsdk::scene_interface* scene, const CImageData& imageD, const int maxTexSize, CTextureEncodeData& encD) {
+		// 合成済みのRGBAを持つ場合は、イメージを介さずに参照もしくはリサイズする.
+		if (!imageD.shadeMasterImage && !imageD.imageRGBAData.empty()) {
+			const sx::vec<int,2> newSize = calcTextureSize(imageD.width, imageD.height, maxTexSize);
+			if (newSize.x == imageD.width && newSize.y == imageD.height) {
+				encD.width  = imageD.width;
+				encD.height = imageD.height;
+				encD.pImageRGBAData = &(imageD.imageRGBAData[0]);
+				return true;
+			}
+			encD.rgbaData.resize((size_t)newSize.x * (size_t)newSize.y * 4);
+			if (ImageResampler::resize(&(imageD.imageRGBAData[0]), imageD.width, imageD.height, &(encD.rgbaData[0]), newSize.x, newSize.y)) {
+				encD.width  = newSize.x;
+				encD.height = newSize.y;
+				return true;
+			}
+			encD.rgbaData.clear();
+		}
+
+		compointer<sxsdk::image_interface> image(imageD.getImage(scene));
+		if (!image) return false;
+		if (!Shade3DUtil::getImageRGBA8(image, encD.rgbaData, encD.width, encD.height)) return false;
+
+		// テクスチャをリサイズする場合 (ver.0.2.0.2 - ).
+		// 読み込んだRGBAをそのまま縮小する.
+		const sx::vec<int,2> newSize = calcTextureSize(encD.width, encD.height, maxTexSize);
+		if (newSize.x != encD.width || newSize.y != encD.height) {
+			std::vector<unsigned char> rgbaData((size_t)newSize.x * (size_t)newSize.y * 4);
+			if (ImageResampler::resize(&(encD.rgbaData[0]), encD.width, encD.height, &(rgbaData[0]), newSize.x, newSize.y)) {
+				encD.rgbaData.swap(rgbaData);
+				encD.width  = newSize.x;
+				encD.height = newSize.y;
+			}
+		}
+		return true;
+	}
+
+	/**
+	 * テクスチャをスレッドプールで並列にエンコード.
+	 * エンコード後、RGBAの作業バッファは解放される.
+	 */
+	void encodeTextures (std::vector<CTextureEncodeData>& encodeList, const CExportDlgParam& exportParam) {
+		const int pngCompressionLevel = std::min(std::max(exportParam.pngCompressionLevel, 0), 9);
+		const int jpegQuality         = std::min(std::max(exportParam.jpegQuality, 1), 100);
+
+		CThreadPool::getInstance().parallelFor((int)encodeList.size(), [&](const int index) {
+			CTextureEncodeData& encD = encodeList[index];
+			const unsigned char* pRGBA = encD.getRGBAData();
+			try {
+				if (pRGBA) {
+					if (encD.jpeg) ImageEncoder::encodeJPEG(pRGBA, encD.width, encD.height, jpegQuality, encD.encodedData);
+					else ImageEncoder::encodePNG(pRGBA, encD.width, encD.height, pngCompressionLevel, encD.encodedData);
+				}
+			} catch (...) {
+				encD.encodedData.clear();
+			}
+			std::vector<unsigned char>().swap(encD.rgbaData);
+			encD.pImageRGBAData = NULL;
+		});
+	}
+
+	/**
+	 * バイト列をファイルに出力.
+	 * @param[in] fileName  出力ファイル名 (UTF-8).
+	 * @param[in] data      バイト列.
+	 */
+	bool writeBinaryFile (const std::string& fileName, const std::vector<unsigned char>& data) {
+		if (data.empty()) return false;
+		try {
+			std::string fileName2 = fileName;
+#if _WINDOWS
+			StringUtil::convUTF8ToSJIS(fileName2, fileName2);
+#endif
+			std::ofstream outStream(fileName2, std::ios::out | std::ios::binary | std::ios::trunc);
+			outStream.write((const char *)&(data[0]), data.size());
+			outStream.flush();
+			return !outStream.fail();
+		} catch (...) { }
+		return false;
+	}
+
 	/**
 	 *   Image/Textures情報を格納.
 	 */
 	void setImagesData (Document& gltfDoc, const CSceneData* sceneData, std::unique_ptr<BufferBuilder>& bufferBuilder, sxsdk::shade_interface* shade, const CExportDlgParam& exportParam) {
 		const size_t imagesCou = sceneData->images.size();
 
-		std::vector<std::string> imageFileNameList;
-		imageFileNameList.resize(imagesCou, "");
-
 		// 最大テクスチャサイズ.
 		const int maxTexSize = sceneData->exportParam.getMaxTextureSize();
 
 		compointer<sxsdk::scene_interface> scene(shade->get_scene_interface());
 
+		// エンコードが必要なテクスチャ.
+		std::vector<CTextureEncodeData> encodeList;
+
+		// 出力するImage要素 (出力できたものだけを最後にまとめて追加する).
+		std::vector<Image> imageList(imagesCou);
+		std::vector<char> imageOutputList(imagesCou, 0);
+
 		for (size_t i = 0; i < imagesCou; ++i) {
 			const CImageData& imageD = sceneData->images[i];
-			if (!imageD.shadeMasterImage && imageD.imageRGBAData.empty()) continue;
+			if (!imageD.shadeMasterImage && imageD.imageRGBAData.empty() && imageD.imageDatas.empty()) continue;
 			std::string fileName = StringUtil::getFileName(imageD.name);
 			if (fileName == "") fileName = std::string("image_") + std::to_string(i);
 
@@ -1486,6 +1722,12 @@ namespace {
 			} else if ((sceneData->exportParam.outputTexture) == GLTFConverter::export_texture_jpeg) {
 				extStr = "jpg";
 			}
+			// インポート時の元画像(jpeg/png)を保持している場合は、その形式を採用.
+			if ((sceneData->exportParam.outputTexture) == GLTFConverter::export_texture_name) {
+				if (imageD.canPassThroughImageDatas("png")) extStr = "png";
+				else if (imageD.canPassThroughImageDatas("jpg")) extStr = "jpg";
+			}
+
 			// アルファ透明を使用する場合は、pngにする.
 			if (imageD.useBaseColorAlpha) extStr = "png";
 
@@ -1493,61 +1735,99 @@ namespace {
 			fileName = StringUtil::getFileName(imageD.name, false) + std::string(".") + extStr;
 
 			try {
-				// 画像ファイルを指定の拡張子(jpg/png)で保存.
-				compointer<sxsdk::image_interface> image(imageD.getImage(scene));
-				if (!image) continue;
-
-				// テクスチャをリサイズする場合 (ver.0.2.0.2 - ).
-				compointer<sxsdk::image_interface> image2;
-				if (sceneData->exportParam.maxTextureSize != GLTFConverter::export_max_texture_size_undefined) {
-					const int srcWidth  = image->get_size().x;
-					const int srcHeight = image->get_size().y;
-					if (srcWidth > maxTexSize || srcHeight > maxTexSize) {
-						sx::vec<int,2> newSize(srcWidth, srcHeight);
-						if (srcWidth > maxTexSize && srcHeight <= maxTexSize) {
-							newSize.x = maxTexSize;
-							newSize.y = maxTexSize * srcHeight / srcWidth;
-						} else if (srcHeight > maxTexSize && srcWidth <= maxTexSize) {
-							newSize.y = maxTexSize;
-							newSize.x = maxTexSize * srcWidth / srcHeight;
-						} else if (srcWidth > maxTexSize && srcHeight > maxTexSize) {
-							if (srcWidth > srcHeight) {
-								newSize.x = maxTexSize;
-								newSize.y = maxTexSize * srcHeight / srcWidth;
-							} else {
-								newSize.y = maxTexSize;
-								newSize.x = maxTexSize * srcWidth / srcHeight;
-							}
-						}
-						if (newSize.x != srcWidth || newSize.y != srcHeight) {
-							image2 = Shade3DUtil::resizeImageWithAlpha(scene, image, newSize);
-						}
-					}
+				const std::string fileFullPath = (sceneData->getFileDir()) + std::string("/") + fileName;
+
+				// 元画像のjpeg/pngのバイト列をそのまま使用できるか.
+				// 同一形式でリサイズが不要な場合は、デコード/エンコードせずにそのまま出力する.
+				bool passThrough = imageD.canPassThroughImageDatas(extStr);
+				if (passThrough && sceneData->exportParam.maxTextureSize != GLTFConverter::export_max_texture_size_undefined) {
+					if (imageD.width > maxTexSize || imageD.height > maxTexSize) passThrough = false;
 				}
 
-				const std::string fileFullPath = (sceneData->getFileDir()) + std::string("/") + fileName;
-				if (image2 && image2->has_image()) {
-					image2->save(fileFullPath.c_str());
-				} else {
-					image->save(fileFullPath.c_str());
+				// GLTFのImage要素.
+				Image& img = imageList[i];
+				img.id = std::to_string(i);
+				if (passThrough) {
+					if (bufferBuilder) {
+						// glbの場合は、バイト列をそのままbufferBuilderに格納.
+						auto imageBufferView = bufferBuilder->AddBufferView(imageD.imageDatas);
+						img.bufferViewId = imageBufferView.id;
+						img.mimeType     = (extStr == "png") ? std::string("image/png") : std::string("image/jpeg");
+						img.name         = fileName;
+					} else {
+						if (writeBinaryFile(fileFullPath, imageD.imageDatas)) img.uri = fileName;
+						else passThrough = false;
+					}
+					if (passThrough) imageOutputList[i] = 1;
 				}
+				if (!passThrough) {
+					// 後でjpg/pngにエンコードしてから出力する.
+					CTextureEncodeData encD;
+					encD.imageIndex   = (int)i;
+					encD.fileName     = fileName;
+					encD.fileFullPath = fileFullPath;
+					encD.jpeg         = (extStr == "jpg");
+					encodeList.push_back(encD);
+
+					if (bufferBuilder) {
+						img.mimeType = encD.jpeg ? std::string("image/jpeg") : std::string("image/png");
+						img.name     = fileName;
+					}
+				}
+
+			} catch (...) {
+				continue;
+			}
+		}
+
+		// テクスチャをjpg/pngにエンコードして出力.
+		// RGBAの取得はメインスレッドで行い、エンコードはスレッド数ずつまとめて並列に行う (同時に保持するRGBAの量を抑えるため).
+		const size_t encodeCou = encodeList.size();
+		const size_t batchCou  = (size_t)CThreadPool::getInstance().getThreadsCount();
+		for (size_t startIndex = 0; startIndex < encodeCou; startIndex += batchCou) {
+			const size_t endIndex = std::min(startIndex + batchCou, encodeCou);
+			std::vector<CTextureEncodeData> batchList(encodeList.begin() + startIndex, encodeList.begin() + endIndex);
+			for (size_t j = 0; j < batchList.size(); ++j) {
+				CTextureEncodeData& encD = batchList[j];
+				try {
+					setTextureEncodeRGBA(scene, sceneData->images[encD.imageIndex], maxTexSize, encD);
+				} catch (...) { }
+			}
+
+			encodeTextures(batchList, exportParam);
 
-				imageFileNameList[i] = fileFullPath;
+			for (size_t j = 0; j < batchList.size(); ++j) {
+				const CTextureEncodeData& encD = batchList[j];
+				if (encD.encodedData.empty()) continue;
+				try {
+					Image& img = imageList[encD.imageIndex];
+					if (bufferBuilder) {
+						// glbの場合は、エンコードしたバイト列をbufferBuilderに格納.
+						auto imageBufferView = bufferBuilder->AddBufferView(encD.encodedData);
+						img.bufferViewId = imageBufferView.id;
+						imageOutputList[encD.imageIndex] = 1;
+					} else {
+						if (writeBinaryFile(encD.fileFullPath, encD.encodedData)) {
+							img.uri = encD.fileName;
+							imageOutputList[encD.imageIndex] = 1;
+						}
+					}
+				} catch (...) { }
+			}
+		}
 
-				// GLTFにImage要素を追加.
-				Image img;
-				img.id       = std::to_string(i);
-				img.uri      = fileName;
-				gltfDoc.images.Append(img);
+		// 出力できたイメージのみ、GLTFにImage/Texture/Sampler要素を追加.
+		for (size_t i = 0; i < imagesCou; ++i) {
+			if (!imageOutputList[i]) continue;
+			try {
+				gltfDoc.images.Append(imageList[i]);
 
-				// GLTFにTexture要素を追加.
 				Texture tex;
 				tex.id        = std::to_string(i);
 				tex.imageId   = std::to_string(i);
 				tex.samplerId = std::to_string(i);
 				gltfDoc.textures.Append(tex);
 
-				// GLTFにSampler要素を追加.
 				Sampler sampl;
 				sampl.id        = std::to_string(i);
 				sampl.minFilter = MinFilter_LINEAR;
@@ -1555,62 +1835,7 @@ namespace {
 				sampl.wrapS     = Wrap_REPEAT;
 				sampl.wrapT     = Wrap_REPEAT;
 				gltfDoc.samplers.Append(sampl);
-
-			} catch (...) {
-				continue;
-			}
-		}
-
-		// glb出力の場合.
-		if (bufferBuilder) {
-			for (size_t i = 0; i < imagesCou; ++i) {
-				// ファイル出力した画像をいったん読み込み、bufferBuilderに格納する.
-				std::string fileName = imageFileNameList[i];
-#if _WINDOWS
-				StringUtil::convUTF8ToSJIS(fileName, fileName);
-#endif
-
-				try {
-					std::shared_ptr<BinStreamReader> binStreamReader;
-					std::shared_ptr<GLTFResourceReader> binReader;
-
-					binStreamReader.reset(new BinStreamReader(StringUtil::getFileDir(fileName)));
-					binReader.reset(new GLTFResourceReader(binStreamReader));
-
-					// uriはSJISに変換.
-					Image image2(gltfDoc.images[i]);
-#if _WINDOWS
-					StringUtil::convUTF8ToSJIS(image2.uri, image2.uri);
-#endif
-
-					auto data = binReader->ReadBinaryData(gltfDoc, image2);
-					auto imageBufferView = bufferBuilder->AddBufferView(data);
-
-					Image newImage(gltfDoc.images[i]);
-					newImage.bufferViewId = imageBufferView.id;
-
-					// mimeの指定 (image/jpeg , image/png).
-					const std::string extStr = StringUtil::getFileExtension(newImage.uri);
-					newImage.mimeType = std::string("image/");
-					if (extStr == "jpg" || extStr == "jpeg") newImage.mimeType += "jpeg";
-					else newImage.mimeType += "png";
-
-					newImage.name = newImage.uri;
-					newImage.uri.clear();
-					gltfDoc.images.Replace(newImage);
-
-				} catch (...) {
-					break;
-				}
-			}
-
-			// 出力したイメージファイルを削除.
-			for (size_t i = 0; i < imagesCou; ++i) {
-				try {
-					const std::string fileName = imageFileNameList[i];
-					shade->delete_file(fileName.c_str());
-				} catch (...) { }
-			}
+			} catch (...) { }
 		}
 	}
 
@@ -1720,6 +1945,22 @@ namespace {
 
 		compointer<sxsdk::scene_interface> scene(shade->get_scene_interface());
 
+		// 出力するテクスチャはpngにエンコードし、スレッド数分たまったら並列にエンコードしてファイル出力する.
+		const int noResizeTexSize = 0x7fffffff;
+		const size_t batchCou = (size_t)CThreadPool::getInstance().getThreadsCount();
+		std::vector<CTextureEncodeData> encodeList;
+
+		auto addEncodeImage = [&](const std::string& fName, sxsdk::image_interface* image) {
+			CTextureEncodeData encD;
+			encD.fileFullPath = fName;
+			if (Shade3DUtil::getImageRGBA8(image, encD.rgbaData, encD.width, encD.height)) encodeList.push_back(std::move(encD));
+		};
+		auto flushEncodeList = [&]() {
+			encodeTextures(encodeList, exportParam);
+			for (size_t i = 0; i < encodeList.size(); ++i) writeBinaryFile(encodeList[i].fileFullPath, encodeList[i].encodedData);
+			encodeList.clear();
+		};
+
 		const size_t materialsCou = sceneData->materials.size();
 
 		for (size_t mLoop = 0; mLoop < materialsCou; ++mLoop) {
@@ -1731,10 +1972,9 @@ namespace {
 				const std::string fName = baseFileName + std::string("_baseColor.png");
 				const CImageData& imageD = sceneData->images[materialD.baseColorImageIndex];
 				try {
-					compointer<sxsdk::image_interface> image(imageD.getImage(scene));
-					if (image) {
-						image->save(fName.c_str());
-					}
+					CTextureEncodeData encD;
+					encD.fileFullPath = fName;
+					if (setTextureEncodeRGBA(scene, imageD, noResizeTexSize, encD)) encodeList.push_back(std::move(encD));
 				} catch (...) { }
 			}
 
@@ -1743,10 +1983,9 @@ namespace {
 				const std::string fName = baseFileName + std::string("_normal.png");
 				const CImageData& imageD = sceneData->images[materialD.normalImageIndex];
 				try {
-					compointer<sxsdk::image_interface> image(imageD.getImage(scene));
-					if (image) {
-						image->save(fName.c_str());
-					}
+					CTextureEncodeData encD;
+					encD.fileFullPath = fName;
+					if (setTextureEncodeRGBA(scene, imageD, noResizeTexSize, encD)) encodeList.push_back(std::move(encD));
 				} catch (...) { }
 			}
 
@@ -1755,10 +1994,9 @@ namespace {
 				const std::string fName = baseFileName + std::string("_emissive.png");
 				const CImageData& imageD = sceneData->images[materialD.emissiveImageIndex];
 				try {
-					compointer<sxsdk::image_interface> image(imageD.getImage(scene));
-					if (image) {
-						image->save(fName.c_str());
-					}
+					CTextureEncodeData encD;
+					encD.fileFullPath = fName;
+					if (setTextureEncodeRGBA(scene, imageD, noResizeTexSize, encD)) encodeList.push_back(std::move(encD));
 				} catch (...) { }
 			}
 
@@ -1767,10 +2005,9 @@ namespace {
 				const std::string fName = baseFileName + std::string("_transmission.png");
 				const CImageData& imageD = sceneData->images[materialD.transmissionTextureIndex];
 				try {
-					compointer<sxsdk::image_interface> image(imageD.getImage(scene));
-					if (image) {
-						image->save(fName.c_str());
-					}
+					CTextureEncodeData encD;
+					encD.fileFullPath = fName;
+					if (setTextureEncodeRGBA(scene, imageD, noResizeTexSize, encD)) encodeList.push_back(std::move(encD));
 				} catch (...) { }
 			}
 
@@ -1799,7 +2036,7 @@ namespace {
 								}
 								sImage->set_pixels_rgba_float(0, y, wid, 1, &(colLine[0]));
 							}
-							sImage->save(fName.c_str());
+							addEncodeImage(fName, sImage);
 						}
 					} catch (...) { }
 				}
@@ -1870,11 +2107,14 @@ namespace {
 							fName = baseFileName + std::string("_MetallicOcclusionSmoothness.png");
 						}
 
-						if (fName != "") sImage->save(fName.c_str());
+						if (fName != "") addEncodeImage(fName, sImage);
 					}
 				} catch (...) { }
 			}
+
+			if (encodeList.size() >= batchCou) flushEncodeList();
 		}
+		flushEncodeList();
 	}
 }
 
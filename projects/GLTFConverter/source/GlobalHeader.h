@@ -8,6 +8,10 @@
 
 #include "sxsdk.cxx"
 
+#include <vector>
+#include <string>
+#include <stdint.h>
+
 /**
  * プラグインID.
  */
@@ -18,11 +22,18 @@
 #define LICENSE_DIALOG_INTERFACE_ID sx::uuid_class("DC1B3583-05DE-4AA7-BE76-1B0B1FC599AD")
 
 // streamに保存するstreamのバージョン.
-#define GLTF_IMPORTER_DLG_STREAM_VERSION		0x101
+#define GLTF_IMPORTER_DLG_STREAM_VERSION		0x102
+#define GLTF_IMPORTER_DLG_STREAM_VERSION_102	0x102
 #define GLTF_IMPORTER_DLG_STREAM_VERSION_101	0x101
 #define GLTF_IMPORTER_DLG_STREAM_VERSION_100	0x100
 
-#define GLTF_EXPORTER_DLG_STREAM_VERSION		0x105
+#define GLTF_EXPORTER_DLG_STREAM_VERSION		0x10b
+#define GLTF_EXPORTER_DLG_STREAM_VERSION_10B	0x10b
+#define GLTF_EXPORTER_DLG_STREAM_VERSION_10A	0x10a
+#define GLTF_EXPORTER_DLG_STREAM_VERSION_109	0x109
+#define GLTF_EXPORTER_DLG_STREAM_VERSION_108	0x108
+#define GLTF_EXPORTER_DLG_STREAM_VERSION_107	0x107
+#define GLTF_EXPORTER_DLG_STREAM_VERSION_106	0x106
 #define GLTF_EXPORTER_DLG_STREAM_VERSION_105	0x105
 #define GLTF_EXPORTER_DLG_STREAM_VERSION_104	0x104
 #define GLTF_EXPORTER_DLG_STREAM_VERSION_103	0x103
@@ -36,6 +47,7 @@
 
 #define ALPHA_MODE_DLG_STREAM_VERSION			0x100
 #define GLTF_LICENSE_STREAM_VERSION				0x100
+#define GLTF_IMAGE_SOURCE_STREAM_VERSION		0x100
 
 // 作業ディレクトリ名.
 #define GLTF_TEMP_DIR "shade3d_temp_gltf"
@@ -146,6 +158,9 @@ public:
 
 	bool bakeWithoutProcessingTextures;						// テクスチャを加工せずにベイク.
 	bool separateOpacityAndTransmission;					// 「不透明(Opacity)」と「透明(Transmission)」を分ける.
+	bool useBakeDiskCache;									// ベイク結果をディスクにキャッシュ.
+	bool bakeStreaming;										// テクスチャをタイル単位でベイク (使用メモリを抑える).
+	int bakeMemoryBudget;									// タイル単位でのベイクで使用するメモリの上限 (MB).
 
 	std::string assetExtrasTitle;							// タイトル.
 	std::string assetExtrasAuthor;							// 作成者.
@@ -155,6 +170,16 @@ public:
 	bool outputAdditionalTextures;							// エンジン別にテクスチャを別途出力.
 	GLTFConverter::engine_type engineType;					// エンジンの種類.
 
+	int pngCompressionLevel;								// pngの圧縮レベル (0 - 9).
+	int jpegQuality;										// jpegの品質 (1 - 100).
+
+	bool staticBatching;									// 静的なメッシュをマテリアルごとにまとめる.
+	int staticBatchingMaxVertices;							// まとめたメッシュの最大頂点数.
+	bool flattenHierarchy;									// 静的なノード階層を平坦化.
+
+	bool generateLODs;										// LODを作成 (MSFT_lod).
+	int lodRatios[3];										// LODごとの、元の三角形数に対する割合 (%). 0の場合は作成しない.
+
 public:
 	CExportDlgParam () {
 		clear();
@@ -172,12 +197,22 @@ public:
 		this->convertColorToLinear  = v.convertColorToLinear;
 		this->bakeWithoutProcessingTextures  = v.bakeWithoutProcessingTextures;
 		this->separateOpacityAndTransmission = v.separateOpacityAndTransmission;
+		this->useBakeDiskCache               = v.useBakeDiskCache;
+		this->bakeStreaming                  = v.bakeStreaming;
+		this->bakeMemoryBudget               = v.bakeMemoryBudget;
 		this->assetExtrasTitle   = v.assetExtrasTitle;
 		this->assetExtrasAuthor  = v.assetExtrasAuthor;
 		this->assetExtrasLicense = v.assetExtrasLicense;
 		this->assetExtrasSource  = v.assetExtrasSource;
 		this->outputAdditionalTextures = v.outputAdditionalTextures;
 		this->engineType               = v.engineType;
+		this->pngCompressionLevel = v.pngCompressionLevel;
+		this->jpegQuality         = v.jpegQuality;
+		this->staticBatching            = v.staticBatching;
+		this->staticBatchingMaxVertices = v.staticBatchingMaxVertices;
+		this->flattenHierarchy          = v.flattenHierarchy;
+		this->generateLODs = v.generateLODs;
+		for (int i = 0; i < 3; ++i) this->lodRatios[i] = v.lodRatios[i];
 	}
 
 	void clear () {
@@ -194,6 +229,9 @@ public:
 
 		bakeWithoutProcessingTextures = false;
 		separateOpacityAndTransmission = false;
+		useBakeDiskCache = false;
+		bakeStreaming    = false;
+		bakeMemoryBudget = 256;
 
 		assetExtrasTitle   = "";
 		assetExtrasAuthor  = "";
@@ -202,6 +240,18 @@ public:
 
 		outputAdditionalTextures = false;
 		engineType = GLTFConverter::engine_unity;
+
+		pngCompressionLevel = 6;
+		jpegQuality         = 90;
+
+		staticBatching            = false;
+		staticBatchingMaxVertices = 65000;		// 頂点インデックスをunsigned shortで出力できる範囲.
+		flattenHierarchy          = false;
+
+		generateLODs = false;
+		lodRatios[0] = 50;
+		lodRatios[1] = 25;
+		lodRatios[2] = 10;
 	}
 
 	/**
@@ -229,6 +279,7 @@ public:
 	bool meshImportVertexColor;		// 頂点カラーの読み込み.
 	bool importAnimation;			// アニメーションの読み込み.
 	bool convertColorFromLinear;	// 色をリニアから変換.
+	bool keepImageSource;			// 元のjpeg/pngのバイト列をマスターイメージに保持 (エクスポート時にそのまま出力).
 
 public:
 	CImportDlgParam () {
@@ -242,6 +293,7 @@ public:
 		meshImportVertexColor = true;
 		importAnimation       = true;
 		convertColorFromLinear = true;
+		keepImageSource        = false;
 	}
 };
 
@@ -285,4 +337,32 @@ public:
 	}
 };
 
+/**
+ * インポート時の元画像の情報.
+ * これは、マスターイメージの属性として指定.
+ * エクスポート時に画像が加工されていない場合は、jpeg/pngをデコードせずにそのまま出力するために使用.
+ */
+class CImageSourceData
+{
+public:
+	std::string mimeType;					// 画像としての種類 ("image/jpeg" "image/png").
+	std::vector<unsigned char> imageDatas;	// 画像情報。jpeg/pngのフォーマットそのままに入る.
+	int width, height;						// 画像サイズ.
+	uint64_t dataHash;						// imageDatasのハッシュ値.
+	uint64_t pixelsHash;					// 読み込み直後のRGBA(1ピクセル4バイト)のハッシュ値.
+
+public:
+	CImageSourceData () {
+		clear();
+	}
+
+	void clear () {
+		mimeType = "";
+		imageDatas.clear();
+		width = height = 0;
+		dataHash   = 0;
+		pixelsHash = 0;
+	}
+};
+
 #endif
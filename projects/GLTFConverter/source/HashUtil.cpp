@@ -0,0 +1,66 @@
+﻿/**
+ * ハッシュ値の計算.
+ */
+#include "HashUtil.h"
+
+#include <string.h>
+
+namespace {
+	const uint64_t HASH64_PRIME = 0x100000001b3ULL;
+
+	/**
+	 * 最終的なビットの撹拌.
+	 */
+	inline uint64_t mix64 (uint64_t h) {
+		h ^= h >> 33;
+		h *= 0xff51afd7ed558ccdULL;
+		h ^= h >> 33;
+		h *= 0xc4ceb9fe1a85ec53ULL;
+		h ^= h >> 33;
+		return h;
+	}
+}
+
+/**
+ * バイト列から64bitのハッシュ値を計算.
+ * 8バイト単位で処理し、余りはFNV-1aで処理する.
+ */
+uint64_t HashUtil::calcHash64 (const void* data, const size_t size, const uint64_t seed)
+{
+	const unsigned char* pD = (const unsigned char *)data;
+	uint64_t h = seed ^ ((uint64_t)size * HASH64_PRIME);
+	if (!pD || size == 0) return mix64(h);
+
+	const size_t wordsCou = size >> 3;
+	uint64_t w;
+	for (size_t i = 0; i < wordsCou; ++i) {
+		memcpy(&w, pD, 8);
+		h = (h ^ mix64(w)) * HASH64_PRIME;
+		h ^= h >> 29;
+		pD += 8;
+	}
+	const size_t restCou = size & 7;
+	for (size_t i = 0; i < restCou; ++i) {
+		h = (h ^ (uint64_t)pD[i]) * HASH64_PRIME;
+	}
+	return mix64(h);
+}
+
+uint64_t HashUtil::calcHash64 (const std::vector<unsigned char>& data, const uint64_t seed)
+{
+	if (data.empty()) return calcHash64(NULL, 0, seed);
+	return calcHash64(&(data[0]), data.size(), seed);
+}
+
+uint64_t HashUtil::calcHash64 (const std::string& str, const uint64_t seed)
+{
+	return calcHash64(str.c_str(), str.length(), seed);
+}
+
+/**
+ * ハッシュ値に値を追加で合成.
+ */
+uint64_t HashUtil::combineHash64 (const uint64_t hash, const uint64_t v)
+{
+	return mix64(hash ^ (v + 0x9e3779b97f4a7c15ULL + (hash << 6) + (hash >> 2)));
+}
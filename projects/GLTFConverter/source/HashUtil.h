@@ -0,0 +1,30 @@
+﻿/**
+ * ハッシュ値の計算.
+ */
+#ifndef _HASHUTIL_H
+#define _HASHUTIL_H
+
+#include <vector>
+#include <string>
+#include <stdint.h>
+
+#define HASH64_SEED  0xcbf29ce484222325ULL		// ハッシュ値計算の初期値.
+
+namespace HashUtil {
+	/**
+	 * バイト列から64bitのハッシュ値を計算.
+	 * @param[in] data  バイト列の先頭.
+	 * @param[in] size  バイト数.
+	 * @param[in] seed  初期値 (続けて計算する場合は前回の結果を渡す).
+	 */
+	uint64_t calcHash64 (const void* data, const size_t size, const uint64_t seed = HASH64_SEED);
+	uint64_t calcHash64 (const std::vector<unsigned char>& data, const uint64_t seed = HASH64_SEED);
+	uint64_t calcHash64 (const std::string& str, const uint64_t seed = HASH64_SEED);
+
+	/**
+	 * ハッシュ値に値を追加で合成.
+	 */
+	uint64_t combineHash64 (const uint64_t hash, const uint64_t v);
+}
+
+#endif
@@ -4,6 +4,9 @@
 
 #include "ImageData.h"
 #include "MathUtil.h"
+#include "HashUtil.h"
+
+#include <string.h>
 
 CImageData::CImageData ()
 {
@@ -21,6 +24,7 @@ CImageData::CImageData (const CImageData& v)
 	this->useBaseColorAlpha = v.useBaseColorAlpha;
 	this->shadeMasterImage  = v.shadeMasterImage;
 	this->imageRGBAData = v.imageRGBAData;
+	this->imageRGBAHash = v.imageRGBAHash;
 	this->materialName = v.materialName;
 }
 
@@ -41,6 +45,7 @@ void CImageData::clear ()
 	shadeMasterImage = NULL;
 
 	imageRGBAData.clear();
+	imageRGBAHash = 0;
 }
 
 /**
@@ -69,6 +74,7 @@ void CImageData::setCustomImage (sxsdk::image_interface* image)
 				iPos += 4;
 			}
 		}
+		imageRGBAHash = HashUtil::calcHash64(imageRGBAData);
 
 	} catch (...) { }
 }
@@ -85,28 +91,16 @@ bool CImageData::isSame (const CImageData &v) const
 		if (this->shadeMasterImage->get_handle() == v.shadeMasterImage->get_handle()) return true;
 	}
 	if (!(this->imageRGBAData.empty()) && !(v.imageRGBAData.empty())) {
-		bool sameF = true;
-		int iPos = 0;
-		for (int y = 0; y < height; ++y) {
-			for (int x = 0; x < width; ++x) {
-				const unsigned char r0 = this->imageRGBAData[iPos + 0];
-				const unsigned char g0 = this->imageRGBAData[iPos + 1];
-				const unsigned char b0 = this->imageRGBAData[iPos + 2];
-				const unsigned char a0 = this->imageRGBAData[iPos + 3];
-				const unsigned char r1 = v.imageRGBAData[iPos + 0];
-				const unsigned char g1 = v.imageRGBAData[iPos + 1];
-				const unsigned char b1 = v.imageRGBAData[iPos + 2];
-				const unsigned char a1 = v.imageRGBAData[iPos + 3];
-				iPos += 4;
+		// ハッシュ値が異なる場合は別の画像.
+		if ((this->imageRGBAHash) != v.imageRGBAHash) return false;
+		if ((this->imageRGBAData.size()) != v.imageRGBAData.size()) return false;
+		return (memcmp(&(this->imageRGBAData[0]), &(v.imageRGBAData[0]), this->imageRGBAData.size()) == 0);
+	}
 
-				if (r0 != r1 || g0 != g1 || b0 != b1 || a0 != a1) {
-					sameF = false;
-					break;
-				}
-			}
-			if (!sameF) break;
-		}
-		return sameF;
+	// タイル単位でベイクし、png/jpegのバイト列のみを持つ場合.
+	if (!(this->shadeMasterImage) && !(v.shadeMasterImage) && this->imageRGBAData.empty() && v.imageRGBAData.empty()) {
+		if (this->imageDatas.empty() || (this->imageDatas.size()) != v.imageDatas.size()) return false;
+		return (memcmp(&(this->imageDatas[0]), &(v.imageDatas[0]), this->imageDatas.size()) == 0);
 	}
 
 	return false;
@@ -141,3 +135,27 @@ compointer<sxsdk::image_interface> CImageData::getImage (sxsdk::scene_interface*
 	return compointer<sxsdk::image_interface>();
 }
 
+/**
+ * imageDatasの先頭のシグネチャから種類を取得.
+ * @return "image/png" or "image/jpeg"。判別できない場合は"".
+ */
+std::string CImageData::getImageDatasMimeType () const
+{
+	if (imageDatas.size() < 8) return "";
+	if (imageDatas[0] == 0x89 && imageDatas[1] == 'P' && imageDatas[2] == 'N' && imageDatas[3] == 'G') return "image/png";
+	if (imageDatas[0] == 0xff && imageDatas[1] == 0xd8 && imageDatas[2] == 0xff) return "image/jpeg";
+	return "";
+}
+
+/**
+ * 元のjpeg/pngのバイト列をそのまま出力できるか.
+ * @param[in] extStr  出力する拡張子 ("jpg" or "png").
+ */
+bool CImageData::canPassThroughImageDatas (const std::string& extStr) const
+{
+	if (imageDatas.empty()) return false;
+	const std::string mimeTypeStr = getImageDatasMimeType();
+	if (extStr == "png") return (mimeTypeStr == "image/png");
+	if (extStr == "jpg" || extStr == "jpeg") return (mimeTypeStr == "image/jpeg");
+	return false;
+}
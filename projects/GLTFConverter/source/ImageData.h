@@ -36,6 +36,7 @@ public:
 
 	sxsdk::master_image_class* shadeMasterImage;	// Shade3Dでのマスターイメージクラス.
 	std::vector<unsigned char> imageRGBAData;		// Shade3Dでのイメージを1ピクセルRGBAで保持 (合成したもの)。エクスポータで使用.
+	uint64_t imageRGBAHash;							// imageRGBADataのハッシュ値.
 
 	std::string materialName;			// 参照しているマスターマテリアル名.
 	int imageMask;						// テクスチャとして使用している情報.
@@ -44,6 +45,7 @@ public:
 public:
 	CImageData ();
 	CImageData (const CImageData& v);
+	CImageData (CImageData&& v) = default;
 	~CImageData ();
 
     CImageData& operator = (const CImageData &v) {
@@ -56,10 +58,12 @@ public:
 		this->useBaseColorAlpha = v.useBaseColorAlpha;
 		this->shadeMasterImage  = v.shadeMasterImage;
 		this->imageRGBAData = v.imageRGBAData;
+		this->imageRGBAHash = v.imageRGBAHash;
 		this->materialName = v.materialName;
 
 		return (*this);
     }
+	CImageData& operator = (CImageData &&v) = default;
 
 	void clear ();
 
@@ -77,6 +81,18 @@ public:
 	 * 画像を取得.
 	 */
 	compointer<sxsdk::image_interface> getImage (sxsdk::scene_interface* scene) const;
+
+	/**
+	 * imageDatasの先頭のシグネチャから種類を取得.
+	 * @return "image/png" or "image/jpeg"。判別できない場合は"".
+	 */
+	std::string getImageDatasMimeType () const;
+
+	/**
+	 * 元のjpeg/pngのバイト列をそのまま出力できるか.
+	 * @param[in] extStr  出力する拡張子 ("jpg" or "png").
+	 */
+	bool canPassThroughImageDatas (const std::string& extStr) const;
 };
 
 #endif
@@ -0,0 +1,1362 @@
+﻿/**
+ * RGBAのピクセル情報をpng/jpegのバイト列にエンコード.
+ * Shade3DのAPIは使用していないため、複数スレッドから同時に呼び出すことができる.
+ */
+#include "ImageEncoder.h"
+
+#include <string.h>
+#include <math.h>
+#include <queue>
+#include <algorithm>
+
+namespace {
+	//----------------------------------------------------.
+	// CRC32/Adler32.
+	//----------------------------------------------------.
+	class CCRC32Table
+	{
+	public:
+		unsigned int table[256];
+
+		CCRC32Table () {
+			for (unsigned int i = 0; i < 256; ++i) {
+				unsigned int c = i;
+				for (int k = 0; k < 8; ++k) c = (c & 1) ? (0xedb88320U ^ (c >> 1)) : (c >> 1);
+				table[i] = c;
+			}
+		}
+	};
+	const CCRC32Table g_crc32Table;
+
+	unsigned int calcCRC32 (unsigned int crc, const unsigned char* data, const size_t size) {
+		crc = ~crc;
+		for (size_t i = 0; i < size; ++i) crc = g_crc32Table.table[(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+		return ~crc;
+	}
+
+	unsigned int calcAdler32 (const unsigned int adler, const unsigned char* data, const size_t size) {
+		unsigned int a = adler & 0xffff, b = (adler >> 16) & 0xffff;
+		size_t pos = 0;
+		while (pos < size) {
+			const size_t cou = std::min(size - pos, (size_t)5552);
+			for (size_t i = 0; i < cou; ++i) {
+				a += data[pos + i];
+				b += a;
+			}
+			a %= 65521;
+			b %= 65521;
+			pos += cou;
+		}
+		return (b << 16) | a;
+	}
+
+	void writeUInt32BE (std::vector<unsigned char>& buff, const unsigned int v) {
+		buff.push_back((unsigned char)((v >> 24) & 0xff));
+		buff.push_back((unsigned char)((v >> 16) & 0xff));
+		buff.push_back((unsigned char)((v >>  8) & 0xff));
+		buff.push_back((unsigned char)(v & 0xff));
+	}
+
+	//----------------------------------------------------.
+	// Huffman符号.
+	//----------------------------------------------------.
+	/**
+	 * 出現頻度から、最大ビット数以内のHuffman符号長を計算.
+	 * 最大ビット数を超える場合は、頻度を平滑化して再計算する.
+	 */
+	void buildHuffmanLengths (const std::vector<unsigned int>& freqs, const int maxBits, std::vector<unsigned char>& lengths) {
+		const int symbolsCou = (int)freqs.size();
+		lengths.assign(symbolsCou, 0);
+
+		std::vector<unsigned int> f = freqs;
+		std::vector<int> symbols;
+		std::vector<int> parents;
+		std::vector<int> depths;
+		while (true) {
+			symbols.clear();
+			for (int i = 0; i < symbolsCou; ++i) {
+				if (f[i] > 0) symbols.push_back(i);
+			}
+			const int usedCou = (int)symbols.size();
+			if (usedCou == 0) return;
+			if (usedCou == 1) {
+				lengths[symbols[0]] = 1;
+				return;
+			}
+
+			// 葉は0 - (usedCou - 1)、中間ノードはそれ以降。親の番号は常に子より大きい.
+			typedef std::pair<unsigned long long, int> HEAP_ITEM;
+			std::priority_queue<HEAP_ITEM, std::vector<HEAP_ITEM>, std::greater<HEAP_ITEM> > heap;
+			for (int i = 0; i < usedCou; ++i) heap.push(HEAP_ITEM(f[symbols[i]], i));
+			parents.assign(usedCou * 2 - 1, -1);
+			int nodeIndex = usedCou;
+			while (heap.size() > 1) {
+				const HEAP_ITEM a = heap.top(); heap.pop();
+				const HEAP_ITEM b = heap.top(); heap.pop();
+				parents[a.second] = nodeIndex;
+				parents[b.second] = nodeIndex;
+				heap.push(HEAP_ITEM(a.first + b.first, nodeIndex));
+				nodeIndex++;
+			}
+			const int rootIndex = nodeIndex - 1;
+			depths.assign(nodeIndex, 0);
+			int maxDepth = 0;
+			for (int i = rootIndex - 1; i >= 0; --i) {
+				depths[i] = depths[parents[i]] + 1;
+				if (i < usedCou) maxDepth = std::max(maxDepth, depths[i]);
+			}
+
+			if (maxDepth <= maxBits) {
+				for (int i = 0; i < usedCou; ++i) lengths[symbols[i]] = (unsigned char)depths[i];
+				return;
+			}
+			for (int i = 0; i < symbolsCou; ++i) {
+				if (f[i] > 0) f[i] = (f[i] >> 1) | 1;
+			}
+		}
+	}
+
+	/**
+	 * 符号長から、Deflate用の符号(ビット反転済み)を計算.
+	 */
+	void buildDeflateCodes (const std::vector<unsigned char>& lengths, std::vector<unsigned short>& codes) {
+		const int symbolsCou = (int)lengths.size();
+		int blCount[16];
+		int nextCode[16];
+		memset(blCount, 0, sizeof(int) * 16);
+		for (int i = 0; i < symbolsCou; ++i) blCount[lengths[i]]++;
+		blCount[0] = 0;
+
+		int code = 0;
+		nextCode[0] = 0;
+		for (int bits = 1; bits < 16; ++bits) {
+			code = (code + blCount[bits - 1]) << 1;
+			nextCode[bits] = code;
+		}
+
+		codes.assign(symbolsCou, 0);
+		for (int i = 0; i < symbolsCou; ++i) {
+			const int len = lengths[i];
+			if (len == 0) continue;
+			int c = nextCode[len]++;
+			int r = 0;
+			for (int k = 0; k < len; ++k) {
+				r = (r << 1) | (c & 1);
+				c >>= 1;
+			}
+			codes[i] = (unsigned short)r;
+		}
+	}
+
+	//----------------------------------------------------.
+	// Deflate (RFC1951).
+	//----------------------------------------------------.
+	const int DEFLATE_WINDOW_SIZE = 32768;
+	const int DEFLATE_WINDOW_MASK = DEFLATE_WINDOW_SIZE - 1;
+	const int DEFLATE_HASH_BITS   = 15;
+	const int DEFLATE_HASH_SIZE   = 1 << DEFLATE_HASH_BITS;
+	const int DEFLATE_MAX_MATCH   = 258;
+	const int DEFLATE_MIN_MATCH   = 3;
+	const size_t DEFLATE_MAX_BLOCK_SYMBOLS = 65536;
+	const size_t DEFLATE_STREAM_CHUNK_SIZE = 256 * 1024;	// ストリームで渡されたデータを圧縮する単位 (bytes).
+
+	const int g_lengthBase[29]  = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+	const int g_lengthExtra[29] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+	const int g_distBase[30]    = { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+	const int g_distExtra[30]   = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+	const int g_codeLengthOrder[19] = { 16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
+
+	/**
+	 * 一致長/距離からDeflateの符号番号を引くテーブル.
+	 */
+	class CDeflateCodeTable
+	{
+	public:
+		unsigned char lengthCode[DEFLATE_MAX_MATCH + 1];
+		unsigned char distCode[512];		// 0 - 256は距離-1、それ以降は((距離-1) >> 7) + 256.
+
+		CDeflateCodeTable () {
+			for (int code = 0; code < 29; ++code) {
+				const int cou = 1 << g_lengthExtra[code];
+				for (int i = 0; i < cou && g_lengthBase[code] + i <= DEFLATE_MAX_MATCH; ++i) lengthCode[g_lengthBase[code] + i] = (unsigned char)code;
+			}
+			lengthCode[DEFLATE_MAX_MATCH] = 28;
+
+			for (int code = 0; code < 30; ++code) {
+				const int cou = 1 << g_distExtra[code];
+				for (int i = 0; i < cou; ++i) {
+					const int d = g_distBase[code] + i - 1;
+					if (d < 256) distCode[d] = (unsigned char)code;
+					else distCode[256 + (d >> 7)] = (unsigned char)code;
+				}
+			}
+		}
+
+		inline int getDistCode (const int dist) const {
+			const int d = dist - 1;
+			return (d < 256) ? distCode[d] : distCode[256 + (d >> 7)];
+		}
+	};
+	const CDeflateCodeTable g_deflateCodeTable;
+
+	/**
+	 * LSBから詰めるビット出力 (Deflate用).
+	 */
+	class CDeflateBitWriter
+	{
+	private:
+		std::vector<unsigned char>& m_buff;
+		unsigned int m_bitBuff;
+		int m_bitCount;
+
+	public:
+		CDeflateBitWriter (std::vector<unsigned char>& buff) : m_buff(buff), m_bitBuff(0), m_bitCount(0) { }
+
+		inline void writeBits (const unsigned int v, const int bitsCou) {
+			m_bitBuff |= v << m_bitCount;
+			m_bitCount += bitsCou;
+			while (m_bitCount >= 8) {
+				m_buff.push_back((unsigned char)(m_bitBuff & 0xff));
+				m_bitBuff >>= 8;
+				m_bitCount -= 8;
+			}
+		}
+
+		void alignToByte () {
+			if (m_bitCount > 0) {
+				m_buff.push_back((unsigned char)(m_bitBuff & 0xff));
+				m_bitBuff  = 0;
+				m_bitCount = 0;
+			}
+		}
+
+		int getBitCount () const { return m_bitCount; }
+	};
+
+	/**
+	 * LZ77の符号 (dist == 0の場合はリテラル).
+	 */
+	struct DEFLATE_SYMBOL
+	{
+		unsigned short litLen;
+		unsigned short dist;
+	};
+
+	/**
+	 * Deflateの圧縮.
+	 * writeで渡されたデータはDEFLATE_STREAM_CHUNK_SIZEごとに圧縮するため、保持するのはスライド窓と未圧縮分のみとなる.
+	 * 圧縮する単位は渡し方によらないため、同じデータであれば同じ結果になる.
+	 */
+	class CDeflateEncoder
+	{
+	private:
+		std::vector<unsigned char> m_buff;		// 一致の参照用の圧縮済みのデータ (スライド窓) + 未圧縮のデータ.
+		size_t m_startPos;						// m_buffでの未圧縮のデータの開始位置.
+		const unsigned char* m_data;			// 圧縮中のm_buffの先頭.
+		size_t m_size;							// 圧縮中の終端位置.
+		int m_level;
+		int m_maxChain;
+		int m_niceLength;
+		bool m_lazyMatch;
+
+		std::vector<int> m_head;
+		std::vector<int> m_prev;
+		std::vector<DEFLATE_SYMBOL> m_symbols;
+		CDeflateBitWriter m_bitWriter;
+
+	public:
+		CDeflateEncoder (const int level, std::vector<unsigned char>& outBuff) : m_startPos(0), m_data(NULL), m_size(0), m_bitWriter(outBuff) {
+			static const int maxChainList[10]   = { 0, 4, 8, 16, 32, 64, 128, 256, 1024, 4096 };
+			static const int niceLengthList[10] = { 0, 16, 32, 32, 64, 128, 128, 258, 258, 258 };
+			const int lv = std::min(std::max(level, 0), 9);
+			m_level      = lv;
+			m_maxChain   = maxChainList[lv];
+			m_niceLength = niceLengthList[lv];
+			m_lazyMatch  = (lv >= 4);
+
+			if (m_level > 0) {
+				m_head.assign(DEFLATE_HASH_SIZE, -1);
+				m_prev.assign(DEFLATE_WINDOW_SIZE, -1);
+				m_symbols.reserve(DEFLATE_MAX_BLOCK_SYMBOLS + 2);
+			}
+		}
+
+		/**
+		 * データを追加.
+		 */
+		void write (const unsigned char* data, const size_t size) {
+			if (size == 0) return;
+			m_buff.insert(m_buff.end(), data, data + size);
+			while (m_buff.size() - m_startPos >= DEFLATE_STREAM_CHUNK_SIZE) {
+				m_compress(m_startPos + DEFLATE_STREAM_CHUNK_SIZE, false);
+			}
+		}
+
+		/**
+		 * 残りのデータを圧縮して、最後のブロックを出力.
+		 */
+		void finish () {
+			m_compress(m_buff.size(), true);
+			m_bitWriter.alignToByte();
+			std::vector<unsigned char>().swap(m_buff);
+			m_startPos = 0;
+		}
+
+	private:
+		/**
+		 * m_startPos - endPosまでを圧縮.
+		 */
+		void m_compress (const size_t endPos, const bool finalBlock) {
+			m_data = m_buff.empty() ? NULL : &(m_buff[0]);
+			m_size = endPos;
+
+			if (m_level <= 0) {
+				if (endPos > m_startPos || finalBlock) m_writeStoredBlocks(m_startPos, endPos, finalBlock);
+			} else {
+				m_encode(finalBlock);
+			}
+			m_slideWindow(endPos);
+		}
+
+		/**
+		 * 圧縮済みのデータのうち、スライド窓より前のものを捨てる.
+		 * m_prevの位置(pos & DEFLATE_WINDOW_MASK)が変わらないように、窓のサイズの倍数単位でずらす.
+		 */
+		void m_slideWindow (const size_t endPos) {
+			m_startPos = endPos;
+			if (endPos <= (size_t)DEFLATE_WINDOW_SIZE * 2) return;
+
+			const size_t shift = ((endPos - DEFLATE_WINDOW_SIZE) / DEFLATE_WINDOW_SIZE) * DEFLATE_WINDOW_SIZE;
+			m_buff.erase(m_buff.begin(), m_buff.begin() + shift);
+			m_startPos -= shift;
+
+			const int iShift = (int)shift;
+			for (size_t i = 0; i < m_head.size(); ++i) m_head[i] = (m_head[i] >= iShift) ? (m_head[i] - iShift) : -1;
+			for (size_t i = 0; i < m_prev.size(); ++i) m_prev[i] = (m_prev[i] >= iShift) ? (m_prev[i] - iShift) : -1;
+		}
+
+		void m_encode (const bool finalBlock) {
+			size_t blockStart = m_startPos;
+			size_t pos = m_startPos;
+			while (pos < m_size) {
+				int dist = 0;
+				int len = m_findMatch(pos, dist);
+				m_insertHash(pos);
+
+				// 1つ先の位置でより長い一致がある場合は、現在位置をリテラルとする.
+				if (len >= DEFLATE_MIN_MATCH && m_lazyMatch && len < m_niceLength && pos + 1 < m_size) {
+					int dist2 = 0;
+					const int len2 = m_findMatch(pos + 1, dist2);
+					if (len2 > len) {
+						m_addLiteral(m_data[pos]);
+						pos++;
+						len  = len2;
+						dist = dist2;
+						m_insertHash(pos);
+					}
+				}
+
+				if (len >= DEFLATE_MIN_MATCH) {
+					DEFLATE_SYMBOL sym;
+					sym.litLen = (unsigned short)len;
+					sym.dist   = (unsigned short)dist;
+					m_symbols.push_back(sym);
+					for (int k = 1; k < len; ++k) m_insertHash(pos + k);
+					pos += len;
+				} else {
+					m_addLiteral(m_data[pos]);
+					pos++;
+				}
+
+				if (m_symbols.size() >= DEFLATE_MAX_BLOCK_SYMBOLS) {
+					m_writeBlock(blockStart, pos, false);
+					blockStart = pos;
+				}
+			}
+			if (pos > blockStart || finalBlock) m_writeBlock(blockStart, pos, finalBlock);
+		}
+
+		inline unsigned int m_hash (const size_t pos) const {
+			return ((m_data[pos] << 10) ^ (m_data[pos + 1] << 5) ^ m_data[pos + 2]) & (DEFLATE_HASH_SIZE - 1);
+		}
+
+		inline void m_insertHash (const size_t pos) {
+			if (pos + 2 >= m_size) return;
+			const unsigned int h = m_hash(pos);
+			m_prev[pos & DEFLATE_WINDOW_MASK] = m_head[h];
+			m_head[h] = (int)pos;
+		}
+
+		inline void m_addLiteral (const unsigned char c) {
+			DEFLATE_SYMBOL sym;
+			sym.litLen = c;
+			sym.dist   = 0;
+			m_symbols.push_back(sym);
+		}
+
+		/**
+		 * 指定位置からの最長一致を探す.
+		 * @return 一致長 (3未満の場合は0).
+		 */
+		int m_findMatch (const size_t pos, int& bestDist) const {
+			if (pos + DEFLATE_MIN_MATCH > m_size) return 0;
+			const int maxLen = (int)std::min((size_t)DEFLATE_MAX_MATCH, m_size - pos);
+			const unsigned char* pCur = m_data + pos;
+
+			int bestLen = DEFLATE_MIN_MATCH - 1;
+			int chain = m_maxChain;
+			int cur = m_head[m_hash(pos)];
+			while (cur >= 0 && chain-- > 0) {
+				const int dist = (int)pos - cur;
+				if (dist <= 0 || dist > DEFLATE_WINDOW_SIZE) break;
+
+				const unsigned char* pPrev = m_data + cur;
+				if (pPrev[bestLen] == pCur[bestLen] && pPrev[0] == pCur[0] && pPrev[1] == pCur[1]) {
+					int len = 2;
+					while (len < maxLen && pPrev[len] == pCur[len]) len++;
+					if (len > bestLen) {
+						bestLen  = len;
+						bestDist = dist;
+						if (len >= m_niceLength || len >= maxLen) break;
+					}
+				}
+
+				const int next = m_prev[cur & DEFLATE_WINDOW_MASK];
+				if (next >= cur) break;
+				cur = next;
+			}
+			return (bestLen >= DEFLATE_MIN_MATCH) ? bestLen : 0;
+		}
+
+		/**
+		 * 無圧縮ブロックを出力.
+		 */
+		void m_writeStoredBlocks (const size_t startPos, const size_t endPos, const bool finalBlock) {
+			size_t pos = startPos;
+			do {
+				const size_t len = std::min(endPos - pos, (size_t)65535);
+				const bool lastF = finalBlock && (pos + len >= endPos);
+				m_bitWriter.writeBits(lastF ? 1 : 0, 1);
+				m_bitWriter.writeBits(0, 2);
+				m_bitWriter.alignToByte();
+				m_bitWriter.writeBits((unsigned int)(len & 0xff), 8);
+				m_bitWriter.writeBits((unsigned int)((len >> 8) & 0xff), 8);
+				m_bitWriter.writeBits((unsigned int)(~len & 0xff), 8);
+				m_bitWriter.writeBits((unsigned int)((~len >> 8) & 0xff), 8);
+				for (size_t i = 0; i < len; ++i) m_bitWriter.writeBits(m_data[pos + i], 8);
+				pos += len;
+			} while (pos < endPos);
+		}
+
+		/**
+		 * 動的Huffman符号のブロックを出力.
+		 * 無圧縮の方が小さい場合は無圧縮ブロックにする.
+		 */
+		void m_writeBlock (const size_t startPos, const size_t endPos, const bool finalBlock) {
+			std::vector<unsigned int> litFreqs(286, 0);
+			std::vector<unsigned int> distFreqs(30, 0);
+			const size_t symbolsCou = m_symbols.size();
+			for (size_t i = 0; i < symbolsCou; ++i) {
+				const DEFLATE_SYMBOL& sym = m_symbols[i];
+				if (sym.dist == 0) {
+					litFreqs[sym.litLen]++;
+				} else {
+					litFreqs[257 + g_deflateCodeTable.lengthCode[sym.litLen]]++;
+					distFreqs[g_deflateCodeTable.getDistCode(sym.dist)]++;
+				}
+			}
+			litFreqs[256] = 1;
+
+			// 符号の要素が1つだけの場合はデコーダ側でエラーになることがあるため、2つ以上にする.
+			if (std::count_if(litFreqs.begin(), litFreqs.end(), [](unsigned int v) { return v > 0; }) < 2) litFreqs[0]++;
+			for (int i = 0; i < 2; ++i) {
+				if (std::count_if(distFreqs.begin(), distFreqs.end(), [](unsigned int v) { return v > 0; }) < 2) {
+					if (distFreqs[i] == 0) distFreqs[i] = 1;
+				}
+			}
+
+			std::vector<unsigned char> litLengths, distLengths;
+			buildHuffmanLengths(litFreqs, 15, litLengths);
+			buildHuffmanLengths(distFreqs, 15, distLengths);
+
+			int hlit = 286;
+			while (hlit > 257 && litLengths[hlit - 1] == 0) hlit--;
+			int hdist = 30;
+			while (hdist > 1 && distLengths[hdist - 1] == 0) hdist--;
+
+			// 符号長をランレングス符号化.
+			std::vector<unsigned char> allLengths;
+			allLengths.reserve(hlit + hdist);
+			allLengths.insert(allLengths.end(), litLengths.begin(), litLengths.begin() + hlit);
+			allLengths.insert(allLengths.end(), distLengths.begin(), distLengths.begin() + hdist);
+
+			std::vector<std::pair<int, int> > clSymbols;		// first : 符号(0-18)、second : 追加ビットの値.
+			{
+				const int cou = (int)allLengths.size();
+				int i = 0;
+				while (i < cou) {
+					const int len = allLengths[i];
+					int run = 1;
+					while (i + run < cou && allLengths[i + run] == len) run++;
+
+					if (len == 0) {
+						int rest = run;
+						while (rest >= 11) {
+							const int r = std::min(rest, 138);
+							clSymbols.push_back(std::pair<int, int>(18, r - 11));
+							rest -= r;
+						}
+						if (rest >= 3) {
+							clSymbols.push_back(std::pair<int, int>(17, rest - 3));
+							rest = 0;
+						}
+						while (rest > 0) {
+							clSymbols.push_back(std::pair<int, int>(0, 0));
+							rest--;
+						}
+					} else {
+						clSymbols.push_back(std::pair<int, int>(len, 0));
+						int rest = run - 1;
+						while (rest >= 3) {
+							const int r = std::min(rest, 6);
+							clSymbols.push_back(std::pair<int, int>(16, r - 3));
+							rest -= r;
+						}
+						while (rest > 0) {
+							clSymbols.push_back(std::pair<int, int>(len, 0));
+							rest--;
+						}
+					}
+					i += run;
+				}
+			}
+
+			std::vector<unsigned int> clFreqs(19, 0);
+			for (size_t i = 0; i < clSymbols.size(); ++i) clFreqs[clSymbols[i].first]++;
+			for (int i = 0; i < 2; ++i) {
+				if (std::count_if(clFreqs.begin(), clFreqs.end(), [](unsigned int v) { return v > 0; }) < 2) {
+					if (clFreqs[i] == 0) clFreqs[i] = 1;
+				}
+			}
+			std::vector<unsigned char> clLengths;
+			buildHuffmanLengths(clFreqs, 7, clLengths);
+			int hclen = 19;
+			while (hclen > 4 && clLengths[g_codeLengthOrder[hclen - 1]] == 0) hclen--;
+
+			// 動的Huffmanでのビット数を計算し、無圧縮と比較.
+			unsigned long long dynamicBits = 3 + 5 + 5 + 4 + 3 * hclen;
+			for (size_t i = 0; i < clSymbols.size(); ++i) {
+				const int s = clSymbols[i].first;
+				dynamicBits += clLengths[s] + ((s == 16) ? 2 : ((s == 17) ? 3 : ((s == 18) ? 7 : 0)));
+			}
+			for (int i = 0; i < 286; ++i) {
+				if (litFreqs[i] == 0) continue;
+				dynamicBits += (unsigned long long)litFreqs[i] * (litLengths[i] + ((i >= 257) ? g_lengthExtra[i - 257] : 0));
+			}
+			for (int i = 0; i < 30; ++i) {
+				if (distFreqs[i] == 0) continue;
+				dynamicBits += (unsigned long long)distFreqs[i] * (distLengths[i] + g_distExtra[i]);
+			}
+			const size_t rawSize = endPos - startPos;
+			const unsigned long long storedBits = (unsigned long long)(rawSize + 5 * (rawSize / 65535 + 1)) * 8 + 7;
+			if (storedBits < dynamicBits) {
+				m_writeStoredBlocks(startPos, endPos, finalBlock);
+				m_symbols.clear();
+				return;
+			}
+
+			std::vector<unsigned short> litCodes, distCodes, clCodes;
+			buildDeflateCodes(litLengths, litCodes);
+			buildDeflateCodes(distLengths, distCodes);
+			buildDeflateCodes(clLengths, clCodes);
+
+			m_bitWriter.writeBits(finalBlock ? 1 : 0, 1);
+			m_bitWriter.writeBits(2, 2);
+			m_bitWriter.writeBits(hlit - 257, 5);
+			m_bitWriter.writeBits(hdist - 1, 5);
+			m_bitWriter.writeBits(hclen - 4, 4);
+			for (int i = 0; i < hclen; ++i) m_bitWriter.writeBits(clLengths[g_codeLengthOrder[i]], 3);
+			for (size_t i = 0; i < clSymbols.size(); ++i) {
+				const int s = clSymbols[i].first;
+				m_bitWriter.writeBits(clCodes[s], clLengths[s]);
+				if (s == 16) m_bitWriter.writeBits(clSymbols[i].second, 2);
+				else if (s == 17) m_bitWriter.writeBits(clSymbols[i].second, 3);
+				else if (s == 18) m_bitWriter.writeBits(clSymbols[i].second, 7);
+			}
+
+			for (size_t i = 0; i < symbolsCou; ++i) {
+				const DEFLATE_SYMBOL& sym = m_symbols[i];
+				if (sym.dist == 0) {
+					m_bitWriter.writeBits(litCodes[sym.litLen], litLengths[sym.litLen]);
+				} else {
+					const int lCode = g_deflateCodeTable.lengthCode[sym.litLen];
+					m_bitWriter.writeBits(litCodes[257 + lCode], litLengths[257 + lCode]);
+					if (g_lengthExtra[lCode] > 0) m_bitWriter.writeBits(sym.litLen - g_lengthBase[lCode], g_lengthExtra[lCode]);
+
+					const int dCode = g_deflateCodeTable.getDistCode(sym.dist);
+					m_bitWriter.writeBits(distCodes[dCode], distLengths[dCode]);
+					if (g_distExtra[dCode] > 0) m_bitWriter.writeBits(sym.dist - g_distBase[dCode], g_distExtra[dCode]);
+				}
+			}
+			m_bitWriter.writeBits(litCodes[256], litLengths[256]);
+			m_symbols.clear();
+		}
+	};
+
+	/**
+	 * zlib形式で圧縮.
+	 * 圧縮したデータは、outDataの末尾に追加していく.
+	 */
+	class CZlibEncoder
+	{
+	private:
+		std::vector<unsigned char>& m_outData;
+		CDeflateEncoder m_deflate;
+		unsigned int m_adler;
+
+	public:
+		CZlibEncoder (const int level, std::vector<unsigned char>& outData) : m_outData(outData), m_deflate(level, outData), m_adler(1) {
+			m_outData.push_back(0x78);
+			if (level <= 1) m_outData.push_back(0x01);
+			else if (level <= 5) m_outData.push_back(0x5e);
+			else if (level <= 6) m_outData.push_back(0x9c);
+			else m_outData.push_back(0xda);
+		}
+
+		void write (const unsigned char* data, const size_t size) {
+			m_adler = calcAdler32(m_adler, data, size);
+			m_deflate.write(data, size);
+		}
+
+		void finish () {
+			m_deflate.finish();
+			writeUInt32BE(m_outData, m_adler);
+		}
+	};
+
+	/**
+	 * pngのチャンクを出力.
+	 */
+	void writePNGChunk (std::vector<unsigned char>& outData, const char* type, const unsigned char* chunkData, const size_t chunkSize) {
+		writeUInt32BE(outData, (unsigned int)chunkSize);
+		const size_t typePos = outData.size();
+		outData.insert(outData.end(), type, type + 4);
+		if (chunkSize > 0) outData.insert(outData.end(), chunkData, chunkData + chunkSize);
+		writeUInt32BE(outData, calcCRC32(0, &(outData[typePos]), chunkSize + 4));
+	}
+
+	/**
+	 * Paethフィルタの予測値.
+	 */
+	inline int paethPredictor (const int a, const int b, const int c) {
+		const int p  = a + b - c;
+		const int pa = std::abs(p - a);
+		const int pb = std::abs(p - b);
+		const int pc = std::abs(p - c);
+		if (pa <= pb && pa <= pc) return a;
+		if (pb <= pc) return b;
+		return c;
+	}
+
+	//----------------------------------------------------.
+	// jpeg.
+	//----------------------------------------------------.
+	const int g_jpegZigZag[64] = {
+		0, 1, 5, 6, 14, 15, 27, 28, 2, 4, 7, 13, 16, 26, 29, 42,
+		3, 8, 12, 17, 25, 30, 41, 43, 9, 11, 18, 24, 31, 40, 44, 53,
+		10, 19, 23, 32, 39, 45, 52, 54, 20, 22, 33, 38, 46, 51, 55, 60,
+		21, 34, 37, 47, 50, 56, 59, 61, 35, 36, 48, 49, 57, 58, 62, 63
+	};
+
+	const int g_jpegLumQuant[64] = {
+		16, 11, 10, 16, 24, 40, 51, 61, 12, 12, 14, 19, 26, 58, 60, 55,
+		14, 13, 16, 24, 40, 57, 69, 56, 14, 17, 22, 29, 51, 87, 80, 62,
+		18, 22, 37, 56, 68, 109, 103, 77, 24, 35, 55, 64, 81, 104, 113, 92,
+		49, 64, 78, 87, 103, 121, 120, 101, 72, 92, 95, 98, 112, 100, 103, 99
+	};
+
+	const int g_jpegChromQuant[64] = {
+		17, 18, 24, 47, 99, 99, 99, 99, 18, 21, 26, 66, 99, 99, 99, 99,
+		24, 26, 56, 99, 99, 99, 99, 99, 47, 66, 99, 99, 99, 99, 99, 99,
+		99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99,
+		99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99
+	};
+
+	// 標準のHuffmanテーブル (ITU-T T.81 K.3).
+	const unsigned char g_jpegDCLumBits[16]   = { 0, 1, 5, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0, 0, 0 };
+	const unsigned char g_jpegDCLumVals[12]   = { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11 };
+	const unsigned char g_jpegDCChromBits[16] = { 0, 3, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0 };
+	const unsigned char g_jpegDCChromVals[12] = { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11 };
+	const unsigned char g_jpegACLumBits[16]   = { 0, 2, 1, 3, 3, 2, 4, 3, 5, 5, 4, 4, 0, 0, 1, 0x7d };
+	const unsigned char g_jpegACLumVals[162]  = {
+		0x01, 0x02, 0x03, 0x00, 0x04, 0x11, 0x05, 0x12, 0x21, 0x31, 0x41, 0x06, 0x13, 0x51, 0x61, 0x07, 0x22, 0x71,
+		0x14, 0x32, 0x81, 0x91, 0xa1, 0x08, 0x23, 0x42, 0xb1, 0xc1, 0x15, 0x52, 0xd1, 0xf0, 0x24, 0x33, 0x62, 0x72,
+		0x82, 0x09, 0x0a, 0x16, 0x17, 0x18, 0x19, 0x1a, 0x25, 0x26, 0x27, 0x28, 0x29, 0x2a, 0x34, 0x35, 0x36, 0x37,
+		0x38, 0x39, 0x3a, 0x43, 0x44, 0x45, 0x46, 0x47, 0x48, 0x49, 0x4a, 0x53, 0x54, 0x55, 0x56, 0x57, 0x58, 0x59,
+		0x5a, 0x63, 0x64, 0x65, 0x66, 0x67, 0x68, 0x69, 0x6a, 0x73, 0x74, 0x75, 0x76, 0x77, 0x78, 0x79, 0x7a, 0x83,
+		0x84, 0x85, 0x86, 0x87, 0x88, 0x89, 0x8a, 0x92, 0x93, 0x94, 0x95, 0x96, 0x97, 0x98, 0x99, 0x9a, 0xa2, 0xa3,
+		0xa4, 0xa5, 0xa6, 0xa7, 0xa8, 0xa9, 0xaa, 0xb2, 0xb3, 0xb4, 0xb5, 0xb6, 0xb7, 0xb8, 0xb9, 0xba, 0xc2, 0xc3,
+		0xc4, 0xc5, 0xc6, 0xc7, 0xc8, 0xc9, 0xca, 0xd2, 0xd3, 0xd4, 0xd5, 0xd6, 0xd7, 0xd8, 0xd9, 0xda, 0xe1, 0xe2,
+		0xe3, 0xe4, 0xe5, 0xe6, 0xe7, 0xe8, 0xe9, 0xea, 0xf1, 0xf2, 0xf3, 0xf4, 0xf5, 0xf6, 0xf7, 0xf8, 0xf9, 0xfa
+	};
+	const unsigned char g_jpegACChromBits[16] = { 0, 2, 1, 2, 4, 4, 3, 4, 7, 5, 4, 4, 0, 1, 2, 0x77 };
+	const unsigned char g_jpegACChromVals[162] = {
+		0x00, 0x01, 0x02, 0x03, 0x11, 0x04, 0x05, 0x21, 0x31, 0x06, 0x12, 0x41, 0x51, 0x07, 0x61, 0x71, 0x13, 0x22,
+		0x32, 0x81, 0x08, 0x14, 0x42, 0x91, 0xa1, 0xb1, 0xc1, 0x09, 0x23, 0x33, 0x52, 0xf0, 0x15, 0x62, 0x72, 0xd1,
+		0x0a, 0x16, 0x24, 0x34, 0xe1, 0x25, 0xf1, 0x17, 0x18, 0x19, 0x1a, 0x26, 0x27, 0x28, 0x29, 0x2a, 0x35, 0x36,
+		0x37, 0x38, 0x39, 0x3a, 0x43, 0x44, 0x45, 0x46, 0x47, 0x48, 0x49, 0x4a, 0x53, 0x54, 0x55, 0x56, 0x57, 0x58,
+		0x59, 0x5a, 0x63, 0x64, 0x65, 0x66, 0x67, 0x68, 0x69, 0x6a, 0x73, 0x74, 0x75, 0x76, 0x77, 0x78, 0x79, 0x7a,
+		0x82, 0x83, 0x84, 0x85, 0x86, 0x87, 0x88, 0x89, 0x8a, 0x92, 0x93, 0x94, 0x95, 0x96, 0x97, 0x98, 0x99, 0x9a,
+		0xa2, 0xa3, 0xa4, 0xa5, 0xa6, 0xa7, 0xa8, 0xa9, 0xaa, 0xb2, 0xb3, 0xb4, 0xb5, 0xb6, 0xb7, 0xb8, 0xb9, 0xba,
+		0xc2, 0xc3, 0xc4, 0xc5, 0xc6, 0xc7, 0xc8, 0xc9, 0xca, 0xd2, 0xd3, 0xd4, 0xd5, 0xd6, 0xd7, 0xd8, 0xd9, 0xda,
+		0xe2, 0xe3, 0xe4, 0xe5, 0xe6, 0xe7, 0xe8, 0xe9, 0xea, 0xf2, 0xf3, 0xf4, 0xf5, 0xf6, 0xf7, 0xf8, 0xf9, 0xfa
+	};
+
+	/**
+	 * jpeg用のHuffman符号テーブル.
+	 */
+	class CJpegHuffmanTable
+	{
+	public:
+		unsigned short codes[256];
+		unsigned char sizes[256];
+
+		CJpegHuffmanTable (const unsigned char* bits, const unsigned char* vals) {
+			memset(codes, 0, sizeof(unsigned short) * 256);
+			memset(sizes, 0, sizeof(unsigned char) * 256);
+			int code = 0;
+			int k = 0;
+			for (int len = 1; len <= 16; ++len) {
+				for (int i = 0; i < bits[len - 1]; ++i) {
+					codes[vals[k]] = (unsigned short)code;
+					sizes[vals[k]] = (unsigned char)len;
+					code++;
+					k++;
+				}
+				code <<= 1;
+			}
+		}
+	};
+	const CJpegHuffmanTable g_jpegDCLumTable(g_jpegDCLumBits, g_jpegDCLumVals);
+	const CJpegHuffmanTable g_jpegDCChromTable(g_jpegDCChromBits, g_jpegDCChromVals);
+	const CJpegHuffmanTable g_jpegACLumTable(g_jpegACLumBits, g_jpegACLumVals);
+	const CJpegHuffmanTable g_jpegACChromTable(g_jpegACChromBits, g_jpegACChromVals);
+
+	/**
+	 * MSBから詰めるビット出力 (jpeg用。0xffの後に0x00を挿入する).
+	 */
+	class CJpegBitWriter
+	{
+	private:
+		std::vector<unsigned char>& m_buff;
+		unsigned int m_bitBuff;
+		int m_bitCount;
+
+	public:
+		CJpegBitWriter (std::vector<unsigned char>& buff) : m_buff(buff), m_bitBuff(0), m_bitCount(0) { }
+
+		inline void writeBits (const unsigned int code, const int bitsCou) {
+			m_bitCount += bitsCou;
+			m_bitBuff |= (code & ((1U << bitsCou) - 1)) << (24 - m_bitCount);
+			while (m_bitCount >= 8) {
+				const unsigned char c = (unsigned char)((m_bitBuff >> 16) & 0xff);
+				m_buff.push_back(c);
+				if (c == 0xff) m_buff.push_back(0);
+				m_bitBuff = (m_bitBuff << 8) & 0xffffff;
+				m_bitCount -= 8;
+			}
+		}
+
+		void flush () {
+			writeBits(0x7f, 7);
+		}
+	};
+
+	/**
+	 * 1次元のDCT (AAN).
+	 */
+	inline void jpegDCT (float* d0, float* d1, float* d2, float* d3, float* d4, float* d5, float* d6, float* d7) {
+		const float tmp0 = *d0 + *d7;
+		const float tmp7 = *d0 - *d7;
+		const float tmp1 = *d1 + *d6;
+		const float tmp6 = *d1 - *d6;
+		const float tmp2 = *d2 + *d5;
+		const float tmp5 = *d2 - *d5;
+		const float tmp3 = *d3 + *d4;
+		const float tmp4 = *d3 - *d4;
+
+		// 偶数部.
+		float tmp10 = tmp0 + tmp3;
+		const float tmp13 = tmp0 - tmp3;
+		float tmp11 = tmp1 + tmp2;
+		float tmp12 = tmp1 - tmp2;
+		*d0 = tmp10 + tmp11;
+		*d4 = tmp10 - tmp11;
+		const float z1 = (tmp12 + tmp13) * 0.707106781f;
+		*d2 = tmp13 + z1;
+		*d6 = tmp13 - z1;
+
+		// 奇数部.
+		tmp10 = tmp4 + tmp5;
+		tmp11 = tmp5 + tmp6;
+		tmp12 = tmp6 + tmp7;
+		const float z5 = (tmp10 - tmp12) * 0.382683433f;
+		const float z2 = tmp10 * 0.541196100f + z5;
+		const float z4 = tmp12 * 1.306562965f + z5;
+		const float z3 = tmp11 * 0.707106781f;
+		const float z11 = tmp7 + z3;
+		const float z13 = tmp7 - z3;
+		*d5 = z13 + z2;
+		*d3 = z13 - z2;
+		*d1 = z11 + z4;
+		*d7 = z11 - z4;
+	}
+
+	inline void jpegCalcBits (const int val, unsigned int& bitsVal, int& bitsCou) {
+		int tmp = (val < 0) ? -val : val;
+		const int v = (val < 0) ? (val - 1) : val;
+		bitsCou = 0;
+		while (tmp) {
+			bitsCou++;
+			tmp >>= 1;
+		}
+		bitsVal = (unsigned int)v & ((1U << bitsCou) - 1);
+	}
+
+	/**
+	 * 8x8のブロックをDCT/量子化してHuffman符号化.
+	 * @return DC成分.
+	 */
+	int jpegProcessBlock (CJpegBitWriter& bitWriter, float* cdu, const float* fdtbl, const int dc, const CJpegHuffmanTable& dcTable, const CJpegHuffmanTable& acTable) {
+		for (int i = 0; i < 64; i += 8) {
+			jpegDCT(&cdu[i], &cdu[i + 1], &cdu[i + 2], &cdu[i + 3], &cdu[i + 4], &cdu[i + 5], &cdu[i + 6], &cdu[i + 7]);
+		}
+		for (int i = 0; i < 8; ++i) {
+			jpegDCT(&cdu[i], &cdu[i + 8], &cdu[i + 16], &cdu[i + 24], &cdu[i + 32], &cdu[i + 40], &cdu[i + 48], &cdu[i + 56]);
+		}
+
+		int du[64];
+		for (int i = 0; i < 64; ++i) {
+			const float v = cdu[i] * fdtbl[i];
+			du[g_jpegZigZag[i]] = (int)((v < 0.0f) ? (v - 0.5f) : (v + 0.5f));
+		}
+
+		unsigned int bitsVal;
+		int bitsCou;
+
+		// DC成分.
+		const int diff = du[0] - dc;
+		if (diff == 0) {
+			bitWriter.writeBits(dcTable.codes[0], dcTable.sizes[0]);
+		} else {
+			jpegCalcBits(diff, bitsVal, bitsCou);
+			bitWriter.writeBits(dcTable.codes[bitsCou], dcTable.sizes[bitsCou]);
+			bitWriter.writeBits(bitsVal, bitsCou);
+		}
+
+		// AC成分.
+		int end0Pos = 63;
+		while (end0Pos > 0 && du[end0Pos] == 0) end0Pos--;
+		if (end0Pos == 0) {
+			bitWriter.writeBits(acTable.codes[0x00], acTable.sizes[0x00]);
+			return du[0];
+		}
+		for (int i = 1; i <= end0Pos; ++i) {
+			const int startPos = i;
+			while (du[i] == 0 && i <= end0Pos) i++;
+			int zerosCou = i - startPos;
+			if (zerosCou >= 16) {
+				const int lng = zerosCou >> 4;
+				for (int k = 0; k < lng; ++k) bitWriter.writeBits(acTable.codes[0xf0], acTable.sizes[0xf0]);
+				zerosCou &= 15;
+			}
+			jpegCalcBits(du[i], bitsVal, bitsCou);
+			const int sym = (zerosCou << 4) + bitsCou;
+			bitWriter.writeBits(acTable.codes[sym], acTable.sizes[sym]);
+			bitWriter.writeBits(bitsVal, bitsCou);
+		}
+		if (end0Pos != 63) bitWriter.writeBits(acTable.codes[0x00], acTable.sizes[0x00]);
+
+		return du[0];
+	}
+}
+
+/**
+ * RGBAのうち、Alpha値が255でないピクセルが存在するか.
+ */
+bool ImageEncoder::hasAlpha (const unsigned char* rgbaData, const int width, const int height)
+{
+	const size_t pixelsCou = (size_t)width * (size_t)height;
+	for (size_t i = 0; i < pixelsCou; ++i) {
+		if (rgbaData[i * 4 + 3] != 255) return true;
+	}
+	return false;
+}
+
+//----------------------------------------------------.
+// 行単位でのエンコード.
+//----------------------------------------------------.
+class ImageEncoder::CStreamEncoder::CImpl
+{
+public:
+	virtual ~CImpl () { }
+
+	/**
+	 * 上から順に、指定行数分のRGBAを渡す.
+	 */
+	virtual void writeRows (const unsigned char* rgbaData, const int rowsCou) = 0;
+
+	/**
+	 * エンコードを終了.
+	 */
+	virtual void finish () = 0;
+};
+
+namespace {
+	// pngのIDATを区切るサイズ (bytes).
+	const size_t PNG_IDAT_CHUNK_SIZE = 64 * 1024;
+
+	/**
+	 * pngのエンコード.
+	 * 行ごとにフィルタをかけてzlibに渡し、圧縮したデータはPNG_IDAT_CHUNK_SIZEごとにIDATとして出力する.
+	 */
+	class CPNGStreamEncoder : public ImageEncoder::CStreamEncoder::CImpl
+	{
+	private:
+		std::vector<unsigned char>& m_outData;
+		int m_width;
+		int m_channels;
+		int m_compressionLevel;
+		size_t m_stride;
+
+		std::vector<unsigned char> m_rawLine, m_prevLine;		// フィルタ前の行データ.
+		std::vector<unsigned char> m_tempLine;
+		std::vector<unsigned char> m_filteredLine;				// 先頭にフィルタの種類を付けた行データ.
+		std::vector<unsigned char> m_compressedData;			// IDATとして未出力の圧縮データ.
+		CZlibEncoder m_zlib;
+
+	public:
+		CPNGStreamEncoder (const int width, const int height, const bool useAlpha, const int compressionLevel, std::vector<unsigned char>& outData)
+			: m_outData(outData), m_width(width), m_channels(useAlpha ? 4 : 3), m_compressionLevel(compressionLevel), m_zlib(compressionLevel, m_compressedData) {
+			m_stride = (size_t)width * m_channels;
+			m_rawLine.resize(m_stride);
+			m_prevLine.assign(m_stride, 0);
+			m_tempLine.resize(m_stride);
+			m_filteredLine.resize(m_stride + 1);
+
+			static const unsigned char signature[8] = { 0x89, 'P', 'N', 'G', 0x0d, 0x0a, 0x1a, 0x0a };
+			m_outData.insert(m_outData.end(), signature, signature + 8);
+
+			std::vector<unsigned char> ihdr;
+			writeUInt32BE(ihdr, (unsigned int)width);
+			writeUInt32BE(ihdr, (unsigned int)height);
+			ihdr.push_back(8);							// Bit depth.
+			ihdr.push_back(useAlpha ? 6 : 2);			// Color type (6:RGBA / 2:RGB).
+			ihdr.push_back(0);							// Compression method.
+			ihdr.push_back(0);							// Filter method.
+			ihdr.push_back(0);							// Interlace method.
+			writePNGChunk(m_outData, "IHDR", &(ihdr[0]), ihdr.size());
+		}
+
+		virtual void writeRows (const unsigned char* rgbaData, const int rowsCou) {
+			const int channels = m_channels;
+			const size_t stride = m_stride;
+
+			for (int y = 0; y < rowsCou; ++y) {
+				const unsigned char* pSrc = rgbaData + (size_t)y * m_width * 4;
+				if (channels == 4) {
+					memcpy(&(m_rawLine[0]), pSrc, stride);
+				} else {
+					for (int x = 0; x < m_width; ++x) {
+						m_rawLine[x * 3 + 0] = pSrc[x * 4 + 0];
+						m_rawLine[x * 3 + 1] = pSrc[x * 4 + 1];
+						m_rawLine[x * 3 + 2] = pSrc[x * 4 + 2];
+					}
+				}
+
+				// 圧縮する場合は、5種類のフィルタのうち差分の絶対値の和が最小のものを採用する.
+				unsigned char* pDst = &(m_filteredLine[0]);
+				if (m_compressionLevel <= 0) {
+					pDst[0] = 0;
+					memcpy(pDst + 1, &(m_rawLine[0]), stride);
+				} else {
+					unsigned long long minSum = 0;
+					for (int filterType = 0; filterType < 5; ++filterType) {
+						unsigned long long sum = 0;
+						for (size_t i = 0; i < stride; ++i) {
+							const int a = (i >= (size_t)channels) ? m_rawLine[i - channels] : 0;
+							const int b = m_prevLine[i];
+							const int c = (i >= (size_t)channels) ? m_prevLine[i - channels] : 0;
+							int v = m_rawLine[i];
+							switch (filterType) {
+							case 1: v -= a; break;
+							case 2: v -= b; break;
+							case 3: v -= (a + b) >> 1; break;
+							case 4: v -= paethPredictor(a, b, c); break;
+							}
+							m_tempLine[i] = (unsigned char)(v & 0xff);
+							sum += (m_tempLine[i] < 128) ? m_tempLine[i] : (256 - m_tempLine[i]);
+						}
+						if (filterType == 0 || sum < minSum) {
+							minSum = sum;
+							pDst[0] = (unsigned char)filterType;
+							memcpy(pDst + 1, &(m_tempLine[0]), stride);
+						}
+					}
+				}
+				m_rawLine.swap(m_prevLine);
+
+				m_zlib.write(pDst, stride + 1);
+				m_flushIDAT(false);
+			}
+		}
+
+		virtual void finish () {
+			m_zlib.finish();
+			m_flushIDAT(true);
+			writePNGChunk(m_outData, "IEND", NULL, 0);
+		}
+
+	private:
+		/**
+		 * 圧縮したデータをIDATとして出力.
+		 * 渡し方によらず同じ結果になるように、最後以外はPNG_IDAT_CHUNK_SIZE単位で区切る.
+		 */
+		void m_flushIDAT (const bool finalChunk) {
+			size_t pos = 0;
+			while (m_compressedData.size() - pos >= PNG_IDAT_CHUNK_SIZE) {
+				writePNGChunk(m_outData, "IDAT", &(m_compressedData[pos]), PNG_IDAT_CHUNK_SIZE);
+				pos += PNG_IDAT_CHUNK_SIZE;
+			}
+			if (finalChunk && pos < m_compressedData.size()) {
+				writePNGChunk(m_outData, "IDAT", &(m_compressedData[pos]), m_compressedData.size() - pos);
+				pos = m_compressedData.size();
+			}
+			if (pos > 0) m_compressedData.erase(m_compressedData.begin(), m_compressedData.begin() + pos);
+		}
+	};
+
+	/**
+	 * jpegのエンコード (ベースライン).
+	 * MCUの1行分(8行または16行)のRGBAがたまるごとに符号化する.
+	 * 品質が90以下の場合は、色差を4:2:0で間引く.
+	 */
+	class CJpegStreamEncoder : public ImageEncoder::CStreamEncoder::CImpl
+	{
+	private:
+		std::vector<unsigned char>& m_outData;
+		int m_width;
+		bool m_subsample;
+		int m_mcuSize;								// MCUの縦横のピクセル数 (8 or 16).
+		float m_fdtblLum[64], m_fdtblChrom[64];
+
+		std::vector<unsigned char> m_stripData;		// MCUの1行分のRGBA.
+		int m_stripRows;							// m_stripDataに格納済みの行数.
+
+		CJpegBitWriter m_bitWriter;
+		int m_dcY, m_dcU, m_dcV;
+
+	public:
+		CJpegStreamEncoder (const int width, const int height, const int quality, std::vector<unsigned char>& outData)
+			: m_outData(outData), m_width(width), m_stripRows(0), m_bitWriter(outData), m_dcY(0), m_dcU(0), m_dcV(0) {
+			const int q = std::min(std::max(quality, 1), 100);
+			const int scale = (q < 50) ? (5000 / q) : (200 - q * 2);
+			const bool subsample = (q <= 90);
+			m_subsample = subsample;
+			m_mcuSize   = subsample ? 16 : 8;
+			m_stripData.resize((size_t)width * m_mcuSize * 4);
+
+			// 量子化テーブル (ジグザグ順).
+			unsigned char lumTable[64], chromTable[64];
+			for (int i = 0; i < 64; ++i) {
+				lumTable[g_jpegZigZag[i]]   = (unsigned char)std::min(std::max((g_jpegLumQuant[i] * scale + 50) / 100, 1), 255);
+				chromTable[g_jpegZigZag[i]] = (unsigned char)std::min(std::max((g_jpegChromQuant[i] * scale + 50) / 100, 1), 255);
+			}
+
+			// AANのDCTのスケールを含めた、量子化の係数.
+			static const float aasf[8] = {
+				1.0f * 2.828427125f, 1.387039845f * 2.828427125f, 1.306562965f * 2.828427125f, 1.175875602f * 2.828427125f,
+				1.0f * 2.828427125f, 0.785694958f * 2.828427125f, 0.541196100f * 2.828427125f, 0.275899379f * 2.828427125f
+			};
+			for (int row = 0, k = 0; row < 8; ++row) {
+				for (int col = 0; col < 8; ++col, ++k) {
+					m_fdtblLum[k]   = 1.0f / ((float)lumTable[g_jpegZigZag[k]] * aasf[row] * aasf[col]);
+					m_fdtblChrom[k] = 1.0f / ((float)chromTable[g_jpegZigZag[k]] * aasf[row] * aasf[col]);
+				}
+			}
+
+			// SOI / APP0(JFIF).
+			{
+				static const unsigned char head[] = { 0xff, 0xd8, 0xff, 0xe0, 0, 0x10, 'J', 'F', 'I', 'F', 0, 1, 1, 0, 0, 1, 0, 1, 0, 0 };
+				m_outData.insert(m_outData.end(), head, head + sizeof(head));
+			}
+
+			// DQT.
+			{
+				static const unsigned char head[] = { 0xff, 0xdb, 0, 0x84 };
+				m_outData.insert(m_outData.end(), head, head + sizeof(head));
+				m_outData.push_back(0);
+				m_outData.insert(m_outData.end(), lumTable, lumTable + 64);
+				m_outData.push_back(1);
+				m_outData.insert(m_outData.end(), chromTable, chromTable + 64);
+			}
+
+			// SOF0.
+			{
+				const unsigned char head[] = {
+					0xff, 0xc0, 0, 0x11, 8,
+					(unsigned char)(height >> 8), (unsigned char)(height & 0xff), (unsigned char)(width >> 8), (unsigned char)(width & 0xff),
+					3, 1, (unsigned char)(subsample ? 0x22 : 0x11), 0, 2, 0x11, 1, 3, 0x11, 1
+				};
+				m_outData.insert(m_outData.end(), head, head + sizeof(head));
+			}
+
+			// DHT.
+			{
+				static const unsigned char head[] = { 0xff, 0xc4, 0x01, 0xa2 };
+				m_outData.insert(m_outData.end(), head, head + sizeof(head));
+				m_outData.push_back(0x00);
+				m_outData.insert(m_outData.end(), g_jpegDCLumBits, g_jpegDCLumBits + 16);
+				m_outData.insert(m_outData.end(), g_jpegDCLumVals, g_jpegDCLumVals + 12);
+				m_outData.push_back(0x10);
+				m_outData.insert(m_outData.end(), g_jpegACLumBits, g_jpegACLumBits + 16);
+				m_outData.insert(m_outData.end(), g_jpegACLumVals, g_jpegACLumVals + 162);
+				m_outData.push_back(0x01);
+				m_outData.insert(m_outData.end(), g_jpegDCChromBits, g_jpegDCChromBits + 16);
+				m_outData.insert(m_outData.end(), g_jpegDCChromVals, g_jpegDCChromVals + 12);
+				m_outData.push_back(0x11);
+				m_outData.insert(m_outData.end(), g_jpegACChromBits, g_jpegACChromBits + 16);
+				m_outData.insert(m_outData.end(), g_jpegACChromVals, g_jpegACChromVals + 162);
+			}
+
+			// SOS.
+			{
+				static const unsigned char head[] = { 0xff, 0xda, 0, 0x0c, 3, 1, 0, 2, 0x11, 3, 0x11, 0, 0x3f, 0 };
+				m_outData.insert(m_outData.end(), head, head + sizeof(head));
+			}
+		}
+
+		virtual void writeRows (const unsigned char* rgbaData, const int rowsCou) {
+			const size_t rowBytes = (size_t)m_width * 4;
+			for (int y = 0; y < rowsCou; ++y) {
+				memcpy(&(m_stripData[rowBytes * m_stripRows]), rgbaData + rowBytes * y, rowBytes);
+				m_stripRows++;
+				if (m_stripRows >= m_mcuSize) {
+					m_encodeStrip();
+					m_stripRows = 0;
+				}
+			}
+		}
+
+		virtual void finish () {
+			// 画像外の行は、最後の行を参照する.
+			if (m_stripRows > 0) {
+				const size_t rowBytes = (size_t)m_width * 4;
+				for (int y = m_stripRows; y < m_mcuSize; ++y) {
+					memcpy(&(m_stripData[rowBytes * y]), &(m_stripData[rowBytes * (m_stripRows - 1)]), rowBytes);
+				}
+				m_encodeStrip();
+				m_stripRows = 0;
+			}
+			m_bitWriter.flush();
+
+			// EOI.
+			m_outData.push_back(0xff);
+			m_outData.push_back(0xd9);
+		}
+
+	private:
+		/**
+		 * 指定位置のYCbCrを取得 (画像外は端のピクセルを参照).
+		 */
+		inline void m_getYUV (int x, const int y, float& fY, float& fU, float& fV) const {
+			x = std::min(x, m_width - 1);
+			const unsigned char* p = &(m_stripData[((size_t)y * m_width + x) * 4]);
+			const float r = (float)p[0];
+			const float g = (float)p[1];
+			const float b = (float)p[2];
+			fY = +0.29900f * r + 0.58700f * g + 0.11400f * b - 128.0f;
+			fU = -0.16874f * r - 0.33126f * g + 0.50000f * b;
+			fV = +0.50000f * r - 0.41869f * g - 0.08131f * b;
+		}
+
+		/**
+		 * MCUの1行分を符号化.
+		 */
+		void m_encodeStrip () {
+			float yBlock[64], uBlock[64], vBlock[64];
+
+			if (m_subsample) {
+				float yMCU[256], uMCU[256], vMCU[256];
+				for (int x = 0; x < m_width; x += 16) {
+					for (int row = 0, pos = 0; row < 16; ++row) {
+						for (int col = 0; col < 16; ++col, ++pos) m_getYUV(x + col, row, yMCU[pos], uMCU[pos], vMCU[pos]);
+					}
+					for (int by = 0; by < 2; ++by) {
+						for (int bx = 0; bx < 2; ++bx) {
+							for (int row = 0; row < 8; ++row) {
+								for (int col = 0; col < 8; ++col) yBlock[row * 8 + col] = yMCU[(by * 8 + row) * 16 + bx * 8 + col];
+							}
+							m_dcY = jpegProcessBlock(m_bitWriter, yBlock, m_fdtblLum, m_dcY, g_jpegDCLumTable, g_jpegACLumTable);
+						}
+					}
+					for (int row = 0; row < 8; ++row) {
+						for (int col = 0; col < 8; ++col) {
+							const int p = (row * 2) * 16 + col * 2;
+							uBlock[row * 8 + col] = (uMCU[p] + uMCU[p + 1] + uMCU[p + 16] + uMCU[p + 17]) * 0.25f;
+							vBlock[row * 8 + col] = (vMCU[p] + vMCU[p + 1] + vMCU[p + 16] + vMCU[p + 17]) * 0.25f;
+						}
+					}
+					m_dcU = jpegProcessBlock(m_bitWriter, uBlock, m_fdtblChrom, m_dcU, g_jpegDCChromTable, g_jpegACChromTable);
+					m_dcV = jpegProcessBlock(m_bitWriter, vBlock, m_fdtblChrom, m_dcV, g_jpegDCChromTable, g_jpegACChromTable);
+				}
+			} else {
+				for (int x = 0; x < m_width; x += 8) {
+					for (int row = 0, pos = 0; row < 8; ++row) {
+						for (int col = 0; col < 8; ++col, ++pos) m_getYUV(x + col, row, yBlock[pos], uBlock[pos], vBlock[pos]);
+					}
+					m_dcY = jpegProcessBlock(m_bitWriter, yBlock, m_fdtblLum, m_dcY, g_jpegDCLumTable, g_jpegACLumTable);
+					m_dcU = jpegProcessBlock(m_bitWriter, uBlock, m_fdtblChrom, m_dcU, g_jpegDCChromTable, g_jpegACChromTable);
+					m_dcV = jpegProcessBlock(m_bitWriter, vBlock, m_fdtblChrom, m_dcV, g_jpegDCChromTable, g_jpegACChromTable);
+				}
+			}
+		}
+	};
+}
+
+ImageEncoder::CStreamEncoder::CStreamEncoder () : m_pImpl(NULL), m_pOutData(NULL), m_height(0), m_rowsCount(0)
+{
+}
+
+ImageEncoder::CStreamEncoder::~CStreamEncoder ()
+{
+	m_clear();
+}
+
+void ImageEncoder::CStreamEncoder::m_clear ()
+{
+	delete m_pImpl;
+	m_pImpl     = NULL;
+	m_pOutData  = NULL;
+	m_height    = 0;
+	m_rowsCount = 0;
+}
+
+/**
+ * エンコードに失敗した場合に、途中までの出力を破棄.
+ */
+void ImageEncoder::CStreamEncoder::m_abort ()
+{
+	if (m_pOutData) m_pOutData->clear();
+	m_clear();
+}
+
+/**
+ * pngのエンコードを開始.
+ */
+bool ImageEncoder::CStreamEncoder::beginPNG (const int width, const int height, const bool useAlpha, const int compressionLevel, std::vector<unsigned char>& outData)
+{
+	m_clear();
+	outData.clear();
+	if (width <= 0 || height <= 0) return false;
+
+	try {
+		m_pOutData  = &outData;
+		m_height    = height;
+		m_pImpl     = new CPNGStreamEncoder(width, height, useAlpha, compressionLevel, outData);
+		return true;
+	} catch (...) { }
+
+	m_abort();
+	return false;
+}
+
+/**
+ * jpegのエンコードを開始.
+ */
+bool ImageEncoder::CStreamEncoder::beginJPEG (const int width, const int height, const int quality, std::vector<unsigned char>& outData)
+{
+	m_clear();
+	outData.clear();
+	if (width <= 0 || height <= 0 || width > 65535 || height > 65535) return false;
+
+	try {
+		m_pOutData  = &outData;
+		m_height    = height;
+		m_pImpl     = new CJpegStreamEncoder(width, height, quality, outData);
+		return true;
+	} catch (...) { }
+
+	m_abort();
+	return false;
+}
+
+/**
+ * 上から順に、指定行数分のRGBAを渡す.
+ */
+bool ImageEncoder::CStreamEncoder::writeRows (const unsigned char* rgbaData, const int rowsCou)
+{
+	if (!m_pImpl || !rgbaData || rowsCou <= 0) return false;
+	if (m_rowsCount + rowsCou > m_height) {
+		m_abort();
+		return false;
+	}
+
+	try {
+		m_pImpl->writeRows(rgbaData, rowsCou);
+		m_rowsCount += rowsCou;
+		return true;
+	} catch (...) { }
+
+	m_abort();
+	return false;
+}
+
+/**
+ * エンコードを終了.
+ */
+bool ImageEncoder::CStreamEncoder::finish ()
+{
+	if (!m_pImpl) return false;
+	if (m_rowsCount != m_height) {
+		m_abort();
+		return false;
+	}
+
+	try {
+		m_pImpl->finish();
+		m_clear();
+		return true;
+	} catch (...) { }
+
+	m_abort();
+	return false;
+}
+
+/**
+ * pngにエンコード.
+ */
+bool ImageEncoder::encodePNG (const unsigned char* rgbaData, const int width, const int height, const int compressionLevel, std::vector<unsigned char>& outData)
+{
+	outData.clear();
+	if (!rgbaData || width <= 0 || height <= 0) return false;
+
+	CStreamEncoder encoder;
+	if (!encoder.beginPNG(width, height, hasAlpha(rgbaData, width, height), compressionLevel, outData)) return false;
+	if (!encoder.writeRows(rgbaData, height)) return false;
+	return encoder.finish();
+}
+
+/**
+ * jpegにエンコード (ベースライン).
+ */
+bool ImageEncoder::encodeJPEG (const unsigned char* rgbaData, const int width, const int height, const int quality, std::vector<unsigned char>& outData)
+{
+	outData.clear();
+	if (!rgbaData || width <= 0 || height <= 0) return false;
+
+	CStreamEncoder encoder;
+	if (!encoder.beginJPEG(width, height, quality, outData)) return false;
+	if (!encoder.writeRows(rgbaData, height)) return false;
+	return encoder.finish();
+}
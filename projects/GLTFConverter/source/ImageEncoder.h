@@ -0,0 +1,98 @@
+﻿/**
+ * RGBAのピクセル情報をpng/jpegのバイト列にエンコード.
+ * Shade3DのAPIは使用していないため、複数スレッドから同時に呼び出すことができる.
+ */
+#ifndef _IMAGEENCODER_H
+#define _IMAGEENCODER_H
+
+#include <vector>
+
+namespace ImageEncoder {
+	/**
+	 * RGBAのうち、Alpha値が255でないピクセルが存在するか.
+	 */
+	bool hasAlpha (const unsigned char* rgbaData, const int width, const int height);
+
+	/**
+	 * pngにエンコード.
+	 * Alpha値をすべて255で持つ場合はRGB、それ以外はRGBAとして出力する.
+	 * @param[in]  rgbaData          1ピクセルRGBA(4バイト)の画像情報.
+	 * @param[in]  width             画像の幅.
+	 * @param[in]  height            画像の高さ.
+	 * @param[in]  compressionLevel  圧縮レベル (0 - 9。0は無圧縮).
+	 * @param[out] outData           pngのバイト列.
+	 */
+	bool encodePNG (const unsigned char* rgbaData, const int width, const int height, const int compressionLevel, std::vector<unsigned char>& outData);
+
+	/**
+	 * jpegにエンコード (ベースライン).
+	 * Alpha値は無視される.
+	 * @param[in]  rgbaData  1ピクセルRGBA(4バイト)の画像情報.
+	 * @param[in]  width     画像の幅.
+	 * @param[in]  height    画像の高さ.
+	 * @param[in]  quality   品質 (1 - 100).
+	 * @param[out] outData   jpegのバイト列.
+	 */
+	bool encodeJPEG (const unsigned char* rgbaData, const int width, const int height, const int quality, std::vector<unsigned char>& outData);
+
+	/**
+	 * 上から順に行単位でRGBAを受け取り、png/jpegにエンコード.
+	 * 画像全体のRGBAを保持せずにエンコードできる (タイル単位でのベイクで使用).
+	 * beginPNG/beginJPEG => writeRows (画像の高さ分) => finishの順に呼ぶ.
+	 * 途中で失敗した場合は、outDataは空になる.
+	 */
+	class CStreamEncoder
+	{
+	public:
+		class CImpl;							// png/jpegごとの実装.
+
+	private:
+		CImpl* m_pImpl;
+		std::vector<unsigned char>* m_pOutData;
+		int m_height;							// 画像の高さ.
+		int m_rowsCount;						// 受け取り済みの行数.
+
+		void m_clear ();
+		void m_abort ();
+
+	public:
+		CStreamEncoder ();
+		~CStreamEncoder ();
+
+		CStreamEncoder (const CStreamEncoder&) = delete;
+		CStreamEncoder& operator = (const CStreamEncoder&) = delete;
+
+		/**
+		 * pngのエンコードを開始.
+		 * @param[in]  width             画像の幅.
+		 * @param[in]  height            画像の高さ.
+		 * @param[in]  useAlpha          RGBAとして出力するか (falseの場合はRGB).
+		 * @param[in]  compressionLevel  圧縮レベル (0 - 9。0は無圧縮).
+		 * @param[out] outData           pngのバイト列 (finishまで追加されていく).
+		 */
+		bool beginPNG (const int width, const int height, const bool useAlpha, const int compressionLevel, std::vector<unsigned char>& outData);
+
+		/**
+		 * jpegのエンコードを開始 (ベースライン).
+		 * @param[in]  width     画像の幅.
+		 * @param[in]  height    画像の高さ.
+		 * @param[in]  quality   品質 (1 - 100).
+		 * @param[out] outData   jpegのバイト列 (finishまで追加されていく).
+		 */
+		bool beginJPEG (const int width, const int height, const int quality, std::vector<unsigned char>& outData);
+
+		/**
+		 * 上から順に、指定行数分のRGBAを渡す.
+		 * @param[in] rgbaData  1ピクセルRGBA(4バイト)の画像情報 (画像の幅 x rowsCou).
+		 * @param[in] rowsCou   行数.
+		 */
+		bool writeRows (const unsigned char* rgbaData, const int rowsCou);
+
+		/**
+		 * エンコードを終了 (画像の高さ分の行を渡した後に呼ぶ).
+		 */
+		bool finish ();
+	};
+}
+
+#endif
@@ -0,0 +1,931 @@
+﻿/**
+ * テクスチャのベイク用の、RGBA(float)/RGBA(8bit)の画素の演算.
+ * スカラーの参照実装と、SSE2(x86/x64)/NEON(ARM64)による実装を持つ.
+ * 1画素(RGBA)が128bitのレジスタ1つに収まるため、合成は1画素単位で処理する.
+ */
+#include "ImageKernels.h"
+
+#include <algorithm>
+#include <math.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define IMAGE_KERNELS_USE_SSE2
+#include <emmintrin.h>
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#define IMAGE_KERNELS_USE_NEON
+#include <arm_neon.h>
+#endif
+
+namespace {
+	// SIMD命令を使用するか.
+#if defined(IMAGE_KERNELS_USE_SSE2) || defined(IMAGE_KERNELS_USE_NEON)
+	bool g_useSIMD = true;
+#else
+	bool g_useSIMD = false;
+#endif
+
+	/**
+	 * 画素ごとのウエイト値.
+	 */
+	inline float getWeight (const float* weightPixels, const float weight, const int x) {
+		return weightPixels ? weightPixels[x * 4] * weight : weight;
+	}
+
+	/**
+	 * ベクトルを正規化 (長さが0の場合はそのまま).
+	 */
+	inline void normalize3 (float& x, float& y, float& z) {
+		const float len = sqrtf(x * x + y * y + z * z);
+		const float invLen = (len > 0.0f) ? (1.0f / len) : 1.0f;
+		x *= invLen;
+		y *= invLen;
+		z *= invLen;
+	}
+
+	//-----------------------------------------------------------.
+	// スカラーの参照実装.
+	//-----------------------------------------------------------.
+	void convertToGrayscaleScalar (float* pixels, const int count, const ImageKernels::CHANNEL_TYPE channel) {
+		for (int x = 0; x < count; ++x) {
+			float* p = pixels + x * 4;
+			const float fVal = (channel == ImageKernels::channel_average) ? (p[0] + p[1] + p[2]) * 0.3333f : p[(int)channel];
+			p[0] = p[1] = p[2] = fVal;
+			p[3] = 1.0f;
+		}
+	}
+
+	void fillAlphaScalar (float* pixels, const int count, const float alpha) {
+		for (int x = 0; x < count; ++x) pixels[x * 4 + 3] = alpha;
+	}
+
+	void invertColorScalar (float* pixels, const int count) {
+		for (int x = 0; x < count; ++x) {
+			float* p = pixels + x * 4;
+			p[0] = 1.0f - p[0];
+			p[1] = 1.0f - p[1];
+			p[2] = 1.0f - p[2];
+		}
+	}
+
+	void blendPixelsScalar (float* pixels, const int count, const ImageKernels::CBlendParam& param) {
+		for (int x = 0; x < count; ++x) {
+			float* p = pixels + x * 4;
+			const float* b = param.basePixels ? (param.basePixels + x * 4) : param.baseColor;
+			const float w  = getWeight(param.weightPixels, param.weight, x);
+			const float w2 = 1.0f - w;
+
+			switch (param.blendType) {
+			case ImageKernels::blend_normal:
+				for (int i = 0; i < 4; ++i) p[i] = p[i] * w + b[i] * w2;
+				break;
+			case ImageKernels::blend_multiply:
+				for (int i = 0; i < 4; ++i) p[i] = (param.fillColor[i] * w2 + p[i] * w) * b[i];
+				break;
+			case ImageKernels::blend_multiply_legacy:
+				for (int i = 0; i < 4; ++i) p[i] = p[i] * b[i] * w;
+				break;
+			case ImageKernels::blend_add:
+				for (int i = 0; i < 4; ++i) p[i] = std::min(std::max(0.0f, b[i] + p[i] * w), 1.0f);
+				break;
+			case ImageKernels::blend_sub:
+				for (int i = 0; i < 4; ++i) p[i] = std::min(std::max(0.0f, b[i] - p[i] * w), 1.0f);
+				break;
+			case ImageKernels::blend_min:
+				for (int i = 0; i < 3; ++i) p[i] = std::min(b[i], p[i] * w);
+				break;
+			case ImageKernels::blend_max:
+				for (int i = 0; i < 3; ++i) p[i] = std::max(b[i], p[i] * w);
+				break;
+			default:
+				break;
+			}
+		}
+	}
+
+	void blendNormalPixelsScalar (float* pixels, const float* basePixels, const float* weightPixels, const float weight, const int count) {
+		for (int x = 0; x < count; ++x) {
+			float* p = pixels + x * 4;
+			const float* b = basePixels + x * 4;
+			const float w  = getWeight(weightPixels, weight, x);
+			const float w2 = 1.0f - w;
+
+			float nx = (p[0] - 0.5f) * 2.0f;
+			float ny = (p[1] - 0.5f) * 2.0f;
+			float nz = p[2];
+			normalize3(nx, ny, nz);
+			float nx2 = (b[0] - 0.5f) * 2.0f;
+			float ny2 = (b[1] - 0.5f) * 2.0f;
+			float nz2 = b[2];
+			normalize3(nx2, ny2, nz2);
+
+			nx = nx * w + nx2 * w2;
+			ny = ny * w + ny2 * w2;
+			nz = nz * w + nz2 * w2;
+			normalize3(nx, ny, nz);
+
+			p[0] = nx * 0.5f + 0.5f;
+			p[1] = ny * 0.5f + 0.5f;
+			p[2] = nz;
+			p[3] = 1.0f;
+		}
+	}
+
+	//-----------------------------------------------------------.
+	// 8bitの画素でのスカラーの参照実装.
+	//-----------------------------------------------------------.
+	/**
+	 * v / 255 を四捨五入 (0 <= v <= 255 * 255).
+	 */
+	inline int div255 (const int v) {
+		const int t = v + 128;
+		return (t + (t >> 8)) >> 8;
+	}
+
+	/**
+	 * 画素ごとのウエイト値 (0 - 255).
+	 */
+	inline int getWeight8 (const unsigned char* weightPixels, const int weight, const int x) {
+		return weightPixels ? div255((int)weightPixels[x * 4] * weight) : weight;
+	}
+
+	inline unsigned char toUInt8 (const float v) {
+		return (unsigned char)std::min(std::max((int)(v * 255.0f + 0.5f), 0), 255);
+	}
+
+	void convertToGrayscale8Scalar (unsigned char* pixels, const int count, const ImageKernels::CHANNEL_TYPE channel) {
+		for (int x = 0; x < count; ++x) {
+			unsigned char* p = pixels + x * 4;
+			// 平均は、(R + G + B) * 0.3333 を16bitの固定小数点で計算.
+			const unsigned char iVal = (channel == ImageKernels::channel_average) ? (unsigned char)((((int)p[0] + (int)p[1] + (int)p[2]) * 21843 + 32768) >> 16) : p[(int)channel];
+			p[0] = p[1] = p[2] = iVal;
+			p[3] = 255;
+		}
+	}
+
+	void fillAlpha8Scalar (unsigned char* pixels, const int count, const unsigned char alpha) {
+		for (int x = 0; x < count; ++x) pixels[x * 4 + 3] = alpha;
+	}
+
+	void invertColor8Scalar (unsigned char* pixels, const int count) {
+		for (int x = 0; x < count; ++x) {
+			unsigned char* p = pixels + x * 4;
+			p[0] = 255 - p[0];
+			p[1] = 255 - p[1];
+			p[2] = 255 - p[2];
+		}
+	}
+
+	/**
+	 * startX番目の画素からcount-1番目の画素までを合成.
+	 */
+	void blendPixels8Scalar (unsigned char* pixels, const int startX, const int count, const ImageKernels::CBlendParam8& param) {
+		for (int x = startX; x < count; ++x) {
+			unsigned char* p = pixels + x * 4;
+			const unsigned char* b = param.basePixels ? (param.basePixels + x * 4) : param.baseColor;
+			const int w  = getWeight8(param.weightPixels, param.weight, x);
+			const int w2 = 255 - w;
+
+			switch (param.blendType) {
+			case ImageKernels::blend_normal:
+				for (int i = 0; i < 4; ++i) p[i] = (unsigned char)div255((int)p[i] * w + (int)b[i] * w2);
+				break;
+			case ImageKernels::blend_multiply:
+				for (int i = 0; i < 4; ++i) p[i] = (unsigned char)div255(div255((int)param.fillColor[i] * w2 + (int)p[i] * w) * (int)b[i]);
+				break;
+			case ImageKernels::blend_multiply_legacy:
+				for (int i = 0; i < 4; ++i) p[i] = (unsigned char)div255(div255((int)p[i] * (int)b[i]) * w);
+				break;
+			case ImageKernels::blend_add:
+				for (int i = 0; i < 4; ++i) p[i] = (unsigned char)std::min((int)b[i] + div255((int)p[i] * w), 255);
+				break;
+			case ImageKernels::blend_sub:
+				for (int i = 0; i < 4; ++i) p[i] = (unsigned char)std::max((int)b[i] - div255((int)p[i] * w), 0);
+				break;
+			case ImageKernels::blend_min:
+				for (int i = 0; i < 3; ++i) p[i] = (unsigned char)std::min((int)b[i], div255((int)p[i] * w));
+				break;
+			case ImageKernels::blend_max:
+				for (int i = 0; i < 3; ++i) p[i] = (unsigned char)std::max((int)b[i], div255((int)p[i] * w));
+				break;
+			default:
+				break;
+			}
+		}
+	}
+
+	/**
+	 * パックする1チャンネル分の値.
+	 */
+	inline unsigned char getPackValue (const ImageKernels::CPackChannel& src, const int x) {
+		if (!src.pixels) return src.value;
+		const unsigned char* p = src.pixels + x * 4;
+		const unsigned char v = (src.channel == ImageKernels::channel_average) ? (unsigned char)((((int)p[0] + (int)p[1] + (int)p[2]) * 21843 + 32768) >> 16) : p[(int)src.channel];
+		return src.invert ? (unsigned char)(255 - v) : v;
+	}
+
+	/**
+	 * startX番目の画素からcount-1番目の画素までをパック.
+	 */
+	void packChannelsScalar (unsigned char* dstPixels, const int startX, const int count, const ImageKernels::CPackChannel& red, const ImageKernels::CPackChannel& green, const ImageKernels::CPackChannel& blue) {
+		for (int x = startX; x < count; ++x) {
+			unsigned char* d = dstPixels + x * 4;
+			d[0] = getPackValue(red, x);
+			d[1] = getPackValue(green, x);
+			d[2] = getPackValue(blue, x);
+			d[3] = 255;
+		}
+	}
+
+#if defined(IMAGE_KERNELS_USE_SSE2)
+	//-----------------------------------------------------------.
+	// SSE2での実装.
+	//-----------------------------------------------------------.
+	inline __m128 selectRGB (const __m128 rgbV, const __m128 alphaV) {
+		const __m128 maskRGB = _mm_castsi128_ps(_mm_set_epi32(0, -1, -1, -1));
+		return _mm_or_ps(_mm_and_ps(maskRGB, rgbV), _mm_andnot_ps(maskRGB, alphaV));
+	}
+
+	inline __m128 clamp01 (const __m128 v) {
+		return _mm_min_ps(_mm_max_ps(v, _mm_setzero_ps()), _mm_set1_ps(1.0f));
+	}
+
+	template<int CHANNEL> void convertToGrayscaleSSE (float* pixels, const int count) {
+		const __m128 oneV = _mm_set1_ps(1.0f);
+		for (int x = 0; x < count; ++x) {
+			const __m128 v = _mm_loadu_ps(pixels + x * 4);
+			_mm_storeu_ps(pixels + x * 4, selectRGB(_mm_shuffle_ps(v, v, _MM_SHUFFLE(CHANNEL, CHANNEL, CHANNEL, CHANNEL)), oneV));
+		}
+	}
+
+	void convertToGrayscaleAverageSSE (float* pixels, const int count) {
+		const __m128 oneV   = _mm_set1_ps(1.0f);
+		const __m128 scaleV = _mm_set1_ps(0.3333f);
+		for (int x = 0; x < count; ++x) {
+			const __m128 v = _mm_loadu_ps(pixels + x * 4);
+			__m128 sumV = _mm_add_ss(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(1, 1, 1, 1)));
+			sumV = _mm_add_ss(sumV, _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 2, 2, 2)));
+			sumV = _mm_mul_ps(_mm_shuffle_ps(sumV, sumV, _MM_SHUFFLE(0, 0, 0, 0)), scaleV);
+			_mm_storeu_ps(pixels + x * 4, selectRGB(sumV, oneV));
+		}
+	}
+
+	void fillAlphaSSE (float* pixels, const int count, const float alpha) {
+		const __m128 alphaV = _mm_set1_ps(alpha);
+		for (int x = 0; x < count; ++x) {
+			_mm_storeu_ps(pixels + x * 4, selectRGB(_mm_loadu_ps(pixels + x * 4), alphaV));
+		}
+	}
+
+	void invertColorSSE (float* pixels, const int count) {
+		const __m128 oneV = _mm_set1_ps(1.0f);
+		for (int x = 0; x < count; ++x) {
+			const __m128 v = _mm_loadu_ps(pixels + x * 4);
+			_mm_storeu_ps(pixels + x * 4, selectRGB(_mm_sub_ps(oneV, v), v));
+		}
+	}
+
+	void blendPixelsSSE (float* pixels, const int count, const ImageKernels::CBlendParam& param) {
+		const __m128 baseColorV = _mm_loadu_ps(param.baseColor);
+		const __m128 fillColorV = _mm_loadu_ps(param.fillColor);
+		const ImageKernels::BLEND_TYPE blendType = param.blendType;
+		if (blendType == ImageKernels::blend_none) return;
+
+		for (int x = 0; x < count; ++x) {
+			float* p = pixels + x * 4;
+			const __m128 pV = _mm_loadu_ps(p);
+			const __m128 bV = param.basePixels ? _mm_loadu_ps(param.basePixels + x * 4) : baseColorV;
+			const float w  = getWeight(param.weightPixels, param.weight, x);
+			const __m128 wV  = _mm_set1_ps(w);
+			const __m128 w2V = _mm_set1_ps(1.0f - w);
+
+			__m128 v;
+			switch (blendType) {
+			case ImageKernels::blend_normal:
+				v = _mm_add_ps(_mm_mul_ps(pV, wV), _mm_mul_ps(bV, w2V));
+				break;
+			case ImageKernels::blend_multiply:
+				v = _mm_mul_ps(_mm_add_ps(_mm_mul_ps(fillColorV, w2V), _mm_mul_ps(pV, wV)), bV);
+				break;
+			case ImageKernels::blend_multiply_legacy:
+				v = _mm_mul_ps(_mm_mul_ps(pV, bV), wV);
+				break;
+			case ImageKernels::blend_add:
+				v = clamp01(_mm_add_ps(bV, _mm_mul_ps(pV, wV)));
+				break;
+			case ImageKernels::blend_sub:
+				v = clamp01(_mm_sub_ps(bV, _mm_mul_ps(pV, wV)));
+				break;
+			case ImageKernels::blend_min:
+				v = selectRGB(_mm_min_ps(bV, _mm_mul_ps(pV, wV)), pV);
+				break;
+			case ImageKernels::blend_max:
+				v = selectRGB(_mm_max_ps(bV, _mm_mul_ps(pV, wV)), pV);
+				break;
+			default:
+				v = pV;
+				break;
+			}
+			_mm_storeu_ps(p, v);
+		}
+	}
+
+	/**
+	 * 4画素分のベクトル(SoA)を正規化.
+	 */
+	inline void normalize3SSE (__m128& xV, __m128& yV, __m128& zV) {
+		const __m128 lenV = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(xV, xV), _mm_mul_ps(yV, yV)), _mm_mul_ps(zV, zV)));
+		const __m128 maskV = _mm_cmpgt_ps(lenV, _mm_setzero_ps());
+		const __m128 oneV = _mm_set1_ps(1.0f);
+		const __m128 invV = _mm_or_ps(_mm_and_ps(maskV, _mm_div_ps(oneV, lenV)), _mm_andnot_ps(maskV, oneV));
+		xV = _mm_mul_ps(xV, invV);
+		yV = _mm_mul_ps(yV, invV);
+		zV = _mm_mul_ps(zV, invV);
+	}
+
+	void blendNormalPixelsSSE (float* pixels, const float* basePixels, const float* weightPixels, const float weight, const int count) {
+		const __m128 halfV  = _mm_set1_ps(0.5f);
+		const __m128 twoV   = _mm_set1_ps(2.0f);
+		const __m128 oneV   = _mm_set1_ps(1.0f);
+		const __m128 weightV = _mm_set1_ps(weight);
+
+		// 4画素ずつ、RGBAの並びをチャンネルごとに入れ替えて処理.
+		int x = 0;
+		for (; x + 4 <= count; x += 4) {
+			float* p = pixels + x * 4;
+			const float* b = basePixels + x * 4;
+			__m128 r0 = _mm_loadu_ps(p + 0);
+			__m128 r1 = _mm_loadu_ps(p + 4);
+			__m128 r2 = _mm_loadu_ps(p + 8);
+			__m128 r3 = _mm_loadu_ps(p + 12);
+			_MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+			__m128 b0 = _mm_loadu_ps(b + 0);
+			__m128 b1 = _mm_loadu_ps(b + 4);
+			__m128 b2 = _mm_loadu_ps(b + 8);
+			__m128 b3 = _mm_loadu_ps(b + 12);
+			_MM_TRANSPOSE4_PS(b0, b1, b2, b3);
+
+			__m128 wV = weightV;
+			if (weightPixels) {
+				const float* wp = weightPixels + x * 4;
+				wV = _mm_mul_ps(_mm_set_ps(wp[12], wp[8], wp[4], wp[0]), weightV);
+			}
+			const __m128 w2V = _mm_sub_ps(oneV, wV);
+
+			__m128 nx = _mm_mul_ps(_mm_sub_ps(r0, halfV), twoV);
+			__m128 ny = _mm_mul_ps(_mm_sub_ps(r1, halfV), twoV);
+			__m128 nz = r2;
+			normalize3SSE(nx, ny, nz);
+			__m128 nx2 = _mm_mul_ps(_mm_sub_ps(b0, halfV), twoV);
+			__m128 ny2 = _mm_mul_ps(_mm_sub_ps(b1, halfV), twoV);
+			__m128 nz2 = b2;
+			normalize3SSE(nx2, ny2, nz2);
+
+			nx = _mm_add_ps(_mm_mul_ps(nx, wV), _mm_mul_ps(nx2, w2V));
+			ny = _mm_add_ps(_mm_mul_ps(ny, wV), _mm_mul_ps(ny2, w2V));
+			nz = _mm_add_ps(_mm_mul_ps(nz, wV), _mm_mul_ps(nz2, w2V));
+			normalize3SSE(nx, ny, nz);
+
+			r0 = _mm_add_ps(_mm_mul_ps(nx, halfV), halfV);
+			r1 = _mm_add_ps(_mm_mul_ps(ny, halfV), halfV);
+			r2 = nz;
+			r3 = oneV;
+			_MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+			_mm_storeu_ps(p + 0, r0);
+			_mm_storeu_ps(p + 4, r1);
+			_mm_storeu_ps(p + 8, r2);
+			_mm_storeu_ps(p + 12, r3);
+		}
+		if (x < count) {
+			blendNormalPixelsScalar(pixels + x * 4, basePixels + x * 4, weightPixels ? (weightPixels + x * 4) : 0, weight, count - x);
+		}
+	}
+
+	//-----------------------------------------------------------.
+	// SSE2での8bitの画素の合成.
+	// 2画素(8要素)を16bitに拡張して処理する.
+	//-----------------------------------------------------------.
+	inline __m128i div255SSE (const __m128i v) {
+		const __m128i t = _mm_add_epi16(v, _mm_set1_epi16(128));
+		return _mm_srli_epi16(_mm_add_epi16(t, _mm_srli_epi16(t, 8)), 8);
+	}
+
+	void blendPixels8SSE (unsigned char* pixels, const int count, const ImageKernels::CBlendParam8& param) {
+		const ImageKernels::BLEND_TYPE blendType = param.blendType;
+		if (blendType == ImageKernels::blend_none) return;
+
+		const __m128i zeroV = _mm_setzero_si128();
+		const __m128i maxV  = _mm_set1_epi16(255);
+		const __m128i maskRGB = _mm_set_epi16(0, -1, -1, -1, 0, -1, -1, -1);
+		const unsigned char* bc = param.baseColor;
+		const unsigned char* fc = param.fillColor;
+		const __m128i baseColorV = _mm_set_epi16(bc[3], bc[2], bc[1], bc[0], bc[3], bc[2], bc[1], bc[0]);
+		const __m128i fillColorV = _mm_set_epi16(fc[3], fc[2], fc[1], fc[0], fc[3], fc[2], fc[1], fc[0]);
+
+		int x = 0;
+		for (; x + 2 <= count; x += 2) {
+			unsigned char* p = pixels + x * 4;
+			const __m128i pV = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)p), zeroV);
+			const __m128i bV = param.basePixels ? _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)(param.basePixels + x * 4)), zeroV) : baseColorV;
+			const short w0 = (short)getWeight8(param.weightPixels, param.weight, x);
+			const short w1 = (short)getWeight8(param.weightPixels, param.weight, x + 1);
+			const __m128i wV  = _mm_set_epi16(w1, w1, w1, w1, w0, w0, w0, w0);
+			const __m128i w2V = _mm_sub_epi16(maxV, wV);
+
+			__m128i v;
+			switch (blendType) {
+			case ImageKernels::blend_normal:
+				v = div255SSE(_mm_add_epi16(_mm_mullo_epi16(pV, wV), _mm_mullo_epi16(bV, w2V)));
+				break;
+			case ImageKernels::blend_multiply:
+				v = div255SSE(_mm_mullo_epi16(div255SSE(_mm_add_epi16(_mm_mullo_epi16(fillColorV, w2V), _mm_mullo_epi16(pV, wV))), bV));
+				break;
+			case ImageKernels::blend_multiply_legacy:
+				v = div255SSE(_mm_mullo_epi16(div255SSE(_mm_mullo_epi16(pV, bV)), wV));
+				break;
+			case ImageKernels::blend_add:
+				v = _mm_min_epi16(_mm_add_epi16(bV, div255SSE(_mm_mullo_epi16(pV, wV))), maxV);
+				break;
+			case ImageKernels::blend_sub:
+				v = _mm_max_epi16(_mm_sub_epi16(bV, div255SSE(_mm_mullo_epi16(pV, wV))), zeroV);
+				break;
+			case ImageKernels::blend_min:
+				v = _mm_min_epi16(bV, div255SSE(_mm_mullo_epi16(pV, wV)));
+				v = _mm_or_si128(_mm_and_si128(maskRGB, v), _mm_andnot_si128(maskRGB, pV));
+				break;
+			case ImageKernels::blend_max:
+				v = _mm_max_epi16(bV, div255SSE(_mm_mullo_epi16(pV, wV)));
+				v = _mm_or_si128(_mm_and_si128(maskRGB, v), _mm_andnot_si128(maskRGB, pV));
+				break;
+			default:
+				v = pV;
+				break;
+			}
+			_mm_storel_epi64((__m128i*)p, _mm_packus_epi16(v, zeroV));
+		}
+		if (x < count) blendPixels8Scalar(pixels, x, count, param);
+	}
+
+	//-----------------------------------------------------------.
+	// SSE2でのチャンネルのパック.
+	// 4画素(32bit x 4)ごとに、チャンネルをシフトして取り出し、出力の位置にシフトして合わせる.
+	//-----------------------------------------------------------.
+	inline __m128i getPackValueSSE (const ImageKernels::CPackChannel& src, const int x) {
+		if (!src.pixels) return _mm_set1_epi32(src.value);
+		const __m128i v = _mm_loadu_si128((const __m128i*)(src.pixels + x * 4));
+		__m128i c;
+		switch (src.channel) {
+		case ImageKernels::channel_green: c = _mm_srli_epi32(v, 8); break;
+		case ImageKernels::channel_blue:  c = _mm_srli_epi32(v, 16); break;
+		case ImageKernels::channel_alpha: c = _mm_srli_epi32(v, 24); break;
+		default: c = v; break;
+		}
+		c = _mm_and_si128(c, _mm_set1_epi32(0xff));
+		return src.invert ? _mm_xor_si128(c, _mm_set1_epi32(0xff)) : c;
+	}
+
+	void packChannelsSSE (unsigned char* dstPixels, const int count, const ImageKernels::CPackChannel& red, const ImageKernels::CPackChannel& green, const ImageKernels::CPackChannel& blue) {
+		const __m128i alphaV = _mm_set1_epi32((int)0xff000000);
+		int x = 0;
+		for (; x + 4 <= count; x += 4) {
+			__m128i v = _mm_or_si128(getPackValueSSE(red, x), alphaV);
+			v = _mm_or_si128(v, _mm_slli_epi32(getPackValueSSE(green, x), 8));
+			v = _mm_or_si128(v, _mm_slli_epi32(getPackValueSSE(blue, x), 16));
+			_mm_storeu_si128((__m128i*)(dstPixels + x * 4), v);
+		}
+		if (x < count) packChannelsScalar(dstPixels, x, count, red, green, blue);
+	}
+#endif
+
+#if defined(IMAGE_KERNELS_USE_NEON)
+	//-----------------------------------------------------------.
+	// NEON(ARM64)での実装.
+	//-----------------------------------------------------------.
+	inline float32x4_t selectRGB (const float32x4_t rgbV, const float32x4_t alphaV) {
+		const uint32_t maskList[4] = { 0xffffffff, 0xffffffff, 0xffffffff, 0 };
+		return vbslq_f32(vld1q_u32(maskList), rgbV, alphaV);
+	}
+
+	inline float32x4_t clamp01 (const float32x4_t v) {
+		return vminq_f32(vmaxq_f32(v, vdupq_n_f32(0.0f)), vdupq_n_f32(1.0f));
+	}
+
+	template<int CHANNEL> void convertToGrayscaleNEON (float* pixels, const int count) {
+		const float32x4_t oneV = vdupq_n_f32(1.0f);
+		for (int x = 0; x < count; ++x) {
+			const float32x4_t v = vld1q_f32(pixels + x * 4);
+			vst1q_f32(pixels + x * 4, selectRGB(vdupq_laneq_f32(v, CHANNEL), oneV));
+		}
+	}
+
+	void convertToGrayscaleAverageNEON (float* pixels, const int count) {
+		const float32x4_t oneV = vdupq_n_f32(1.0f);
+		for (int x = 0; x < count; ++x) {
+			const float32x4_t v = vld1q_f32(pixels + x * 4);
+			const float fVal = (vgetq_lane_f32(v, 0) + vgetq_lane_f32(v, 1) + vgetq_lane_f32(v, 2)) * 0.3333f;
+			vst1q_f32(pixels + x * 4, selectRGB(vdupq_n_f32(fVal), oneV));
+		}
+	}
+
+	void fillAlphaNEON (float* pixels, const int count, const float alpha) {
+		const float32x4_t alphaV = vdupq_n_f32(alpha);
+		for (int x = 0; x < count; ++x) {
+			vst1q_f32(pixels + x * 4, selectRGB(vld1q_f32(pixels + x * 4), alphaV));
+		}
+	}
+
+	void invertColorNEON (float* pixels, const int count) {
+		const float32x4_t oneV = vdupq_n_f32(1.0f);
+		for (int x = 0; x < count; ++x) {
+			const float32x4_t v = vld1q_f32(pixels + x * 4);
+			vst1q_f32(pixels + x * 4, selectRGB(vsubq_f32(oneV, v), v));
+		}
+	}
+
+	void blendPixelsNEON (float* pixels, const int count, const ImageKernels::CBlendParam& param) {
+		const float32x4_t baseColorV = vld1q_f32(param.baseColor);
+		const float32x4_t fillColorV = vld1q_f32(param.fillColor);
+		const ImageKernels::BLEND_TYPE blendType = param.blendType;
+		if (blendType == ImageKernels::blend_none) return;
+
+		for (int x = 0; x < count; ++x) {
+			float* p = pixels + x * 4;
+			const float32x4_t pV = vld1q_f32(p);
+			const float32x4_t bV = param.basePixels ? vld1q_f32(param.basePixels + x * 4) : baseColorV;
+			const float w  = getWeight(param.weightPixels, param.weight, x);
+			const float32x4_t wV  = vdupq_n_f32(w);
+			const float32x4_t w2V = vdupq_n_f32(1.0f - w);
+
+			float32x4_t v;
+			switch (blendType) {
+			case ImageKernels::blend_normal:
+				v = vaddq_f32(vmulq_f32(pV, wV), vmulq_f32(bV, w2V));
+				break;
+			case ImageKernels::blend_multiply:
+				v = vmulq_f32(vaddq_f32(vmulq_f32(fillColorV, w2V), vmulq_f32(pV, wV)), bV);
+				break;
+			case ImageKernels::blend_multiply_legacy:
+				v = vmulq_f32(vmulq_f32(pV, bV), wV);
+				break;
+			case ImageKernels::blend_add:
+				v = clamp01(vaddq_f32(bV, vmulq_f32(pV, wV)));
+				break;
+			case ImageKernels::blend_sub:
+				v = clamp01(vsubq_f32(bV, vmulq_f32(pV, wV)));
+				break;
+			case ImageKernels::blend_min:
+				v = selectRGB(vminq_f32(bV, vmulq_f32(pV, wV)), pV);
+				break;
+			case ImageKernels::blend_max:
+				v = selectRGB(vmaxq_f32(bV, vmulq_f32(pV, wV)), pV);
+				break;
+			default:
+				v = pV;
+				break;
+			}
+			vst1q_f32(p, v);
+		}
+	}
+
+	inline void normalize3NEON (float32x4_t& xV, float32x4_t& yV, float32x4_t& zV) {
+		const float32x4_t lenV = vsqrtq_f32(vaddq_f32(vaddq_f32(vmulq_f32(xV, xV), vmulq_f32(yV, yV)), vmulq_f32(zV, zV)));
+		const float32x4_t oneV = vdupq_n_f32(1.0f);
+		const float32x4_t invV = vbslq_f32(vcgtq_f32(lenV, vdupq_n_f32(0.0f)), vdivq_f32(oneV, lenV), oneV);
+		xV = vmulq_f32(xV, invV);
+		yV = vmulq_f32(yV, invV);
+		zV = vmulq_f32(zV, invV);
+	}
+
+	void blendNormalPixelsNEON (float* pixels, const float* basePixels, const float* weightPixels, const float weight, const int count) {
+		const float32x4_t halfV   = vdupq_n_f32(0.5f);
+		const float32x4_t twoV    = vdupq_n_f32(2.0f);
+		const float32x4_t oneV    = vdupq_n_f32(1.0f);
+		const float32x4_t weightV = vdupq_n_f32(weight);
+
+		// 4画素ずつ、チャンネルごとに分けて読み込んで処理.
+		int x = 0;
+		for (; x + 4 <= count; x += 4) {
+			float* p = pixels + x * 4;
+			float32x4x4_t pV = vld4q_f32(p);
+			const float32x4x4_t bV = vld4q_f32(basePixels + x * 4);
+			float32x4_t wV = weightV;
+			if (weightPixels) wV = vmulq_f32(vld4q_f32(weightPixels + x * 4).val[0], weightV);
+			const float32x4_t w2V = vsubq_f32(oneV, wV);
+
+			float32x4_t nx = vmulq_f32(vsubq_f32(pV.val[0], halfV), twoV);
+			float32x4_t ny = vmulq_f32(vsubq_f32(pV.val[1], halfV), twoV);
+			float32x4_t nz = pV.val[2];
+			normalize3NEON(nx, ny, nz);
+			float32x4_t nx2 = vmulq_f32(vsubq_f32(bV.val[0], halfV), twoV);
+			float32x4_t ny2 = vmulq_f32(vsubq_f32(bV.val[1], halfV), twoV);
+			float32x4_t nz2 = bV.val[2];
+			normalize3NEON(nx2, ny2, nz2);
+
+			nx = vaddq_f32(vmulq_f32(nx, wV), vmulq_f32(nx2, w2V));
+			ny = vaddq_f32(vmulq_f32(ny, wV), vmulq_f32(ny2, w2V));
+			nz = vaddq_f32(vmulq_f32(nz, wV), vmulq_f32(nz2, w2V));
+			normalize3NEON(nx, ny, nz);
+
+			pV.val[0] = vaddq_f32(vmulq_f32(nx, halfV), halfV);
+			pV.val[1] = vaddq_f32(vmulq_f32(ny, halfV), halfV);
+			pV.val[2] = nz;
+			pV.val[3] = oneV;
+			vst4q_f32(p, pV);
+		}
+		if (x < count) {
+			blendNormalPixelsScalar(pixels + x * 4, basePixels + x * 4, weightPixels ? (weightPixels + x * 4) : 0, weight, count - x);
+		}
+	}
+
+	//-----------------------------------------------------------.
+	// NEONでの8bitの画素の合成.
+	// 2画素(8要素)を16bitに拡張して処理する.
+	//-----------------------------------------------------------.
+	inline uint16x8_t div255NEON (const uint16x8_t v) {
+		const uint16x8_t t = vaddq_u16(v, vdupq_n_u16(128));
+		return vshrq_n_u16(vaddq_u16(t, vshrq_n_u16(t, 8)), 8);
+	}
+
+	void blendPixels8NEON (unsigned char* pixels, const int count, const ImageKernels::CBlendParam8& param) {
+		const ImageKernels::BLEND_TYPE blendType = param.blendType;
+		if (blendType == ImageKernels::blend_none) return;
+
+		const uint16x8_t maxV = vdupq_n_u16(255);
+		const uint16_t maskList[8] = { 0xffff, 0xffff, 0xffff, 0, 0xffff, 0xffff, 0xffff, 0 };
+		const uint16x8_t maskRGB = vld1q_u16(maskList);
+		const unsigned char* bc = param.baseColor;
+		const unsigned char* fc = param.fillColor;
+		const uint16_t baseColorList[8] = { bc[0], bc[1], bc[2], bc[3], bc[0], bc[1], bc[2], bc[3] };
+		const uint16_t fillColorList[8] = { fc[0], fc[1], fc[2], fc[3], fc[0], fc[1], fc[2], fc[3] };
+		const uint16x8_t baseColorV = vld1q_u16(baseColorList);
+		const uint16x8_t fillColorV = vld1q_u16(fillColorList);
+
+		int x = 0;
+		for (; x + 2 <= count; x += 2) {
+			unsigned char* p = pixels + x * 4;
+			const uint16x8_t pV = vmovl_u8(vld1_u8(p));
+			const uint16x8_t bV = param.basePixels ? vmovl_u8(vld1_u8(param.basePixels + x * 4)) : baseColorV;
+			const uint16_t w0 = (uint16_t)getWeight8(param.weightPixels, param.weight, x);
+			const uint16_t w1 = (uint16_t)getWeight8(param.weightPixels, param.weight, x + 1);
+			const uint16x8_t wV  = vcombine_u16(vdup_n_u16(w0), vdup_n_u16(w1));
+			const uint16x8_t w2V = vsubq_u16(maxV, wV);
+
+			uint16x8_t v;
+			switch (blendType) {
+			case ImageKernels::blend_normal:
+				v = div255NEON(vaddq_u16(vmulq_u16(pV, wV), vmulq_u16(bV, w2V)));
+				break;
+			case ImageKernels::blend_multiply:
+				v = div255NEON(vmulq_u16(div255NEON(vaddq_u16(vmulq_u16(fillColorV, w2V), vmulq_u16(pV, wV))), bV));
+				break;
+			case ImageKernels::blend_multiply_legacy:
+				v = div255NEON(vmulq_u16(div255NEON(vmulq_u16(pV, bV)), wV));
+				break;
+			case ImageKernels::blend_add:
+				v = vminq_u16(vaddq_u16(bV, div255NEON(vmulq_u16(pV, wV))), maxV);
+				break;
+			case ImageKernels::blend_sub:
+				v = vqsubq_u16(bV, div255NEON(vmulq_u16(pV, wV)));
+				break;
+			case ImageKernels::blend_min:
+				v = vbslq_u16(maskRGB, vminq_u16(bV, div255NEON(vmulq_u16(pV, wV))), pV);
+				break;
+			case ImageKernels::blend_max:
+				v = vbslq_u16(maskRGB, vmaxq_u16(bV, div255NEON(vmulq_u16(pV, wV))), pV);
+				break;
+			default:
+				v = pV;
+				break;
+			}
+			vst1_u8(p, vmovn_u16(v));
+		}
+		if (x < count) blendPixels8Scalar(pixels, x, count, param);
+	}
+
+	//-----------------------------------------------------------.
+	// NEONでのチャンネルのパック.
+	// 8画素ごとに、チャンネルごとに分けて読み込み(vld4)、出力のR/G/Bに並べて書き込む(vst4).
+	//-----------------------------------------------------------.
+	inline uint8x8_t getPackValueNEON (const ImageKernels::CPackChannel& src, const int x) {
+		if (!src.pixels) return vdup_n_u8(src.value);
+		const uint8x8x4_t v = vld4_u8(src.pixels + x * 4);
+		uint8x8_t c;
+		switch (src.channel) {
+		case ImageKernels::channel_green: c = v.val[1]; break;
+		case ImageKernels::channel_blue:  c = v.val[2]; break;
+		case ImageKernels::channel_alpha: c = v.val[3]; break;
+		default: c = v.val[0]; break;
+		}
+		return src.invert ? vmvn_u8(c) : c;
+	}
+
+	void packChannelsNEON (unsigned char* dstPixels, const int count, const ImageKernels::CPackChannel& red, const ImageKernels::CPackChannel& green, const ImageKernels::CPackChannel& blue) {
+		int x = 0;
+		for (; x + 8 <= count; x += 8) {
+			uint8x8x4_t v;
+			v.val[0] = getPackValueNEON(red, x);
+			v.val[1] = getPackValueNEON(green, x);
+			v.val[2] = getPackValueNEON(blue, x);
+			v.val[3] = vdup_n_u8(255);
+			vst4_u8(dstPixels + x * 4, v);
+		}
+		if (x < count) packChannelsScalar(dstPixels, x, count, red, green, blue);
+	}
+#endif
+}
+
+/**
+ * SIMD命令で処理できる環境か.
+ */
+bool ImageKernels::hasSIMD ()
+{
+#if defined(IMAGE_KERNELS_USE_SSE2) || defined(IMAGE_KERNELS_USE_NEON)
+	return true;
+#else
+	return false;
+#endif
+}
+
+/**
+ * SIMD命令を使用するか指定.
+ */
+void ImageKernels::setUseSIMD (const bool useSIMD)
+{
+	g_useSIMD = useSIMD && hasSIMD();
+}
+
+bool ImageKernels::getUseSIMD ()
+{
+	return g_useSIMD;
+}
+
+/**
+ * 指定のチャンネルをRGBに入れ、グレースケールにする.
+ */
+void ImageKernels::convertToGrayscale (float* pixels, const int count, const CHANNEL_TYPE channel)
+{
+	if (!pixels || count <= 0) return;
+	if (g_useSIMD) {
+#if defined(IMAGE_KERNELS_USE_SSE2)
+		switch (channel) {
+		case channel_red:     convertToGrayscaleSSE<0>(pixels, count); return;
+		case channel_green:   convertToGrayscaleSSE<1>(pixels, count); return;
+		case channel_blue:    convertToGrayscaleSSE<2>(pixels, count); return;
+		case channel_alpha:   convertToGrayscaleSSE<3>(pixels, count); return;
+		case channel_average: convertToGrayscaleAverageSSE(pixels, count); return;
+		}
+#elif defined(IMAGE_KERNELS_USE_NEON)
+		switch (channel) {
+		case channel_red:     convertToGrayscaleNEON<0>(pixels, count); return;
+		case channel_green:   convertToGrayscaleNEON<1>(pixels, count); return;
+		case channel_blue:    convertToGrayscaleNEON<2>(pixels, count); return;
+		case channel_alpha:   convertToGrayscaleNEON<3>(pixels, count); return;
+		case channel_average: convertToGrayscaleAverageNEON(pixels, count); return;
+		}
+#endif
+	}
+	convertToGrayscaleScalar(pixels, count, channel);
+}
+
+/**
+ * Alphaを指定の値にする.
+ */
+void ImageKernels::fillAlpha (float* pixels, const int count, const float alpha)
+{
+	if (!pixels || count <= 0) return;
+	if (g_useSIMD) {
+#if defined(IMAGE_KERNELS_USE_SSE2)
+		fillAlphaSSE(pixels, count, alpha);
+		return;
+#elif defined(IMAGE_KERNELS_USE_NEON)
+		fillAlphaNEON(pixels, count, alpha);
+		return;
+#endif
+	}
+	fillAlphaScalar(pixels, count, alpha);
+}
+
+/**
+ * RGBを反転.
+ */
+void ImageKernels::invertColor (float* pixels, const int count)
+{
+	if (!pixels || count <= 0) return;
+	if (g_useSIMD) {
+#if defined(IMAGE_KERNELS_USE_SSE2)
+		invertColorSSE(pixels, count);
+		return;
+#elif defined(IMAGE_KERNELS_USE_NEON)
+		invertColorNEON(pixels, count);
+		return;
+#endif
+	}
+	invertColorScalar(pixels, count);
+}
+
+/**
+ * 画素を合成.
+ */
+void ImageKernels::blendPixels (float* pixels, const int count, const CBlendParam& param)
+{
+	if (!pixels || count <= 0) return;
+	if (g_useSIMD) {
+#if defined(IMAGE_KERNELS_USE_SSE2)
+		blendPixelsSSE(pixels, count, param);
+		return;
+#elif defined(IMAGE_KERNELS_USE_NEON)
+		blendPixelsNEON(pixels, count, param);
+		return;
+#endif
+	}
+	blendPixelsScalar(pixels, count, param);
+}
+
+/**
+ * 法線マップの画素を、法線ベクトルとして合成.
+ */
+void ImageKernels::blendNormalPixels (float* pixels, const float* basePixels, const float* weightPixels, const float weight, const int count)
+{
+	if (!pixels || !basePixels || count <= 0) return;
+	if (g_useSIMD) {
+#if defined(IMAGE_KERNELS_USE_SSE2)
+		blendNormalPixelsSSE(pixels, basePixels, weightPixels, weight, count);
+		return;
+#elif defined(IMAGE_KERNELS_USE_NEON)
+		blendNormalPixelsNEON(pixels, basePixels, weightPixels, weight, count);
+		return;
+#endif
+	}
+	blendNormalPixelsScalar(pixels, basePixels, weightPixels, weight, count);
+}
+
+/**
+ * floatのパラメータから変換.
+ */
+ImageKernels::CBlendParam8::CBlendParam8 (const CBlendParam& v)
+{
+	blendType    = v.blendType;
+	basePixels   = 0;
+	weightPixels = 0;
+	weight       = (int)toUInt8(v.weight);
+	for (int i = 0; i < 4; ++i) {
+		baseColor[i] = toUInt8(v.baseColor[i]);
+		fillColor[i] = toUInt8(v.fillColor[i]);
+	}
+}
+
+/**
+ * 8bitの画素での演算.
+ * 1画素が32bitのため、SIMD命令では合成(blendPixels)のみを処理する.
+ */
+void ImageKernels::convertToGrayscale (unsigned char* pixels, const int count, const CHANNEL_TYPE channel)
+{
+	if (!pixels || count <= 0) return;
+	convertToGrayscale8Scalar(pixels, count, channel);
+}
+
+void ImageKernels::fillAlpha (unsigned char* pixels, const int count, const unsigned char alpha)
+{
+	if (!pixels || count <= 0) return;
+	fillAlpha8Scalar(pixels, count, alpha);
+}
+
+void ImageKernels::invertColor (unsigned char* pixels, const int count)
+{
+	if (!pixels || count <= 0) return;
+	invertColor8Scalar(pixels, count);
+}
+
+void ImageKernels::blendPixels (unsigned char* pixels, const int count, const CBlendParam8& param)
+{
+	if (!pixels || count <= 0) return;
+	if (g_useSIMD) {
+#if defined(IMAGE_KERNELS_USE_SSE2)
+		blendPixels8SSE(pixels, count, param);
+		return;
+#elif defined(IMAGE_KERNELS_USE_NEON)
+		blendPixels8NEON(pixels, count, param);
+		return;
+#endif
+	}
+	blendPixels8Scalar(pixels, 0, count, param);
+}
+
+/**
+ * 3つのチャンネルを、出力のR/G/Bにパック.
+ * RGBの平均を参照する場合は、スカラーの参照実装で処理する.
+ */
+void ImageKernels::packChannels (unsigned char* dstPixels, const int count, const CPackChannel& red, const CPackChannel& green, const CPackChannel& blue)
+{
+	if (!dstPixels || count <= 0) return;
+	const bool useAverage = (red.pixels && red.channel == channel_average) || (green.pixels && green.channel == channel_average) || (blue.pixels && blue.channel == channel_average);
+	if (g_useSIMD && !useAverage) {
+#if defined(IMAGE_KERNELS_USE_SSE2)
+		packChannelsSSE(dstPixels, count, red, green, blue);
+		return;
+#elif defined(IMAGE_KERNELS_USE_NEON)
+		packChannelsNEON(dstPixels, count, red, green, blue);
+		return;
+#endif
+	}
+	packChannelsScalar(dstPixels, 0, count, red, green, blue);
+}
@@ -0,0 +1,196 @@
+﻿/**
+ * テクスチャのベイク用の、RGBA(float)/RGBA(8bit)の画素の演算.
+ * 画素はR/G/B/Aの順に並ぶ (floatはsxsdk::rgba_class、8bitはsx::rgba8_classと同じ並び).
+ * 8bitの演算は0-255を0.0-1.0とみなした固定小数点で行い、結果は四捨五入する.
+ * Shade3DのAPIは使用していないため、複数スレッドから同時に呼び出すことができる.
+ */
+#ifndef _IMAGEKERNELS_H
+#define _IMAGEKERNELS_H
+
+namespace ImageKernels {
+	/**
+	 * グレースケールに変換する際のチャンネル.
+	 */
+	enum CHANNEL_TYPE {
+		channel_red = 0,
+		channel_green,
+		channel_blue,
+		channel_alpha,
+		channel_average,				// RGBの平均.
+	};
+
+	/**
+	 * 合成方法.
+	 */
+	enum BLEND_TYPE {
+		blend_none = 0,					// 合成しない (上に重ねる画素をそのまま採用).
+		blend_normal,					// 「通常」合成.
+		blend_multiply,					// 「乗算」合成.
+		blend_multiply_legacy,			// 「乗算 (レガシー)」合成.
+		blend_add,						// 「加算」合成.
+		blend_sub,						// 「減算」合成.
+		blend_min,						// 「比較(暗)」合成.
+		blend_max,						// 「比較(明)」合成.
+	};
+
+	/**
+	 * 合成のパラメータ.
+	 * ウエイト値は、weightPixelsがある場合は (weightPixelsのR * weight)、ない場合はweightとなる.
+	 */
+	class CBlendParam
+	{
+	public:
+		BLEND_TYPE blendType;			// 合成方法.
+		const float* basePixels;		// 合成先の画素. NULLの場合はbaseColorを使用.
+		float baseColor[4];				// 合成先の色.
+		float fillColor[4];				// 「乗算」合成で、ウエイトが0の場合の色.
+		const float* weightPixels;		// ウエイトの画素 (Rを使用). NULLの場合はweightのみを使用.
+		float weight;					// ウエイト値.
+
+	public:
+		CBlendParam () {
+			clear();
+		}
+
+		void clear () {
+			blendType    = blend_normal;
+			basePixels   = 0;
+			weightPixels = 0;
+			weight       = 1.0f;
+			for (int i = 0; i < 4; ++i) {
+				baseColor[i] = 1.0f;
+				fillColor[i] = 1.0f;
+			}
+		}
+	};
+
+	/**
+	 * 8bitの画素での合成のパラメータ.
+	 * ウエイト値は、weightPixelsがある場合は (weightPixelsのR * weight / 255)、ない場合はweightとなる.
+	 */
+	class CBlendParam8
+	{
+	public:
+		BLEND_TYPE blendType;					// 合成方法.
+		const unsigned char* basePixels;		// 合成先の画素. NULLの場合はbaseColorを使用.
+		unsigned char baseColor[4];				// 合成先の色.
+		unsigned char fillColor[4];				// 「乗算」合成で、ウエイトが0の場合の色.
+		const unsigned char* weightPixels;		// ウエイトの画素 (Rを使用). NULLの場合はweightのみを使用.
+		int weight;								// ウエイト値 (0 - 255).
+
+	public:
+		CBlendParam8 () {
+			clear();
+		}
+
+		/**
+		 * floatのパラメータから変換 (basePixels/weightPixelsは変換しない).
+		 */
+		explicit CBlendParam8 (const CBlendParam& v);
+
+		void clear () {
+			blendType    = blend_normal;
+			basePixels   = 0;
+			weightPixels = 0;
+			weight       = 255;
+			for (int i = 0; i < 4; ++i) {
+				baseColor[i] = 255;
+				fillColor[i] = 255;
+			}
+		}
+	};
+
+	/**
+	 * 複数のイメージのチャンネルを1つのイメージにパックする際の、1チャンネル分の指定.
+	 */
+	class CPackChannel
+	{
+	public:
+		const unsigned char* pixels;			// 参照する画素. NULLの場合はvalueを使用.
+		CHANNEL_TYPE channel;					// 参照するチャンネル.
+		bool invert;							// 値を反転 (255 - 値).
+		unsigned char value;					// pixelsがNULLの場合の値.
+
+	public:
+		CPackChannel () {
+			clear();
+		}
+
+		void clear () {
+			pixels  = 0;
+			channel = channel_red;
+			invert  = false;
+			value   = 255;
+		}
+	};
+
+	/**
+	 * SIMD命令で処理できる環境か (SSE2/NEON).
+	 */
+	bool hasSIMD ();
+
+	/**
+	 * SIMD命令を使用するか指定 (falseの場合はスカラーの参照実装を使用).
+	 * 既定では、SIMD命令を使用できる場合は使用する.
+	 */
+	void setUseSIMD (const bool useSIMD);
+	bool getUseSIMD ();
+
+	/**
+	 * 指定のチャンネルをRGBに入れ、グレースケールにする (Alphaは1).
+	 * @param[in,out] pixels  画素.
+	 * @param[in]     count   画素数.
+	 * @param[in]     channel チャンネル.
+	 */
+	void convertToGrayscale (float* pixels, const int count, const CHANNEL_TYPE channel);
+
+	/**
+	 * Alphaを指定の値にする.
+	 */
+	void fillAlpha (float* pixels, const int count, const float alpha);
+
+	/**
+	 * RGBを反転 (1 - RGB).
+	 */
+	void invertColor (float* pixels, const int count);
+
+	/**
+	 * 画素を合成.
+	 * @param[in,out] pixels  上に重ねる画素. 合成結果が返る.
+	 * @param[in]     count   画素数.
+	 * @param[in]     param   合成のパラメータ.
+	 */
+	void blendPixels (float* pixels, const int count, const CBlendParam& param);
+
+	/**
+	 * 法線マップの画素を、法線ベクトルとして合成.
+	 * @param[in,out] pixels        上に重ねる法線マップの画素. 合成結果が返る.
+	 * @param[in]     basePixels    合成先の法線マップの画素.
+	 * @param[in]     weightPixels  ウエイトの画素 (Rを使用). NULLの場合はweightのみを使用.
+	 * @param[in]     weight        ウエイト値.
+	 * @param[in]     count         画素数.
+	 */
+	void blendNormalPixels (float* pixels, const float* basePixels, const float* weightPixels, const float weight, const int count);
+
+	/**
+	 * 8bitの画素での演算 (float版と同じ処理を固定小数点で行う).
+	 * 法線マップの合成は精度が必要なため、float版のみとする.
+	 */
+	void convertToGrayscale (unsigned char* pixels, const int count, const CHANNEL_TYPE channel);
+	void fillAlpha (unsigned char* pixels, const int count, const unsigned char alpha);
+	void invertColor (unsigned char* pixels, const int count);
+	void blendPixels (unsigned char* pixels, const int count, const CBlendParam8& param);
+
+	/**
+	 * 3つのチャンネルを、1度の走査で出力のR/G/Bにパックする (Alphaは255).
+	 * glTFのOcclusion(R)/Roughness(G)/Metallic(B)のテクスチャの作成で使用.
+	 * @param[out] dstPixels  出力の画素.
+	 * @param[in]  count      画素数.
+	 * @param[in]  red        Rに格納する値.
+	 * @param[in]  green      Gに格納する値.
+	 * @param[in]  blue       Bに格納する値.
+	 */
+	void packChannels (unsigned char* dstPixels, const int count, const CPackChannel& red, const CPackChannel& green, const CPackChannel& blue);
+}
+
+#endif
@@ -0,0 +1,442 @@
+﻿/**
+ * RGBA(8bit)のイメージの拡大縮小.
+ * 出力の1行ごとに、参照する元の行(ライン)をウエイトを掛けて加算し(縦の補間)、.
+ * 加算したライン上を補間する(横の補間)。作業用のメモリはスレッドごとに1ライン分となる.
+ * スカラーの参照実装と、SSE2(x86/x64)/NEON(ARM64)による実装を持つ (1画素(RGBA)を128bitのレジスタ1つで処理).
+ */
+#include "ImageResampler.h"
+#include "ImageKernels.h"
+#include "ThreadPool.h"
+
+#include <math.h>
+#include <string.h>
+#include <algorithm>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define IMAGE_RESAMPLER_USE_SSE2
+#include <emmintrin.h>
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#define IMAGE_RESAMPLER_USE_NEON
+#include <arm_neon.h>
+#endif
+
+namespace {
+	// 補間のウエイトとして無視する値.
+	const double WEIGHT_EPSILON = 1e-5;
+
+	// 乗算済みのAlphaがこの値未満の場合は、RGBを0とする (8bitで0に丸められる値).
+	const float ALPHA_EPSILON = 0.5f;
+
+	// 1回のparallelForで、スレッドあたりに分割する数.
+	const int CHUNKS_PER_THREAD = 4;
+
+	const double PI = 3.14159265358979323846;
+
+	/**
+	 * フィルタの半径 (出力の1画素を1とした場合).
+	 */
+	double getFilterSupport (const ImageResampler::FILTER_TYPE filter) {
+		switch (filter) {
+		case ImageResampler::filter_triangle:
+			return 1.0;
+		case ImageResampler::filter_lanczos3:
+			return 3.0;
+		case ImageResampler::filter_mitchell:
+			return 2.0;
+		default:
+			return 0.5;
+		}
+	}
+
+	/**
+	 * フィルタの値.
+	 * @param[in] filter  フィルタ (filter_box以外).
+	 * @param[in] t       中心からの距離.
+	 */
+	double evalFilter (const ImageResampler::FILTER_TYPE filter, const double t) {
+		const double x = fabs(t);
+		switch (filter) {
+		case ImageResampler::filter_triangle:
+			return (x < 1.0) ? (1.0 - x) : 0.0;
+
+		case ImageResampler::filter_lanczos3:
+			{
+				if (x < 1e-8) return 1.0;
+				if (x >= 3.0) return 0.0;
+				const double px = PI * x;
+				return 3.0 * sin(px) * sin(px / 3.0) / (px * px);
+			}
+
+		case ImageResampler::filter_mitchell:
+			{
+				const double B = 1.0 / 3.0;
+				const double C = 1.0 / 3.0;
+				if (x < 1.0) {
+					return ((12.0 - 9.0 * B - 6.0 * C) * x * x * x + (-18.0 + 12.0 * B + 6.0 * C) * x * x + (6.0 - 2.0 * B)) / 6.0;
+				}
+				if (x < 2.0) {
+					return ((-B - 6.0 * C) * x * x * x + (6.0 * B + 30.0 * C) * x * x + (-12.0 * B - 48.0 * C) * x + (8.0 * B + 24.0 * C)) / 6.0;
+				}
+				return 0.0;
+			}
+
+		default:
+			return 0.0;
+		}
+	}
+
+	/**
+	 * 0.0-255.0の値を8bitに変換 (四捨五入).
+	 */
+	inline unsigned char toByte (const float v) {
+		return (unsigned char)(int)(std::min(std::max(v, 0.0f), 255.0f) + 0.5f);
+	}
+
+	//-----------------------------------------------------------.
+	// スカラーの参照実装.
+	//-----------------------------------------------------------.
+	void accumulateLineScalar (const unsigned char* line, const int count, const float weight, const bool premultiply, float* acc) {
+		if (premultiply) {
+			const float wA = weight * (1.0f / 255.0f);
+			for (int x = 0; x < count; ++x) {
+				const unsigned char* p = line + x * 4;
+				float* a = acc + x * 4;
+				const float f = (float)p[3] * wA;
+				a[0] += (float)p[0] * f;
+				a[1] += (float)p[1] * f;
+				a[2] += (float)p[2] * f;
+				a[3] += (float)p[3] * weight;
+			}
+		} else {
+			for (int x = 0; x < count; ++x) {
+				const unsigned char* p = line + x * 4;
+				float* a = acc + x * 4;
+				a[0] += (float)p[0] * weight;
+				a[1] += (float)p[1] * weight;
+				a[2] += (float)p[2] * weight;
+				a[3] += (float)p[3] * weight;
+			}
+		}
+	}
+
+	void resampleLineScalar (const float* acc, const ImageResampler::CAxisWeights& pixelWeights, const int count, const bool premultiplied, unsigned char* dst) {
+		const int* indices   = &(pixelWeights.indices[0]);
+		const float* weights = &(pixelWeights.weights[0]);
+		for (int x = 0; x < count; ++x) {
+			float r = 0.0f, g = 0.0f, b = 0.0f, a = 0.0f;
+			const int iEnd = pixelWeights.starts[x + 1];
+			for (int i = pixelWeights.starts[x]; i < iEnd; ++i) {
+				const float* p = acc + indices[i] * 4;
+				const float w = weights[i];
+				r += p[0] * w;
+				g += p[1] * w;
+				b += p[2] * w;
+				a += p[3] * w;
+			}
+			if (premultiplied) {
+				if (a >= ALPHA_EPSILON) {
+					const float f = 255.0f / a;
+					r *= f;
+					g *= f;
+					b *= f;
+				} else {
+					r = g = b = 0.0f;
+				}
+			}
+			dst[0] = toByte(r);
+			dst[1] = toByte(g);
+			dst[2] = toByte(b);
+			dst[3] = toByte(a);
+			dst += 4;
+		}
+	}
+
+#if defined(IMAGE_RESAMPLER_USE_SSE2)
+	//-----------------------------------------------------------.
+	// SSE2での実装.
+	//-----------------------------------------------------------.
+	inline __m128 loadPixelSSE (const unsigned char* p, const __m128i zeroV) {
+		int v;
+		memcpy(&v, p, 4);
+		return _mm_cvtepi32_ps(_mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(v), zeroV), zeroV));
+	}
+
+	inline __m128 selectRGB (const __m128 rgbV, const __m128 alphaV) {
+		const __m128 maskRGB = _mm_castsi128_ps(_mm_set_epi32(0, -1, -1, -1));
+		return _mm_or_ps(_mm_and_ps(maskRGB, rgbV), _mm_andnot_ps(maskRGB, alphaV));
+	}
+
+	void accumulateLineSSE (const unsigned char* line, const int count, const float weight, const bool premultiply, float* acc) {
+		const __m128i zeroV = _mm_setzero_si128();
+		const __m128 weightV = _mm_set1_ps(weight);
+		if (premultiply) {
+			const __m128 wAV = _mm_set1_ps(weight * (1.0f / 255.0f));
+			for (int x = 0; x < count; ++x) {
+				const __m128 pV = loadPixelSSE(line + x * 4, zeroV);
+				const __m128 fV = selectRGB(_mm_mul_ps(_mm_shuffle_ps(pV, pV, _MM_SHUFFLE(3, 3, 3, 3)), wAV), weightV);
+				_mm_storeu_ps(acc + x * 4, _mm_add_ps(_mm_loadu_ps(acc + x * 4), _mm_mul_ps(pV, fV)));
+			}
+		} else {
+			for (int x = 0; x < count; ++x) {
+				const __m128 pV = loadPixelSSE(line + x * 4, zeroV);
+				_mm_storeu_ps(acc + x * 4, _mm_add_ps(_mm_loadu_ps(acc + x * 4), _mm_mul_ps(pV, weightV)));
+			}
+		}
+	}
+
+	void resampleLineSSE (const float* acc, const ImageResampler::CAxisWeights& pixelWeights, const int count, const bool premultiplied, unsigned char* dst) {
+		const int* indices   = &(pixelWeights.indices[0]);
+		const float* weights = &(pixelWeights.weights[0]);
+		const __m128 zeroV = _mm_setzero_ps();
+		const __m128 maxV  = _mm_set1_ps(255.0f);
+		const __m128 halfV = _mm_set1_ps(0.5f);
+		const __m128i zeroIV = _mm_setzero_si128();
+
+		for (int x = 0; x < count; ++x) {
+			__m128 sV = zeroV;
+			const int iEnd = pixelWeights.starts[x + 1];
+			for (int i = pixelWeights.starts[x]; i < iEnd; ++i) {
+				sV = _mm_add_ps(sV, _mm_mul_ps(_mm_loadu_ps(acc + indices[i] * 4), _mm_set1_ps(weights[i])));
+			}
+			if (premultiplied) {
+				const float a = _mm_cvtss_f32(_mm_shuffle_ps(sV, sV, _MM_SHUFFLE(3, 3, 3, 3)));
+				if (a >= ALPHA_EPSILON) {
+					sV = _mm_mul_ps(sV, selectRGB(_mm_set1_ps(255.0f / a), _mm_set1_ps(1.0f)));
+				} else {
+					sV = selectRGB(zeroV, sV);
+				}
+			}
+			const __m128i iV = _mm_cvttps_epi32(_mm_add_ps(_mm_min_ps(_mm_max_ps(sV, zeroV), maxV), halfV));
+			const __m128i bV = _mm_packus_epi16(_mm_packs_epi32(iV, zeroIV), zeroIV);
+			const int v = _mm_cvtsi128_si32(bV);
+			memcpy(dst + x * 4, &v, 4);
+		}
+	}
+#endif
+
+#if defined(IMAGE_RESAMPLER_USE_NEON)
+	//-----------------------------------------------------------.
+	// NEON(ARM64)での実装.
+	//-----------------------------------------------------------.
+	inline float32x4_t loadPixelNEON (const unsigned char* p) {
+		uint8_t v[8] = { p[0], p[1], p[2], p[3], 0, 0, 0, 0 };
+		return vcvtq_f32_u32(vmovl_u16(vget_low_u16(vmovl_u8(vld1_u8(v)))));
+	}
+
+	void accumulateLineNEON (const unsigned char* line, const int count, const float weight, const bool premultiply, float* acc) {
+		const float32x4_t weightV = vdupq_n_f32(weight);
+		if (premultiply) {
+			const float wA = weight * (1.0f / 255.0f);
+			for (int x = 0; x < count; ++x) {
+				const float32x4_t pV = loadPixelNEON(line + x * 4);
+				const float32x4_t fV = vsetq_lane_f32(weight, vmulq_n_f32(vdupq_laneq_f32(pV, 3), wA), 3);
+				vst1q_f32(acc + x * 4, vaddq_f32(vld1q_f32(acc + x * 4), vmulq_f32(pV, fV)));
+			}
+		} else {
+			for (int x = 0; x < count; ++x) {
+				const float32x4_t pV = loadPixelNEON(line + x * 4);
+				vst1q_f32(acc + x * 4, vaddq_f32(vld1q_f32(acc + x * 4), vmulq_f32(pV, weightV)));
+			}
+		}
+	}
+
+	void resampleLineNEON (const float* acc, const ImageResampler::CAxisWeights& pixelWeights, const int count, const bool premultiplied, unsigned char* dst) {
+		const int* indices   = &(pixelWeights.indices[0]);
+		const float* weights = &(pixelWeights.weights[0]);
+		const float32x4_t zeroV = vdupq_n_f32(0.0f);
+		const float32x4_t maxV  = vdupq_n_f32(255.0f);
+		const float32x4_t halfV = vdupq_n_f32(0.5f);
+
+		for (int x = 0; x < count; ++x) {
+			float32x4_t sV = zeroV;
+			const int iEnd = pixelWeights.starts[x + 1];
+			for (int i = pixelWeights.starts[x]; i < iEnd; ++i) {
+				sV = vaddq_f32(sV, vmulq_n_f32(vld1q_f32(acc + indices[i] * 4), weights[i]));
+			}
+			if (premultiplied) {
+				const float a = vgetq_lane_f32(sV, 3);
+				if (a >= ALPHA_EPSILON) {
+					sV = vsetq_lane_f32(a, vmulq_n_f32(sV, 255.0f / a), 3);
+				} else {
+					sV = vsetq_lane_f32(a, zeroV, 3);
+				}
+			}
+			const uint32x4_t iV = vcvtq_u32_f32(vaddq_f32(vminq_f32(vmaxq_f32(sV, zeroV), maxV), halfV));
+			const uint8x8_t bV = vmovn_u16(vcombine_u16(vmovn_u32(iV), vdup_n_u16(0)));
+			dst[x * 4 + 0] = vget_lane_u8(bV, 0);
+			dst[x * 4 + 1] = vget_lane_u8(bV, 1);
+			dst[x * 4 + 2] = vget_lane_u8(bV, 2);
+			dst[x * 4 + 3] = vget_lane_u8(bV, 3);
+		}
+	}
+#endif
+}
+
+/**
+ * ウエイトを計算.
+ * filter_boxは、出力の1画素が覆う範囲とイメージの画素が重なる面積をウエイトとする (縮小時は面積平均、拡大時はバイリニア).
+ * それ以外は、縮小時はフィルタの幅を縮小率に合わせて広げる.
+ */
+void ImageResampler::CAxisWeights::build (const int dstCount, const int srcCount, const int repeat, const bool flip, const FILTER_TYPE filter)
+{
+	const int rep = std::max(repeat, 1);
+	const double scale  = (double)srcCount * (double)rep / (double)dstCount;		// 出力の1画素あたりのイメージの画素数.
+	const double fScale = std::max(scale, 1.0);										// フィルタの幅の倍率.
+	const double support = getFilterSupport(filter) * fScale;
+
+	starts.resize(dstCount + 1);
+	indices.clear();
+	weights.clear();
+	identity  = (dstCount == srcCount && rep == 1 && !flip);
+	singleTap = (dstCount == srcCount && rep == 1);
+
+	// 同じサイズの場合はフィルタを掛けず、そのまま(反転時は逆順に)参照する.
+	if (singleTap) {
+		indices.resize(dstCount);
+		weights.assign(dstCount, 1.0f);
+		for (int i = 0; i <= dstCount; ++i) starts[i] = i;
+		for (int i = 0; i < dstCount; ++i) indices[i] = flip ? (dstCount - 1 - i) : i;
+		return;
+	}
+
+	std::vector<double> tmpWeights;
+	for (int i = 0; i < dstCount; ++i) {
+		starts[i] = (int)indices.size();
+
+		// 出力の画素の中心に対応する、繰り返しを含めたイメージ上の位置.
+		const double c = ((flip ? (double)(dstCount - i) : (double)i) + (flip ? -0.5 : 0.5)) * scale;
+
+		const double p0 = c - support;
+		const double p1 = c + support;
+		const int k0 = (int)floor(p0);
+		const int k1 = (int)ceil(p1) - 1;
+		tmpWeights.clear();
+		for (int k = k0; k <= k1; ++k) {
+			if (filter == filter_box) {
+				tmpWeights.push_back(std::max(0.0, std::min(p1, (double)(k + 1)) - std::max(p0, (double)k)));
+			} else {
+				tmpWeights.push_back(evalFilter(filter, ((double)k + 0.5 - c) / fScale));
+			}
+		}
+
+		double sumW = 0.0;
+		for (size_t j = 0; j < tmpWeights.size(); ++j) {
+			if (fabs(tmpWeights[j]) > WEIGHT_EPSILON) sumW += tmpWeights[j];
+		}
+		if (sumW <= WEIGHT_EPSILON) sumW = 1.0;
+
+		for (int k = k0; k <= k1; ++k) {
+			const double w = tmpWeights[k - k0];
+			if (fabs(w) <= WEIGHT_EPSILON) continue;
+			int index = k;
+			if (rep > 1) {
+				index = ((k % srcCount) + srcCount) % srcCount;
+			} else {
+				index = std::min(std::max(k, 0), srcCount - 1);
+			}
+			indices.push_back(index);
+			weights.push_back((float)(w / sumW));
+		}
+	}
+	starts[dstCount] = (int)indices.size();
+}
+
+/**
+ * 1ラインの画素にウエイトを掛けて加算.
+ */
+void ImageResampler::accumulateLine (const unsigned char* line, const int count, const float weight, const bool premultiply, float* acc)
+{
+#if defined(IMAGE_RESAMPLER_USE_SSE2)
+	if (ImageKernels::getUseSIMD()) return accumulateLineSSE(line, count, weight, premultiply, acc);
+#elif defined(IMAGE_RESAMPLER_USE_NEON)
+	if (ImageKernels::getUseSIMD()) return accumulateLineNEON(line, count, weight, premultiply, acc);
+#endif
+	accumulateLineScalar(line, count, weight, premultiply, acc);
+}
+
+/**
+ * 加算したラインを補間し、出力の1行を計算.
+ */
+void ImageResampler::resampleLine (const float* acc, const CAxisWeights& pixelWeights, const int count, const bool premultiplied, unsigned char* dst)
+{
+#if defined(IMAGE_RESAMPLER_USE_SSE2)
+	if (ImageKernels::getUseSIMD()) return resampleLineSSE(acc, pixelWeights, count, premultiplied, dst);
+#elif defined(IMAGE_RESAMPLER_USE_NEON)
+	if (ImageKernels::getUseSIMD()) return resampleLineNEON(acc, pixelWeights, count, premultiplied, dst);
+#endif
+	resampleLineScalar(acc, pixelWeights, count, premultiplied, dst);
+}
+
+/**
+ * RGBAにAlphaが255でない画素があるか.
+ */
+bool ImageResampler::hasAlpha (const unsigned char* rgbaData, const size_t count)
+{
+	for (size_t i = 0; i < count; ++i) {
+		if (rgbaData[i * 4 + 3] != 255) return true;
+	}
+	return false;
+}
+
+/**
+ * イメージを拡大縮小.
+ */
+bool ImageResampler::resize (const unsigned char* srcRGBA, const int srcWidth, const int srcHeight, unsigned char* dstRGBA, const int dstWidth, const int dstHeight, const CResampleParam& param)
+{
+	if (!srcRGBA || !dstRGBA || srcWidth <= 0 || srcHeight <= 0 || dstWidth <= 0 || dstHeight <= 0) return false;
+
+	// Alphaがすべて255の場合は、乗算/除算を省略する.
+	const bool premultiply = hasAlpha(srcRGBA, (size_t)srcWidth * (size_t)srcHeight);
+
+	// 90度回転の場合は、列をラインとして並べ替えたものを参照する.
+	// 出力の(u, v)で回転前の(v, 1 - u)を参照する.
+	std::vector<unsigned char> columns;
+	const unsigned char* lines = srcRGBA;
+	int lineLength = srcWidth;
+	CAxisWeights lineWeights, pixelWeights;
+	if (!param.rotate90) {
+		lineWeights.build(dstHeight, srcHeight, param.repeatV, param.flipV, param.filter);
+		pixelWeights.build(dstWidth, srcWidth, param.repeatU, param.flipH, param.filter);
+	} else {
+		lineLength = srcHeight;
+		columns.resize((size_t)srcWidth * (size_t)srcHeight * 4);
+		for (int y = 0; y < srcHeight; ++y) {
+			const unsigned char* pSrc = srcRGBA + (size_t)y * (size_t)srcWidth * 4;
+			for (int x = 0; x < srcWidth; ++x) {
+				memcpy(&(columns[((size_t)x * (size_t)srcHeight + (size_t)y) * 4]), pSrc + x * 4, 4);
+			}
+		}
+		lines = &(columns[0]);
+		lineWeights.build(dstHeight, srcWidth, param.repeatU, param.flipH, param.filter);
+		pixelWeights.build(dstWidth, srcHeight, param.repeatV, !param.flipV, param.filter);
+	}
+	const size_t lineBytes = (size_t)lineLength * 4;
+
+	// 出力の行をまとまりに分け、並列に処理.
+	const int chunksCou = std::max(1, std::min(dstHeight, CThreadPool::getInstance().getThreadsCount() * CHUNKS_PER_THREAD));
+	CThreadPool::getInstance().parallelFor(chunksCou, [&](const int chunkIndex) {
+		const int y0 = (int)((long long)dstHeight * chunkIndex / chunksCou);
+		const int y1 = (int)((long long)dstHeight * (chunkIndex + 1) / chunksCou);
+		std::vector<float> accLine((size_t)lineLength * 4);
+
+		for (int y = y0; y < y1; ++y) {
+			unsigned char* dst = dstRGBA + (size_t)y * (size_t)dstWidth * 4;
+			const int iStart = lineWeights.starts[y];
+			const int tapsCou = lineWeights.getTapsCount(y);
+			if (tapsCou == 1 && pixelWeights.identity) {
+				memcpy(dst, lines + (size_t)lineWeights.indices[iStart] * lineBytes, lineBytes);
+				continue;
+			}
+
+			// 画素を混ぜない行は、乗算/除算の誤差が出ないようにそのまま補間する.
+			const bool rowPremultiply = premultiply && !(tapsCou == 1 && pixelWeights.singleTap);
+			std::fill(accLine.begin(), accLine.end(), 0.0f);
+			for (int i = iStart; i < iStart + tapsCou; ++i) {
+				accumulateLine(lines + (size_t)lineWeights.indices[i] * lineBytes, lineLength, lineWeights.weights[i], rowPremultiply, &(accLine[0]));
+			}
+			resampleLine(&(accLine[0]), pixelWeights, dstWidth, rowPremultiply, dst);
+		}
+	});
+
+	return true;
+}
@@ -0,0 +1,126 @@
+﻿/**
+ * RGBA(8bit)のイメージの拡大縮小.
+ * 縦/横に分離したフィルタで、アルファを乗算済みの色として補間するため、半透明の境界が暗くならない.
+ * 画素の読み込み時に乗算、書き込み時に除算を行い、作業用に全解像度のイメージは確保しない (90度回転時を除く).
+ * Shade3DのAPIは使用していない.
+ */
+#ifndef _IMAGERESAMPLER_H
+#define _IMAGERESAMPLER_H
+
+#include <vector>
+#include <stddef.h>
+
+namespace ImageResampler {
+	/**
+	 * 補間のフィルタ.
+	 */
+	enum FILTER_TYPE {
+		filter_box = 0,					// 出力の1画素が覆う範囲の面積平均.
+		filter_triangle,				// テント (拡大時はバイリニア).
+		filter_lanczos3,				// Lanczos (3 lobes).
+		filter_mitchell,				// Mitchell-Netravali (B = C = 1/3).
+	};
+
+	/**
+	 * 既定のフィルタ.
+	 */
+	const FILTER_TYPE DEFAULT_FILTER = filter_mitchell;
+
+	/**
+	 * 拡大縮小のパラメータ.
+	 * 反転/90度回転/繰り返しは、CImagesBlend::m_duplicateImageと同じ指定.
+	 */
+	class CResampleParam
+	{
+	public:
+		FILTER_TYPE filter;				// フィルタ.
+		bool flipH;						// 左右反転.
+		bool flipV;						// 上下反転.
+		bool rotate90;					// 90度回転.
+		int repeatU;					// 繰り返し回数U.
+		int repeatV;					// 繰り返し回数V.
+
+	public:
+		CResampleParam () {
+			clear();
+		}
+
+		void clear () {
+			filter   = DEFAULT_FILTER;
+			flipH    = false;
+			flipV    = false;
+			rotate90 = false;
+			repeatU  = 1;
+			repeatV  = 1;
+		}
+	};
+
+	/**
+	 * 出力の1軸の各位置で参照する、イメージ上の位置とウエイト.
+	 * 出力のi番目は、indices/weightsの[starts[i], starts[i + 1])を使用する.
+	 */
+	class CAxisWeights
+	{
+	public:
+		std::vector<int> starts;
+		std::vector<int> indices;
+		std::vector<float> weights;
+		bool identity;					// 出力のi番目がイメージのi番目そのままの場合.
+		bool singleTap;					// 出力のすべての画素が、イメージの1画素のみを参照する場合 (同じサイズでの反転など).
+
+	public:
+		CAxisWeights () : identity(false), singleTap(false) { }
+
+		/**
+		 * ウエイトを計算.
+		 * @param[in] dstCount  出力の画素数.
+		 * @param[in] srcCount  イメージの画素数.
+		 * @param[in] repeat    繰り返し回数 (1より大きい場合は端で折り返す。1の場合は端の画素を延長).
+		 * @param[in] flip      反転.
+		 * @param[in] filter    フィルタ.
+		 */
+		void build (const int dstCount, const int srcCount, const int repeat, const bool flip, const FILTER_TYPE filter);
+
+		int getTapsCount (const int i) const { return starts[i + 1] - starts[i]; }
+	};
+
+	/**
+	 * 1ラインの画素にウエイトを掛けて加算 (acc += line * weight).
+	 * @param[in]     line         ラインの画素 (RGBAの順で0-255).
+	 * @param[in]     count        画素数.
+	 * @param[in]     weight       ウエイト.
+	 * @param[in]     premultiply  RGBにAlphaを乗算して加算する.
+	 * @param[in,out] acc          加算先 (count x 4).
+	 */
+	void accumulateLine (const unsigned char* line, const int count, const float weight, const bool premultiply, float* acc);
+
+	/**
+	 * accumulateLineで加算したラインを補間し、出力の1行を計算.
+	 * @param[in]  acc            ラインの画素 (RGBAの順で0.0-255.0).
+	 * @param[in]  pixelWeights   ライン上のウエイト.
+	 * @param[in]  count          出力の画素数.
+	 * @param[in]  premultiplied  accが乗算済みの場合はtrue (出力時にAlphaで除算する).
+	 * @param[out] dst            出力の画素.
+	 */
+	void resampleLine (const float* acc, const CAxisWeights& pixelWeights, const int count, const bool premultiplied, unsigned char* dst);
+
+	/**
+	 * RGBAにAlphaが255でない画素があるか.
+	 */
+	bool hasAlpha (const unsigned char* rgbaData, const size_t count);
+
+	/**
+	 * イメージを拡大縮小.
+	 * 出力の行ごとに、複数スレッドで並列に処理する (CThreadPool::parallelForの中から呼び出した場合は、そのスレッドで処理する).
+	 * @param[in]  srcRGBA    元の画素 (1ピクセルRGBA(4バイト)).
+	 * @param[in]  srcWidth   元の幅.
+	 * @param[in]  srcHeight  元の高さ.
+	 * @param[out] dstRGBA    出力の画素 (dstWidth x dstHeight x 4バイトを確保しておくこと).
+	 * @param[in]  dstWidth   出力の幅.
+	 * @param[in]  dstHeight  出力の高さ.
+	 * @param[in]  param      パラメータ.
+	 */
+	bool resize (const unsigned char* srcRGBA, const int srcWidth, const int srcHeight, unsigned char* dstRGBA, const int dstWidth, const int dstHeight, const CResampleParam& param = CResampleParam());
+}
+
+#endif
@@ -5,13 +5,160 @@
 #include "MathUtil.h"
 #include "Shade3DUtil.h"
 #include "StreamCtrl.h"
+#include "ImageKernels.h"
+#include "BakeCache.h"
+#include "HashUtil.h"
+#include "ThreadPool.h"
+#include "TileBaker.h"
+#include "ImageResampler.h"
+#include "ImageEncoder.h"
 
 #include <math.h>
+#include <string.h>
+#include <algorithm>
+#include <functional>
+#include <memory>
 
 // sxsdk::image_interface* の解放処理.
 // 注意点として、compointer<sxsdk::image_interface>で確保した場合は自動で解放されるため、Releaseを呼んではいけない.
 #define IMAGE_INTERFACE_RELEASE(image) {if (image) { image->Release(); image = NULL; } }
 
+namespace {
+	/**
+	 * ベイク結果のキャッシュ用のキーに値を追加.
+	 */
+	inline uint64_t combineBakeKey (const uint64_t key, const int v) {
+		return HashUtil::combineHash64(key, (uint64_t)(int64_t)v);
+	}
+	inline uint64_t combineBakeKey (const uint64_t key, const float v) {
+		uint32_t iV;
+		memcpy(&iV, &v, sizeof(float));
+		return HashUtil::combineHash64(key, (uint64_t)iV);
+	}
+	inline uint64_t combineBakeKey (const uint64_t key, const sxsdk::rgb_class& col) {
+		return combineBakeKey(combineBakeKey(combineBakeKey(key, col.red), col.green), col.blue);
+	}
+
+	/**
+	 * ベイクしたイメージをキャッシュ用のデータとして格納.
+	 */
+	void storeBakedImage (CBakedImageData& bakedImage, sxsdk::image_interface* image, const bool hasImage, const std::string& name, const int texCoord, const sx::vec<int,2>& repeat, const sxsdk::rgb_class& factor) {
+		bakedImage.clear();
+		bakedImage.hasImage = hasImage;
+		bakedImage.name     = name;
+		bakedImage.texCoord = texCoord;
+		bakedImage.repeat   = repeat;
+		bakedImage.factor   = factor;
+		if (hasImage && image) bakedImage.imageData.setCustomImage(image);
+	}
+
+	// 並列処理で、一度に読み込む行のまとまり(バンド)の1イメージあたりの最大サイズ (bytes).
+	const size_t BAKE_BAND_MAX_BYTES = 4 * 1024 * 1024;
+
+	/**
+	 * イメージの画素の読み込み/書き込み (float/8bit).
+	 */
+	inline void getImagePixels (sxsdk::image_interface* image, const int y, const int width, const int height, sxsdk::rgba_class* pixels) {
+		image->get_pixels_rgba_float(0, y, width, height, pixels);
+	}
+	inline void getImagePixels (sxsdk::image_interface* image, const int y, const int width, const int height, sx::rgba8_class* pixels) {
+		image->get_pixels_rgba(0, y, width, height, pixels);
+	}
+	inline void setImagePixels (sxsdk::image_interface* image, const int y, const int width, const int height, const sxsdk::rgba_class* pixels) {
+		image->set_pixels_rgba_float(0, y, width, height, pixels);
+	}
+	inline void setImagePixels (sxsdk::image_interface* image, const int y, const int width, const int height, const sx::rgba8_class* pixels) {
+		image->set_pixels_rgba(0, y, width, height, pixels);
+	}
+
+	/**
+	 * イメージを行のまとまり(バンド)ごとに読み込み、行ごとの画素の処理を複数スレッドで並列に行う.
+	 * Shade3DのAPIでの画素の読み書きはメインスレッドで行うため、funcの中では画素の演算のみを行うこと.
+	 * 各行は独立して処理されるため、スレッド数によらず同じ結果になる.
+	 * @param[in] width      処理する幅 (srcImages/dstImageは、このサイズ以上であること).
+	 * @param[in] height     処理する高さ.
+	 * @param[in] srcImages  読み込むイメージ. NULLの場合は読み込まず、画素はすべて0となる.
+	 * @param[in] dstImage   処理後のrows[0]を書き込むイメージ. NULLの場合は書き込まない.
+	 * @param[in] func       行ごとの処理. rows[i]は、srcImages[i]のy行目の画素 (sxsdk::rgba_class または sx::rgba8_class).
+	 */
+	template<class T> void processImageRowsParallel (const int width, const int height, const std::vector<sxsdk::image_interface*>& srcImages, sxsdk::image_interface* dstImage, const std::function<void (const int y, T* const* rows)>& func)
+	{
+		const int imagesCou = (int)srcImages.size();
+		if (width <= 0 || height <= 0 || imagesCou == 0) return;
+
+		const size_t rowBytes = (size_t)width * sizeof(T);
+		const int bandRows = std::max(1, std::min(height, (int)(BAKE_BAND_MAX_BYTES / rowBytes)));
+
+		std::vector< std::vector<T> > bandBuffers(imagesCou);
+		for (int i = 0; i < imagesCou; ++i) bandBuffers[i].resize((size_t)width * (size_t)bandRows);
+
+		for (int y0 = 0; y0 < height; y0 += bandRows) {
+			const int rowsCou = std::min(bandRows, height - y0);
+			for (int i = 0; i < imagesCou; ++i) {
+				if (srcImages[i]) {
+					getImagePixels(srcImages[i], y0, width, rowsCou, &(bandBuffers[i][0]));
+				} else {
+					memset(&(bandBuffers[i][0]), 0, sizeof(T) * bandBuffers[i].size());
+				}
+			}
+
+			CThreadPool::getInstance().parallelFor(rowsCou, [&](const int iy) {
+				std::vector<T*> rows(imagesCou);
+				for (int i = 0; i < imagesCou; ++i) rows[i] = &(bandBuffers[i][(size_t)iy * (size_t)width]);
+				func(y0 + iy, &(rows[0]));
+			});
+
+			if (dstImage) setImagePixels(dstImage, y0, width, rowsCou, &(bandBuffers[0][0]));
+		}
+	}
+
+	/**
+	 * Shade3Dのイメージを、タイル単位でのベイクで参照する.
+	 * 画素の読み込みはTileBaker::bakeを呼び出したメインスレッドで行われる.
+	 */
+	class CShadeImageTileSource : public TileBaker::CTileSource
+	{
+	private:
+		compointer<sxsdk::image_interface> m_imageRef;		// 参照を保持する場合.
+		sxsdk::image_interface* m_image;
+		int m_width, m_height;
+
+	public:
+		CShadeImageTileSource (const compointer<sxsdk::image_interface>& image) : m_imageRef(image), m_image(image), m_width(image->get_size().x), m_height(image->get_size().y) { }
+
+		/**
+		 * 呼び出し側で保持しているイメージを参照する.
+		 */
+		CShadeImageTileSource (sxsdk::image_interface* image) : m_image(image), m_width(image->get_size().x), m_height(image->get_size().y) { }
+
+		virtual int getWidth () const { return m_width; }
+		virtual int getHeight () const { return m_height; }
+		virtual bool readPixels (const int x, const int y, const int width, const int height, unsigned char* rgbaData) {
+			try {
+				m_image->get_pixels_rgba(x, y, width, height, reinterpret_cast<sx::rgba8_class*>(rgbaData));
+				return true;
+			} catch (...) { }
+			return false;
+		}
+	};
+
+	/**
+	 * 最大テクスチャサイズに収まるように、縦横比を維持したサイズを計算 (glTF出力時と同じ計算).
+	 */
+	sx::vec<int,2> fitTextureSize (const int srcWidth, const int srcHeight, const int maxTexSize) {
+		sx::vec<int,2> newSize(srcWidth, srcHeight);
+		if (srcWidth <= maxTexSize && srcHeight <= maxTexSize) return newSize;
+		if (srcWidth > srcHeight) {
+			newSize.x = maxTexSize;
+			newSize.y = std::max(1, maxTexSize * srcHeight / srcWidth);
+		} else {
+			newSize.y = maxTexSize;
+			newSize.x = std::max(1, maxTexSize * srcWidth / srcHeight);
+		}
+		return newSize;
+	}
+}
+
 /*
 	Shade3Dの「透明」「不透明マスク」「チャンネル合成のアルファ透明」は、最終的に合成されてすべてOpacityのテクスチャに格納される.
 */
@@ -48,6 +195,9 @@ void CImagesBlend::clear ()
 	IMAGE_INTERFACE_RELEASE(m_transparencyImage);
 	IMAGE_INTERFACE_RELEASE(m_opacityMaskImage);
 
+	m_diffuseEncodedImage.clear();
+	m_glowEncodedImage.clear();
+
 	m_diffuseRepeat    = sx::vec<int,2>(1, 1);
 	m_normalRepeat     = sx::vec<int,2>(1, 1);
 	m_reflectionRepeat = sx::vec<int,2>(1, 1);
@@ -257,11 +407,20 @@ CImagesBlend::IMAGE_BAKE_RESULT CImagesBlend::blendImages (const CExportDlgParam
 	}
 
 	// Shade3Dでの表面材質のマッピングレイヤごとに、各種イメージを合成.
-	if (m_hasDiffuseImage) m_blendImages(sxsdk::enums::diffuse_mapping, m_diffuseRepeat);
+	// Diffuse/Glowは、タイル単位でベイクできる場合はイメージを作成せずにpng/jpegにエンコードする.
+	if (m_hasDiffuseImage) {
+		if (!m_canStreamBake(sxsdk::enums::diffuse_mapping) || !m_streamBakeImages(sxsdk::enums::diffuse_mapping, m_diffuseRepeat, m_diffuseEncodedImage)) {
+			m_blendImages(sxsdk::enums::diffuse_mapping, m_diffuseRepeat);
+		}
+	}
 	if (m_hasNormalImage) m_blendImages(sxsdk::enums::normal_mapping, m_normalRepeat);
 	if (m_hasReflectionImage) m_blendImages(sxsdk::enums::reflection_mapping, m_reflectionRepeat);
 	if (m_hasRoughnessImage) m_blendImages(sxsdk::enums::roughness_mapping, m_roughnessRepeat);
-	if (m_hasGlowImage) m_blendImages(sxsdk::enums::glow_mapping, m_glowRepeat);
+	if (m_hasGlowImage) {
+		if (!m_canStreamBake(sxsdk::enums::glow_mapping) || !m_streamBakeImages(sxsdk::enums::glow_mapping, m_glowRepeat, m_glowEncodedImage)) {
+			m_blendImages(sxsdk::enums::glow_mapping, m_glowRepeat);
+		}
+	}
 	if (m_hasTransparencyImage) m_blendImages(sxsdk::enums::transparency_mapping, m_transparencyRepeat);
 	if (m_hasOpacityMaskImage) m_blendImages(MAPPING_TYPE_OPACITY, m_opacityMaskRepeat);
 	if (m_hasOcclusionImage) m_blendImages(MAPPING_TYPE_GLTF_OCCLUSION, m_occlusionRepeat);
@@ -652,6 +811,7 @@ sx::vec<int,2> CImagesBlend::m_getMaxMappingImageSize (const sxsdk::enums::mappi
 
  /**
   * テクスチャを複製する場合に、反転や繰り返し回数を考慮.
+  * 拡大縮小はImageResamplerで行い、アルファを持つ場合は乗算済みの色として補間する.
   * @param[in] image       イメージクラス.
   * @param[in] dstSize     複製後のサイズ.
   * @param[in] flipColor   色反転.
@@ -663,183 +823,39 @@ sx::vec<int,2> CImagesBlend::m_getMaxMappingImageSize (const sxsdk::enums::mappi
   */
 compointer<sxsdk::image_interface> CImagesBlend::m_duplicateImage (sxsdk::image_interface* image, const sx::vec<int,2>& dstSize, const bool flipColor, const bool flipH, const bool flipV, const bool rotate90, const int repeatU, const int repeatV)
 {
-	compointer<sxsdk::image_interface> image2, dstImage;
+	compointer<sxsdk::image_interface> dstImage;
 	const int width  = dstSize.x;
 	const int height = dstSize.y;
 	if (width == 0 || height == 0) return dstImage;
 
-	std::vector<sx::rgba8_class> lineCols, lineCols2;
-	lineCols.resize(width);
-	lineCols2.resize(width);
-
-	if (repeatU > 1 || repeatV > 1) {
-		dstImage = m_pScene->create_image_interface(dstSize);
-
-		// gc->draw_imageでは、アルファ値も合成してしまうためアルファは分けて考える.
-		if (Shade3DUtil::hasImageAlpha(image)) {
-			const sx::vec<int,2> imgSize = image->get_size();
-			const int imgWidth  = imgSize.x;
-			const int imgHeight = imgSize.y;
-
-			// アルファだけを取得し、Redに一時的に入れる.
-			compointer<sxsdk::image_interface> alphaImage(m_pScene->create_image_interface(imgSize));
-			{
-				std::vector<sxsdk::rgba_class> lineD, lineD2;
-				lineD.resize(imgWidth);
-				lineD2.resize(imgWidth, sxsdk::rgba_class(0, 0, 0, 1));
-				for (int y = 0; y < imgHeight; ++y) {
-					image->get_pixels_rgba_float(0, y, imgWidth, 1, &(lineD[0]));
-					for (int x = 0; x < imgWidth; ++x) lineD2[x].red = lineD[x].alpha;
-					alphaImage->set_pixels_rgba_float(0, y, imgWidth, 1, &(lineD2[0]));
-				}
-			}
-
-			// イメージのAlphaを1にする.
-			compointer<sxsdk::image_interface> image2(m_pScene->create_image_interface(imgSize));
-			{
-				std::vector<sxsdk::rgba_class> lineD;
-				lineD.resize(imgWidth);
-				for (int y = 0; y < imgHeight; ++y) {
-					image->get_pixels_rgba_float(0, y, imgWidth, 1, &(lineD[0]));
-					for (int x = 0; x < imgWidth; ++x) lineD[x].alpha = 1.0f;
-					image2->set_pixels_rgba_float(0, y, imgWidth, 1, &(lineD[0]));
-				}
-			}
-
-			// RGBをタイリング.
-			try {
-				compointer<sxsdk::graphic_context_interface> gc(dstImage->get_graphic_context_interface());
-				gc->set_color(sxsdk::rgb_class(1, 1, 1));
-				const float dx = (float)width / (float)repeatU;
-				const float dy = (float)height / (float)repeatV;
-
-				sx::rectangle_class rect;
-				for (float y = 0.0f; y < (float)(height - 1); y += dy) {
-					for (float x = 0.0f; x < (float)(width - 1); x += dx) {
-						rect.min = sx::vec<int,2>((int)x, (int)y);
-						rect.max = sx::vec<int,2>((int)(x + dx), (int)(y + dy));
-						rect.min.x = std::max(0, rect.min.x);
-						rect.min.y = std::max(0, rect.min.y);
-						rect.max.x = std::min(width - 1, rect.max.x);
-						rect.max.y = std::min(height - 1, rect.max.y);
-						gc->draw_image(image2, rect);
-					}
-				}
-				gc->restore_color();
-			} catch (...) { }
-
-			// Aをタイリング.
-			compointer<sxsdk::image_interface> dstImageA(m_pScene->create_image_interface(dstSize));
-			try {
-				compointer<sxsdk::graphic_context_interface> gc(dstImageA->get_graphic_context_interface());
-				gc->set_color(sxsdk::rgb_class(1, 1, 1));
-				const float dx = (float)width / (float)repeatU;
-				const float dy = (float)height / (float)repeatV;
-
-				sx::rectangle_class rect;
-				for (float y = 0.0f; y < (float)(height - 1); y += dy) {
-					for (float x = 0.0f; x < (float)(width - 1); x += dx) {
-						rect.min = sx::vec<int,2>((int)x, (int)y);
-						rect.max = sx::vec<int,2>((int)(x + dx), (int)(y + dy));
-						rect.min.x = std::max(0, rect.min.x);
-						rect.min.y = std::max(0, rect.min.y);
-						rect.max.x = std::min(width - 1, rect.max.x);
-						rect.max.y = std::min(height - 1, rect.max.y);
-						gc->draw_image(alphaImage, rect);
-					}
-				}
-				gc->restore_color();
-			} catch (...) { }
-
-			// RGB + AをdstImageに格納.
-			try {
-				std::vector<sxsdk::rgba_class> lineD, lineD2;
-				lineD.resize(width);
-				lineD2.resize(width);
-
-				for (int y = 0; y < height; ++y) {
-					dstImage->get_pixels_rgba_float(0, y, width, 1, &(lineD[0]));
-					dstImageA->get_pixels_rgba_float(0, y, width, 1, &(lineD2[0]));
-
-					for (int x = 0; x < width; ++x) {
-						lineD[x].alpha = lineD2[x].red;
-					}
-					dstImage->set_pixels_rgba_float(0, y, width, 1, &(lineD[0]));
-				}
-
-			} catch (...) { }
-
-		} else {
-			try {
-				compointer<sxsdk::graphic_context_interface> gc(dstImage->get_graphic_context_interface());
-				gc->set_color(sxsdk::rgb_class(1, 1, 1));
-				const float dx = (float)width / (float)repeatU;
-				const float dy = (float)height / (float)repeatV;
-
-				sx::rectangle_class rect;
-				for (float y = 0.0f; y < (float)(height - 1); y += dy) {
-					for (float x = 0.0f; x < (float)(width - 1); x += dx) {
-						rect.min = sx::vec<int,2>((int)x, (int)y);
-						rect.max = sx::vec<int,2>((int)(x + dx), (int)(y + dy));
-						rect.min.x = std::max(0, rect.min.x);
-						rect.min.y = std::max(0, rect.min.y);
-						rect.max.x = std::min(width - 1, rect.max.x);
-						rect.max.y = std::min(height - 1, rect.max.y);
-						gc->draw_image(image, rect);
-					}
-				}
-				gc->restore_color();
-			} catch (...) { }
-		}
-
-	} else {
-		dstImage = Shade3DUtil::resizeImageWithAlpha(m_pScene, image, dstSize);
-	}
-
-	if (flipColor) {
-		for (int y = 0; y < height; ++y) {
-			dstImage->get_pixels_rgba(0, y, width, 1, &(lineCols[0]));
-			for (int x = 0; x < width; ++x) {
-				lineCols[x].red   = 255 - lineCols[x].red;
-				lineCols[x].green = 255 - lineCols[x].green;
-				lineCols[x].blue  = 255 - lineCols[x].blue;
-			}
-			dstImage->set_pixels_rgba(0, y, width, 1, &(lineCols[0]));
-		}
-	}
-	if (flipH) {
-		for (int y = 0; y < height; ++y) {
-			dstImage->get_pixels_rgba(0, y, width, 1, &(lineCols2[0]));
-			for (int x = 0; x < width; ++x) {
-				lineCols[x] = lineCols2[width - x - 1];
-			}
-			dstImage->set_pixels_rgba(0, y, width, 1, &(lineCols[0]));
-		}
-	}
-
-	if (flipV) {
-		for (int y = 0; y < height / 2; ++y) {
-			dstImage->get_pixels_rgba(0, y, width, 1, &(lineCols[0]));
-			dstImage->get_pixels_rgba(0, height - y - 1, width, 1, &(lineCols2[0]));
-			dstImage->set_pixels_rgba(0, y, width, 1, &(lineCols2[0]));
-			dstImage->set_pixels_rgba(0, height - y - 1, width, 1, &(lineCols[0]));
+	try {
+		// 画素を1度だけ読み込み、繰り返し/反転/90度回転を含めて1回で拡大縮小する.
+		std::vector<unsigned char> srcRGBA;
+		int srcWidth, srcHeight;
+		if (!Shade3DUtil::getImageRGBA8(image, srcRGBA, srcWidth, srcHeight)) return dstImage;
+
+		ImageResampler::CResampleParam param;
+		param.flipH    = flipH;
+		param.flipV    = flipV;
+		param.rotate90 = rotate90;
+		param.repeatU  = repeatU;
+		param.repeatV  = repeatV;
+		std::vector<unsigned char> dstRGBA((size_t)width * (size_t)height * 4);
+		if (!ImageResampler::resize(&(srcRGBA[0]), srcWidth, srcHeight, &(dstRGBA[0]), width, height, param)) return dstImage;
+		std::vector<unsigned char>().swap(srcRGBA);
+
+		// 色反転は、行ごとに並列に処理.
+		if (flipColor) {
+			CThreadPool::getInstance().parallelFor(height, [&](const int y) {
+				ImageKernels::invertColor(&(dstRGBA[(size_t)y * (size_t)width * 4]), width);
+			});
 		}
-	}
 
-	if (rotate90) {
-		try {
-			compointer<sxsdk::image_interface> image2 = Shade3DUtil::resizeImageWithAlpha(m_pScene, dstImage, sx::vec<int,2>(height, width));
-
-			for (int y = 0; y < height; ++y) {
-				image2->get_pixels_rgba(y, 0, 1, width, &(lineCols2[0]));
-				for (int x = 0; x < width; ++x) {
-					lineCols[x] = lineCols2[width - x - 1];
+		dstImage = m_pScene->create_image_interface(dstSize);
+		Shade3DUtil::setImageRGBA8(dstImage, &(dstRGBA[0]), width, height);
+		dstImage->update();
 
-				}
-				dstImage->set_pixels_rgba(0, y, width, 1, &(lineCols[0]));
-			}
-		} catch (...) { }
-	}
+	} catch (...) { }
 
 	return dstImage;
  }
@@ -859,7 +875,6 @@ bool CImagesBlend::m_blendImages (const sxsdk::enums::mapping_type mappingType,
 	sxsdk::master_image_class* pNewMasterImage = NULL;
 	std::string newTexName;
 	int counter = 0;
-	std::vector<sxsdk::rgba_class> rgbaLine0, rgbaLine, rgbaWeightLine;
 	sxsdk::rgba_class col, whiteCol;
 	whiteCol = sxsdk::rgba_class(1, 1, 1, 1);
 	bool singleSimpleMapping = true;				// 1枚のテクスチャのみの参照で、色反転や左右反転/上下反転などがない場合は.
@@ -886,9 +901,6 @@ bool CImagesBlend::m_blendImages (const sxsdk::enums::mapping_type mappingType,
 	const sx::vec<int,2> dstTexSize = m_getMaxMappingImageSize(mappingType);
 	if (dstTexSize.x == 0 || dstTexSize.y == 0) return false;
 
-	// 「マット」を持つか.
-	const bool hasWeightTex = m_hasWeightTexture(mappingType);
-
 	int uvIndex = 0;
 	int occlusionChannelMix = 0;
 	for (int i = 0; i < layersCou; ++i) {
@@ -1005,17 +1017,10 @@ bool CImagesBlend::m_blendImages (const sxsdk::enums::mapping_type mappingType,
 				if (type == sxsdk::enums::diffuse_mapping) {
 					compointer<sxsdk::image_interface> image2(image->duplicate_image());
 
-					std::vector<sxsdk::rgba_class> colA;
-					float fA;
-					colA.resize(width);
-					for (int y = 0; y < height; ++y) {
-						image2->get_pixels_rgba_float(0, y, width, 1, &(colA[0]));
-						for (int x = 0; x < width; ++x) {
-							fA = colA[x].alpha;
-							colA[x] = sxsdk::rgba_class(fA, fA, fA, 1.0f);
-						}
-						image2->set_pixels_rgba_float(0, y, width, 1, &(colA[0]));
-					}
+					std::vector<sxsdk::image_interface*> bandImages(1, (sxsdk::image_interface*)image2);
+					processImageRowsParallel<sx::rgba8_class>(width, height, bandImages, image2, [&](const int y, sx::rgba8_class* const* rows) {
+						ImageKernels::convertToGrayscale(reinterpret_cast<unsigned char*>(rows[0]), width, ImageKernels::channel_alpha);
+					});
 					image = image2;
 				}
 			}
@@ -1043,9 +1048,6 @@ bool CImagesBlend::m_blendImages (const sxsdk::enums::mapping_type mappingType,
 				newRepeatX  = repeatU;
 				newRepeatY  = repeatV;
 				newTexCoord = uvIndex;
-				rgbaLine.resize(newWidth);
-				rgbaLine0.resize(newWidth);
-				if (hasWeightTex) rgbaWeightLine.resize(newWidth);
 
 				// マスターイメージを持つか調べる.
 				pNewMasterImage = Shade3DUtil::getMasterImageFromImage(m_pScene, image);
@@ -1074,155 +1076,95 @@ bool CImagesBlend::m_blendImages (const sxsdk::enums::mapping_type mappingType,
 				if (type == sxsdk::enums::bump_mapping) image2->convert_bump_to_normalmap(1.0f);
 			}
 
-			for (int y = 0; y < newHeight; ++y) {
-				image2->get_pixels_rgba_float(0, y, newWidth, 1, &(rgbaLine[0]));
-
-				if (weightWidth > 0) {
-					weightImage2->get_pixels_rgba_float(0, y, newWidth, 1, &(rgbaWeightLine[0]));
-				}
-
-				// チャンネルの合成モード により、色を埋める.
-				if (useChannelMix) {
-					float fVal;
-					if (channelMix == sxsdk::enums::mapping_grayscale_alpha_mode) {
-						for (int x = 0; x < newWidth; ++x) {
-							fVal = rgbaLine[x].alpha;
-							rgbaLine[x] = sxsdk::rgba_class(fVal, fVal, fVal, 1.0f);
-						}
-					} else if (channelMix == sxsdk::enums::mapping_grayscale_red_mode) {
-						for (int x = 0; x < newWidth; ++x) {
-							fVal = rgbaLine[x].red;
-							rgbaLine[x] = sxsdk::rgba_class(fVal, fVal, fVal, 1.0f);
-						}
-					} else if (channelMix == sxsdk::enums::mapping_grayscale_green_mode) {
-						for (int x = 0; x < newWidth; ++x) {
-							fVal = rgbaLine[x].green;
-							rgbaLine[x] = sxsdk::rgba_class(fVal, fVal, fVal, 1.0f);
-						}
-					} else if (channelMix == sxsdk::enums::mapping_grayscale_blue_mode) {
-						for (int x = 0; x < newWidth; ++x) {
-							fVal = rgbaLine[x].blue;
-							rgbaLine[x] = sxsdk::rgba_class(fVal, fVal, fVal, 1.0f);
-						}
-					} else if (channelMix == sxsdk::enums::mapping_grayscale_average_mode) {
-						for (int x = 0; x < newWidth; ++x) {
-							fVal = (rgbaLine[x].red + rgbaLine[x].green + rgbaLine[x].blue) * 0.3333f;
-							rgbaLine[x] = sxsdk::rgba_class(fVal, fVal, fVal, 1.0f);
-						}
-					}
-				}
-
-				// 「アルファ透明」でない場合.
-				if (mappingType == sxsdk::enums::diffuse_mapping) {
-					if (channelMix != sxsdk::enums::mapping_transparent_alpha_mode) {
-						for (int x = 0; x < newWidth; ++x) rgbaLine[x].alpha = 1.0f;
+			// チャンネルの合成モード.
+			ImageKernels::CHANNEL_TYPE grayscaleChannel = ImageKernels::channel_red;
+			if (channelMix == sxsdk::enums::mapping_grayscale_alpha_mode) grayscaleChannel = ImageKernels::channel_alpha;
+			else if (channelMix == sxsdk::enums::mapping_grayscale_green_mode) grayscaleChannel = ImageKernels::channel_green;
+			else if (channelMix == sxsdk::enums::mapping_grayscale_blue_mode) grayscaleChannel = ImageKernels::channel_blue;
+			else if (channelMix == sxsdk::enums::mapping_grayscale_average_mode) grayscaleChannel = ImageKernels::channel_average;
+
+			// 合成のパラメータ.
+			ImageKernels::CBlendParam blendParam;
+			blendParam.weight       = alphaTrans ? 1.0f : weight;
+			if (counter == 0) {
+				blendParam.blendType = (blendMode == 7 && mappingType != sxsdk::enums::normal_mapping) ? ImageKernels::blend_multiply : ImageKernels::blend_normal;
+				blendParam.basePixels = NULL;
+				blendParam.baseColor[0] = blendParam.fillColor[0] = baseCol.red;
+				blendParam.baseColor[1] = blendParam.fillColor[1] = baseCol.green;
+				blendParam.baseColor[2] = blendParam.fillColor[2] = baseCol.blue;
+				blendParam.baseColor[3] = blendParam.fillColor[3] = baseCol.alpha;
+			} else {
+				if (blendMode == sxsdk::enums::mapping_blend_mode) blendParam.blendType = ImageKernels::blend_normal;				// 「通常」合成.
+				else if (blendMode == sxsdk::enums::mapping_mul_mode) blendParam.blendType = ImageKernels::blend_multiply_legacy;	// 「乗算 (レガシー)」合成.
+				else if (blendMode == 7) blendParam.blendType = ImageKernels::blend_multiply;										// 「乗算」合成.
+				else if (blendMode == sxsdk::enums::mapping_add_mode) blendParam.blendType = ImageKernels::blend_add;				// 「加算」合成.
+				else if (blendMode == sxsdk::enums::mapping_sub_mode) blendParam.blendType = ImageKernels::blend_sub;				// 「減算」合成.
+				else if (blendMode == sxsdk::enums::mapping_min_mode) blendParam.blendType = ImageKernels::blend_min;				// 「比較(暗)」合成.
+				else if (blendMode == sxsdk::enums::mapping_max_mode) blendParam.blendType = ImageKernels::blend_max;				// 「比較(明)」合成.
+				else blendParam.blendType = ImageKernels::blend_none;
+				blendParam.fillColor[0] = whiteCol.red;
+				blendParam.fillColor[1] = whiteCol.green;
+				blendParam.fillColor[2] = whiteCol.blue;
+				blendParam.fillColor[3] = whiteCol.alpha;
+			}
+
+			// 行のまとまりごとに、[0]重ねるイメージ、[1]合成先のイメージ、[2]「マット」のイメージを読み込んで合成.
+			std::vector<sxsdk::image_interface*> bandImages;
+			bandImages.push_back(image2);
+			bandImages.push_back((counter > 0) ? newImage : NULL);
+			bandImages.push_back((weightWidth > 0) ? (sxsdk::image_interface*)weightImage2 : NULL);
+			const bool useWeightPixels = (!alphaTrans && weightWidth > 0);
+
+			// 法線マップはベクトルとして合成するためfloatで処理し、それ以外は8bitの固定小数点で処理する.
+			// glTFのテクスチャは8bitで出力されるため、8bitで処理しても結果の誤差は1以内となる.
+			if (mappingType != sxsdk::enums::normal_mapping) {
+				const ImageKernels::CBlendParam8 blendParam8(blendParam);
+				processImageRowsParallel<sx::rgba8_class>(newWidth, newHeight, bandImages, newImage, [&](const int y, sx::rgba8_class* const* rows) {
+					unsigned char* pixels = reinterpret_cast<unsigned char*>(rows[0]);
+
+					// チャンネルの合成モード により、色を埋める.
+					if (useChannelMix) {
+						ImageKernels::convertToGrayscale(pixels, newWidth, grayscaleChannel);
 					}
-				}
 
-				// Roughnessの場合、Shade3Dはテクスチャの濃淡は逆転している.
-				// 「テクスチャを加工せずにベイク」の場合はそのまま採用するため、この処理は行わない.
-				if (!m_exportParam.bakeWithoutProcessingTextures) {
-					if (mappingType == sxsdk::enums::roughness_mapping) {
-						for (int x = 0; x < newWidth; ++x) {
-							rgbaLine[x].red   = 1.0f - rgbaLine[x].red;
-							rgbaLine[x].green = 1.0f - rgbaLine[x].green;
-							rgbaLine[x].blue  = 1.0f - rgbaLine[x].blue;
+					// 「アルファ透明」でない場合.
+					if (mappingType == sxsdk::enums::diffuse_mapping) {
+						if (channelMix != sxsdk::enums::mapping_transparent_alpha_mode) {
+							ImageKernels::fillAlpha(pixels, newWidth, (unsigned char)255);
 						}
 					}
-				}
-
-				if (counter == 0) {
-					float aV;
-					if (blendMode == 7 && mappingType != sxsdk::enums::normal_mapping) {				// 「乗算」合成.
-						for (int x = 0; x < newWidth; ++x) {
-							const float w  = alphaTrans ? 1.0f : ((weightWidth > 0) ? rgbaWeightLine[x].red * weight : weight);
-							const float w2 = 1.0f - w;
-							rgbaLine[x] = (baseCol * w2 + rgbaLine[x] * w) * baseCol;
-						}
 
-					} else {										// 「通常」合成.
-						for (int x = 0; x < newWidth; ++x) {
-							const float w  = alphaTrans ? 1.0f : ((weightWidth > 0) ? rgbaWeightLine[x].red * weight : weight);
-							const float w2 = 1.0f - w;
-							rgbaLine[x] = rgbaLine[x] * w + baseCol * w2;
+					// Roughnessの場合、Shade3Dはテクスチャの濃淡は逆転している.
+					// 「テクスチャを加工せずにベイク」の場合はそのまま採用するため、この処理は行わない.
+					if (!m_exportParam.bakeWithoutProcessingTextures) {
+						if (mappingType == sxsdk::enums::roughness_mapping) {
+							ImageKernels::invertColor(pixels, newWidth);
 						}
 					}
 
-				} else {
-					newImage->get_pixels_rgba_float(0, y, newWidth, 1, &(rgbaLine0[0]));
-
-					if (mappingType == sxsdk::enums::normal_mapping) {
-						sxsdk::vec3 n, n2;
-						sxsdk::rgb_class col;
-						for (int x = 0; x < newWidth; ++x) {
-							const float w  = alphaTrans ? 1.0f : ((weightWidth > 0) ? rgbaWeightLine[x].red * weight : weight);
-							const float w2 = 1.0f - w;
-							n  = MathUtil::convRGBToNormal(sxsdk::rgb_class(rgbaLine[x].red, rgbaLine[x].green, rgbaLine[x].blue));
-							n2 = MathUtil::convRGBToNormal(sxsdk::rgb_class(rgbaLine0[x].red, rgbaLine0[x].green, rgbaLine0[x].blue));
-
-							n = n * w + n2 * w2;
-							col = MathUtil::convNormalToRGB(n);
-							rgbaLine[x] = sxsdk::rgba_class(col.red, col.green, col.blue, 1.0f);
-						}
-
-					} else {
-						if (blendMode == sxsdk::enums::mapping_blend_mode) {		// 「通常」合成.
-							for (int x = 0; x < newWidth; ++x) {
-								const float w  = alphaTrans ? 1.0f : ((weightWidth > 0) ? rgbaWeightLine[x].red * weight : weight);
-								const float w2 = 1.0f - w;
-								rgbaLine[x] = rgbaLine[x] * w + rgbaLine0[x] * w2;
-							}
+					ImageKernels::CBlendParam8 rowBlendParam = blendParam8;
+					rowBlendParam.weightPixels = useWeightPixels ? reinterpret_cast<const unsigned char*>(rows[2]) : NULL;
+					if (counter > 0) rowBlendParam.basePixels = reinterpret_cast<const unsigned char*>(rows[1]);
+					ImageKernels::blendPixels(pixels, newWidth, rowBlendParam);
+				});
 
-						} else if (blendMode == sxsdk::enums::mapping_mul_mode) {	// 「乗算 (レガシー)」合成.
-							for (int x = 0; x < newWidth; ++x) {
-								const float w  = alphaTrans ? 1.0f : ((weightWidth > 0) ? rgbaWeightLine[x].red * weight : weight);
-								const float w2 = 1.0f - w;
-								rgbaLine[x] = rgbaLine[x] * rgbaLine0[x] * w;
-							}
-						} else if (blendMode == 7) {							// 「乗算」合成.
-							for (int x = 0; x < newWidth; ++x) {
-								const float w  = alphaTrans ? 1.0f : ((weightWidth > 0) ? rgbaWeightLine[x].red * weight : weight);
-								const float w2 = 1.0f - w;
+			} else {
+				processImageRowsParallel<sxsdk::rgba_class>(newWidth, newHeight, bandImages, newImage, [&](const int y, sxsdk::rgba_class* const* rows) {
+					float* pixels = reinterpret_cast<float*>(rows[0]);
 
-								rgbaLine[x] = (whiteCol * w2 + rgbaLine[x] * w) * rgbaLine0[x];
-							}
+					// チャンネルの合成モード により、色を埋める.
+					if (useChannelMix) {
+						ImageKernels::convertToGrayscale(pixels, newWidth, grayscaleChannel);
+					}
 
-						} else if (blendMode == sxsdk::enums::mapping_add_mode) {		// 「加算」合成.
-							for (int x = 0; x < newWidth; ++x) {
-								const float w  = alphaTrans ? 1.0f : ((weightWidth > 0) ? rgbaWeightLine[x].red * weight : weight);
-								rgbaLine[x] = rgbaLine0[x] + (rgbaLine[x] * w);
-								rgbaLine[x].red   = std::min(std::max(0.0f, rgbaLine[x].red), 1.0f);
-								rgbaLine[x].green = std::min(std::max(0.0f, rgbaLine[x].green), 1.0f);
-								rgbaLine[x].blue  = std::min(std::max(0.0f, rgbaLine[x].blue), 1.0f);
-								rgbaLine[x].alpha = std::min(std::max(0.0f, rgbaLine[x].alpha), 1.0f);
-							}
-						} else if (blendMode == sxsdk::enums::mapping_sub_mode) {		// 「減算」合成.
-							for (int x = 0; x < newWidth; ++x) {
-								const float w  = alphaTrans ? 1.0f : ((weightWidth > 0) ? rgbaWeightLine[x].red * weight : weight);
-								rgbaLine[x] = rgbaLine0[x] - (rgbaLine[x] * w);
-								rgbaLine[x].red   = std::min(std::max(0.0f, rgbaLine[x].red), 1.0f);
-								rgbaLine[x].green = std::min(std::max(0.0f, rgbaLine[x].green), 1.0f);
-								rgbaLine[x].blue  = std::min(std::max(0.0f, rgbaLine[x].blue), 1.0f);
-								rgbaLine[x].alpha = std::min(std::max(0.0f, rgbaLine[x].alpha), 1.0f);
-							}
-						} else if (blendMode == sxsdk::enums::mapping_min_mode) {		// 「比較(暗)」合成.
-							for (int x = 0; x < newWidth; ++x) {
-								const float w  = alphaTrans ? 1.0f : ((weightWidth > 0) ? rgbaWeightLine[x].red * weight : weight);
-								rgbaLine[x].red   = std::min(rgbaLine0[x].red,   rgbaLine[x].red   * w);
-								rgbaLine[x].green = std::min(rgbaLine0[x].green, rgbaLine[x].green * w);
-								rgbaLine[x].blue  = std::min(rgbaLine0[x].blue,  rgbaLine[x].blue  * w);
-							}
-						} else if (blendMode == sxsdk::enums::mapping_max_mode) {		// 「比較(明)」合成.
-							for (int x = 0; x < newWidth; ++x) {
-								const float w  = alphaTrans ? 1.0f : ((weightWidth > 0) ? rgbaWeightLine[x].red * weight : weight);
-								rgbaLine[x].red   = std::max(rgbaLine0[x].red,   rgbaLine[x].red   * w);
-								rgbaLine[x].green = std::max(rgbaLine0[x].green, rgbaLine[x].green * w);
-								rgbaLine[x].blue  = std::max(rgbaLine0[x].blue,  rgbaLine[x].blue  * w);
-							}
-						}
+					ImageKernels::CBlendParam rowBlendParam = blendParam;
+					rowBlendParam.weightPixels = useWeightPixels ? reinterpret_cast<const float*>(rows[2]) : NULL;
+					if (counter == 0) {
+						ImageKernels::blendPixels(pixels, newWidth, rowBlendParam);
+					} else {
+						ImageKernels::blendNormalPixels(pixels, reinterpret_cast<const float*>(rows[1]), rowBlendParam.weightPixels, rowBlendParam.weight, newWidth);
 					}
-				}
-				newImage->set_pixels_rgba_float(0, y, newWidth, 1, &(rgbaLine[0]));
+				});
 			}
 			counter++;
 
@@ -1288,6 +1230,191 @@ bool CImagesBlend::m_blendImages (const sxsdk::enums::mapping_type mappingType,
 	return false;
 }
 
+/**
+ * 指定のテクスチャを合成する際に、タイル単位でベイクできるかチェック.
+ * @param[in] mappingType  マッピングの種類.
+ */
+bool CImagesBlend::m_canStreamBake (const sxsdk::enums::mapping_type mappingType) const
+{
+	if (!m_exportParam.bakeStreaming) return false;
+
+	// エンジン別のテクスチャ出力では、ベイクしたイメージを参照するため.
+	if (m_exportParam.outputAdditionalTextures) return false;
+
+	if (mappingType == sxsdk::enums::glow_mapping) return true;
+	if (mappingType != sxsdk::enums::diffuse_mapping) return false;
+
+	// 不透明度をAlphaに格納する場合や、Reflectionにより色を調整する場合は、ベイク後にDiffuseを加工するため.
+	if (m_hasReflectionImage || m_hasTransparencyImage || m_hasOpacityMaskImage) return false;
+	if (m_alphaModeType != GLTFConverter::alpha_mode_opaque) return false;
+	if (m_surface->get_transparency() > 0.0f) return false;
+	if (!m_exportParam.bakeWithoutProcessingTextures && m_surface->get_reflection() > 0.3f) return false;
+
+	return true;
+}
+
+/**
+ * 指定のテクスチャを、タイル単位で合成してpng/jpegにエンコード.
+ * マッピングレイヤの扱いはm_blendImagesと同じ.
+ * @param[in]  mappingType   マッピングの種類.
+ * @param[in]  repeatTex     繰り返し回数.
+ * @param[out] encodedImage  エンコードしたイメージ.
+ */
+bool CImagesBlend::m_streamBakeImages (const sxsdk::enums::mapping_type mappingType, const sx::vec<int,2>& repeatTex, CImageData& encodedImage)
+{
+	encodedImage.clear();
+
+	const sxsdk::rgba_class whiteCol(1, 1, 1, 1);
+	sxsdk::rgba_class baseCol(1, 1, 1, 1);
+	if (mappingType == sxsdk::enums::glow_mapping) {
+		baseCol = sxsdk::rgba_class(m_surface->get_glow_color());
+	}
+
+	// 合成するテクスチャサイズ。出力時に縮小しないように、最大テクスチャサイズに収めてベイクする.
+	const sx::vec<int,2> dstTexSize = m_getMaxMappingImageSize(mappingType);
+	if (dstTexSize.x == 0 || dstTexSize.y == 0) return false;
+	const sx::vec<int,2> newSize = fitTextureSize(dstTexSize.x, dstTexSize.y, m_exportParam.getMaxTextureSize());
+
+	// 参照するイメージは、ベイクが終わるまで保持する.
+	std::vector< std::unique_ptr<CShadeImageTileSource> > sources;
+	std::vector<TileBaker::CTileBakeLayer> layers;
+	int newTexCoord = -1;
+
+	const int layersCou = m_surface->get_number_of_mapping_layers();
+	for (int i = 0; i < layersCou; ++i) {
+		sxsdk::mapping_layer_class& mappingLayer = m_surface->mapping_layer(i);
+		if (mappingLayer.get_pattern() != sxsdk::enums::image_pattern) continue;
+		if (mappingLayer.get_projection() != 3) continue;		// UV投影でない場合.
+		if (mappingLayer.get_type() != mappingType) continue;
+
+		const float weight = std::min(std::max(mappingLayer.get_weight(), 0.0f), 1.0f);
+		if (MathUtil::isZero(weight)) continue;
+
+		const int uvIndex = mappingLayer.get_uv_mapping();
+		if (newTexCoord >= 0 && uvIndex != newTexCoord) continue;
+
+		try {
+			compointer<sxsdk::image_interface> image(mappingLayer.get_image_interface());
+			if (!image || !(image->has_image())) continue;
+			if ((image->get_size().x) <= 1 || (image->get_size().y) <= 1) continue;
+			if (newTexCoord < 0) newTexCoord = uvIndex;
+
+			TileBaker::CTileBakeLayer layer;
+			sources.push_back(std::unique_ptr<CShadeImageTileSource>(new CShadeImageTileSource(image)));
+			layer.image.source    = sources.back().get();
+			layer.image.flipColor = mappingLayer.get_flip_color();
+			layer.image.flipH     = mappingLayer.get_horizontal_flip();
+			layer.image.flipV     = mappingLayer.get_vertical_flip();
+			layer.image.rotate90  = mappingLayer.get_swap_axes();
+			if (repeatTex[0] == 1 && repeatTex[1] == 1) {
+				layer.image.repeatU = mappingLayer.get_repetition_X();
+				layer.image.repeatV = mappingLayer.get_repetition_Y();
+			}
+
+			// 1つ前が「マット」の場合.
+			if (i > 0) {
+				sxsdk::mapping_layer_class& prevMappingLayer = m_surface->mapping_layer(i - 1);
+				if (prevMappingLayer.get_pattern() == sxsdk::enums::image_pattern && prevMappingLayer.get_type() == sxsdk::enums::weight_mapping) {
+					if (newTexCoord == prevMappingLayer.get_uv_mapping()) {
+						compointer<sxsdk::image_interface> weightImage(prevMappingLayer.get_image_interface());
+						if (weightImage && (weightImage->has_image()) && (weightImage->get_size().x) > 1 && (weightImage->get_size().y) > 1) {
+							sources.push_back(std::unique_ptr<CShadeImageTileSource>(new CShadeImageTileSource(weightImage)));
+							layer.weightImage.source    = sources.back().get();
+							layer.weightImage.flipColor = prevMappingLayer.get_flip_color();
+							layer.weightImage.flipH     = prevMappingLayer.get_horizontal_flip();
+							layer.weightImage.flipV     = prevMappingLayer.get_vertical_flip();
+							layer.weightImage.rotate90  = prevMappingLayer.get_swap_axes();
+							if (repeatTex[0] == 1 && repeatTex[1] == 1) {
+								layer.weightImage.repeatU = prevMappingLayer.get_repetition_X();
+								layer.weightImage.repeatV = prevMappingLayer.get_repetition_Y();
+							}
+						}
+					}
+				}
+			}
+
+			// チャンネルの合成モード.
+			const int channelMix = mappingLayer.get_channel_mix();
+			layer.useGrayscale = (channelMix == sxsdk::enums::mapping_grayscale_alpha_mode ||
+								  channelMix == sxsdk::enums::mapping_grayscale_red_mode ||
+								  channelMix == sxsdk::enums::mapping_grayscale_green_mode ||
+								  channelMix == sxsdk::enums::mapping_grayscale_blue_mode ||
+								  channelMix == sxsdk::enums::mapping_grayscale_average_mode);
+			if (channelMix == sxsdk::enums::mapping_grayscale_alpha_mode) layer.grayscaleChannel = ImageKernels::channel_alpha;
+			else if (channelMix == sxsdk::enums::mapping_grayscale_green_mode) layer.grayscaleChannel = ImageKernels::channel_green;
+			else if (channelMix == sxsdk::enums::mapping_grayscale_blue_mode) layer.grayscaleChannel = ImageKernels::channel_blue;
+			else if (channelMix == sxsdk::enums::mapping_grayscale_average_mode) layer.grayscaleChannel = ImageKernels::channel_average;
+
+			// 「アルファ透明」でない場合.
+			if (mappingType == sxsdk::enums::diffuse_mapping) {
+				layer.fillAlpha = (channelMix != sxsdk::enums::mapping_transparent_alpha_mode);
+			}
+
+			// 合成のパラメータ.
+			const int blendMode = mappingLayer.get_blend_mode();
+			ImageKernels::CBlendParam& blendParam = layer.blendParam;
+			blendParam.weight = weight;
+			if (layers.empty()) {
+				blendParam.blendType = (blendMode == 7) ? ImageKernels::blend_multiply : ImageKernels::blend_normal;
+				blendParam.baseColor[0] = blendParam.fillColor[0] = baseCol.red;
+				blendParam.baseColor[1] = blendParam.fillColor[1] = baseCol.green;
+				blendParam.baseColor[2] = blendParam.fillColor[2] = baseCol.blue;
+				blendParam.baseColor[3] = blendParam.fillColor[3] = baseCol.alpha;
+			} else {
+				if (blendMode == sxsdk::enums::mapping_blend_mode) blendParam.blendType = ImageKernels::blend_normal;				// 「通常」合成.
+				else if (blendMode == sxsdk::enums::mapping_mul_mode) blendParam.blendType = ImageKernels::blend_multiply_legacy;	// 「乗算 (レガシー)」合成.
+				else if (blendMode == 7) blendParam.blendType = ImageKernels::blend_multiply;										// 「乗算」合成.
+				else if (blendMode == sxsdk::enums::mapping_add_mode) blendParam.blendType = ImageKernels::blend_add;				// 「加算」合成.
+				else if (blendMode == sxsdk::enums::mapping_sub_mode) blendParam.blendType = ImageKernels::blend_sub;				// 「減算」合成.
+				else if (blendMode == sxsdk::enums::mapping_min_mode) blendParam.blendType = ImageKernels::blend_min;				// 「比較(暗)」合成.
+				else if (blendMode == sxsdk::enums::mapping_max_mode) blendParam.blendType = ImageKernels::blend_max;				// 「比較(明)」合成.
+				else blendParam.blendType = ImageKernels::blend_none;
+				blendParam.fillColor[0] = whiteCol.red;
+				blendParam.fillColor[1] = whiteCol.green;
+				blendParam.fillColor[2] = whiteCol.blue;
+				blendParam.fillColor[3] = whiteCol.alpha;
+			}
+			layers.push_back(layer);
+
+		} catch (...) { }
+	}
+	if (layers.empty()) return false;
+
+	// 完成した行から順にエンコードする (Alphaは出力しない).
+	const bool useJpeg = (m_exportParam.outputTexture == GLTFConverter::export_texture_jpeg);
+	const size_t memoryBudget = (size_t)std::max(m_exportParam.bakeMemoryBudget, 16) * 1024 * 1024;
+	ImageEncoder::CStreamEncoder encoder;
+	bool ret = false;
+	if (useJpeg) {
+		ret = encoder.beginJPEG(newSize.x, newSize.y, std::min(std::max(m_exportParam.jpegQuality, 1), 100), encodedImage.imageDatas);
+	} else {
+		ret = encoder.beginPNG(newSize.x, newSize.y, false, std::min(std::max(m_exportParam.pngCompressionLevel, 0), 9), encodedImage.imageDatas);
+	}
+	if (ret) {
+		ret = TileBaker::bake(newSize.x, newSize.y, layers, memoryBudget, [&](const int y, const int rowsCou, const unsigned char* rgbaData) {
+			return encoder.writeRows(rgbaData, rowsCou);
+		});
+	}
+	if (ret) ret = encoder.finish();
+	if (!ret) {
+		encodedImage.clear();
+		return false;
+	}
+	encodedImage.width    = newSize.x;
+	encodedImage.height   = newSize.y;
+	encodedImage.mimeType = useJpeg ? "image/jpeg" : "image/png";
+
+	if (mappingType == sxsdk::enums::diffuse_mapping) {
+		m_diffuseRepeat   = repeatTex;
+		m_diffuseTexCoord = newTexCoord;
+	}
+	if (mappingType == sxsdk::enums::glow_mapping) {
+		m_glowRepeat   = repeatTex;
+		m_glowTexCoord = newTexCoord;
+	}
+	return true;
+}
+
 /**
  * 「不透明」と「透明」のテクスチャを分離もしくは合成して再格納.
  * @return 不透明度のテクスチャを格納.
@@ -1405,20 +1532,17 @@ void CImagesBlend::m_convTransparencyData ()
 	if (!m_diffuseImage) {
 		m_diffuseImage = m_pScene->create_image_interface(sx::vec<int,2>(transWid, transHei));
 
-		std::vector<sxsdk::rgba_class> lineCols;
-		lineCols.resize(transWid);
-		float vR;
-		for (int y = 0; y < transHei; ++y) {
-			m_transparencyImage->get_pixels_rgba_float(0, y, transWid, 1, &(lineCols[0]));
+		std::vector<sxsdk::image_interface*> bandImages(1, m_transparencyImage);
+		processImageRowsParallel<sxsdk::rgba_class>(transWid, transHei, bandImages, m_diffuseImage, [&](const int y, sxsdk::rgba_class* const* rows) {
+			sxsdk::rgba_class* lineCols = rows[0];
 			for (int x = 0; x < transWid; ++x) {
-				vR = lineCols[x].red * m_transparency;
+				const float vR = lineCols[x].red * m_transparency;
 				lineCols[x].red   = transCol.red   * vR + m_diffuseColor.red   * (1.0f - vR);
 				lineCols[x].green = transCol.green * vR + m_diffuseColor.green * (1.0f - vR);
 				lineCols[x].blue  = transCol.blue  * vR + m_diffuseColor.blue  * (1.0f - vR);
 				lineCols[x].alpha = 1.0f;
 			}
-			m_diffuseImage->set_pixels_rgba_float(0, y, transWid, 1, &(lineCols[0]));
-		}
+		});
 		m_diffuseRepeat   = m_transparencyRepeat;
 		m_diffuseTexCoord = m_transparencyTexCoord;
 
@@ -1441,24 +1565,22 @@ void CImagesBlend::m_convTransparencyData ()
 		if (m_diffuseRepeat == m_transparencyRepeat) {
 			compointer<sxsdk::image_interface> tImg = Shade3DUtil::resizeImageWithAlpha(m_pScene, m_transparencyImage, sx::vec<int,2>(diffuseWid, diffuseHei));
 
-			std::vector<sxsdk::rgba_class> lineCols, lineCols2;
-			lineCols.resize(diffuseWid);
-			lineCols2.resize(diffuseWid);
-			float vR;
-			sxsdk::rgba_class col;
-			for (int y = 0; y < diffuseHei; ++y) {
-				tImg->get_pixels_rgba_float(0, y, diffuseWid, 1, &(lineCols[0]));
-				m_diffuseImage->get_pixels_rgba_float(0, y, diffuseWid, 1, &(lineCols2[0]));
+			std::vector<sxsdk::image_interface*> bandImages;
+			bandImages.push_back(tImg);
+			bandImages.push_back(m_diffuseImage);
+			const sxsdk::rgba_class diffuseCol(m_diffuseColor, 1.0f);
+			processImageRowsParallel<sxsdk::rgba_class>(diffuseWid, diffuseHei, bandImages, m_diffuseImage, [&](const int y, sxsdk::rgba_class* const* rows) {
+				sxsdk::rgba_class* lineCols        = rows[0];
+				const sxsdk::rgba_class* lineCols2 = rows[1];
 				for (int x = 0; x < diffuseWid; ++x) {
-					vR  = lineCols[x].red * m_transparency;
-					col = lineCols2[x] * sxsdk::rgba_class(m_diffuseColor, 1.0f);
+					const float vR = lineCols[x].red * m_transparency;
+					const sxsdk::rgba_class col = lineCols2[x] * diffuseCol;
 					lineCols[x].red   = transCol.red   * vR + col.red   * (1.0f - vR);
 					lineCols[x].green = transCol.green * vR + col.green * (1.0f - vR);
 					lineCols[x].blue  = transCol.blue  * vR + col.blue  * (1.0f - vR);
 					lineCols[x].alpha = col.alpha;
 				}
-				m_diffuseImage->set_pixels_rgba_float(0, y, diffuseWid, 1, &(lineCols[0]));
-			}
+			});
 
 			m_diffuseColor = sxsdk::rgb_class(1, 1, 1);
 			m_diffuseTexturesCount = 1;
@@ -1481,7 +1603,8 @@ void CImagesBlend::m_convShade3DToPBRMaterial ()
 	// なお、ここでの「色」はテクスチャに乗算するものなので、リニア変換は行わない.
 	// 「拡散反射色」「発光色」については、テクスチャ作成時にすでに考慮しているのでここでは入れない.
 	const float diffuseV = std::min(1.0f, std::max(0.0f, m_surface->get_diffuse()));
-	const sxsdk::rgb_class col0 = (m_diffuseImage && m_diffuseTexturesCount >= 2) ? sxsdk::rgb_class(1, 1, 1) : (m_surface->get_diffuse_color());
+	const bool hasDiffuseImage = (m_diffuseImage || !m_diffuseEncodedImage.imageDatas.empty());
+	const sxsdk::rgb_class col0 = (hasDiffuseImage && m_diffuseTexturesCount >= 2) ? sxsdk::rgb_class(1, 1, 1) : (m_surface->get_diffuse_color());
 	sxsdk::rgb_class col = col0 * diffuseV;
 	sxsdk::rgb_class reflectionCol = m_surface->get_reflection_color();
 	const float reflectionV  = std::max(std::min(1.0f, m_surface->get_reflection()), 0.0f);
@@ -1496,7 +1619,7 @@ void CImagesBlend::m_convShade3DToPBRMaterial ()
 	m_transparency = m_surface->get_transparency();
 
 	const float emissiveV = std::min(1.0f, std::max(0.0f, m_surface->get_glow()));
-	const sxsdk::rgb_class emCol0 = m_glowImage ? sxsdk::rgb_class(1, 1, 1) : (m_surface->get_glow_color());
+	const sxsdk::rgb_class emCol0 = (m_glowImage || !m_glowEncodedImage.imageDatas.empty()) ? sxsdk::rgb_class(1, 1, 1) : (m_surface->get_glow_color());
 	sxsdk::rgb_class emCol = emCol0 * emissiveV;
 	m_emissiveColor = emCol;
 
@@ -1902,7 +2025,7 @@ void CImagesBlend::m_convShade3DToPBRMaterial ()
 void CImagesBlend::m_noBakeShade3DToPBRMaterial ()
 {
 	m_diffuseColor = (m_surface->get_diffuse_color()) * (m_surface->get_diffuse());
-	if (m_diffuseImage && m_diffuseTexturesCount >= 2) {
+	if ((m_diffuseImage || !m_diffuseEncodedImage.imageDatas.empty()) && m_diffuseTexturesCount >= 2) {
 		m_diffuseColor = sxsdk::rgb_class(1, 1, 1);
 	}
 
@@ -1911,7 +2034,7 @@ void CImagesBlend::m_noBakeShade3DToPBRMaterial ()
 	m_transparency = m_surface->get_transparency();
 
 	m_emissiveColor = (m_surface->get_glow_color()) * (m_surface->get_glow());
-	if (m_glowImage) m_emissiveColor = sxsdk::rgb_class(1, 1, 1);
+	if (m_glowImage || !m_glowEncodedImage.imageDatas.empty()) m_emissiveColor = sxsdk::rgb_class(1, 1, 1);
 
 	// 「不透明」と「透明」のテクスチャを分離もしくは合成して再格納.
 	sxsdk::image_interface* dstOpacityImage = m_storeOpasicyTransparencyTexture();
@@ -1998,6 +2121,8 @@ void CImagesBlend::m_noBakeShade3DToPBRMaterial ()
 
 /**
  * glTFのMetallic-Roughnessのパック処理  (Occlusion(R)/Roughness(G)/Metallic(B)).
+ * TileBaker::packで、各イメージをバンドごとに読み込み (サイズが異なる場合はリサイズ) パックする.
+ * 作業用のメモリはbakeMemoryBudgetに収まる.
  * Occlusionは分離できる.
  * TexCoordがMetallic-RoughnessとOcclusionで異なる場合、.
  * テクスチャサイズがMetallic-RoughnessとOcclusionで異なる場合、は、Occlusionテクスチャは独立して使用する.
@@ -2029,96 +2154,211 @@ void CImagesBlend::m_packOcclusionRoughnessMetallicImage ()
 	}
 	if (mrTexWidth == 0 || mrTexHeight == 0) return;
 
+	// OcclusionのTexCoordとサイズがMetallic/Roughnessと同じ場合、[R]にOcclusionを格納.
+	bool packOcclusion = false;
+	if (m_occlusionImage) {
+		const int width  = m_occlusionImage->get_size().x;
+		const int height = m_occlusionImage->get_size().y;
+		packOcclusion = (width == mrTexWidth && height == mrTexHeight && mrTexCoord == m_occlusionTexCoord && mrRepeat == m_occlusionRepeat);
+	}
+
 	try {
+		// Occlusion(R)/Roughness(G)/Metallic(B)の参照.
+		// イメージがない要素は1.0とする.
+		std::unique_ptr<CShadeImageTileSource> occlusionSource, roughnessSource, metallicSource;
+		TileBaker::CTilePackChannel occlusionCh, roughnessCh, metallicCh;
+		if (packOcclusion) {
+			occlusionSource.reset(new CShadeImageTileSource(m_occlusionImage));
+			occlusionCh.image.source = occlusionSource.get();
+		}
+		if (m_roughnessImage) {
+			roughnessSource.reset(new CShadeImageTileSource(m_roughnessImage));
+			roughnessCh.image.source = roughnessSource.get();
+		}
+		if (m_reflectionImage) {
+			metallicSource.reset(new CShadeImageTileSource(m_reflectionImage));
+			metallicCh.image.source = metallicSource.get();
+		}
+
 		m_glTFMetallicRoughnessImage = m_pScene->create_image_interface(sx::vec<int,2>(mrTexWidth, mrTexHeight));
 		if (!m_glTFMetallicRoughnessImage) return;
 
-		std::vector<sxsdk::rgba_class> lineCols;
-		lineCols.resize(mrTexWidth);
-		for (int x = 0; x < mrTexWidth; ++x) lineCols[x] = sxsdk::rgba_class(1, 1, 1, 1);
-		for (int y = 0; y < mrTexHeight; ++y) {
-			m_glTFMetallicRoughnessImage->set_pixels_rgba_float(0, y, mrTexWidth, 1, &(lineCols[0]));
+		// バンドごとにパックして、完成した行をイメージに書き込む.
+		sxsdk::image_interface* dstImage = m_glTFMetallicRoughnessImage;
+		const size_t memoryBudget = (size_t)std::max(m_exportParam.bakeMemoryBudget, 16) * 1024 * 1024;
+		const bool ret = TileBaker::pack(mrTexWidth, mrTexHeight, occlusionCh, roughnessCh, metallicCh, memoryBudget,
+			[&](const int y, const int rowsCou, const unsigned char* rgbaData) {
+				setImagePixels(dstImage, y, mrTexWidth, rowsCou, reinterpret_cast<const sx::rgba8_class*>(rgbaData));
+				return true;
+			});
+		if (ret) {
+			m_glTFMetallicRoughnessImage->update();
+		} else {
+			IMAGE_INTERFACE_RELEASE(m_glTFMetallicRoughnessImage);
 		}
-	} catch (...) { }
 
-	// Metallicを[B]に格納.
-	if (m_reflectionImage) {
-		const int width  = m_reflectionImage->get_size().x;
-		const int height = m_reflectionImage->get_size().y;
+	} catch (...) {
+		IMAGE_INTERFACE_RELEASE(m_glTFMetallicRoughnessImage);
+	}
 
-		try {
-			sxsdk::image_interface* image = NULL;
-			if (width == mrTexWidth && height == mrTexHeight) image = m_reflectionImage;
-			else {
-				sx::vec<int,2> tSize(mrTexWidth, mrTexHeight);
-				image = m_reflectionImage->duplicate_image(&tSize);
-			}
-			std::vector<sxsdk::rgba_class> lineCols, lineCols2;
-			lineCols.resize(mrTexWidth);
-			lineCols2.resize(mrTexWidth);
+	if (packOcclusion && m_glTFMetallicRoughnessImage) {
+		m_useOcclusionInMetallicRoughnessTexture = true;
+		IMAGE_INTERFACE_RELEASE(m_occlusionImage);
+		m_hasOcclusionImage = false;
+	}
 
-			for (int y = 0; y < mrTexHeight; ++y) {
-				m_glTFMetallicRoughnessImage->get_pixels_rgba_float(0, y, mrTexWidth, 1, &(lineCols[0]));
-				image->get_pixels_rgba_float(0, y, mrTexWidth, 1, &(lineCols2[0]));
-				for (int x = 0; x < mrTexWidth; ++x) lineCols[x].blue = lineCols2[x].red;
-				m_glTFMetallicRoughnessImage->set_pixels_rgba_float(0, y, mrTexWidth, 1, &(lineCols[0]));
-			}
-			if (image != m_reflectionImage) IMAGE_INTERFACE_RELEASE(image);
+	// Metallic/RoughnessのイメージはMetallic-Roughnessイメージに格納したため、メモリを解放.
+	if (m_glTFMetallicRoughnessImage) {
+		IMAGE_INTERFACE_RELEASE(m_reflectionImage);
+		IMAGE_INTERFACE_RELEASE(m_roughnessImage);
+	}
+}
 
-		} catch (...) { }
+/**
+ * ベイク結果のキャッシュ用のキーを計算.
+ * 途中で失敗した場合、途中までのキーは別の表面材質と一致する可能性があるため使用しない.
+ */
+bool CImagesBlend::calcBakeKey (const CExportDlgParam& exportParam, CBakeCache& bakeCache, uint64_t& key)
+{
+	key = combineBakeKey(HASH64_SEED, BAKE_CACHE_VERSION);
+
+	// ベイクに影響するエクスポートのパラメータ.
+	key = combineBakeKey(key, exportParam.bakeWithoutProcessingTextures ? 1 : 0);
+	key = combineBakeKey(key, exportParam.separateOpacityAndTransmission ? 1 : 0);
+	key = combineBakeKey(key, (int)exportParam.maxTextureSize);
+
+	// タイル単位でベイクする場合は、エンコード済みのイメージを格納するため出力形式も影響する.
+	key = combineBakeKey(key, exportParam.bakeStreaming ? 1 : 0);
+	if (exportParam.bakeStreaming) {
+		key = combineBakeKey(key, (int)exportParam.outputTexture);
+		key = combineBakeKey(key, exportParam.pngCompressionLevel);
+		key = combineBakeKey(key, exportParam.jpegQuality);
+		key = combineBakeKey(key, exportParam.outputAdditionalTextures ? 1 : 0);
 	}
 
-	// Roughnessを[G]に格納.
-	if (m_roughnessImage) {
-		const int width  = m_roughnessImage->get_size().x;
-		const int height = m_roughnessImage->get_size().y;
+	try {
+		// AlphaModeの情報.
+		CAlphaModeMaterialData alphaModeData;
+		if (StreamCtrl::loadAlphaModeMaterialParam(m_surface, alphaModeData)) {
+			key = combineBakeKey(key, (int)alphaModeData.alphaModeType);
+			key = combineBakeKey(key, alphaModeData.alphaCutoff);
+		} else {
+			key = combineBakeKey(key, -1);
+		}
 
-		try {
-			sxsdk::image_interface* image = NULL;
-			if (width == mrTexWidth && height == mrTexHeight) image = m_roughnessImage;
-			else {
-				sx::vec<int,2> tSize(mrTexWidth, mrTexHeight);
-				image = m_roughnessImage->duplicate_image(&tSize);
+		// 表面材質のパラメータ.
+		key = combineBakeKey(key, m_surface->get_diffuse());
+		key = combineBakeKey(key, m_surface->get_diffuse_color());
+		key = combineBakeKey(key, m_surface->get_reflection());
+		key = combineBakeKey(key, m_surface->get_reflection_color());
+		key = combineBakeKey(key, m_surface->get_roughness());
+		key = combineBakeKey(key, m_surface->get_transparency());
+		key = combineBakeKey(key, m_surface->get_transparency_color());
+		key = combineBakeKey(key, m_surface->get_glow());
+		key = combineBakeKey(key, m_surface->get_glow_color());
+		key = combineBakeKey(key, m_surface->get_has_specular_1() ? 1 : 0);
+		key = combineBakeKey(key, m_surface->get_highlight());
+		key = combineBakeKey(key, m_surface->get_highlight_color());
+		key = combineBakeKey(key, m_surface->get_highlight_size());
+
+		// マッピングレイヤのパラメータと参照イメージ.
+		const int layersCou = m_surface->get_number_of_mapping_layers();
+		key = combineBakeKey(key, layersCou);
+		for (int i = 0; i < layersCou; ++i) {
+			sxsdk::mapping_layer_class& mappingLayer = m_surface->mapping_layer(i);
+			const int pattern = mappingLayer.get_pattern();
+			key = combineBakeKey(key, pattern);
+			key = combineBakeKey(key, mappingLayer.get_type());
+			key = combineBakeKey(key, mappingLayer.get_projection());
+			key = combineBakeKey(key, mappingLayer.get_uv_mapping());
+			key = combineBakeKey(key, mappingLayer.get_weight());
+			key = combineBakeKey(key, mappingLayer.get_blend_mode());
+			key = combineBakeKey(key, mappingLayer.get_channel_mix());
+			key = combineBakeKey(key, mappingLayer.get_flip_color() ? 1 : 0);
+			key = combineBakeKey(key, mappingLayer.get_horizontal_flip() ? 1 : 0);
+			key = combineBakeKey(key, mappingLayer.get_vertical_flip() ? 1 : 0);
+			key = combineBakeKey(key, mappingLayer.get_swap_axes() ? 1 : 0);
+			key = combineBakeKey(key, mappingLayer.get_repetition_X());
+			key = combineBakeKey(key, mappingLayer.get_repetition_Y());
+
+			if (Shade3DUtil::isOcclusionMappingLayer(&mappingLayer)) {
+				COcclusionShaderData occlusionD;
+				StreamCtrl::loadOcclusionParam(mappingLayer, occlusionD);
+				key = combineBakeKey(key, occlusionD.uvIndex);
+				key = combineBakeKey(key, occlusionD.channelMix);
 			}
-			std::vector<sxsdk::rgba_class> lineCols, lineCols2;
-			lineCols.resize(mrTexWidth);
-			lineCols2.resize(mrTexWidth);
 
-			for (int y = 0; y < mrTexHeight; ++y) {
-				m_glTFMetallicRoughnessImage->get_pixels_rgba_float(0, y, mrTexWidth, 1, &(lineCols[0]));
-				image->get_pixels_rgba_float(0, y, mrTexWidth, 1, &(lineCols2[0]));
-				for (int x = 0; x < mrTexWidth; ++x) lineCols[x].green = lineCols2[x].red;
-				m_glTFMetallicRoughnessImage->set_pixels_rgba_float(0, y, mrTexWidth, 1, &(lineCols[0]));
+			if (pattern == sxsdk::enums::image_pattern) {
+				compointer<sxsdk::image_interface> image(mappingLayer.get_image_interface());
+				key = HashUtil::combineHash64(key, (image && image->has_image()) ? bakeCache.getImageHash(m_pScene, image) : 0);
 			}
-			if (image != m_roughnessImage) IMAGE_INTERFACE_RELEASE(image);
-
-		} catch (...) { }
+		}
+	} catch (...) {
+		key = 0;
+		return false;
 	}
 
-	// OcclusionのTexCoordとサイズがMetallic/Roughnessと同じ場合、[R]にOcclusionを格納.
-	if (m_occlusionImage) {
-		const int width  = m_occlusionImage->get_size().x;
-		const int height = m_occlusionImage->get_size().y;
-		if (width == mrTexWidth && height == mrTexHeight && mrTexCoord == m_occlusionTexCoord && mrRepeat == m_occlusionRepeat) {
-			try {
-				sxsdk::image_interface* image = m_occlusionImage;
-				std::vector<sxsdk::rgba_class> lineCols, lineCols2;
-				lineCols.resize(mrTexWidth);
-				lineCols2.resize(mrTexWidth);
-
-				for (int y = 0; y < mrTexHeight; ++y) {
-					m_glTFMetallicRoughnessImage->get_pixels_rgba_float(0, y, mrTexWidth, 1, &(lineCols[0]));
-					image->get_pixels_rgba_float(0, y, mrTexWidth, 1, &(lineCols2[0]));
-					for (int x = 0; x < mrTexWidth; ++x) lineCols[x].red = lineCols2[x].red;
-					m_glTFMetallicRoughnessImage->set_pixels_rgba_float(0, y, mrTexWidth, 1, &(lineCols[0]));
-				}
+	return true;
+}
 
-			} catch (...) { }
-			m_useOcclusionInMetallicRoughnessTexture = true;
+/**
+ * ベイク結果を、キャッシュ用のデータとして取得.
+ */
+void CImagesBlend::getBakeResult (const IMAGE_BAKE_RESULT result, CBakeResultData& data)
+{
+	data.clear();
 
-			IMAGE_INTERFACE_RELEASE(m_occlusionImage);
-			m_hasOcclusionImage = false;
-		}
+	// 出力しないイメージは先に解放し、格納したイメージも順に解放して、ピーク時のメモリを抑える.
+	IMAGE_INTERFACE_RELEASE(m_reflectionImage);
+	IMAGE_INTERFACE_RELEASE(m_roughnessImage);
+	IMAGE_INTERFACE_RELEASE(m_opacityMaskImage);
+
+	data.bakeResult        = (int)result;
+	data.alphaModeType     = m_alphaModeType;
+	data.alphaCutoff       = m_alphaCutoff;
+	data.transparency      = m_transparency;
+	data.normalStrength    = m_normalStrength;
+	data.diffuseAlphaTrans = m_diffuseAlphaTrans;
+	data.useOcclusionInMetallicRoughnessTexture = m_useOcclusionInMetallicRoughnessTexture;
+	data.metallicFactor  = getImageFactor(sxsdk::enums::reflection_mapping);
+	data.roughnessFactor = getImageFactor(sxsdk::enums::roughness_mapping);
+
+	{
+		const sxsdk::enums::mapping_type iType = sxsdk::enums::diffuse_mapping;
+		storeBakedImage(data.baseColor, getImage(iType), hasImage(iType), getImageName(iType), getTexCoord(iType), getImageRepeat(iType), getImageFactor(iType));
+		if (!m_diffuseEncodedImage.imageDatas.empty()) data.baseColor.imageData = std::move(m_diffuseEncodedImage);
+		IMAGE_INTERFACE_RELEASE(m_diffuseImage);
+		m_diffuseEncodedImage.clear();
+	}
+	{
+		const sxsdk::enums::mapping_type iType = sxsdk::enums::transparency_mapping;
+		storeBakedImage(data.transmission, getImage(iType), hasImage(iType), getImageName(iType), getTexCoord(iType), getImageRepeat(iType), getImageFactor(iType));
+		IMAGE_INTERFACE_RELEASE(m_transparencyImage);
+	}
+	{
+		const sxsdk::enums::mapping_type iType = sxsdk::enums::normal_mapping;
+		storeBakedImage(data.normal, getImage(iType), hasImage(iType), getImageName(iType), getTexCoord(iType), getImageRepeat(iType), getImageFactor(iType));
+		IMAGE_INTERFACE_RELEASE(m_normalImage);
+	}
+	{
+		const sxsdk::enums::mapping_type iType = sxsdk::enums::glow_mapping;
+		storeBakedImage(data.emissive, getImage(iType), hasImage(iType), getImageName(iType), getTexCoord(iType), getImageRepeat(iType), getImageFactor(iType));
+		if (!m_glowEncodedImage.imageDatas.empty()) data.emissive.imageData = std::move(m_glowEncodedImage);
+		IMAGE_INTERFACE_RELEASE(m_glowImage);
+		m_glowEncodedImage.clear();
+	}
+	{
+		// Metallic-Roughnessの反復回数とUV層は、Reflectionのものを使用.
+		const sxsdk::enums::mapping_type iType = sxsdk::enums::reflection_mapping;
+		sxsdk::image_interface* image = getMetallicRoughnessImage();
+		storeBakedImage(data.metallicRoughness, image, (image != NULL), "", getTexCoord(iType), getImageRepeat(iType), sxsdk::rgb_class(1, 1, 1));
+		IMAGE_INTERFACE_RELEASE(m_glTFMetallicRoughnessImage);
+	}
+	{
+		const sxsdk::enums::mapping_type iType = MAPPING_TYPE_GLTF_OCCLUSION;
+		sxsdk::image_interface* image = getImage(iType);
+		storeBakedImage(data.occlusion, image, (image != NULL), getImageName(iType), getTexCoord(iType), getImageRepeat(iType), getImageFactor(iType));
+		IMAGE_INTERFACE_RELEASE(m_occlusionImage);
 	}
 }
 
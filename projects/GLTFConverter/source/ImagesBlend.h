@@ -5,6 +5,12 @@
 #define _IMAGESBLEND_H
 
 #include "GlobalHeader.h"
+#include "ImageData.h"
+
+#include <stdint.h>
+
+class CBakeCache;
+class CBakeResultData;
 
 
 class CImagesBlend
@@ -35,6 +41,10 @@ private:
 
 	sxsdk::image_interface* m_glTFMetallicRoughnessImage;		// glTFでのMetallicRoughness画像.
 
+	// タイル単位でベイクした場合は、イメージを作成せずにpng/jpegにエンコードしたバイト列を格納する.
+	CImageData m_diffuseEncodedImage;							// Diffuseのエンコード済みの画像.
+	CImageData m_glowEncodedImage;								// Glowのエンコード済みの画像.
+
 	std::string m_diffuseImageName;								// Diffuseの画像名.
 	std::string m_normalImageName;								// Normalの画像名.
 	std::string m_reflectionImageName;							// Reflectionの画像名.
@@ -99,6 +109,24 @@ private:
 	 */
 	bool m_blendImages (const sxsdk::enums::mapping_type mappingType, const sx::vec<int,2>& repeatTex);
 
+	/**
+	 * 指定のテクスチャを合成する際に、タイル単位でベイクできるかチェック.
+	 * ベイク後に、他のテクスチャとの合成やPBRマテリアルへの変換で加工されないDiffuse/Glowのみ.
+	 * @param[in] mappingType  マッピングの種類.
+	 */
+	bool m_canStreamBake (const sxsdk::enums::mapping_type mappingType) const;
+
+	/**
+	 * 指定のテクスチャを、タイル単位で合成してpng/jpegにエンコード.
+	 * 全解像度の中間イメージを確保せず、作業用のメモリはbakeMemoryBudget以下に抑える.
+	 * 出力サイズは、最大テクスチャサイズに収まるように縮小する.
+	 * @param[in]  mappingType   マッピングの種類.
+	 * @param[in]  repeatTex     繰り返し回数.
+	 * @param[out] encodedImage  エンコードしたイメージ.
+	 * @return 失敗した場合はfalse (m_blendImagesで合成すること).
+	 */
+	bool m_streamBakeImages (const sxsdk::enums::mapping_type mappingType, const sx::vec<int,2>& repeatTex, CImageData& encodedImage);
+
 	/**
 	 * 指定のテクスチャの種類がベイク不要の1枚のテクスチャであるかチェック.
 	 * @param[in]  mappingType   マッピングの種類.
@@ -182,6 +210,24 @@ public:
 	 */
 	IMAGE_BAKE_RESULT blendImages (const CExportDlgParam& exportParam);
 
+	/**
+	 * ベイク結果のキャッシュ用のキーを計算.
+	 * 表面材質のパラメータ、マッピングレイヤのパラメータと参照イメージの内容、ベイクに影響するエクスポートのパラメータから計算する.
+	 * @param[in]  exportParam  エクスポートのパラメータ.
+	 * @param[in]  bakeCache    イメージのハッシュ値の計算に使用.
+	 * @param[out] key          計算したキー.
+	 * @return キーを計算できなかった場合はfalse (キャッシュは使用しない).
+	 */
+	bool calcBakeKey (const CExportDlgParam& exportParam, CBakeCache& bakeCache, uint64_t& key);
+
+	/**
+	 * ベイク結果を、キャッシュ用のデータとして取得.
+	 * メモリを抑えるため、格納したイメージは解放される (呼び出し後はgetImageなどでイメージを取得できない).
+	 * @param[in]  result  blendImagesの戻り値.
+	 * @param[out] data    ベイク結果.
+	 */
+	void getBakeResult (const IMAGE_BAKE_RESULT result, CBakeResultData& data);
+
 	/**
 	 * 各種イメージを持つか (単一または複数).
 	 */
@@ -4,6 +4,7 @@
 
 #include "MaterialData.h"
 #include "MathUtil.h"
+#include "HashUtil.h"
 
 CMaterialData::CMaterialData ()
 {
@@ -205,3 +206,19 @@ bool CMaterialData::isSame (const CMaterialData& v) const
 
 	return true;
 }
+
+/**
+ * isSameで完全一致を比較する要素(整数/bool値)からハッシュ値を計算.
+ */
+uint64_t CMaterialData::calcStructureHash () const
+{
+	const int values[] = {
+		alphaMode, doubleSided ? 1 : 0, unlit ? 1 : 0, hasVertexColor ? 1 : 0,
+		baseColorImageIndex, normalImageIndex, emissiveImageIndex, metallicRoughnessImageIndex, occlusionImageIndex,
+		baseColorTexCoord, normalTexCoord, emissiveTexCoord, metallicRoughnessTexCoord, occlusionTexCoord,
+		clearcoatTextureIndex, clearcoatRoughnessIndex, clearcoatNormalIndex,
+		sheenColorTextureIndex, sheenRoughnessTextureIndex,
+		transmissionTextureIndex, transmissionTexCoord
+	};
+	return HashUtil::calcHash64(values, sizeof(values));
+}
@@ -91,6 +91,7 @@ public:
 public:
 	CMaterialData ();
 	CMaterialData (const CMaterialData& v);
+	CMaterialData (CMaterialData&& v) = default;
 	~CMaterialData ();
 
     CMaterialData& operator = (const CMaterialData &v) {
@@ -157,6 +158,7 @@ public:
 
 		return (*this);
     }
+	CMaterialData& operator = (CMaterialData &&v) = default;
 
 	void clear ();
 
@@ -165,6 +167,12 @@ public:
 	 */
 	bool isSame (const CMaterialData& v) const;
 
+	/**
+	 * isSameで完全一致を比較する要素(整数/bool値)からハッシュ値を計算.
+	 * 許容誤差付きで比較する浮動小数点の要素は含まない.
+	 */
+	uint64_t calcStructureHash () const;
+
 };
 
 #endif
@@ -3,6 +3,112 @@
  */
 #include "MeshData.h"
 #include "MathUtil.h"
+#include "HashUtil.h"
+
+#include <algorithm>
+#include <utility>
+#include <unordered_map>
+#include <math.h>
+#include <string.h>
+
+namespace {
+	// 頂点のマージ時の許容誤差 (MathUtil::isZeroの既定の許容誤差).
+	const double CORNER_WELD_TOLERANCE = 1e-3;
+
+	// 頂点のマージ時に法線/UV/頂点カラーを量子化する幅.
+	// 許容誤差より十分大きくし、0.0/0.5/1.0などの値がセルの中央になるようにする.
+	const double CORNER_WELD_CELL_SIZE = 1.0 / 64.0;
+
+	// コーナーの法線/UV0/UV1/Color0の要素数の最大.
+	const int CORNER_VALUES_MAX = 3 + 2 + 2 + 4;
+
+	/**
+	 * 法線/UV/頂点カラーの要素を量子化 (四捨五入).
+	 * @param[in]  v            値.
+	 * @param[out] neighborDir  許容誤差内にセルの境界がある場合は、隣のセルの方向 (-1 or +1)。それ以外は0.
+	 * @return セル番号.
+	 */
+	inline int64_t quantizeCornerValue (const float v, int& neighborDir) {
+		const double s = (double)v / CORNER_WELD_CELL_SIZE;
+		const double cell = std::max(-1e15, std::min(1e15, floor(s + 0.5)));
+
+		// floatの誤差を考慮して、許容誤差より少し広めに判定.
+		const double margin = 0.5 - (CORNER_WELD_TOLERANCE * 1.01) / CORNER_WELD_CELL_SIZE;
+		const double d = s - cell;
+		neighborDir = (d > margin) ? 1 : ((d < -margin) ? -1 : 0);
+		return (int64_t)cell;
+	}
+
+	/**
+	 * useListがtrueの要素のみを残すように、配列を前詰め (順番は維持).
+	 * @param[in,out] data     配列.
+	 * @param[in]     useList  要素ごとに、残す場合はtrue.
+	 * @param[in]     stride   useListの1要素あたりの、dataの要素数.
+	 */
+	template<typename T> void compactArray (std::vector<T>& data, const std::vector<bool>& useList, const size_t stride) {
+		if (data.empty()) return;
+		const size_t cou = std::min(useList.size(), data.size() / stride);
+		size_t dstPos = 0;
+		for (size_t i = 0, srcPos = 0; i < cou; ++i, srcPos += stride) {
+			if (!useList[i]) continue;
+			if (dstPos != srcPos) {
+				for (size_t k = 0; k < stride; ++k) data[dstPos + k] = std::move(data[srcPos + k]);
+			}
+			dstPos += stride;
+		}
+		// useListの範囲外の要素はそのまま残す.
+		for (size_t srcPos = cou * stride; srcPos < data.size(); ++srcPos, ++dstPos) {
+			if (dstPos != srcPos) data[dstPos] = std::move(data[srcPos]);
+		}
+		data.resize(dstPos);
+	}
+
+	/**
+	 * 三角形をフェイスグループごとに分類 (counting sort。グループ内の三角形の順番は維持).
+	 * groupTriangles[groupOffsets[i]] - groupTriangles[groupOffsets[i + 1] - 1] が、faceGroupSlotsでiとなるフェイスグループの三角形番号.
+	 * @param[in]  triangleFaceGroupIndex  三角形ごとのフェイスグループ番号.
+	 * @param[in]  faceGroupSlots          フェイスグループ番号 => 分類先の番号.
+	 * @param[in]  slotsCou                分類先の数.
+	 * @param[out] groupOffsets            分類先ごとの開始位置 (slotsCou + 1個).
+	 * @param[out] groupTriangles          分類した三角形番号.
+	 */
+	void bucketTrianglesByFaceGroup (const std::vector<int>& triangleFaceGroupIndex, const std::unordered_map<int, int>& faceGroupSlots, const size_t slotsCou, std::vector<int>& groupOffsets, std::vector<int>& groupTriangles) {
+		const size_t triCou = triangleFaceGroupIndex.size();
+		std::vector<int> triSlots(triCou, -1);
+		groupOffsets.assign(slotsCou + 1, 0);
+		for (size_t i = 0; i < triCou; ++i) {
+			auto iter = faceGroupSlots.find(triangleFaceGroupIndex[i]);
+			if (iter == faceGroupSlots.end()) continue;
+			triSlots[i] = iter->second;
+			groupOffsets[triSlots[i] + 1]++;
+		}
+		for (size_t i = 0; i < slotsCou; ++i) groupOffsets[i + 1] += groupOffsets[i];
+
+		groupTriangles.resize(groupOffsets[slotsCou]);
+		std::vector<int> fillPos(groupOffsets.begin(), groupOffsets.end() - 1);
+		for (size_t i = 0; i < triCou; ++i) {
+			if (triSlots[i] >= 0) groupTriangles[fillPos[triSlots[i]]++] = (int)i;
+		}
+	}
+
+	/**
+	 * 配列の要素数とバイト列を、ハッシュ値に合成.
+	 */
+	template<typename T> uint64_t combineArrayHash (const uint64_t hash, const std::vector<T>& data) {
+		const uint64_t h = HashUtil::combineHash64(hash, (uint64_t)data.size());
+		if (data.empty()) return h;
+		return HashUtil::calcHash64(&data[0], sizeof(T) * data.size(), h);
+	}
+
+	/**
+	 * 配列の内容がバイト単位で同一か.
+	 */
+	template<typename T> bool isSameArray (const std::vector<T>& a, const std::vector<T>& b) {
+		if (a.size() != b.size()) return false;
+		if (a.empty()) return true;
+		return (memcmp(&a[0], &b[0], sizeof(T) * a.size()) == 0);
+	}
+}
 
 //---------------------------------------------------------------.
 /**
@@ -27,6 +133,10 @@ CTempMeshData::CTempMeshData (const CTempMeshData& v)
 	this->triangleUV1     = v.triangleUV1;
 	this->triangleColor0  = v.triangleColor0;
 	this->triangleColor1  = v.triangleColor1;
+	this->vertexNormals   = v.vertexNormals;
+	this->vertexUV0       = v.vertexUV0;
+	this->vertexUV1       = v.vertexUV1;
+	this->vertexColor0    = v.vertexColor0;
 
 	this->materialIndex   = v.materialIndex;
 	this->faceGroupMaterialIndex = v.faceGroupMaterialIndex;
@@ -52,6 +162,10 @@ void CTempMeshData::clear ()
 	triangleColor0.clear();
 	triangleColor1.clear();
 	triangleFaceGroupIndex.clear();
+	vertexNormals.clear();
+	vertexUV0.clear();
+	vertexUV1.clear();
+	vertexColor0.clear();
 
 	materialIndex = 0;
 	faceGroupMaterialIndex.clear();
@@ -111,27 +225,9 @@ void CTempMeshData::optimize (const bool removeUnusedVertices)
 		}
 
 		if (!removeTriIndexList.empty()) {
-			const int rCou = (int)removeTriIndexList.size();
-			for (int i = rCou - 1; i >= 0; --i) {
-				const int triIndex = removeTriIndexList[i];
-				const int iPos = triIndex * 3;
-				for (int j = 0; j < 3; ++j) triangleIndices.erase(triangleIndices.begin() + iPos);
-				if (!triangleFaceGroupIndex.empty()) {
-					triangleFaceGroupIndex.erase(triangleFaceGroupIndex.begin() + triIndex);
-				}
-				if (!triangleNormals.empty()) {
-					for (int j = 0; j < 3; ++j) triangleNormals.erase(triangleNormals.begin() + iPos);
-				}
-				if (!triangleUV0.empty()) {
-					for (int j = 0; j < 3; ++j) triangleUV0.erase(triangleUV0.begin() + iPos);
-				}
-				if (!triangleUV1.empty()) {
-					for (int j = 0; j < 3; ++j) triangleUV1.erase(triangleUV1.begin() + iPos);
-				}
-				if (!triangleColor0.empty()) {
-					for (int j = 0; j < 3; ++j) triangleColor0.erase(triangleColor0.begin() + iPos);
-				}
-			}
+			std::vector<bool> useTriangleList(triCou, true);
+			for (size_t i = 0; i < removeTriIndexList.size(); ++i) useTriangleList[removeTriIndexList[i]] = false;
+			removeTriangles(useTriangleList);
 		}
 	}
 
@@ -139,48 +235,76 @@ void CTempMeshData::optimize (const bool removeUnusedVertices)
 	if (removeUnusedVertices) {
 		const size_t versCou = vertices.size();
 
-		std::vector<int> useVersList;
-		useVersList.resize(versCou, -1);
-
+		std::vector<bool> useVersList(versCou, false);
 		for (size_t i = 0; i < triangleIndices.size(); ++i) {
-			useVersList[ triangleIndices[i] ] = 1;
-		}
-		{
-			int iPos = 0;
-			for (size_t i = 0; i < versCou; ++i) {
-				if (useVersList[i] > 0) useVersList[i] = iPos++;
-			}
+			useVersList[ triangleIndices[i] ] = true;
 		}
+		removeVertices(useVersList);
+	}
+}
 
-		for (size_t i = 0; i < triangleIndices.size(); ++i) {
-			triangleIndices[i] = useVersList[ triangleIndices[i] ];
-		}
+/**
+ * 三角形を削除 (三角形の順番は維持).
+ */
+void CTempMeshData::removeTriangles (const std::vector<bool>& useTriangleList)
+{
+	compactArray(triangleIndices, useTriangleList, 3);
+	compactArray(triangleFaceGroupIndex, useTriangleList, 1);
+	compactArray(triangleNormals, useTriangleList, 3);
+	compactArray(triangleUV0, useTriangleList, 3);
+	compactArray(triangleUV1, useTriangleList, 3);
+	compactArray(triangleColor0, useTriangleList, 3);
+	compactArray(triangleColor1, useTriangleList, 3);
+}
 
-		// glTFの仕様では、meshのprimitiveごとに、同一のMorph Targetsの要素数で同じ順番である必要がある模様.
-		// そのため、頂点数が0のものがあってもあえて残す.
-		for (size_t i = 0; i < morphTargets.morphTargetsData.size(); ++i) {
-			COneMorphTargetData& mTargetD = morphTargets.morphTargetsData[i];
-			const size_t vCou = mTargetD.vIndices.size();
-			for (size_t j = 0; j < vCou; ++j) {
-				mTargetD.vIndices[j] = useVersList[ mTargetD.vIndices[j] ];
-			}
-			for (int j = (int)vCou - 1; j >= 0; --j) {
-				if (mTargetD.vIndices[j] < 0) {
-					mTargetD.vIndices.erase(mTargetD.vIndices.begin() + j);
-					mTargetD.position.erase(mTargetD.position.begin() + j);
-				}
-			}
+/**
+ * 頂点を削除 (頂点の順番は維持).
+ */
+void CTempMeshData::removeVertices (const std::vector<bool>& useVertexList)
+{
+	const size_t versCou = vertices.size();
+
+	// 頂点番号の振り直し用のテーブル (削除される頂点は-1).
+	std::vector<int> newIndexList(versCou, -1);
+	{
+		int iPos = 0;
+		for (size_t i = 0; i < versCou; ++i) {
+			if (i >= useVertexList.size() || useVertexList[i]) newIndexList[i] = iPos++;
 		}
+		if (iPos == (int)versCou) return;
+	}
 
-		for (int i = (int)versCou - 1; i >= 0; --i) {
-			if (useVersList[i] < 0) {
-				useVersList.erase(useVersList.begin() + i);
-				vertices.erase(vertices.begin() + i);
-				if (!skinWeights.empty()) skinWeights.erase(skinWeights.begin() + i);
-				if (!skinJointsHandle.empty()) skinJointsHandle.erase(skinJointsHandle.begin() + i);
-			}
+	for (size_t i = 0; i < triangleIndices.size(); ++i) {
+		triangleIndices[i] = newIndexList[ triangleIndices[i] ];
+	}
+
+	// glTFの仕様では、meshのprimitiveごとに、同一のMorph Targetsの要素数で同じ順番である必要がある模様.
+	// そのため、頂点数が0のものがあってもあえて残す.
+	for (size_t i = 0; i < morphTargets.morphTargetsData.size(); ++i) {
+		COneMorphTargetData& mTargetD = morphTargets.morphTargetsData[i];
+		const size_t vCou = mTargetD.vIndices.size();
+		std::vector<bool> useList(vCou, true);
+		for (size_t j = 0; j < vCou; ++j) {
+			const int vIndex = mTargetD.vIndices[j];
+			mTargetD.vIndices[j] = (vIndex >= 0 && vIndex < (int)versCou) ? newIndexList[vIndex] : -1;
+			if (mTargetD.vIndices[j] < 0) useList[j] = false;
 		}
+		compactArray(mTargetD.vIndices, useList, 1);
+		compactArray(mTargetD.position, useList, 1);
+		compactArray(mTargetD.normal, useList, 1);
+		compactArray(mTargetD.tangent, useList, 1);
 	}
+
+	std::vector<bool> useList(versCou);
+	for (size_t i = 0; i < versCou; ++i) useList[i] = (newIndexList[i] >= 0);
+	compactArray(vertices, useList, 1);
+	compactArray(skinWeights, useList, 1);
+	compactArray(skinJoints, useList, 1);
+	compactArray(skinJointsHandle, useList, 1);
+	compactArray(vertexNormals, useList, 1);
+	compactArray(vertexUV0, useList, 1);
+	compactArray(vertexUV1, useList, 1);
+	compactArray(vertexColor0, useList, 1);
 }
 
 //---------------------------------------------------------------.
@@ -200,6 +324,7 @@ CPrimitiveData::CPrimitiveData (const CPrimitiveData& v)
 	this->uv0             = v.uv0;
 	this->uv1             = v.uv1;
 	this->color0          = v.color0;
+	this->tangents        = v.tangents;
 	this->triangleIndices = v.triangleIndices;
 	this->materialIndex   = v.materialIndex;
 	this->skinWeights     = v.skinWeights;
@@ -223,6 +348,7 @@ void CPrimitiveData::clear ()
 	uv0.clear();
 	uv1.clear();
 	color0.clear();
+	tangents.clear();
 	triangleIndices.clear();
 	materialIndex = 0;
 	skinWeights.clear();
@@ -255,82 +381,165 @@ void CPrimitiveData::convert (const CTempMeshData& tempMeshData)
 	const size_t trisCou = triangleIndices.size() / 3;
 	if (versCou == 0 || trisCou <= 1) return;
 
-	// 各頂点で共有する面をリスト.
-	std::vector< std::vector< sx::vec<int,2> > > faceIndexInVertexList;
-	faceIndexInVertexList.resize(versCou);
-	for (size_t i = 0; i < versCou; ++i) faceIndexInVertexList[i].clear();
-
-	for (size_t i = 0, iPos = 0; i < trisCou; ++i, iPos += 3) {
-		const int i0 = triangleIndices[iPos + 0];
-		const int i1 = triangleIndices[iPos + 1];
-		const int i2 = triangleIndices[iPos + 2];
-		faceIndexInVertexList[i0].push_back(sx::vec<int,2>(i, 0));
-		faceIndexInVertexList[i1].push_back(sx::vec<int,2>(i, 1));
-		faceIndexInVertexList[i2].push_back(sx::vec<int,2>(i, 2));
+	const bool hasUV0    = !tempMeshData.triangleUV0.empty();
+	const bool hasUV1    = !tempMeshData.triangleUV1.empty();
+	const bool hasColor0 = !tempMeshData.triangleColor0.empty();
+	const size_t cornersCou = trisCou * 3;
+
+	// 各頂点で共有する三角形の頂点(コーナー)をリスト (CSR形式).
+	// vertexCorners[vertexCornerOffsets[v]] - vertexCorners[vertexCornerOffsets[v + 1] - 1] が頂点vを参照するコーナー.
+	std::vector<int> vertexCornerOffsets(versCou + 1, 0);
+	std::vector<int> vertexCorners(cornersCou);
+	for (size_t i = 0; i < cornersCou; ++i) vertexCornerOffsets[triangleIndices[i] + 1]++;
+	for (size_t i = 0; i < versCou; ++i) vertexCornerOffsets[i + 1] += vertexCornerOffsets[i];
+	{
+		std::vector<int> fillPos(vertexCornerOffsets.begin(), vertexCornerOffsets.end() - 1);
+		for (size_t i = 0; i < cornersCou; ++i) vertexCorners[fillPos[triangleIndices[i]]++] = (int)i;
 	}
 
-	// 追加した同一頂点番号を格納するバッファ.
-	std::vector< std::vector<int> > sameVersList;
-	sameVersList.resize(versCou);
-	for (size_t i = 0; i < versCou; ++i) sameVersList[i].clear();
-
-	// 共有する頂点のうち、法線/UV0/UV1が異なる場合は頂点として分離.
+	// コーナーの法線/UV0/UV1/Color0が同じか (許容誤差内か).
+	auto isSameCorner = [&](const int iP1, const int iP2) -> bool {
+		if (!MathUtil::isZero(tempMeshData.triangleNormals[iP1] - tempMeshData.triangleNormals[iP2])) return false;
+		if (hasUV0 && !MathUtil::isZero(tempMeshData.triangleUV0[iP1] - tempMeshData.triangleUV0[iP2])) return false;
+		if (hasUV1 && !MathUtil::isZero(tempMeshData.triangleUV1[iP1] - tempMeshData.triangleUV1[iP2])) return false;
+		if (hasColor0) {
+			const sxsdk::vec4& col1 = tempMeshData.triangleColor0[iP1];
+			const sxsdk::vec4& col2 = tempMeshData.triangleColor0[iP2];
+			if (!MathUtil::isZero(col1.x - col2.x) || !MathUtil::isZero(col1.y - col2.y) || !MathUtil::isZero(col1.z - col2.z) || !MathUtil::isZero(col1.w - col2.w)) return false;
+		}
+		return true;
+	};
+
+	// コーナーの法線/UV0/UV1/Color0の要素を並べる.
+	auto getCornerValues = [&](const int iP, float* values) -> int {
+		int cou = 0;
+		const sxsdk::vec3& n = tempMeshData.triangleNormals[iP];
+		values[cou++] = n.x;
+		values[cou++] = n.y;
+		values[cou++] = n.z;
+		if (hasUV0) {
+			const sxsdk::vec2& uv = tempMeshData.triangleUV0[iP];
+			values[cou++] = uv.x;
+			values[cou++] = uv.y;
+		}
+		if (hasUV1) {
+			const sxsdk::vec2& uv = tempMeshData.triangleUV1[iP];
+			values[cou++] = uv.x;
+			values[cou++] = uv.y;
+		}
+		if (hasColor0) {
+			const sxsdk::vec4& col = tempMeshData.triangleColor0[iP];
+			values[cou++] = col.x;
+			values[cou++] = col.y;
+			values[cou++] = col.z;
+			values[cou++] = col.w;
+		}
+		return cou;
+	};
+
+	// 頂点番号と、量子化したセル番号からキーを計算.
+	auto calcCornerKey = [&](const int vIndex, const int64_t* cells, const int cellsCou) -> uint64_t {
+		uint64_t key = HashUtil::combineHash64(HASH64_SEED, (uint64_t)vIndex);
+		for (int k = 0; k < cellsCou; ++k) key = HashUtil::combineHash64(key, (uint64_t)cells[k]);
+		return key;
+	};
+
+	// 共有する頂点のうち、法線/UV0/UV1/Color0が異なる場合は頂点として分離.
+	// 頂点vから分離した頂点は、versCou + sameVersOffsets[v] - versCou + sameVersOffsets[v + 1] - 1 に追加される.
+	std::vector<int> newVertexSrcList;					// 追加する頂点の、元の頂点番号.
+	std::vector<int> sameVersOffsets(versCou + 1, 0);
+	std::unordered_multimap<uint64_t, int> cornerMap;	// キー => 頂点の代表となるコーナー.
+	cornerMap.reserve(cornersCou);
+	std::vector<int> vertexReps;						// 処理中の頂点の代表となるコーナー.
+	float values[CORNER_VALUES_MAX];
+	int64_t cells[CORNER_VALUES_MAX], probeCells[CORNER_VALUES_MAX];
+	int probeIndices[CORNER_VALUES_MAX], probeDirs[CORNER_VALUES_MAX];
 	for (size_t vLoop = 0; vLoop < versCou; ++vLoop) {
-		const std::vector< sx::vec<int,2> >& facesList = faceIndexInVertexList[vLoop];
-		const size_t vtCou = facesList.size();
-		if (vtCou <= 1) continue;
-
-		// 法線/UVをチェック.
-		for (size_t i = 1; i < vtCou; ++i) {
-			const int iP1 = facesList[i][0] * 3 + facesList[i][1];
-			const sxsdk::vec3& n_1   = tempMeshData.triangleNormals[iP1];
-			const sxsdk::vec2& uv0_1 = (tempMeshData.triangleUV0.empty()) ? sxsdk::vec2(0, 0) : tempMeshData.triangleUV0[iP1];
-			const sxsdk::vec2& uv1_1 = (tempMeshData.triangleUV1.empty()) ? sxsdk::vec2(0, 0) : tempMeshData.triangleUV1[iP1];
-
-			int sIndex = -1;
-			for (size_t j = 0; j < i; ++j) {
-				const int iP2 = facesList[j][0] * 3 + facesList[j][1];
-				const sxsdk::vec3& n_2   = tempMeshData.triangleNormals[iP2];
-				const sxsdk::vec2& uv0_2 = (tempMeshData.triangleUV0.empty()) ? sxsdk::vec2(0, 0) : tempMeshData.triangleUV0[iP2];
-				const sxsdk::vec2& uv1_2 = (tempMeshData.triangleUV1.empty()) ? sxsdk::vec2(0, 0) : tempMeshData.triangleUV1[iP2];
-				if (MathUtil::isZero(n_1 - n_2) && MathUtil::isZero(uv0_1 - uv0_2) && MathUtil::isZero(uv1_1 - uv1_2)) {
-					sIndex = (int)j;
-					break;
+		sameVersOffsets[vLoop] = (int)newVertexSrcList.size();
+		const int cStart = vertexCornerOffsets[vLoop];
+		const int cEnd   = vertexCornerOffsets[vLoop + 1];
+		if (cEnd - cStart <= 1) continue;
+
+		vertexReps.clear();
+		for (int i = cStart; i < cEnd; ++i) {
+			const int iP1 = vertexCorners[i];
+			const int valuesCou = getCornerValues(iP1, values);
+			int probeCou = 0;
+			for (int k = 0; k < valuesCou; ++k) {
+				int dir;
+				cells[k] = quantizeCornerValue(values[k], dir);
+				if (dir != 0) {
+					probeIndices[probeCou] = k;
+					probeDirs[probeCou]    = dir;
+					probeCou++;
 				}
 			}
+			const uint64_t key = calcCornerKey((int)vLoop, cells, valuesCou);
 
-			// 新しく頂点を追加して対応.
-			if (sIndex < 0) {
-				const size_t vIndex = vertices.size();
-				{
-					const sxsdk::vec3 v = vertices[vLoop];
-					vertices.push_back(v);
-				}
-				if (!skinWeights.empty()) {
-					const sxsdk::vec4 v = skinWeights[vLoop];
-					skinWeights.push_back(v);
+			// 同じセル、および許容誤差内で隣接するセルにある代表コーナーから、同一のものを探す.
+			// 複数ある場合は、先に追加された代表コーナーを使用.
+			int sIndex = -1;
+			if (probeCou < 30 && ((size_t)1 << probeCou) <= vertexReps.size()) {
+				for (int mask = 0; mask < (1 << probeCou); ++mask) {
+					uint64_t probeKey = key;
+					if (mask != 0) {
+						memcpy(probeCells, cells, sizeof(int64_t) * valuesCou);
+						for (int k = 0; k < probeCou; ++k) {
+							if (mask & (1 << k)) probeCells[probeIndices[k]] += probeDirs[k];
+						}
+						probeKey = calcCornerKey((int)vLoop, probeCells, valuesCou);
+					}
+					auto range = cornerMap.equal_range(probeKey);
+					for (auto iter = range.first; iter != range.second; ++iter) {
+						if ((sIndex < 0 || iter->second < sIndex) && isSameCorner(iP1, iter->second)) sIndex = iter->second;
+					}
 				}
-				if (!skinJointsHandle.empty()) {
-					const sx::vec<void*,4> v = skinJointsHandle[vLoop];
-					skinJointsHandle.push_back(v);
+			} else {
+				// 隣接するセルの組み合わせが多い場合は、代表コーナーをすべて比較.
+				for (size_t k = 0; k < vertexReps.size(); ++k) {
+					if (isSameCorner(iP1, vertexReps[k])) {
+						sIndex = vertexReps[k];
+						break;
+					}
 				}
-				sameVersList[vLoop].push_back(vIndex);
+			}
+			if (sIndex >= 0) {
+				triangleIndices[iP1] = triangleIndices[sIndex];
+				continue;
+			}
 
-				triangleIndices[iP1] = vIndex;
-			} else {
-				const int iP2 = facesList[sIndex][0] * 3 + facesList[sIndex][1];
-				triangleIndices[iP1] = triangleIndices[iP2];
+			// 新しく頂点を追加して対応 (先頭のコーナーは元の頂点を使用).
+			if (i != cStart) {
+				triangleIndices[iP1] = (int)(versCou + newVertexSrcList.size());
+				newVertexSrcList.push_back((int)vLoop);
 			}
+			cornerMap.insert(std::pair<uint64_t, int>(key, iP1));
+			vertexReps.push_back(iP1);
+		}
+	}
+	sameVersOffsets[versCou] = (int)newVertexSrcList.size();
+
+	// 分離した頂点を追加.
+	const size_t addVersCou = newVertexSrcList.size();
+	if (addVersCou > 0) {
+		vertices.resize(versCou + addVersCou);
+		if (!skinWeights.empty()) skinWeights.resize(versCou + addVersCou);
+		if (!skinJointsHandle.empty()) skinJointsHandle.resize(versCou + addVersCou);
+		for (size_t i = 0; i < addVersCou; ++i) {
+			const int srcIndex = newVertexSrcList[i];
+			vertices[versCou + i] = vertices[srcIndex];
+			if (!skinWeights.empty()) skinWeights[versCou + i] = skinWeights[srcIndex];
+			if (!skinJointsHandle.empty()) skinJointsHandle[versCou + i] = skinJointsHandle[srcIndex];
 		}
 	}
 
 	// 法線とUVを格納.
 	const size_t newVersCou = vertices.size();
 	normals.resize(newVersCou);
-	if (!tempMeshData.triangleUV0.empty()) {
+	if (hasUV0) {
 		uv0.resize(newVersCou);
 	}
-	if (!tempMeshData.triangleUV1.empty()) {
+	if (hasUV1) {
 		uv1.resize(newVersCou);
 	}
 
@@ -339,13 +548,13 @@ void CPrimitiveData::convert (const CTempMeshData& tempMeshData)
 			const int iV = triangleIndices[iPos + j];
 			normals[iV] = tempMeshData.triangleNormals[iPos + j];
 		}
-		if (!tempMeshData.triangleUV0.empty()) {
+		if (hasUV0) {
 			for (int j = 0; j < 3; ++j) {
 				const int iV = triangleIndices[iPos + j];
 				uv0[iV] = tempMeshData.triangleUV0[iPos + j];
 			}
 		}
-		if (!tempMeshData.triangleUV1.empty()) {
+		if (hasUV1) {
 			for (int j = 0; j < 3; ++j) {
 				const int iV = triangleIndices[iPos + j];
 				uv1[iV] = tempMeshData.triangleUV1[iPos + j];
@@ -354,7 +563,7 @@ void CPrimitiveData::convert (const CTempMeshData& tempMeshData)
 	}
 
 	// 頂点カラーを格納.
-	if (!tempMeshData.triangleColor0.empty()) {
+	if (hasColor0) {
 		color0.resize(newVersCou);
 		for (size_t i = 0, iPos = 0; i < trisCou; ++i, iPos += 3) {
 			for (int j = 0; j < 3; ++j) {
@@ -374,22 +583,33 @@ void CPrimitiveData::convert (const CTempMeshData& tempMeshData)
 			for (int i = 0; i < targetsCou; ++i) {
 				const COneMorphTargetData& srcTargetD = tempMeshData.morphTargets.morphTargetsData[i];
 				morphTargets.morphTargetsData[i] = srcTargetD;
+				if (addVersCou == 0) continue;
+
 				COneMorphTargetData& dstTargetD = morphTargets.morphTargetsData[i];
 				const size_t vCou = srcTargetD.vIndices.size();
+
+				// 分離した頂点分を追加.
+				size_t dstVCou = vCou;
 				for (size_t j = 0; j < vCou; ++j) {
 					const int vIndex = srcTargetD.vIndices[j];
-					if (!sameVersList[vIndex].empty()) {
-						const std::vector<int>& vIList = sameVersList[vIndex];
-						for (size_t k = 0; k < vIList.size(); ++k) {
-							const int vNewIndex = vIList[k];
-							dstTargetD.vIndices.push_back(vNewIndex);
-							dstTargetD.position.push_back(srcTargetD.position[j]);
-							if (!srcTargetD.normal.empty()) {
-								dstTargetD.normal.push_back(srcTargetD.normal[j]);
-							}
-							if (!srcTargetD.tangent.empty()) {
-								dstTargetD.tangent.push_back(srcTargetD.tangent[j]);
-							}
+					dstVCou += sameVersOffsets[vIndex + 1] - sameVersOffsets[vIndex];
+				}
+				if (dstVCou == vCou) continue;
+				dstTargetD.vIndices.reserve(dstVCou);
+				dstTargetD.position.reserve(dstVCou);
+				if (!srcTargetD.normal.empty()) dstTargetD.normal.reserve(dstVCou);
+				if (!srcTargetD.tangent.empty()) dstTargetD.tangent.reserve(dstVCou);
+
+				for (size_t j = 0; j < vCou; ++j) {
+					const int vIndex = srcTargetD.vIndices[j];
+					for (int k = sameVersOffsets[vIndex]; k < sameVersOffsets[vIndex + 1]; ++k) {
+						dstTargetD.vIndices.push_back((int)versCou + k);
+						dstTargetD.position.push_back(srcTargetD.position[j]);
+						if (!srcTargetD.normal.empty()) {
+							dstTargetD.normal.push_back(srcTargetD.normal[j]);
+						}
+						if (!srcTargetD.tangent.empty()) {
+							dstTargetD.tangent.push_back(srcTargetD.tangent[j]);
 						}
 					}
 				}
@@ -429,17 +649,49 @@ void CPrimitiveData::calcBoundingBox (sxsdk::vec3& bbMin, sxsdk::vec3& bbMax) co
  */
 int CPrimitiveData::convert (const CTempMeshData& tempMeshData, const bool shareVerticesMesh, std::vector<CPrimitiveData>& primitivesData, std::vector<int>& faceGroupIndexList)
 {
-	// 使用しているフェイスグループ番号を取得.
+	// 使用しているフェイスグループ番号を取得 (出現順).
 	faceGroupIndexList.clear();
+	std::unordered_map<int, int> faceGroupSlots;		// フェイスグループ番号 => faceGroupIndexList内の位置.
 	const size_t triCou = tempMeshData.triangleFaceGroupIndex.size();
 	for (size_t i = 0; i < triCou; ++i) {
 		const int fgIndex = tempMeshData.triangleFaceGroupIndex[i];
-		if (std::find(faceGroupIndexList.begin(), faceGroupIndexList.end(), fgIndex) == faceGroupIndexList.end()) {
+		if (faceGroupSlots.find(fgIndex) == faceGroupSlots.end()) {
+			faceGroupSlots[fgIndex] = (int)faceGroupIndexList.size();
 			faceGroupIndexList.push_back(fgIndex);
 		}
 	}
+	const size_t faceGroupsCou = faceGroupIndexList.size();
+
+	// tempMeshDataの三角形を、tempMeshDの末尾に追加.
+	auto appendTriangle = [&tempMeshData](CTempMeshData& tempMeshD, const size_t iPos) {
+		for (int j = 0; j < 3; ++j) tempMeshD.triangleIndices.push_back(tempMeshData.triangleIndices[iPos + j]);
+		if (!tempMeshData.triangleNormals.empty()) {
+			for (int j = 0; j < 3; ++j) tempMeshD.triangleNormals.push_back(tempMeshData.triangleNormals[iPos + j]);
+		}
+		if (!tempMeshData.triangleUV0.empty()) {
+			for (int j = 0; j < 3; ++j) tempMeshD.triangleUV0.push_back(tempMeshData.triangleUV0[iPos + j]);
+		}
+		if (!tempMeshData.triangleUV1.empty()) {
+			for (int j = 0; j < 3; ++j) tempMeshD.triangleUV1.push_back(tempMeshData.triangleUV1[iPos + j]);
+		}
+		if (!tempMeshData.triangleColor0.empty()) {
+			for (int j = 0; j < 3; ++j) tempMeshD.triangleColor0.push_back(tempMeshData.triangleColor0[iPos + j]);
+		}
+	};
+	auto reserveTriangles = [&tempMeshData](CTempMeshData& tempMeshD, const size_t cou) {
+		tempMeshD.triangleIndices.reserve(cou * 3);
+		tempMeshD.triangleFaceGroupIndex.reserve(cou);
+		if (!tempMeshData.triangleNormals.empty()) tempMeshD.triangleNormals.reserve(cou * 3);
+		if (!tempMeshData.triangleUV0.empty()) tempMeshD.triangleUV0.reserve(cou * 3);
+		if (!tempMeshData.triangleUV1.empty()) tempMeshD.triangleUV1.reserve(cou * 3);
+		if (!tempMeshData.triangleColor0.empty()) tempMeshD.triangleColor0.reserve(cou * 3);
+	};
+
+	std::vector<int> groupOffsets;
+	std::vector<int> groupTriangles;
 
 	primitivesData.clear();
+	primitivesData.reserve(faceGroupsCou);
 	if (shareVerticesMesh) {		// 1Meshで複数Primitiveの頂点を共有する場合.
 		CTempMeshData tempMeshD;
 		tempMeshD.name             = tempMeshData.name;
@@ -447,35 +699,12 @@ int CPrimitiveData::convert (const CTempMeshData& tempMeshData, const bool share
 		tempMeshD.skinWeights      = tempMeshData.skinWeights;
 		tempMeshD.skinJointsHandle = tempMeshData.skinJointsHandle;
 		tempMeshD.morphTargets     = tempMeshData.morphTargets;
-		tempMeshD.faceGroupMaterialIndex.resize(triCou, 0);
 
+		// 三角形ごとのフェイスグループ番号は、optimize()で三角形とともに詰められる.
+		reserveTriangles(tempMeshD, triCou);
 		for (size_t i = 0, iPos = 0; i < triCou; ++i, iPos += 3) {
-			tempMeshD.faceGroupMaterialIndex[i] = tempMeshData.triangleFaceGroupIndex[i];
-			{
-				tempMeshD.triangleIndices.push_back(tempMeshData.triangleIndices[iPos + 0]);
-				tempMeshD.triangleIndices.push_back(tempMeshData.triangleIndices[iPos + 1]);
-				tempMeshD.triangleIndices.push_back(tempMeshData.triangleIndices[iPos + 2]);
-			}
-			if (!tempMeshData.triangleNormals.empty()) {
-				tempMeshD.triangleNormals.push_back(tempMeshData.triangleNormals[iPos + 0]);
-				tempMeshD.triangleNormals.push_back(tempMeshData.triangleNormals[iPos + 1]);
-				tempMeshD.triangleNormals.push_back(tempMeshData.triangleNormals[iPos + 2]);
-			}
-			if (!tempMeshData.triangleUV0.empty()) {
-				tempMeshD.triangleUV0.push_back(tempMeshData.triangleUV0[iPos + 0]);
-				tempMeshD.triangleUV0.push_back(tempMeshData.triangleUV0[iPos + 1]);
-				tempMeshD.triangleUV0.push_back(tempMeshData.triangleUV0[iPos + 2]);
-			}
-			if (!tempMeshData.triangleUV1.empty()) {
-				tempMeshD.triangleUV1.push_back(tempMeshData.triangleUV1[iPos + 0]);
-				tempMeshD.triangleUV1.push_back(tempMeshData.triangleUV1[iPos + 1]);
-				tempMeshD.triangleUV1.push_back(tempMeshData.triangleUV1[iPos + 2]);
-			}
-			if (!tempMeshData.triangleColor0.empty()) {
-				tempMeshD.triangleColor0.push_back(tempMeshData.triangleColor0[iPos + 0]);
-				tempMeshD.triangleColor0.push_back(tempMeshData.triangleColor0[iPos + 1]);
-				tempMeshD.triangleColor0.push_back(tempMeshData.triangleColor0[iPos + 2]);
-			}
+			appendTriangle(tempMeshD, iPos);
+			tempMeshD.triangleFaceGroupIndex.push_back(tempMeshData.triangleFaceGroupIndex[i]);
 		}
 
 		// 不要頂点の除去.
@@ -485,78 +714,106 @@ int CPrimitiveData::convert (const CTempMeshData& tempMeshData, const bool share
 		primitiveAllD.convert(tempMeshD);
 
 		// 面のフェイスグループ番号ごとに分離して格納.
-		for (size_t fgLoop = 0; fgLoop < faceGroupIndexList.size(); ++fgLoop) {
-			const int faceGroupIndex = faceGroupIndexList[fgLoop];
-
-			primitivesData.push_back(CPrimitiveData());
+		bucketTrianglesByFaceGroup(tempMeshD.triangleFaceGroupIndex, faceGroupSlots, faceGroupsCou, groupOffsets, groupTriangles);
+		for (size_t fgLoop = 0; fgLoop < faceGroupsCou; ++fgLoop) {
+			primitivesData.emplace_back();
 			CPrimitiveData& primitiveD = primitivesData.back();
 
 			if (fgLoop == 0) {
+				// 三角形インデックス以外は、primitiveAllDから移動.
 				primitiveD.name             = tempMeshD.name;
-				primitiveD.vertices         = primitiveAllD.vertices;
-				primitiveD.normals          = primitiveAllD.normals;
-				primitiveD.uv0              = primitiveAllD.uv0;
-				primitiveD.uv1              = primitiveAllD.uv1;
-				primitiveD.color0           = primitiveAllD.color0;
-				primitiveD.skinWeights      = primitiveAllD.skinWeights;
-				primitiveD.skinJointsHandle = primitiveAllD.skinJointsHandle;
-				primitiveD.morphTargets     = primitiveAllD.morphTargets;
+				primitiveD.vertices         = std::move(primitiveAllD.vertices);
+				primitiveD.normals          = std::move(primitiveAllD.normals);
+				primitiveD.uv0              = std::move(primitiveAllD.uv0);
+				primitiveD.uv1              = std::move(primitiveAllD.uv1);
+				primitiveD.color0           = std::move(primitiveAllD.color0);
+				primitiveD.skinWeights      = std::move(primitiveAllD.skinWeights);
+				primitiveD.skinJointsHandle = std::move(primitiveAllD.skinJointsHandle);
+				primitiveD.morphTargets     = std::move(primitiveAllD.morphTargets);
 			}
-			const size_t triCou = primitiveAllD.triangleIndices.size() / 3;
-			for (size_t i = 0, iPos = 0; i < triCou; ++i, iPos += 3) {
-				const int fgIndex = tempMeshD.faceGroupMaterialIndex[i];
-				if (fgIndex != faceGroupIndex) continue;
-				primitiveD.triangleIndices.push_back(primitiveAllD.triangleIndices[iPos + 0]);
-				primitiveD.triangleIndices.push_back(primitiveAllD.triangleIndices[iPos + 1]);
-				primitiveD.triangleIndices.push_back(primitiveAllD.triangleIndices[iPos + 2]);
+			primitiveD.triangleIndices.resize((groupOffsets[fgLoop + 1] - groupOffsets[fgLoop]) * 3);
+			for (int i = groupOffsets[fgLoop], dstPos = 0; i < groupOffsets[fgLoop + 1]; ++i, dstPos += 3) {
+				const int iPos = groupTriangles[i] * 3;
+				primitiveD.triangleIndices[dstPos + 0] = primitiveAllD.triangleIndices[iPos + 0];
+				primitiveD.triangleIndices[dstPos + 1] = primitiveAllD.triangleIndices[iPos + 1];
+				primitiveD.triangleIndices[dstPos + 2] = primitiveAllD.triangleIndices[iPos + 2];
 			}
 		}
 
 	} else {						// 複数Primitiveで独自の頂点に分離する場合.
-		for (size_t fgLoop = 0; fgLoop < faceGroupIndexList.size(); ++fgLoop) {
-			const int faceGroupIndex = faceGroupIndexList[fgLoop];
+		bucketTrianglesByFaceGroup(tempMeshData.triangleFaceGroupIndex, faceGroupSlots, faceGroupsCou, groupOffsets, groupTriangles);
+
+		// フェイスグループで使用する頂点のみを、元の頂点順で格納する.
+		const size_t versCou = tempMeshData.vertices.size();
+		std::vector<int> localVertexIndex(versCou, -1);
+		std::vector<int> usedVertices;
+
+		for (size_t fgLoop = 0; fgLoop < faceGroupsCou; ++fgLoop) {
+			const int tStart = groupOffsets[fgLoop];
+			const int tEnd   = groupOffsets[fgLoop + 1];
+
+			usedVertices.clear();
+			for (int i = tStart; i < tEnd; ++i) {
+				const int iPos = groupTriangles[i] * 3;
+				for (int j = 0; j < 3; ++j) {
+					const int vIndex = tempMeshData.triangleIndices[iPos + j];
+					if (localVertexIndex[vIndex] < 0) {
+						localVertexIndex[vIndex] = 0;
+						usedVertices.push_back(vIndex);
+					}
+				}
+			}
+			std::sort(usedVertices.begin(), usedVertices.end());
+			for (size_t i = 0; i < usedVertices.size(); ++i) localVertexIndex[usedVertices[i]] = (int)i;
 
 			CTempMeshData tempMeshD;
-			tempMeshD.name             = tempMeshData.name;
-			tempMeshD.vertices         = tempMeshData.vertices;
-			tempMeshD.skinWeights      = tempMeshData.skinWeights;
-			tempMeshD.skinJointsHandle = tempMeshData.skinJointsHandle;
-			tempMeshD.morphTargets     = tempMeshData.morphTargets;
-
-			for (size_t i = 0, iPos = 0; i < triCou; ++i, iPos += 3) {
-				const int fgIndex = tempMeshData.triangleFaceGroupIndex[i];
-				if (fgIndex != faceGroupIndex) continue;
-				{
-					tempMeshD.triangleIndices.push_back(tempMeshData.triangleIndices[iPos + 0]);
-					tempMeshD.triangleIndices.push_back(tempMeshData.triangleIndices[iPos + 1]);
-					tempMeshD.triangleIndices.push_back(tempMeshData.triangleIndices[iPos + 2]);
-				}
-				if (!tempMeshData.triangleNormals.empty()) {
-					tempMeshD.triangleNormals.push_back(tempMeshData.triangleNormals[iPos + 0]);
-					tempMeshD.triangleNormals.push_back(tempMeshData.triangleNormals[iPos + 1]);
-					tempMeshD.triangleNormals.push_back(tempMeshData.triangleNormals[iPos + 2]);
-				}
-				if (!tempMeshData.triangleUV0.empty()) {
-					tempMeshD.triangleUV0.push_back(tempMeshData.triangleUV0[iPos + 0]);
-					tempMeshD.triangleUV0.push_back(tempMeshData.triangleUV0[iPos + 1]);
-					tempMeshD.triangleUV0.push_back(tempMeshData.triangleUV0[iPos + 2]);
+			tempMeshD.name = tempMeshData.name;
+			{
+				const size_t localVersCou = usedVertices.size();
+				tempMeshD.vertices.resize(localVersCou);
+				if (!tempMeshData.skinWeights.empty()) tempMeshD.skinWeights.resize(localVersCou);
+				if (!tempMeshData.skinJointsHandle.empty()) tempMeshD.skinJointsHandle.resize(localVersCou);
+				for (size_t i = 0; i < localVersCou; ++i) {
+					const int vIndex = usedVertices[i];
+					tempMeshD.vertices[i] = tempMeshData.vertices[vIndex];
+					if (!tempMeshData.skinWeights.empty()) tempMeshD.skinWeights[i] = tempMeshData.skinWeights[vIndex];
+					if (!tempMeshData.skinJointsHandle.empty()) tempMeshD.skinJointsHandle[i] = tempMeshData.skinJointsHandle[vIndex];
 				}
-				if (!tempMeshData.triangleUV1.empty()) {
-					tempMeshD.triangleUV1.push_back(tempMeshData.triangleUV1[iPos + 0]);
-					tempMeshD.triangleUV1.push_back(tempMeshData.triangleUV1[iPos + 1]);
-					tempMeshD.triangleUV1.push_back(tempMeshData.triangleUV1[iPos + 2]);
+			}
+
+			// Morph Targetsは、使用する頂点の要素のみを格納.
+			tempMeshD.morphTargets = tempMeshData.morphTargets;
+			for (size_t i = 0; i < tempMeshD.morphTargets.morphTargetsData.size(); ++i) {
+				COneMorphTargetData& targetD = tempMeshD.morphTargets.morphTargetsData[i];
+				std::vector<bool> useList(targetD.vIndices.size(), false);
+				for (size_t j = 0; j < targetD.vIndices.size(); ++j) {
+					const int vIndex = targetD.vIndices[j];
+					if (vIndex >= 0 && (size_t)vIndex < versCou && localVertexIndex[vIndex] >= 0) {
+						useList[j] = true;
+						targetD.vIndices[j] = localVertexIndex[vIndex];
+					}
 				}
-				if (!tempMeshData.triangleColor0.empty()) {
-					tempMeshD.triangleColor0.push_back(tempMeshData.triangleColor0[iPos + 0]);
-					tempMeshD.triangleColor0.push_back(tempMeshData.triangleColor0[iPos + 1]);
-					tempMeshD.triangleColor0.push_back(tempMeshData.triangleColor0[iPos + 2]);
+				compactArray(targetD.vIndices, useList, 1);
+				compactArray(targetD.position, useList, 1);
+				compactArray(targetD.normal, useList, 1);
+				compactArray(targetD.tangent, useList, 1);
+			}
+
+			reserveTriangles(tempMeshD, tEnd - tStart);
+			for (int i = tStart; i < tEnd; ++i) {
+				const size_t iPos = (size_t)groupTriangles[i] * 3;
+				appendTriangle(tempMeshD, iPos);
+				for (int j = 0; j < 3; ++j) {
+					int& vIndex = tempMeshD.triangleIndices[tempMeshD.triangleIndices.size() - 3 + j];
+					vIndex = localVertexIndex[vIndex];
 				}
 			}
+			for (size_t i = 0; i < usedVertices.size(); ++i) localVertexIndex[usedVertices[i]] = -1;
 
 			// 不要頂点の除去.
 			tempMeshD.optimize();
 
-			primitivesData.push_back(CPrimitiveData());
+			primitivesData.emplace_back();
 			CPrimitiveData& primitiveD = primitivesData.back();
 			primitiveD.convert(tempMeshD);
 		}
@@ -585,6 +842,71 @@ bool CPrimitiveData::hasNeedVertexColorAlpha () const
 	return hasAlpha;
 }
 
+/**
+ * 頂点/三角形インデックス/スキン/Morph Targets/マテリアル番号からハッシュ値を計算 (Export時に使用).
+ * 名前は含まない.
+ */
+uint64_t CPrimitiveData::calcContentHash () const
+{
+	uint64_t hash = HashUtil::combineHash64(HASH64_SEED, (uint64_t)(int64_t)materialIndex);
+	hash = combineArrayHash(hash, vertices);
+	hash = combineArrayHash(hash, normals);
+	hash = combineArrayHash(hash, uv0);
+	hash = combineArrayHash(hash, uv1);
+	hash = combineArrayHash(hash, color0);
+	hash = combineArrayHash(hash, tangents);
+	hash = combineArrayHash(hash, skinWeights);
+	hash = combineArrayHash(hash, skinJoints);
+	hash = combineArrayHash(hash, skinJointsHandle);
+	hash = combineArrayHash(hash, triangleIndices);
+
+	const std::vector<COneMorphTargetData>& targets = morphTargets.morphTargetsData;
+	hash = HashUtil::combineHash64(hash, (uint64_t)targets.size());
+	for (size_t i = 0; i < targets.size(); ++i) {
+		const COneMorphTargetData& targetD = targets[i];
+		hash = combineArrayHash(hash, targetD.position);
+		hash = combineArrayHash(hash, targetD.normal);
+		hash = combineArrayHash(hash, targetD.tangent);
+		hash = combineArrayHash(hash, targetD.vIndices);
+		hash = HashUtil::calcHash64(&targetD.weight, sizeof(float), hash);
+		hash = HashUtil::calcHash64(targetD.name, hash);
+	}
+	return hash;
+}
+
+/**
+ * calcContentHashで使用する要素が、すべて同一か.
+ */
+bool CPrimitiveData::isSameContent (const CPrimitiveData& v) const
+{
+	if (materialIndex != v.materialIndex) return false;
+	if (!isSameArray(vertices, v.vertices)) return false;
+	if (!isSameArray(normals, v.normals)) return false;
+	if (!isSameArray(uv0, v.uv0)) return false;
+	if (!isSameArray(uv1, v.uv1)) return false;
+	if (!isSameArray(color0, v.color0)) return false;
+	if (!isSameArray(tangents, v.tangents)) return false;
+	if (!isSameArray(skinWeights, v.skinWeights)) return false;
+	if (!isSameArray(skinJoints, v.skinJoints)) return false;
+	if (!isSameArray(skinJointsHandle, v.skinJointsHandle)) return false;
+	if (!isSameArray(triangleIndices, v.triangleIndices)) return false;
+
+	const std::vector<COneMorphTargetData>& targets  = morphTargets.morphTargetsData;
+	const std::vector<COneMorphTargetData>& targets2 = v.morphTargets.morphTargetsData;
+	if (targets.size() != targets2.size()) return false;
+	for (size_t i = 0; i < targets.size(); ++i) {
+		const COneMorphTargetData& targetD  = targets[i];
+		const COneMorphTargetData& targetD2 = targets2[i];
+		if (!isSameArray(targetD.position, targetD2.position)) return false;
+		if (!isSameArray(targetD.normal, targetD2.normal)) return false;
+		if (!isSameArray(targetD.tangent, targetD2.tangent)) return false;
+		if (!isSameArray(targetD.vIndices, targetD2.vIndices)) return false;
+		if (memcmp(&targetD.weight, &targetD2.weight, sizeof(float)) != 0) return false;
+		if (targetD.name != targetD2.name) return false;
+	}
+	return true;
+}
+
 //---------------------------------------------------------------.
 CMeshData::CMeshData ()
 {
@@ -596,6 +918,7 @@ CMeshData::CMeshData (const CMeshData& v)
 	this->name        = v.name;
 	this->primitives  = v.primitives;
 	this->pMeshHandle = v.pMeshHandle;
+	this->m_mergedMeshData = v.m_mergedMeshData;
 }
 
 CMeshData::~CMeshData ()
@@ -607,14 +930,64 @@ void CMeshData::clear ()
 	name = "";
 	primitives.clear();
 	pMeshHandle = NULL;
+	m_mergedMeshData.reset();
+}
+
+/**
+ * Primitiveごとのハッシュ値を合成 (Export時に使用).
+ */
+uint64_t CMeshData::calcContentHash () const
+{
+	uint64_t hash = HashUtil::combineHash64(HASH64_SEED, (uint64_t)primitives.size());
+	for (size_t i = 0; i < primitives.size(); ++i) {
+		hash = HashUtil::combineHash64(hash, primitives[i].calcContentHash());
+	}
+	return hash;
+}
+
+/**
+ * すべてのPrimitiveの内容が同一か.
+ */
+bool CMeshData::isSameContent (const CMeshData& v) const
+{
+	if (primitives.size() != v.primitives.size()) return false;
+	for (size_t i = 0; i < primitives.size(); ++i) {
+		if (!primitives[i].isSameContent(v.primitives[i])) return false;
+	}
+	return true;
+}
+
+/**
+ * 複数のPrimitiveを1つにまとめたメッシュ情報を取得 (Import時に使用).
+ * 初回のみmergePrimitivesを行い、以降はキャッシュを返す.
+ * @return まとめたメッシュ情報。失敗した場合はNULL.
+ */
+const CTempMeshData* CMeshData::getMergedPrimitives ()
+{
+	if (!m_mergedMeshData) {
+		std::shared_ptr<CTempMeshData> tempMeshData = std::make_shared<CTempMeshData>();
+		if (!mergePrimitives(*tempMeshData, true)) return NULL;
+		m_mergedMeshData = tempMeshData;
+	}
+	return m_mergedMeshData.get();
+}
+
+/**
+ * getMergedPrimitivesのキャッシュを破棄.
+ */
+void CMeshData::clearMergedPrimitives ()
+{
+	m_mergedMeshData.reset();
 }
 
 /**
  * 複数のPrimitiveを1つのメッシュにまとめる (Import時に使用).
  * Shade3Dのフェイスグループを使用する1つのポリゴンメッシュにする.
- * @param[out] tempMeshData  まとめたメッシュ情報を格納.
+ * @param[out] tempMeshData      まとめたメッシュ情報を格納.
+ * @param[in]  vertexAttributes  法線/UV/頂点カラーを頂点ごと(vertexNormalsなど)に格納する場合はtrue.
+ *                               falseの場合は三角形の頂点ごと(triangleNormalsなど)に展開する.
  */
-bool CMeshData::mergePrimitives (CTempMeshData& tempMeshData) const
+bool CMeshData::mergePrimitives (CTempMeshData& tempMeshData, const bool vertexAttributes) const
 {
 	const size_t primitivesCou = primitives.size();
 	tempMeshData.clear();
@@ -625,6 +998,8 @@ bool CMeshData::mergePrimitives (CTempMeshData& tempMeshData) const
 	// どの要素を使用するか.
 	bool useUV0, useUV1, useNormal, useColor0, useSkinWeights, useSkinJoints, useMorphTargets;
 	useUV0 = useUV1 = useNormal = useColor0 = useSkinWeights = useSkinJoints = useMorphTargets = false;
+	size_t allVersCou = 0;
+	size_t allTriCou  = 0;
 	for (size_t loop = 0; loop < primitivesCou; ++loop) {
 		const CPrimitiveData& primitiveD = primitives[loop];
 		if (!primitiveD.normals.empty()) useNormal = true;
@@ -634,125 +1009,72 @@ bool CMeshData::mergePrimitives (CTempMeshData& tempMeshData) const
 		if (!primitiveD.skinWeights.empty()) useSkinWeights = true;
 		if (!primitiveD.color0.empty()) useColor0 = true;
 		if (!primitiveD.morphTargets.morphTargetsData.empty()) useMorphTargets = true;
+		allVersCou += primitiveD.vertices.size();
+		allTriCou  += primitiveD.triangleIndices.size() / 3;
 	}
 
-	size_t vOffset = 0;
+	// 要素数は既知のため、先に確保しておく.
+	// 法線/UV/頂点カラーを持たないPrimitiveの要素は、0または白で埋める.
+	const size_t attrCou = vertexAttributes ? allVersCou : (allTriCou * 3);
+	tempMeshData.vertices.resize(allVersCou);
+	tempMeshData.triangleIndices.resize(allTriCou * 3);
+	tempMeshData.triangleFaceGroupIndex.resize(allTriCou);
+	if (useNormal) {
+		if (vertexAttributes) tempMeshData.vertexNormals.resize(attrCou, sxsdk::vec3(0, 0, 0));
+		else tempMeshData.triangleNormals.resize(attrCou, sxsdk::vec3(0, 0, 0));
+	}
+	if (useUV0) {
+		if (vertexAttributes) tempMeshData.vertexUV0.resize(attrCou, sxsdk::vec2(0, 0));
+		else tempMeshData.triangleUV0.resize(attrCou, sxsdk::vec2(0, 0));
+	}
+	if (useUV1) {
+		if (vertexAttributes) tempMeshData.vertexUV1.resize(attrCou, sxsdk::vec2(0, 0));
+		else tempMeshData.triangleUV1.resize(attrCou, sxsdk::vec2(0, 0));
+	}
+	if (useColor0) {
+		if (vertexAttributes) tempMeshData.vertexColor0.resize(attrCou, sxsdk::vec4(1, 1, 1, 1));
+		else tempMeshData.triangleColor0.resize(attrCou, sxsdk::vec4(1, 1, 1, 1));
+	}
+	if (useSkinWeights) tempMeshData.skinWeights.resize(allVersCou, sxsdk::vec4(0, 0, 0, 0));
+	if (useSkinJoints) tempMeshData.skinJoints.resize(allVersCou, sx::vec<int,4>(0, 0, 0, 0));
+
+	// 頂点ごと、または三角形の頂点ごとに要素を格納.
+	// 三角形の頂点ごとの場合は、三角形の頂点インデックスから展開する.
+	auto storeAttribute = [](const auto& srcList, auto& dstList, const std::vector<int>& triangleIndices, const bool perVertex, const size_t vOffset, const size_t versCou, const size_t triOffset) {
+		if (srcList.empty()) return;
+		if (perVertex) {
+			std::copy(srcList.begin(), srcList.begin() + std::min(srcList.size(), versCou), dstList.begin() + vOffset);
+		} else {
+			const size_t cou = triangleIndices.size();
+			for (size_t i = 0; i < cou; ++i) dstList[triOffset * 3 + i] = srcList[triangleIndices[i]];
+		}
+	};
+
+	size_t vOffset   = 0;
+	size_t triOffset = 0;
 	tempMeshData.faceGroupMaterialIndex.resize(primitivesCou, -1);
 	for (size_t loop = 0; loop < primitivesCou; ++loop) {
 		const CPrimitiveData& primitiveD = primitives[loop];
 
 		const size_t versCou = primitiveD.vertices.size();
 		const size_t triCou  = primitiveD.triangleIndices.size() / 3;
-		for (size_t i = 0; i < versCou; ++i) {
-			tempMeshData.vertices.push_back(primitiveD.vertices[i]);
-		}
+		std::copy(primitiveD.vertices.begin(), primitiveD.vertices.end(), tempMeshData.vertices.begin() + vOffset);
 		for (size_t i = 0, iPos = 0; i < triCou; ++i, iPos += 3) {
-			const int i0 = primitiveD.triangleIndices[iPos + 0];
-			const int i1 = primitiveD.triangleIndices[iPos + 1];
-			const int i2 = primitiveD.triangleIndices[iPos + 2];
-			tempMeshData.triangleIndices.push_back(i0 + vOffset);
-			tempMeshData.triangleIndices.push_back(i1 + vOffset);
-			tempMeshData.triangleIndices.push_back(i2 + vOffset);
-
-			tempMeshData.triangleFaceGroupIndex.push_back(loop);
-		}
-
-		if (useNormal) {
-			if (!primitiveD.normals.empty()) {
-				for (size_t i = 0, iPos = 0; i < triCou; ++i, iPos += 3) {
-					const int i0 = primitiveD.triangleIndices[iPos + 0];
-					const int i1 = primitiveD.triangleIndices[iPos + 1];
-					const int i2 = primitiveD.triangleIndices[iPos + 2];
-					tempMeshData.triangleNormals.push_back(primitiveD.normals[i0]);
-					tempMeshData.triangleNormals.push_back(primitiveD.normals[i1]);
-					tempMeshData.triangleNormals.push_back(primitiveD.normals[i2]);
-				}
-			} else {
-				for (size_t i = 0; i < triCou; ++i) {
-					tempMeshData.triangleNormals.push_back(sxsdk::vec3(0, 0, 0));
-					tempMeshData.triangleNormals.push_back(sxsdk::vec3(0, 0, 0));
-					tempMeshData.triangleNormals.push_back(sxsdk::vec3(0, 0, 0));
-				}
-			}
-		}
-		if (useUV0) {
-			if (!primitiveD.uv0.empty()) {
-				for (size_t i = 0, iPos = 0; i < triCou; ++i, iPos += 3) {
-					const int i0 = primitiveD.triangleIndices[iPos + 0];
-					const int i1 = primitiveD.triangleIndices[iPos + 1];
-					const int i2 = primitiveD.triangleIndices[iPos + 2];
-					tempMeshData.triangleUV0.push_back(primitiveD.uv0[i0]);
-					tempMeshData.triangleUV0.push_back(primitiveD.uv0[i1]);
-					tempMeshData.triangleUV0.push_back(primitiveD.uv0[i2]);
-				}
-			} else {
-				for (size_t i = 0; i < triCou; ++i) {
-					tempMeshData.triangleUV0.push_back(sxsdk::vec2(0, 0));
-					tempMeshData.triangleUV0.push_back(sxsdk::vec2(0, 0));
-					tempMeshData.triangleUV0.push_back(sxsdk::vec2(0, 0));
-				}
-			}
-		}
-		if (useUV1) {
-			if (!primitiveD.uv1.empty()) {
-				for (size_t i = 0, iPos = 0; i < triCou; ++i, iPos += 3) {
-					const int i0 = primitiveD.triangleIndices[iPos + 0];
-					const int i1 = primitiveD.triangleIndices[iPos + 1];
-					const int i2 = primitiveD.triangleIndices[iPos + 2];
-					tempMeshData.triangleUV1.push_back(primitiveD.uv1[i0]);
-					tempMeshData.triangleUV1.push_back(primitiveD.uv1[i1]);
-					tempMeshData.triangleUV1.push_back(primitiveD.uv1[i2]);
-				}
-			} else {
-				for (size_t i = 0; i < triCou; ++i) {
-					tempMeshData.triangleUV1.push_back(sxsdk::vec2(0, 0));
-					tempMeshData.triangleUV1.push_back(sxsdk::vec2(0, 0));
-					tempMeshData.triangleUV1.push_back(sxsdk::vec2(0, 0));
-				}
-			}
-		}
-		if (useColor0) {
-			if (!primitiveD.color0.empty()) {
-				for (size_t i = 0, iPos = 0; i < triCou; ++i, iPos += 3) {
-					const int i0 = primitiveD.triangleIndices[iPos + 0];
-					const int i1 = primitiveD.triangleIndices[iPos + 1];
-					const int i2 = primitiveD.triangleIndices[iPos + 2];
-					tempMeshData.triangleColor0.push_back(primitiveD.color0[i0]);
-					tempMeshData.triangleColor0.push_back(primitiveD.color0[i1]);
-					tempMeshData.triangleColor0.push_back(primitiveD.color0[i2]);
-				}
-			} else {
-				for (size_t i = 0; i < triCou; ++i) {
-					tempMeshData.triangleColor0.push_back(sxsdk::vec4(1, 1, 1, 1));
-					tempMeshData.triangleColor0.push_back(sxsdk::vec4(1, 1, 1, 1));
-					tempMeshData.triangleColor0.push_back(sxsdk::vec4(1, 1, 1, 1));
-				}
-			}
+			const size_t dstPos = (triOffset + i) * 3;
+			tempMeshData.triangleIndices[dstPos + 0] = primitiveD.triangleIndices[iPos + 0] + (int)vOffset;
+			tempMeshData.triangleIndices[dstPos + 1] = primitiveD.triangleIndices[iPos + 1] + (int)vOffset;
+			tempMeshData.triangleIndices[dstPos + 2] = primitiveD.triangleIndices[iPos + 2] + (int)vOffset;
+			tempMeshData.triangleFaceGroupIndex[triOffset + i] = (int)loop;
 		}
 
+		if (useNormal) storeAttribute(primitiveD.normals, vertexAttributes ? tempMeshData.vertexNormals : tempMeshData.triangleNormals, primitiveD.triangleIndices, vertexAttributes, vOffset, versCou, triOffset);
+		if (useUV0) storeAttribute(primitiveD.uv0, vertexAttributes ? tempMeshData.vertexUV0 : tempMeshData.triangleUV0, primitiveD.triangleIndices, vertexAttributes, vOffset, versCou, triOffset);
+		if (useUV1) storeAttribute(primitiveD.uv1, vertexAttributes ? tempMeshData.vertexUV1 : tempMeshData.triangleUV1, primitiveD.triangleIndices, vertexAttributes, vOffset, versCou, triOffset);
+		if (useColor0) storeAttribute(primitiveD.color0, vertexAttributes ? tempMeshData.vertexColor0 : tempMeshData.triangleColor0, primitiveD.triangleIndices, vertexAttributes, vOffset, versCou, triOffset);
+
 		// スキンの情報は頂点ごとに持つ.
-		if (useSkinWeights) {
-			if (!primitiveD.skinWeights.empty()) {
-				for (size_t i = 0; i < versCou; ++i) {
-					tempMeshData.skinWeights.push_back(primitiveD.skinWeights[i]);
-				}
-			} else {
-				for (size_t i = 0; i < versCou; ++i) {
-					tempMeshData.skinWeights.push_back(sxsdk::vec4(0, 0, 0, 0));
-				}
-			}
-		}
-		if (useSkinJoints) {
-			if (!primitiveD.skinJoints.empty()) {
-				for (size_t i = 0; i < versCou; ++i) {
-					tempMeshData.skinJoints.push_back(primitiveD.skinJoints[i]);
-				}
-			} else {
-				for (size_t i = 0; i < versCou; ++i) {
-					tempMeshData.skinJoints.push_back(sx::vec<int,4>(0, 0, 0, 0));
-				}
-			}
-		}
+		if (useSkinWeights) storeAttribute(primitiveD.skinWeights, tempMeshData.skinWeights, primitiveD.triangleIndices, true, vOffset, versCou, triOffset);
+		if (useSkinJoints) storeAttribute(primitiveD.skinJoints, tempMeshData.skinJoints, primitiveD.triangleIndices, true, vOffset, versCou, triOffset);
 
 		// Morph Targets情報.
 		// glTFではPrimitiveの頂点数分の情報を持っているが、すべてを持つのはリソースを消費するため、.
@@ -762,17 +1084,16 @@ bool CMeshData::mergePrimitives (CTempMeshData& tempMeshData) const
 			if (targetsCou > 0) {
 				// glTFからの読み込みでは、mesh内のprimitiveはすべて同じ数のMorph Targetsを持っているのが仕様.
 				if (loop == 0) {
+					tempMeshData.morphTargets.morphTargetsData.resize(targetsCou);
 					for (size_t i = 0; i < targetsCou; ++i) {
 						const COneMorphTargetData& mTargetD = primitiveD.morphTargets.morphTargetsData[i];
-						COneMorphTargetData tData;
+						COneMorphTargetData& tData = tempMeshData.morphTargets.morphTargetsData[i];
 						tData.weight = mTargetD.weight;
 						tData.name   = mTargetD.name;
-						tempMeshData.morphTargets.morphTargetsData.push_back(tData);
 					}
 				}
 
-				std::vector<int> useVerList;
-				for (size_t i = 0; i < targetsCou; ++i) {
+				for (size_t i = 0; i < targetsCou && i < tempMeshData.morphTargets.morphTargetsData.size(); ++i) {
 					const COneMorphTargetData& mTargetD = primitiveD.morphTargets.morphTargetsData[i];
 					const size_t vCou = mTargetD.position.size();
 					if (vCou == 0) continue;
@@ -780,9 +1101,15 @@ bool CMeshData::mergePrimitives (CTempMeshData& tempMeshData) const
 					COneMorphTargetData& tData = tempMeshData.morphTargets.morphTargetsData[i];
 
 					// 使用している頂点に対するインデックスを保持.
+					size_t useCou = 0;
+					for (size_t j = 0; j < vCou; ++j) {
+						if (!sx::zero(mTargetD.position[j])) useCou++;
+					}
+					tData.vIndices.reserve(tData.vIndices.size() + useCou);
+					tData.position.reserve(tData.position.size() + useCou);
 					for (size_t j = 0; j < vCou; ++j) {
 						if (!sx::zero(mTargetD.position[j])) {
-							tData.vIndices.push_back(j + vOffset);
+							tData.vIndices.push_back((int)(j + vOffset));
 							tData.position.push_back(mTargetD.position[j]);
 						}
 					}
@@ -792,7 +1119,8 @@ bool CMeshData::mergePrimitives (CTempMeshData& tempMeshData) const
 
 		tempMeshData.faceGroupMaterialIndex[loop] = primitiveD.materialIndex;
 
-		vOffset += versCou;
+		vOffset   += versCou;
+		triOffset += triCou;
 	}
 
 	return true;
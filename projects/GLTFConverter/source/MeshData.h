@@ -9,6 +9,7 @@
 
 #include <vector>
 #include <string>
+#include <memory>
 
 //---------------------------------------------------------------.
 /**
@@ -32,6 +33,13 @@ public:
 	std::vector<sxsdk::vec4> triangleColor0;		// 三角形ごとの頂点カラー0.
 	std::vector<sxsdk::vec4> triangleColor1;		// 三角形ごとの頂点カラー1.
 
+	// 頂点ごとの法線/UV/頂点カラー (Import時に使用).
+	// mergePrimitivesで頂点ごとに格納した場合は、triangleNormals/triangleUV0/triangleUV1/triangleColor0の代わりにこちらを使用.
+	std::vector<sxsdk::vec3> vertexNormals;			// 頂点ごとの法線.
+	std::vector<sxsdk::vec2> vertexUV0;				// 頂点ごとのUV0.
+	std::vector<sxsdk::vec2> vertexUV1;				// 頂点ごとのUV1.
+	std::vector<sxsdk::vec4> vertexColor0;			// 頂点ごとの頂点カラー0.
+
 	int materialIndex;							// 対応するマテリアル番号.
 	std::vector<int> faceGroupMaterialIndex;	// フェイスグループごとのマテリアル番号リスト.
 
@@ -40,6 +48,7 @@ public:
 public:
 	CTempMeshData ();
 	CTempMeshData (const CTempMeshData& v);
+	CTempMeshData (CTempMeshData&& v) = default;
 	~CTempMeshData ();
 
     CTempMeshData& operator = (const CTempMeshData &v) {
@@ -55,6 +64,10 @@ public:
 		this->triangleUV1     = v.triangleUV1;
 		this->triangleColor0  = v.triangleColor0;
 		this->triangleColor1  = v.triangleColor1;
+		this->vertexNormals   = v.vertexNormals;
+		this->vertexUV0       = v.vertexUV0;
+		this->vertexUV1       = v.vertexUV1;
+		this->vertexColor0    = v.vertexColor0;
 
 		this->materialIndex   = v.materialIndex;
 		this->faceGroupMaterialIndex = v.faceGroupMaterialIndex;
@@ -63,6 +76,7 @@ public:
 
 		return (*this);
     }
+	CTempMeshData& operator = (CTempMeshData &&v) = default;
 
 	void clear ();
 
@@ -71,6 +85,34 @@ public:
 	 * @param[in]  removeUnusedVertices   未使用頂点を削除する場合はtrue.
 	 */
 	void optimize (const bool removeUnusedVertices = true);
+
+	/**
+	 * 三角形を削除 (三角形の順番は維持).
+	 * 三角形ごと/三角形の頂点ごとの配列をすべて前詰めする.
+	 * @param[in]  useTriangleList   三角形ごとに、残す場合はtrue.
+	 */
+	void removeTriangles (const std::vector<bool>& useTriangleList);
+
+	/**
+	 * 頂点を削除 (頂点の順番は維持).
+	 * 頂点ごとの配列を前詰めし、三角形の頂点インデックスとMorph Targetsの頂点番号を振り直す.
+	 * 削除する頂点を参照する三角形はないこと.
+	 * @param[in]  useVertexList   頂点ごとに、残す場合はtrue.
+	 */
+	void removeVertices (const std::vector<bool>& useVertexList);
+
+	/**
+	 * 三角形の頂点(iPos = 三角形番号 * 3 + (0 - 2))での法線/UV/頂点カラーを取得.
+	 * 頂点ごとに格納されている場合は、三角形の頂点インデックスから参照する.
+	 */
+	bool hasNormals () const { return !triangleNormals.empty() || !vertexNormals.empty(); }
+	bool hasUV0 () const { return !triangleUV0.empty() || !vertexUV0.empty(); }
+	bool hasUV1 () const { return !triangleUV1.empty() || !vertexUV1.empty(); }
+	bool hasColor0 () const { return !triangleColor0.empty() || !vertexColor0.empty(); }
+	const sxsdk::vec3& getNormal (const size_t iPos) const { return vertexNormals.empty() ? triangleNormals[iPos] : vertexNormals[triangleIndices[iPos]]; }
+	const sxsdk::vec2& getUV0 (const size_t iPos) const { return vertexUV0.empty() ? triangleUV0[iPos] : vertexUV0[triangleIndices[iPos]]; }
+	const sxsdk::vec2& getUV1 (const size_t iPos) const { return vertexUV1.empty() ? triangleUV1[iPos] : vertexUV1[triangleIndices[iPos]]; }
+	const sxsdk::vec4& getColor0 (const size_t iPos) const { return vertexColor0.empty() ? triangleColor0[iPos] : vertexColor0[triangleIndices[iPos]]; }
 };
 
 //---------------------------------------------------------------.
@@ -88,6 +130,7 @@ public:
 	std::vector<sxsdk::vec2> uv0;			// 頂点ごとのUV0.
 	std::vector<sxsdk::vec2> uv1;			// 頂点ごとのUV1.
 	std::vector<sxsdk::vec4> color0;		// 頂点ごとのColor0.
+	std::vector<sxsdk::vec4> tangents;		// 頂点ごとの接線 (wは従法線の向き。Export時に法線マップを持つ場合のみ使用).
 	std::vector<sxsdk::vec4> skinWeights;		// 頂点ごとのスキン時のウエイト (最大4つ分).
 	std::vector< sx::vec<int,4> > skinJoints;	// 頂点ごとのスキン時に参照するジョイントインデックスリスト (最大4つ分).
 	std::vector< sx::vec<void *,4> > skinJointsHandle;	// 頂点ごとのスキンのジョイントのハンドル (Export時に使用).
@@ -105,6 +148,7 @@ public:
 public:
 	CPrimitiveData ();
 	CPrimitiveData (const CPrimitiveData& v);
+	CPrimitiveData (CPrimitiveData&& v) = default;
 	~CPrimitiveData ();
 
     CPrimitiveData& operator = (const CPrimitiveData &v) {
@@ -114,6 +158,7 @@ public:
 		this->uv0             = v.uv0;
 		this->uv1             = v.uv1;
 		this->color0          = v.color0;
+		this->tangents        = v.tangents;
 		this->triangleIndices = v.triangleIndices;
 		this->materialIndex   = v.materialIndex;
 		this->skinWeights     = v.skinWeights;
@@ -126,6 +171,7 @@ public:
 
 		return (*this);
     }
+	CPrimitiveData& operator = (CPrimitiveData &&v) = default;
 
 	void clear ();
 
@@ -153,6 +199,17 @@ public:
 	 * 頂点カラー情報で、Alphaを出力する必要があるか.
 	 */
 	bool hasNeedVertexColorAlpha () const;
+
+	/**
+	 * 頂点/三角形インデックス/スキン/Morph Targets/マテリアル番号の内容からハッシュ値を計算 (Export時に使用).
+	 * 同一形状の検出に使用する。名前は含まない.
+	 */
+	uint64_t calcContentHash () const;
+
+	/**
+	 * calcContentHashで使用する要素が、すべて同一か.
+	 */
+	bool isSameContent (const CPrimitiveData& v) const;
 };
 
 /**
@@ -166,26 +223,57 @@ public:
 
 	void* pMeshHandle;							// Shade3Dのポリゴンメッシュクラスのハンドル (Import時に一時使用).
 
+private:
+	std::shared_ptr<CTempMeshData> m_mergedMeshData;	// mergePrimitivesの結果のキャッシュ (Import時に一時使用).
+
 public:
 	CMeshData ();
 	CMeshData (const CMeshData& v);
+	CMeshData (CMeshData&& v) = default;
 	~CMeshData ();
 
     CMeshData& operator = (const CMeshData &v) {
 		this->name        = v.name;
 		this->primitives  = v.primitives;
 		this->pMeshHandle = v.pMeshHandle;
+		this->m_mergedMeshData = v.m_mergedMeshData;
 		return (*this);
     }
+	CMeshData& operator = (CMeshData &&v) = default;
 
 	void clear ();
 
+	/**
+	 * Primitiveごとの内容のハッシュ値を合成 (Export時に使用).
+	 */
+	uint64_t calcContentHash () const;
+
+	/**
+	 * すべてのPrimitiveの内容が同一か.
+	 */
+	bool isSameContent (const CMeshData& v) const;
+
 	/**
 	 * 複数のPrimitiveを1つのメッシュにまとめる (Import時に使用).
 	 * Shade3Dのフェイスグループを使用する1つのポリゴンメッシュにする.
 	 * @param[out] tempMeshData  まとめたメッシュ情報を格納.
+	 * @param[in]  vertexAttributes  法線/UV/頂点カラーを頂点ごと(vertexNormalsなど)に格納する場合はtrue.
+	 *                               falseの場合は三角形の頂点ごと(triangleNormalsなど)に展開する.
+	 */
+	bool mergePrimitives (CTempMeshData& tempMeshData, const bool vertexAttributes = false) const;
+
+	/**
+	 * 複数のPrimitiveを1つにまとめたメッシュ情報を取得 (Import時に使用).
+	 * 初回のみmergePrimitivesを行い、以降はキャッシュを返す.
+	 * メッシュ生成、スキンの割り当てで共有する.
+	 * @return まとめたメッシュ情報。失敗した場合はNULL.
+	 */
+	const CTempMeshData* getMergedPrimitives ();
+
+	/**
+	 * getMergedPrimitivesのキャッシュを破棄.
 	 */
-	bool mergePrimitives (CTempMeshData& tempMeshData) const;
+	void clearMergedPrimitives ();
 };
 
 #endif
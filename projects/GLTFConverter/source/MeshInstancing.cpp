@@ -0,0 +1,116 @@
+﻿/**
+ * インポート時に、複数のノードから参照されるglTFのメッシュを管理する.
+ */
+#include "MeshInstancing.h"
+
+using namespace MeshInstancing;
+
+CMeshInstancePlan::CMeshInstancePlan ()
+{
+	clear();
+}
+
+void CMeshInstancePlan::clear ()
+{
+	m_nodeMeshIndices.clear();
+	m_nodeSkinIndices.clear();
+	m_nodeMeshHandles.clear();
+	m_meshRemainingNodesCount.clear();
+	m_meshHasSkin.clear();
+	m_meshMasterNodes.clear();
+	m_meshMergeStates.clear();
+}
+
+/**
+ * ノードごとのメッシュ番号とスキン番号を指定.
+ */
+void CMeshInstancePlan::init (const std::vector<int>& nodeMeshIndices, const std::vector<int>& nodeSkinIndices, const int meshesCou)
+{
+	clear();
+	const size_t nodesCou = nodeMeshIndices.size();
+	m_nodeMeshIndices.resize(nodesCou, -1);
+	m_nodeSkinIndices.resize(nodesCou, -1);
+	m_nodeMeshHandles.resize(nodesCou, NULL);
+
+	m_meshRemainingNodesCount.resize(meshesCou, 0);
+	m_meshHasSkin.resize(meshesCou, 0);
+	m_meshMasterNodes.resize(meshesCou, -1);
+	m_meshMergeStates.resize(meshesCou, 0);
+
+	// メッシュごとに参照しているノード数を数える.
+	for (size_t i = 0; i < nodesCou; ++i) {
+		const int meshIndex = nodeMeshIndices[i];
+		if (meshIndex < 0 || meshIndex >= meshesCou) continue;
+		m_nodeMeshIndices[i] = meshIndex;
+		m_meshRemainingNodesCount[meshIndex]++;
+		if (i < nodeSkinIndices.size() && nodeSkinIndices[i] >= 0) {
+			m_nodeSkinIndices[i] = nodeSkinIndices[i];
+			m_meshHasSkin[meshIndex] = 1;
+		}
+	}
+}
+
+/**
+ * ノードのメッシュ形状を生成.
+ */
+void* CMeshInstancePlan::createNodeMesh (CMeshInstanceHost& host, const int nodeIndex)
+{
+	if (nodeIndex < 0 || nodeIndex >= (int)m_nodeMeshIndices.size()) return NULL;
+	const int meshIndex = m_nodeMeshIndices[nodeIndex];
+	if (meshIndex < 0) return NULL;
+
+	// 最初に参照するノードの場合のみマージする (失敗した場合は以降のノードでも行わない).
+	if (m_meshMergeStates[meshIndex] == 0) {
+		m_meshMergeStates[meshIndex] = host.mergeMesh(meshIndex) ? 1 : -1;
+	}
+
+	void* handle = NULL;
+	if (m_meshMergeStates[meshIndex] > 0) {
+		handle = host.createNodeMesh(nodeIndex, meshIndex, m_meshMasterNodes[meshIndex]);
+		if (handle && m_meshMasterNodes[meshIndex] < 0) m_meshMasterNodes[meshIndex] = nodeIndex;
+	}
+	m_nodeMeshHandles[nodeIndex] = handle;
+
+	// 最後に参照するノードの場合、スキンの割り当てで使用しなければマージしたメッシュ情報を破棄.
+	if ((--m_meshRemainingNodesCount[meshIndex]) <= 0 && !m_meshHasSkin[meshIndex] && m_meshMergeStates[meshIndex] > 0) {
+		host.releaseMergedMesh(meshIndex);
+		m_meshMergeStates[meshIndex] = 0;
+	}
+
+	return handle;
+}
+
+/**
+ * スキンを持つノードごとに、生成したメッシュ形状へスキンを割り当てる.
+ */
+void CMeshInstancePlan::bindSkins (CMeshInstanceHost& host)
+{
+	for (size_t i = 0; i < m_nodeMeshIndices.size(); ++i) {
+		const int meshIndex = m_nodeMeshIndices[i];
+		if (meshIndex < 0 || m_nodeSkinIndices[i] < 0 || !m_nodeMeshHandles[i]) continue;
+		if (m_meshMergeStates[meshIndex] <= 0) continue;
+		host.bindSkin((int)i, meshIndex, m_nodeSkinIndices[i], m_nodeMeshHandles[i]);
+	}
+}
+
+/**
+ * 保持しているマージ結果をすべて破棄.
+ */
+void CMeshInstancePlan::releaseMergedMeshes (CMeshInstanceHost& host)
+{
+	for (size_t i = 0; i < m_meshMergeStates.size(); ++i) {
+		if (m_meshMergeStates[i] > 0) {
+			host.releaseMergedMesh((int)i);
+			m_meshMergeStates[i] = 0;
+		}
+	}
+}
+
+/**
+ * ノードで生成したメッシュ形状のhandleを取得.
+ */
+void* CMeshInstancePlan::getNodeMeshHandle (const int nodeIndex) const
+{
+	if (nodeIndex < 0 || nodeIndex >= (int)m_nodeMeshHandles.size()) return NULL;
+	return m_nodeMeshHandles[nodeIndex];
+}
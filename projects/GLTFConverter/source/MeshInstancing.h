@@ -0,0 +1,104 @@
+﻿/**
+ * インポート時に、複数のノードから参照されるglTFのメッシュを管理する.
+ * プリミティブのマージはメッシュごとに1回だけ行い、同じメッシュを参照する後続のノードはその結果を再利用する.
+ * スキンは、メッシュではなくそれを参照するノードごとに割り当てる.
+ * 形状の生成などはCMeshInstanceHostを介して行うため、Shade3DのAPIを使用せずに動作を確認できる.
+ */
+#ifndef _MESHINSTANCING_H
+#define _MESHINSTANCING_H
+
+#include <vector>
+#include <stddef.h>
+
+namespace MeshInstancing {
+	/**
+	 * メッシュのマージ、形状の生成、スキンの割り当てを行う側 (インポート時はShade3Dのシーン).
+	 */
+	class CMeshInstanceHost
+	{
+	public:
+		virtual ~CMeshInstanceHost () { }
+
+		/**
+		 * 指定のメッシュのプリミティブを1つにマージする.
+		 * 結果はreleaseMergedMeshが呼ばれるまで保持する.
+		 */
+		virtual bool mergeMesh (const int meshIndex) = 0;
+
+		/**
+		 * mergeMeshでマージしたメッシュ情報を破棄.
+		 */
+		virtual void releaseMergedMesh (const int meshIndex) = 0;
+
+		/**
+		 * マージしたメッシュ情報から、ノードのメッシュ形状を生成.
+		 * @param[in] nodeIndex        ノード番号.
+		 * @param[in] meshIndex        メッシュ番号.
+		 * @param[in] masterNodeIndex  同じメッシュで先に形状を生成したノード番号 (このノードが最初の場合は-1).
+		 * @return 生成した形状のhandle. 失敗した場合はNULL.
+		 */
+		virtual void* createNodeMesh (const int nodeIndex, const int meshIndex, const int masterNodeIndex) = 0;
+
+		/**
+		 * ノードで生成したメッシュ形状に、スキンを割り当てる.
+		 * @param[in] nodeIndex   ノード番号.
+		 * @param[in] meshIndex   メッシュ番号.
+		 * @param[in] skinIndex   スキン番号.
+		 * @param[in] meshHandle  createNodeMeshで生成した形状のhandle.
+		 */
+		virtual void bindSkin (const int nodeIndex, const int meshIndex, const int skinIndex, void* meshHandle) = 0;
+	};
+
+	/**
+	 * ノードとメッシュの参照関係から、マージの回数と破棄のタイミングを管理する.
+	 */
+	class CMeshInstancePlan
+	{
+	private:
+		std::vector<int> m_nodeMeshIndices;			// ノードごとのメッシュ番号 (-1の場合はメッシュを持たない).
+		std::vector<int> m_nodeSkinIndices;			// ノードごとのスキン番号 (-1の場合はスキンを持たない).
+		std::vector<void *> m_nodeMeshHandles;		// ノードごとの、生成したメッシュ形状のhandle.
+
+		std::vector<int> m_meshRemainingNodesCount;	// メッシュごとの、まだ形状を生成していない参照ノード数.
+		std::vector<char> m_meshHasSkin;			// メッシュごとの、スキンを持つノードから参照されているか.
+		std::vector<int> m_meshMasterNodes;			// メッシュごとの、最初に形状を生成したノード番号.
+		std::vector<char> m_meshMergeStates;		// メッシュごとのマージの状態 (0:未マージ、1:マージ済み、-1:失敗).
+
+	public:
+		CMeshInstancePlan ();
+
+		void clear ();
+
+		/**
+		 * ノードごとのメッシュ番号とスキン番号を指定.
+		 * @param[in] nodeMeshIndices  ノードごとのメッシュ番号 (-1の場合はメッシュを持たない).
+		 * @param[in] nodeSkinIndices  ノードごとのスキン番号 (-1の場合はスキンを持たない).
+		 * @param[in] meshesCou        メッシュ数.
+		 */
+		void init (const std::vector<int>& nodeMeshIndices, const std::vector<int>& nodeSkinIndices, const int meshesCou);
+
+		/**
+		 * ノードのメッシュ形状を生成.
+		 * メッシュの最初の参照時にのみマージを行い、最後の参照ノードの生成後、スキンで使用しなければマージ結果を破棄する.
+		 * @return 生成した形状のhandle. メッシュを持たない場合や失敗した場合はNULL.
+		 */
+		void* createNodeMesh (CMeshInstanceHost& host, const int nodeIndex);
+
+		/**
+		 * スキンを持つノードごとに、生成したメッシュ形状へスキンを割り当てる.
+		 */
+		void bindSkins (CMeshInstanceHost& host);
+
+		/**
+		 * 保持しているマージ結果をすべて破棄.
+		 */
+		void releaseMergedMeshes (CMeshInstanceHost& host);
+
+		/**
+		 * ノードで生成したメッシュ形状のhandleを取得.
+		 */
+		void* getNodeMeshHandle (const int nodeIndex) const;
+	};
+}
+
+#endif
@@ -0,0 +1,811 @@
+﻿/**
+ * エクスポート時のメッシュの最適化.
+ */
+#include "MeshOptimizer.h"
+
+#include <algorithm>
+#include <utility>
+#include <stdint.h>
+#include <math.h>
+
+namespace {
+	// 三角形の並び替えで想定する頂点キャッシュ(LRU)のサイズ.
+	const int VERTEX_CACHE_SIZE = 32;
+
+	/**
+	 * 頂点のスコアを計算 (Forsyth, "Linear-Speed Vertex Cache Optimisation").
+	 * @param[in] cachePos        頂点キャッシュ内での位置 (キャッシュにない場合は-1).
+	 * @param[in] remainingCount  この頂点を参照する、未出力の三角形数.
+	 */
+	float calcVertexScore (const int cachePos, const int remainingCount) {
+		if (remainingCount <= 0) return -1.0f;
+
+		float score = 0.0f;
+		if (cachePos >= 0) {
+			if (cachePos < 3) {
+				// 直前の三角形で使った頂点は、どの順番で使っても同じなので固定値.
+				score = 0.75f;
+			} else {
+				const float scaler = 1.0f / (float)(VERTEX_CACHE_SIZE - 3);
+				score = powf(1.0f - (float)(cachePos - 3) * scaler, 1.5f);
+			}
+		}
+
+		// 残りの三角形が少ない頂点を優先して、孤立した三角形が残らないようにする.
+		score += 2.0f / sqrtf((float)remainingCount);
+		return score;
+	}
+
+	/**
+	 * 頂点の並びに合わせて、頂点ごとの配列を並び替え.
+	 * 要素数が頂点数と異なる配列はそのまま.
+	 */
+	template<typename T> void remapVertexArray (std::vector<T>& data, const std::vector<int>& vertexRemap) {
+		if (data.empty() || data.size() != vertexRemap.size()) return;
+		std::vector<T> tmpData(data.size());
+		for (size_t i = 0; i < data.size(); ++i) tmpData[vertexRemap[i]] = std::move(data[i]);
+		data.swap(tmpData);
+	}
+
+	/**
+	 * 頂点番号を置き換え.
+	 */
+	void remapIndices (std::vector<int>& indices, const std::vector<int>& vertexRemap) {
+		const int versCou = (int)vertexRemap.size();
+		for (size_t i = 0; i < indices.size(); ++i) {
+			const int vIndex = indices[i];
+			if (vIndex >= 0 && vIndex < versCou) indices[i] = vertexRemap[vIndex];
+		}
+	}
+
+	/**
+	 * 三角形の頂点インデックスが、すべて頂点数の範囲内か.
+	 */
+	bool checkIndices (const std::vector<int>& triangleIndices, const size_t verticesCount) {
+		if ((triangleIndices.size() % 3) != 0) return false;
+		for (size_t i = 0; i < triangleIndices.size(); ++i) {
+			if (triangleIndices[i] < 0 || triangleIndices[i] >= (int)verticesCount) return false;
+		}
+		return true;
+	}
+
+	// LOD作成時、縮退で許容する誤差の最大 (バウンディングボックスの対角線の長さに対する割合).
+	const double SIMPLIFY_MAX_ERROR_RATIO = 0.05;
+
+	// LOD作成時、縮退の処理を繰り返す最大回数.
+	const int SIMPLIFY_MAX_PASSES = 100;
+
+	// 境界の辺に垂直な面の誤差の重み (境界の形状を維持しやすくする).
+	const double SIMPLIFY_BORDER_WEIGHT = 10.0;
+
+	/**
+	 * 頂点ごとの誤差の二次形式 (Garland and Heckbert, "Surface Simplification Using Quadric Error Metrics").
+	 * 面積で重み付けした平面までの距離の2乗の和を保持する.
+	 */
+	class CQuadric
+	{
+	public:
+		double a00, a01, a02, a11, a12, a22;
+		double b0, b1, b2;
+		double c;
+		double weight;
+
+	public:
+		CQuadric () {
+			clear();
+		}
+
+		void clear () {
+			a00 = a01 = a02 = a11 = a12 = a22 = 0.0;
+			b0 = b1 = b2 = 0.0;
+			c = 0.0;
+			weight = 0.0;
+		}
+
+		/**
+		 * 平面 (nx * x + ny * y + nz * z + d = 0) を追加.
+		 */
+		void addPlane (const double nx, const double ny, const double nz, const double d, const double w) {
+			a00 += w * nx * nx;
+			a01 += w * nx * ny;
+			a02 += w * nx * nz;
+			a11 += w * ny * ny;
+			a12 += w * ny * nz;
+			a22 += w * nz * nz;
+			b0  += w * nx * d;
+			b1  += w * ny * d;
+			b2  += w * nz * d;
+			c   += w * d * d;
+			weight += w;
+		}
+
+		void add (const CQuadric& v) {
+			a00 += v.a00;  a01 += v.a01;  a02 += v.a02;
+			a11 += v.a11;  a12 += v.a12;  a22 += v.a22;
+			b0  += v.b0;   b1  += v.b1;   b2  += v.b2;
+			c   += v.c;
+			weight += v.weight;
+		}
+
+		/**
+		 * 指定の位置での誤差 (重みで正規化した、平面までの距離の2乗).
+		 */
+		double calcError (const sxsdk::vec3& p) const {
+			if (weight <= 0.0) return 0.0;
+			const double x = p.x;
+			const double y = p.y;
+			const double z = p.z;
+			const double e = a00 * x * x + a11 * y * y + a22 * z * z
+			               + 2.0 * (a01 * x * y + a02 * x * z + a12 * y * z)
+			               + 2.0 * (b0 * x + b1 * y + b2 * z) + c;
+			return fabs(e) / weight;
+		}
+	};
+
+	/**
+	 * 位置ごとの辺 (縮退候補の判定用).
+	 */
+	class CSimplifyEdge
+	{
+	public:
+		int pos0, pos1;			// 辺の両端の位置番号 (pos0 < pos1).
+		int group;				// 三角形が属するグループ (Primitive番号).
+		int triangleIndex;		// 三角形番号.
+		bool forward;			// 三角形の向きでpos0 => pos1の場合はtrue.
+
+		bool operator < (const CSimplifyEdge& v) const {
+			if (pos0 != v.pos0) return pos0 < v.pos0;
+			if (pos1 != v.pos1) return pos1 < v.pos1;
+			return group < v.group;
+		}
+	};
+
+	/**
+	 * 縮退の候補 (位置fromPosをtoPosに移動).
+	 */
+	class CSimplifyCollapse
+	{
+	public:
+		int fromPos, toPos;
+		double cost;
+
+		bool operator < (const CSimplifyCollapse& v) const {
+			if (cost != v.cost) return cost < v.cost;
+			if (fromPos != v.fromPos) return fromPos < v.fromPos;
+			return toPos < v.toPos;
+		}
+	};
+
+	/**
+	 * 三角形の法線 (正規化しない).
+	 */
+	sxsdk::vec3 calcTriangleNormal (const sxsdk::vec3& p0, const sxsdk::vec3& p1, const sxsdk::vec3& p2) {
+		const sxsdk::vec3 e1 = p1 - p0;
+		const sxsdk::vec3 e2 = p2 - p0;
+		return sxsdk::vec3(e1.y * e2.z - e1.z * e2.y, e1.z * e2.x - e1.x * e2.z, e1.x * e2.y - e1.y * e2.x);
+	}
+
+	/**
+	 * 辺の縮退で三角形数を削減.
+	 * 縮退は辺の片方の頂点を、もう片方の頂点に合わせる (新しい頂点は作らない).
+	 * @param[in]     positions        頂点座標.
+	 * @param[in,out] triangleIndices  三角形の頂点インデックス.
+	 * @param[in,out] triangleGroups   三角形ごとのグループ (Primitive番号). グループの境界は維持する.
+	 * @param[in]     targetTrianglesCount  目標の三角形数.
+	 * @param[in]     maxError         許容する誤差の最大 (距離).
+	 */
+	void simplifyTriangles (const std::vector<sxsdk::vec3>& positions, std::vector<int>& triangleIndices, std::vector<int>& triangleGroups, const size_t targetTrianglesCount, const double maxError) {
+		const int versCou = (int)positions.size();
+		if (versCou == 0) return;
+
+		// 同一位置の頂点をまとめる.
+		// posIndex[i]は頂点iと同じ位置の頂点のうち、先頭の頂点番号.
+		std::vector<int> posIndex(versCou);
+		{
+			std::vector<int> sortedList(versCou);
+			for (int i = 0; i < versCou; ++i) sortedList[i] = i;
+			std::sort(sortedList.begin(), sortedList.end(), [&](const int a, const int b) {
+				const sxsdk::vec3& pA = positions[a];
+				const sxsdk::vec3& pB = positions[b];
+				if (pA.x != pB.x) return pA.x < pB.x;
+				if (pA.y != pB.y) return pA.y < pB.y;
+				if (pA.z != pB.z) return pA.z < pB.z;
+				return a < b;
+			});
+			int headIndex = sortedList[0];
+			for (int i = 0; i < versCou; ++i) {
+				const int vIndex = sortedList[i];
+				const sxsdk::vec3& p0 = positions[headIndex];
+				const sxsdk::vec3& p1 = positions[vIndex];
+				if (p0.x != p1.x || p0.y != p1.y || p0.z != p1.z) headIndex = vIndex;
+				posIndex[vIndex] = headIndex;
+			}
+		}
+
+		// 位置ごとの、同じ位置の頂点のリスト.
+		std::vector<int> wedgeOffsets(versCou + 1, 0);
+		std::vector<int> wedgeList(versCou);
+		{
+			for (int i = 0; i < versCou; ++i) wedgeOffsets[posIndex[i] + 1]++;
+			for (int i = 0; i < versCou; ++i) wedgeOffsets[i + 1] += wedgeOffsets[i];
+			std::vector<int> fillPos(wedgeOffsets.begin(), wedgeOffsets.end() - 1);
+			for (int i = 0; i < versCou; ++i) wedgeList[fillPos[posIndex[i]]++] = i;
+		}
+
+		// 三角形の面から、位置ごとの誤差の二次形式を計算.
+		std::vector<CQuadric> quadrics(versCou);
+		for (size_t i = 0; i + 2 < triangleIndices.size(); i += 3) {
+			const sxsdk::vec3& p0 = positions[triangleIndices[i + 0]];
+			const sxsdk::vec3& p1 = positions[triangleIndices[i + 1]];
+			const sxsdk::vec3& p2 = positions[triangleIndices[i + 2]];
+			const sxsdk::vec3 n = calcTriangleNormal(p0, p1, p2);
+			const double len = sqrt((double)n.x * n.x + (double)n.y * n.y + (double)n.z * n.z);
+			if (len <= 0.0) continue;
+			const double nx = n.x / len;
+			const double ny = n.y / len;
+			const double nz = n.z / len;
+			const double d  = -(nx * p0.x + ny * p0.y + nz * p0.z);
+			const double area = len * 0.5;
+			for (int j = 0; j < 3; ++j) quadrics[posIndex[triangleIndices[i + j]]].addPlane(nx, ny, nz, d, area);
+		}
+
+		const double maxCost = maxError * maxError;
+		size_t trisCou = triangleIndices.size() / 3;
+
+		std::vector<CSimplifyEdge> edgeList;
+		std::vector<uint64_t> borderEdges;
+		std::vector<int> borderCount(versCou);
+		std::vector<int> triangleOffsets(versCou + 1);
+		std::vector<int> vertexTriangles;
+		std::vector<CSimplifyCollapse> collapseList;
+		std::vector<bool> lockedList(versCou);
+		std::vector<int> vertexRemap(versCou);
+		std::vector< std::pair<int, int> > wedgeMap;
+
+		for (int pass = 0; pass < SIMPLIFY_MAX_PASSES && trisCou > targetTrianglesCount; ++pass) {
+			// 位置ごとの辺を、三角形のグループ単位で集める.
+			edgeList.clear();
+			for (size_t i = 0; i < trisCou; ++i) {
+				for (int j = 0; j < 3; ++j) {
+					const int pA = posIndex[triangleIndices[i * 3 + j]];
+					const int pB = posIndex[triangleIndices[i * 3 + ((j + 1) % 3)]];
+					CSimplifyEdge edge;
+					edge.pos0          = std::min(pA, pB);
+					edge.pos1          = std::max(pA, pB);
+					edge.group         = triangleGroups[i];
+					edge.triangleIndex = (int)i;
+					edge.forward       = (pA < pB);
+					edgeList.push_back(edge);
+				}
+			}
+			std::sort(edgeList.begin(), edgeList.end());
+
+			// 同一グループ内で、逆向きの辺が1つだけ存在しない辺を境界とする.
+			// メッシュの境界、グループ(マテリアル)の境界、非多様体の辺が該当する.
+			borderEdges.clear();
+			for (size_t i = 0; i < edgeList.size(); ) {
+				size_t j = i;
+				int forwardCou = 0;
+				int backwardCou = 0;
+				while (j < edgeList.size() && edgeList[j].pos0 == edgeList[i].pos0 && edgeList[j].pos1 == edgeList[i].pos1 && edgeList[j].group == edgeList[i].group) {
+					if (edgeList[j].forward) forwardCou++;
+					else backwardCou++;
+					j++;
+				}
+				if (forwardCou != 1 || backwardCou != 1) {
+					const CSimplifyEdge& edge = edgeList[i];
+					borderEdges.push_back(((uint64_t)edge.pos0 << 32) | (uint64_t)edge.pos1);
+
+					// 最初に、境界の辺に垂直な面を誤差に加える.
+					if (pass == 0 && edge.pos0 != edge.pos1) {
+						const int* pI = &triangleIndices[edge.triangleIndex * 3];
+						const sxsdk::vec3 n = calcTriangleNormal(positions[pI[0]], positions[pI[1]], positions[pI[2]]);
+						const sxsdk::vec3& p0 = positions[edge.pos0];
+						const sxsdk::vec3 e = positions[edge.pos1] - p0;
+						const sxsdk::vec3 bn(e.y * n.z - e.z * n.y, e.z * n.x - e.x * n.z, e.x * n.y - e.y * n.x);
+						const double len = sqrt((double)bn.x * bn.x + (double)bn.y * bn.y + (double)bn.z * bn.z);
+						if (len > 0.0) {
+							const double nx = bn.x / len;
+							const double ny = bn.y / len;
+							const double nz = bn.z / len;
+							const double d  = -(nx * p0.x + ny * p0.y + nz * p0.z);
+							const double w  = ((double)e.x * e.x + (double)e.y * e.y + (double)e.z * e.z) * SIMPLIFY_BORDER_WEIGHT;
+							quadrics[edge.pos0].addPlane(nx, ny, nz, d, w);
+							quadrics[edge.pos1].addPlane(nx, ny, nz, d, w);
+						}
+					}
+				}
+				i = j;
+			}
+			std::sort(borderEdges.begin(), borderEdges.end());
+			borderEdges.erase(std::unique(borderEdges.begin(), borderEdges.end()), borderEdges.end());
+
+			// 位置ごとの、境界の辺でつながる位置の数.
+			// 3以上の場合は境界が分岐する角となるため、移動させない.
+			borderCount.assign(versCou, 0);
+			for (size_t i = 0; i < borderEdges.size(); ++i) {
+				borderCount[(int)(borderEdges[i] >> 32)]++;
+				borderCount[(int)(borderEdges[i] & 0xffffffff)]++;
+			}
+
+			// 頂点ごとの、参照する三角形番号のリスト.
+			triangleOffsets.assign(versCou + 1, 0);
+			for (size_t i = 0; i < trisCou * 3; ++i) triangleOffsets[triangleIndices[i] + 1]++;
+			for (int i = 0; i < versCou; ++i) triangleOffsets[i + 1] += triangleOffsets[i];
+			vertexTriangles.resize(trisCou * 3);
+			{
+				std::vector<int> fillPos(triangleOffsets.begin(), triangleOffsets.end() - 1);
+				for (size_t i = 0; i < trisCou * 3; ++i) vertexTriangles[fillPos[triangleIndices[i]]++] = (int)(i / 3);
+			}
+
+			// 縮退の候補を誤差の小さい順に並べる.
+			collapseList.clear();
+			for (size_t i = 0; i < edgeList.size(); ++i) {
+				const CSimplifyEdge& edge = edgeList[i];
+				if (edge.pos0 == edge.pos1) continue;
+				if (i > 0 && edgeList[i - 1].pos0 == edge.pos0 && edgeList[i - 1].pos1 == edge.pos1) continue;
+
+				const bool borderEdgeF = std::binary_search(borderEdges.begin(), borderEdges.end(), ((uint64_t)edge.pos0 << 32) | (uint64_t)edge.pos1);
+				for (int j = 0; j < 2; ++j) {
+					const int fromPos = (j == 0) ? edge.pos0 : edge.pos1;
+					const int toPos   = (j == 0) ? edge.pos1 : edge.pos0;
+
+					// 境界上の位置は、境界の辺に沿ってのみ移動できる.
+					if (borderCount[fromPos] > 2) continue;
+					if (borderCount[fromPos] > 0 && !borderEdgeF) continue;
+
+					const double cost = quadrics[fromPos].calcError(positions[toPos]);
+					if (cost > maxCost) continue;
+
+					CSimplifyCollapse collapse;
+					collapse.fromPos = fromPos;
+					collapse.toPos   = toPos;
+					collapse.cost    = cost;
+					collapseList.push_back(collapse);
+				}
+			}
+			if (collapseList.empty()) break;
+			std::sort(collapseList.begin(), collapseList.end());
+
+			// 誤差の小さい順に縮退.
+			// 1回の処理では、縮退で変化する三角形が重ならないように周囲の位置をロックする.
+			lockedList.assign(versCou, false);
+			for (int i = 0; i < versCou; ++i) vertexRemap[i] = i;
+			int collapseCou = 0;
+			for (size_t i = 0; i < collapseList.size() && trisCou > targetTrianglesCount; ++i) {
+				const int fromPos = collapseList[i].fromPos;
+				const int toPos   = collapseList[i].toPos;
+				if (lockedList[fromPos] || lockedList[toPos]) continue;
+
+				// fromPosの頂点ごとに、三角形で隣接するtoPosの頂点を移動先とする.
+				// 移動先が1つに決まらない場合(UVの不連続な辺をまたぐ場合など)は縮退しない.
+				wedgeMap.clear();
+				bool validF = true;
+				for (int j = wedgeOffsets[fromPos]; j < wedgeOffsets[fromPos + 1] && validF; ++j) {
+					const int vIndex = wedgeList[j];
+					if (triangleOffsets[vIndex] == triangleOffsets[vIndex + 1]) continue;
+					int toIndex = -1;
+					for (int k = triangleOffsets[vIndex]; k < triangleOffsets[vIndex + 1] && validF; ++k) {
+						const int* pI = &triangleIndices[vertexTriangles[k] * 3];
+						for (int m = 0; m < 3; ++m) {
+							if (posIndex[pI[m]] != toPos) continue;
+							if (toIndex < 0) toIndex = pI[m];
+							else if (toIndex != pI[m]) validF = false;
+						}
+					}
+					if (toIndex < 0) validF = false;
+					if (validF) wedgeMap.push_back(std::make_pair(vIndex, toIndex));
+				}
+				if (!validF || wedgeMap.empty()) continue;
+
+				// 縮退で三角形が裏返る場合は縮退しない.
+				int removeTrisCou = 0;
+				for (size_t j = 0; j < wedgeMap.size() && validF; ++j) {
+					const int vIndex = wedgeMap[j].first;
+					for (int k = triangleOffsets[vIndex]; k < triangleOffsets[vIndex + 1]; ++k) {
+						const int* pI = &triangleIndices[vertexTriangles[k] * 3];
+						if (posIndex[pI[0]] == toPos || posIndex[pI[1]] == toPos || posIndex[pI[2]] == toPos) {
+							removeTrisCou++;
+							continue;
+						}
+						sxsdk::vec3 p[3];
+						for (int m = 0; m < 3; ++m) p[m] = positions[pI[m]];
+						const sxsdk::vec3 n0 = calcTriangleNormal(p[0], p[1], p[2]);
+						for (int m = 0; m < 3; ++m) {
+							if (pI[m] == vIndex) p[m] = positions[toPos];
+						}
+						const sxsdk::vec3 n1 = calcTriangleNormal(p[0], p[1], p[2]);
+						const double dotV = (double)n0.x * n1.x + (double)n0.y * n1.y + (double)n0.z * n1.z;
+						const double len0 = sqrt((double)n0.x * n0.x + (double)n0.y * n0.y + (double)n0.z * n0.z);
+						const double len1 = sqrt((double)n1.x * n1.x + (double)n1.y * n1.y + (double)n1.z * n1.z);
+						if (dotV < 0.25 * len0 * len1) {
+							validF = false;
+							break;
+						}
+					}
+				}
+				if (!validF) continue;
+
+				for (size_t j = 0; j < wedgeMap.size(); ++j) vertexRemap[wedgeMap[j].first] = wedgeMap[j].second;
+				quadrics[toPos].add(quadrics[fromPos]);
+
+				lockedList[fromPos] = true;
+				lockedList[toPos]   = true;
+				for (size_t j = 0; j < wedgeMap.size(); ++j) {
+					const int vIndex = wedgeMap[j].first;
+					for (int k = triangleOffsets[vIndex]; k < triangleOffsets[vIndex + 1]; ++k) {
+						const int* pI = &triangleIndices[vertexTriangles[k] * 3];
+						for (int m = 0; m < 3; ++m) lockedList[posIndex[pI[m]]] = true;
+					}
+				}
+
+				trisCou -= std::min((size_t)removeTrisCou, trisCou);
+				collapseCou++;
+			}
+			if (collapseCou == 0) break;
+
+			// 頂点番号を置き換えて、位置が縮退した三角形を除く.
+			size_t dstPos = 0;
+			for (size_t i = 0; i + 2 < triangleIndices.size(); i += 3) {
+				const int i0 = vertexRemap[triangleIndices[i + 0]];
+				const int i1 = vertexRemap[triangleIndices[i + 1]];
+				const int i2 = vertexRemap[triangleIndices[i + 2]];
+				const int p0 = posIndex[i0];
+				const int p1 = posIndex[i1];
+				const int p2 = posIndex[i2];
+				if (p0 == p1 || p1 == p2 || p2 == p0) continue;
+				triangleGroups[dstPos / 3] = triangleGroups[i / 3];
+				triangleIndices[dstPos + 0] = i0;
+				triangleIndices[dstPos + 1] = i1;
+				triangleIndices[dstPos + 2] = i2;
+				dstPos += 3;
+			}
+			triangleIndices.resize(dstPos);
+			triangleGroups.resize(dstPos / 3);
+			trisCou = dstPos / 3;
+		}
+	}
+
+	/**
+	 * 参照されない頂点を除いて、頂点ごとの配列を詰める.
+	 * @param[in] vertexRemap   calcVertexFetchRemapで求めた頂点番号の置き換え.
+	 * @param[in] usedCount     参照される頂点数.
+	 */
+	template<typename T> void compactVertexArray (std::vector<T>& data, const std::vector<int>& vertexRemap, const size_t usedCount) {
+		if (data.empty() || data.size() != vertexRemap.size()) return;
+		remapVertexArray(data, vertexRemap);
+		data.resize(usedCount);
+	}
+}
+
+/**
+ * FIFOの頂点キャッシュを想定した、キャッシュのミス数を計算.
+ */
+size_t MeshOptimizer::calcCacheMissesCount (const std::vector<int>& triangleIndices, const size_t verticesCount, const int cacheSize)
+{
+	// 頂点ごとに、キャッシュに入ったときのタイムスタンプを保持.
+	// 現在のタイムスタンプとの差がcacheSize以内であれば、キャッシュに残っている.
+	std::vector<size_t> timeStamps(verticesCount, 0);
+	size_t curTime = (size_t)cacheSize + 1;
+	size_t missesCou = 0;
+	for (size_t i = 0; i < triangleIndices.size(); ++i) {
+		const int vIndex = triangleIndices[i];
+		if (vIndex < 0 || vIndex >= (int)verticesCount) continue;
+		if (curTime - timeStamps[vIndex] > (size_t)cacheSize) {
+			timeStamps[vIndex] = curTime++;
+			missesCou++;
+		}
+	}
+	return missesCou;
+}
+
+/**
+ * 頂点キャッシュの効率が良くなるように三角形を並び替え (Forsythのアルゴリズム).
+ */
+void MeshOptimizer::optimizeVertexCache (std::vector<int>& triangleIndices, const size_t verticesCount)
+{
+	const size_t triCou = triangleIndices.size() / 3;
+	if (triCou <= 1 || !checkIndices(triangleIndices, verticesCount)) return;
+
+	// 頂点ごとの、参照する三角形番号のリスト.
+	// vertexTriangles[triangleOffsets[i]] - vertexTriangles[triangleOffsets[i] + remainingCount[i] - 1]が、頂点iを参照する未出力の三角形.
+	std::vector<int> triangleOffsets(verticesCount + 1, 0);
+	std::vector<int> remainingCount(verticesCount, 0);
+	std::vector<int> vertexTriangles(triCou * 3);
+	for (size_t i = 0; i < triCou * 3; ++i) remainingCount[triangleIndices[i]]++;
+	for (size_t i = 0; i < verticesCount; ++i) triangleOffsets[i + 1] = triangleOffsets[i] + remainingCount[i];
+	{
+		std::vector<int> fillPos(triangleOffsets.begin(), triangleOffsets.end() - 1);
+		for (size_t i = 0; i < triCou * 3; ++i) vertexTriangles[fillPos[triangleIndices[i]]++] = (int)(i / 3);
+	}
+
+	std::vector<int> cachePos(verticesCount, -1);
+	std::vector<float> vertexScores(verticesCount, 0.0f);
+	for (size_t i = 0; i < verticesCount; ++i) vertexScores[i] = calcVertexScore(-1, remainingCount[i]);
+
+	std::vector<bool> emittedList(triCou, false);
+	int bestTriangle = -1;
+	float bestScore  = -1.0f;
+	for (size_t i = 0; i < triCou; ++i) {
+		const int* pI = &triangleIndices[i * 3];
+		const float score = vertexScores[pI[0]] + vertexScores[pI[1]] + vertexScores[pI[2]];
+		if (score > bestScore) {
+			bestScore    = score;
+			bestTriangle = (int)i;
+		}
+	}
+
+	std::vector<int> newIndices;
+	newIndices.reserve(triCou * 3);
+	std::vector<int> cache, newCache;
+	cache.reserve(VERTEX_CACHE_SIZE + 3);
+	newCache.reserve(VERTEX_CACHE_SIZE + 3);
+	size_t scanPos = 0;
+
+	for (size_t loop = 0; loop < triCou; ++loop) {
+		// キャッシュ内の頂点から候補が見つからない場合は、未出力の三角形を先頭から探す.
+		if (bestTriangle < 0) {
+			while (emittedList[scanPos]) scanPos++;
+			bestTriangle = (int)scanPos;
+		}
+
+		const int* pI = &triangleIndices[bestTriangle * 3];
+		emittedList[bestTriangle] = true;
+
+		// 出力した三角形を、頂点ごとの未出力の三角形リストから除く.
+		newCache.clear();
+		for (int j = 0; j < 3; ++j) {
+			const int vIndex = pI[j];
+			newIndices.push_back(vIndex);
+			newCache.push_back(vIndex);
+
+			int* pTris = &vertexTriangles[triangleOffsets[vIndex]];
+			const int cou = remainingCount[vIndex];
+			for (int k = 0; k < cou; ++k) {
+				if (pTris[k] == bestTriangle) {
+					std::swap(pTris[k], pTris[cou - 1]);
+					break;
+				}
+			}
+			remainingCount[vIndex]--;
+		}
+
+		// 三角形の頂点をキャッシュの先頭に入れる (LRU).
+		for (size_t j = 0; j < cache.size(); ++j) {
+			const int vIndex = cache[j];
+			if (vIndex != pI[0] && vIndex != pI[1] && vIndex != pI[2]) newCache.push_back(vIndex);
+		}
+		cache.swap(newCache);
+
+		// キャッシュ内の頂点のスコアを更新。あふれた頂点はキャッシュから除く.
+		for (size_t j = 0; j < cache.size(); ++j) {
+			const int vIndex = cache[j];
+			cachePos[vIndex] = (j < (size_t)VERTEX_CACHE_SIZE) ? (int)j : -1;
+			vertexScores[vIndex] = calcVertexScore(cachePos[vIndex], remainingCount[vIndex]);
+		}
+
+		// キャッシュ内の頂点を参照する三角形から、次に出力する三角形を探す.
+		bestTriangle = -1;
+		bestScore    = -1.0f;
+		for (size_t j = 0; j < cache.size(); ++j) {
+			const int vIndex = cache[j];
+			const int* pTris = &vertexTriangles[triangleOffsets[vIndex]];
+			for (int k = 0; k < remainingCount[vIndex]; ++k) {
+				const int triIndex = pTris[k];
+				const int* pI2 = &triangleIndices[triIndex * 3];
+				const float score = vertexScores[pI2[0]] + vertexScores[pI2[1]] + vertexScores[pI2[2]];
+				if (score > bestScore) {
+					bestScore    = score;
+					bestTriangle = triIndex;
+				}
+			}
+		}
+		if (cache.size() > (size_t)VERTEX_CACHE_SIZE) cache.resize(VERTEX_CACHE_SIZE);
+	}
+
+	triangleIndices.swap(newIndices);
+}
+
+/**
+ * 三角形から参照される順に、頂点の並びを決める.
+ */
+void MeshOptimizer::calcVertexFetchRemap (const std::vector<const std::vector<int>*>& indicesList, const size_t verticesCount, std::vector<int>& vertexRemap)
+{
+	vertexRemap.assign(verticesCount, -1);
+	int newIndex = 0;
+	for (size_t i = 0; i < indicesList.size(); ++i) {
+		const std::vector<int>& indices = *(indicesList[i]);
+		for (size_t j = 0; j < indices.size(); ++j) {
+			const int vIndex = indices[j];
+			if (vIndex < 0 || vIndex >= (int)verticesCount) continue;
+			if (vertexRemap[vIndex] < 0) vertexRemap[vIndex] = newIndex++;
+		}
+	}
+	for (size_t i = 0; i < verticesCount; ++i) {
+		if (vertexRemap[i] < 0) vertexRemap[i] = newIndex++;
+	}
+}
+
+/**
+ * メッシュの三角形と頂点を、頂点キャッシュと頂点フェッチの効率が良くなるように並び替え.
+ */
+void MeshOptimizer::optimizeMeshVertexOrder (CMeshData& meshData, CVertexCacheStats& stats)
+{
+	stats.clear();
+	const size_t primCou = meshData.primitives.size();
+
+	std::vector<const std::vector<int>*> indicesList;
+	std::vector<int> vertexRemap;
+	std::vector<bool> useVertexList;
+
+	for (size_t primLoop = 0; primLoop < primCou; ++primLoop) {
+		CPrimitiveData& primD = meshData.primitives[primLoop];
+		if (primD.vertices.empty()) continue;		// 0番目のPrimitiveの頂点を共有している.
+		const size_t versCou = primD.vertices.size();
+
+		// 頂点を共有するPrimitive.
+		std::vector<CPrimitiveData*> sharedPrimitives;
+		sharedPrimitives.push_back(&primD);
+		if (primLoop == 0) {
+			for (size_t i = 1; i < primCou; ++i) {
+				if (meshData.primitives[i].vertices.empty()) sharedPrimitives.push_back(&(meshData.primitives[i]));
+			}
+		}
+
+		bool validF = true;
+		for (size_t i = 0; i < sharedPrimitives.size(); ++i) {
+			if (!checkIndices(sharedPrimitives[i]->triangleIndices, versCou)) validF = false;
+		}
+		if (!validF) continue;
+
+		// 三角形を並び替え.
+		useVertexList.assign(versCou, false);
+		indicesList.clear();
+		for (size_t i = 0; i < sharedPrimitives.size(); ++i) {
+			std::vector<int>& triangleIndices = sharedPrimitives[i]->triangleIndices;
+			stats.trianglesCount    += triangleIndices.size() / 3;
+			stats.cacheMissesBefore += calcCacheMissesCount(triangleIndices, versCou);
+
+			optimizeVertexCache(triangleIndices, versCou);
+
+			stats.cacheMissesAfter += calcCacheMissesCount(triangleIndices, versCou);
+			for (size_t j = 0; j < triangleIndices.size(); ++j) useVertexList[triangleIndices[j]] = true;
+			indicesList.push_back(&triangleIndices);
+		}
+		for (size_t i = 0; i < versCou; ++i) {
+			if (useVertexList[i]) stats.verticesCount++;
+		}
+
+		// 頂点を参照順に並び替え.
+		calcVertexFetchRemap(indicesList, versCou, vertexRemap);
+		for (size_t i = 0; i < sharedPrimitives.size(); ++i) remapIndices(sharedPrimitives[i]->triangleIndices, vertexRemap);
+
+		remapVertexArray(primD.vertices, vertexRemap);
+		remapVertexArray(primD.normals, vertexRemap);
+		remapVertexArray(primD.uv0, vertexRemap);
+		remapVertexArray(primD.uv1, vertexRemap);
+		remapVertexArray(primD.color0, vertexRemap);
+		remapVertexArray(primD.tangents, vertexRemap);
+		remapVertexArray(primD.skinWeights, vertexRemap);
+		remapVertexArray(primD.skinJoints, vertexRemap);
+		remapVertexArray(primD.skinJointsHandle, vertexRemap);
+
+		// Morph Targetsは参照する頂点番号のみを置き換える.
+		std::vector<COneMorphTargetData>& targets = primD.morphTargets.morphTargetsData;
+		for (size_t i = 0; i < targets.size(); ++i) remapIndices(targets[i].vIndices, vertexRemap);
+	}
+}
+
+/**
+ * QEM(Quadric Error Metrics)で三角形数を削減したメッシュを作成 (LOD用).
+ */
+bool MeshOptimizer::simplifyMesh (const CMeshData& meshData, const float ratio, CMeshData& dstMeshData)
+{
+	const size_t primCou = meshData.primitives.size();
+	if (primCou == 0 || ratio <= 0.0f || ratio >= 1.0f) return false;
+
+	for (size_t i = 0; i < primCou; ++i) {
+		if (!meshData.primitives[i].morphTargets.morphTargetsData.empty()) return false;
+	}
+
+	// メッシュ全体の頂点を1つにまとめる.
+	// 頂点を共有しているPrimitive(1番目以降で頂点が空)は、0番目のPrimitiveの頂点を参照する.
+	std::vector<int> ownerList(primCou);
+	std::vector<int> offsetList(primCou, 0);
+	std::vector<sxsdk::vec3> positions;
+	for (size_t i = 0; i < primCou; ++i) {
+		const CPrimitiveData& primD = meshData.primitives[i];
+		ownerList[i] = (i > 0 && primD.vertices.empty()) ? 0 : (int)i;
+		if (ownerList[i] != (int)i) continue;
+		offsetList[i] = (int)positions.size();
+		positions.insert(positions.end(), primD.vertices.begin(), primD.vertices.end());
+	}
+
+	std::vector<int> triangleIndices;
+	std::vector<int> triangleGroups;
+	sxsdk::vec3 bbMin(0, 0, 0), bbMax(0, 0, 0);
+	for (size_t i = 0; i < primCou; ++i) {
+		const CPrimitiveData& ownerD = meshData.primitives[ownerList[i]];
+		const std::vector<int>& indices = meshData.primitives[i].triangleIndices;
+		if (indices.empty() || !checkIndices(indices, ownerD.vertices.size())) return false;
+
+		for (size_t j = 0; j < indices.size(); ++j) {
+			const int vIndex = offsetList[ownerList[i]] + indices[j];
+			const sxsdk::vec3& p = positions[vIndex];
+			if (triangleIndices.empty()) {
+				bbMin = bbMax = p;
+			} else {
+				bbMin.x = std::min(bbMin.x, p.x);  bbMin.y = std::min(bbMin.y, p.y);  bbMin.z = std::min(bbMin.z, p.z);
+				bbMax.x = std::max(bbMax.x, p.x);  bbMax.y = std::max(bbMax.y, p.y);  bbMax.z = std::max(bbMax.z, p.z);
+			}
+			triangleIndices.push_back(vIndex);
+		}
+		triangleGroups.insert(triangleGroups.end(), indices.size() / 3, (int)i);
+	}
+
+	const size_t srcTrisCou = triangleIndices.size() / 3;
+	const size_t targetTrisCou = (size_t)((double)srcTrisCou * (double)ratio);
+	if (targetTrisCou == 0) return false;
+
+	const sxsdk::vec3 bbSize = bbMax - bbMin;
+	const double diagonal = sqrt((double)bbSize.x * bbSize.x + (double)bbSize.y * bbSize.y + (double)bbSize.z * bbSize.z);
+	simplifyTriangles(positions, triangleIndices, triangleGroups, targetTrisCou, diagonal * SIMPLIFY_MAX_ERROR_RATIO);
+
+	// 三角形数がほとんど減らない場合は、LODとして使わない.
+	const size_t dstTrisCou = triangleIndices.size() / 3;
+	if (dstTrisCou == 0 || (double)dstTrisCou > (double)srcTrisCou * std::min(1.0, (double)ratio * 1.5)) return false;
+
+	dstMeshData = meshData;
+	for (size_t i = 0; i < primCou; ++i) dstMeshData.primitives[i].triangleIndices.clear();
+	for (size_t i = 0; i < dstTrisCou; ++i) {
+		const int primIndex = triangleGroups[i];
+		std::vector<int>& indices = dstMeshData.primitives[primIndex].triangleIndices;
+		const int offset = offsetList[ownerList[primIndex]];
+		for (int j = 0; j < 3; ++j) indices.push_back(triangleIndices[i * 3 + j] - offset);
+	}
+
+	// 三角形がなくなったPrimitiveがある場合は、マテリアルが欠けるためLODとして使わない.
+	for (size_t i = 0; i < primCou; ++i) {
+		if (dstMeshData.primitives[i].triangleIndices.empty()) return false;
+	}
+
+	// 参照されなくなった頂点を除く.
+	std::vector<const std::vector<int>*> indicesList;
+	std::vector<int> vertexRemap;
+	for (size_t primLoop = 0; primLoop < primCou; ++primLoop) {
+		if (ownerList[primLoop] != (int)primLoop) continue;
+		CPrimitiveData& primD = dstMeshData.primitives[primLoop];
+		const size_t versCou = primD.vertices.size();
+
+		indicesList.clear();
+		for (size_t i = 0; i < primCou; ++i) {
+			if (ownerList[i] == (int)primLoop) indicesList.push_back(&(dstMeshData.primitives[i].triangleIndices));
+		}
+		calcVertexFetchRemap(indicesList, versCou, vertexRemap);
+
+		std::vector<bool> useVertexList(versCou, false);
+		for (size_t i = 0; i < indicesList.size(); ++i) {
+			const std::vector<int>& indices = *(indicesList[i]);
+			for (size_t j = 0; j < indices.size(); ++j) useVertexList[indices[j]] = true;
+		}
+		size_t usedCou = 0;
+		for (size_t i = 0; i < versCou; ++i) {
+			if (useVertexList[i]) usedCou++;
+		}
+
+		for (size_t i = 0; i < primCou; ++i) {
+			if (ownerList[i] == (int)primLoop) remapIndices(dstMeshData.primitives[i].triangleIndices, vertexRemap);
+		}
+		compactVertexArray(primD.vertices, vertexRemap, usedCou);
+		compactVertexArray(primD.normals, vertexRemap, usedCou);
+		compactVertexArray(primD.uv0, vertexRemap, usedCou);
+		compactVertexArray(primD.uv1, vertexRemap, usedCou);
+		compactVertexArray(primD.color0, vertexRemap, usedCou);
+		compactVertexArray(primD.tangents, vertexRemap, usedCou);
+		compactVertexArray(primD.skinWeights, vertexRemap, usedCou);
+		compactVertexArray(primD.skinJoints, vertexRemap, usedCou);
+		compactVertexArray(primD.skinJointsHandle, vertexRemap, usedCou);
+	}
+
+	return true;
+}
@@ -0,0 +1,96 @@
+﻿/**
+ * エクスポート時のメッシュの最適化.
+ * Shade3DのAPIは使用していないため、メッシュごとに複数スレッドから同時に呼び出すことができる.
+ */
+#ifndef _MESHOPTIMIZER_H
+#define _MESHOPTIMIZER_H
+
+#include "MeshData.h"
+
+#include <vector>
+
+/**
+ * 頂点キャッシュの効率の計測結果.
+ * ACMR = 頂点キャッシュのミス数 / 三角形数、ATVR = 頂点キャッシュのミス数 / 頂点数.
+ */
+class CVertexCacheStats
+{
+public:
+	size_t trianglesCount;			// 三角形数.
+	size_t verticesCount;			// 三角形から参照される頂点数.
+	size_t cacheMissesBefore;		// 最適化前の頂点キャッシュのミス数.
+	size_t cacheMissesAfter;		// 最適化後の頂点キャッシュのミス数.
+
+public:
+	CVertexCacheStats () {
+		clear();
+	}
+
+	void clear () {
+		trianglesCount    = 0;
+		verticesCount     = 0;
+		cacheMissesBefore = 0;
+		cacheMissesAfter  = 0;
+	}
+
+	void add (const CVertexCacheStats& v) {
+		trianglesCount    += v.trianglesCount;
+		verticesCount     += v.verticesCount;
+		cacheMissesBefore += v.cacheMissesBefore;
+		cacheMissesAfter  += v.cacheMissesAfter;
+	}
+
+	float getACMRBefore () const { return (trianglesCount > 0) ? (float)cacheMissesBefore / (float)trianglesCount : 0.0f; }
+	float getACMRAfter () const { return (trianglesCount > 0) ? (float)cacheMissesAfter / (float)trianglesCount : 0.0f; }
+	float getATVRBefore () const { return (verticesCount > 0) ? (float)cacheMissesBefore / (float)verticesCount : 0.0f; }
+	float getATVRAfter () const { return (verticesCount > 0) ? (float)cacheMissesAfter / (float)verticesCount : 0.0f; }
+};
+
+namespace MeshOptimizer {
+	/**
+	 * FIFOの頂点キャッシュを想定した、キャッシュのミス数を計算.
+	 * @param[in] triangleIndices  三角形の頂点インデックス.
+	 * @param[in] verticesCount    頂点数.
+	 * @param[in] cacheSize        頂点キャッシュのサイズ.
+	 */
+	size_t calcCacheMissesCount (const std::vector<int>& triangleIndices, const size_t verticesCount, const int cacheSize = 16);
+
+	/**
+	 * 頂点キャッシュの効率が良くなるように三角形を並び替え (Forsythのアルゴリズム).
+	 * @param[in,out] triangleIndices  三角形の頂点インデックス.
+	 * @param[in]     verticesCount    頂点数.
+	 */
+	void optimizeVertexCache (std::vector<int>& triangleIndices, const size_t verticesCount);
+
+	/**
+	 * 三角形から参照される順に、頂点の並びを決める.
+	 * 参照されない頂点は末尾に元の順番で並べる.
+	 * @param[in]  indicesList    三角形の頂点インデックスのリスト (同じ頂点を共有するもの).
+	 * @param[in]  verticesCount  頂点数.
+	 * @param[out] vertexRemap    元の頂点番号 => 新しい頂点番号.
+	 */
+	void calcVertexFetchRemap (const std::vector<const std::vector<int>*>& indicesList, const size_t verticesCount, std::vector<int>& vertexRemap);
+
+	/**
+	 * メッシュの三角形と頂点を、頂点キャッシュと頂点フェッチの効率が良くなるように並び替え.
+	 * Mesh内のPrimitiveで頂点情報を共有している場合(1番目以降のPrimitiveの頂点が空)は、0番目のPrimitiveの頂点をまとめて並び替える.
+	 * 頂点ごとの情報、スキン、Morph Targetsの頂点番号も合わせて置き換える.
+	 * @param[in,out] meshData  メッシュ情報.
+	 * @param[out]    stats     頂点キャッシュの効率の計測結果.
+	 */
+	void optimizeMeshVertexOrder (CMeshData& meshData, CVertexCacheStats& stats);
+
+	/**
+	 * QEM(Quadric Error Metrics)で三角形数を削減したメッシュを作成 (LOD用).
+	 * 辺を片方の頂点に縮退させるため、残った頂点の法線/UV/頂点カラー/スキンの情報は元のままとなる.
+	 * 同一位置で頂点が分かれている箇所(UVや法線の不連続な辺)、メッシュの境界、Primitive(マテリアル)の境界は維持する.
+	 * Morph Targetsを持つメッシュは対象外.
+	 * @param[in]  meshData     元のメッシュ情報.
+	 * @param[in]  ratio        元の三角形数に対する、目標の三角形数の割合 (0.0 - 1.0).
+	 * @param[out] dstMeshData  三角形数を削減したメッシュ情報.
+	 * @return 三角形数を削減できた場合はtrue.
+	 */
+	bool simplifyMesh (const CMeshData& meshData, const float ratio, CMeshData& dstMeshData);
+}
+
+#endif
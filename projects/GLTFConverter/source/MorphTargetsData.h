@@ -30,6 +30,7 @@ public:
 public:
 	COneMorphTargetData ();
 	COneMorphTargetData (const COneMorphTargetData& v);
+	COneMorphTargetData (COneMorphTargetData&& v) = default;
 	~COneMorphTargetData ();
 
     COneMorphTargetData& operator = (const COneMorphTargetData &v) {
@@ -43,6 +44,7 @@ public:
 
 		return (*this);
 	}
+	COneMorphTargetData& operator = (COneMorphTargetData &&v) = default;
 
 	void clear ();
 };
@@ -59,12 +61,14 @@ public:
 public:
 	CMorphTargetsData ();
 	CMorphTargetsData (const CMorphTargetsData& v);
+	CMorphTargetsData (CMorphTargetsData&& v) = default;
 	~CMorphTargetsData ();
 
     CMorphTargetsData& operator = (const CMorphTargetsData &v) {
 		this->morphTargetsData = v.morphTargetsData;
 		return (*this);
 	}
+	CMorphTargetsData& operator = (CMorphTargetsData &&v) = default;
 
 	void clear();
 };
@@ -4,11 +4,89 @@
 
 #include "SceneData.h"
 #include "StringUtil.h"
+#include "MathUtil.h"
+#include "HashUtil.h"
+#include "MeshOptimizer.h"
+#include "TangentGenerator.h"
+#include "ThreadPool.h"
 
 #include <iostream>
 #include <fstream>
 #include <string>
 #include <sstream>
+#include <utility>
+#include <math.h>
+
+namespace {
+	// マテリアル比較時の色の許容誤差 (CMaterialData::isSameでのMathUtil::isZeroの既定値).
+	const float MATERIAL_COLOR_TOLERANCE = (float)(1e-3);
+
+	// マテリアル検索用に色を量子化する幅 (許容誤差の2倍より大きくすること).
+	const float MATERIAL_COLOR_CELL_SIZE = 1.0f / 64.0f;
+
+	/**
+	 * 法線を変換行列で変換 (逆行列の転置を掛ける).
+	 * @param[in] n       法線.
+	 * @param[in] invMat  変換行列の逆行列.
+	 */
+	sxsdk::vec3 transformNormal (const sxsdk::vec3& n, const sxsdk::mat4& invMat) {
+		const sxsdk::vec3 n2(n.x * invMat[0][0] + n.y * invMat[0][1] + n.z * invMat[0][2],
+							 n.x * invMat[1][0] + n.y * invMat[1][1] + n.z * invMat[1][2],
+							 n.x * invMat[2][0] + n.y * invMat[2][1] + n.z * invMat[2][2]);
+		const float len = sqrtf(n2.x * n2.x + n2.y * n2.y + n2.z * n2.z);
+		return (len > 1e-8f) ? (n2 * (1.0f / len)) : n;
+	}
+
+	/**
+	 * 変換行列の回転/スケール部分の行列式.
+	 * 負の場合は面が反転する.
+	 */
+	float calcDeterminant3 (const sxsdk::mat4& m) {
+		return m[0][0] * (m[1][1] * m[2][2] - m[1][2] * m[2][1])
+			 - m[0][1] * (m[1][0] * m[2][2] - m[1][2] * m[2][0])
+			 + m[0][2] * (m[1][0] * m[2][1] - m[1][1] * m[2][0]);
+	}
+}
+
+//---------------------------------------------.
+CUniqueNameRegistry::CUniqueNameRegistry ()
+{
+	clear();
+}
+
+void CUniqueNameRegistry::clear ()
+{
+	m_names.clear();
+	m_nextSuffix.clear();
+	m_registeredCount = 0;
+}
+
+/**
+ * 名前を登録.
+ */
+void CUniqueNameRegistry::add (const std::string& name)
+{
+	m_names.insert(name);
+	m_registeredCount++;
+}
+
+/**
+ * 名前が登録済みでない場合はそのまま返し、登録済みの場合は「name_1」「name_2」.. のうち未登録のものを返す.
+ * 名前は削除されないため、前回見つかった連番から探索を再開する.
+ */
+std::string CUniqueNameRegistry::getUniqueName (const std::string& name)
+{
+	if (m_names.find(name) == m_names.end()) return name;
+
+	int& suffix = m_nextSuffix[name];
+	if (suffix < 1) suffix = 1;
+	while (true) {
+		const std::string name2 = name + std::string("_") + std::to_string(suffix);
+		if (m_names.find(name2) == m_names.end()) return name2;
+		suffix++;
+	}
+	return name;
+}
 
 //---------------------------------------------.
 CNodeData::CNodeData ()
@@ -32,7 +110,10 @@ CNodeData::CNodeData (const CNodeData& v)
 	this->isBone          = v.isBone;
 	this->isEndBone       = v.isEndBone;
 	this->pShapeHandle    = v.pShapeHandle;
+	this->pMeshHandle     = v.pMeshHandle;
 	this->hasAnimation    = v.hasAnimation;
+	this->lodNodeIndices     = v.lodNodeIndices;
+	this->lodScreenCoverages = v.lodScreenCoverages;
 }
 
 CNodeData::~CNodeData ()
@@ -51,7 +132,10 @@ void CNodeData::clear ()
 	isBone = false;
 	isEndBone = false;
 	pShapeHandle = NULL;
+	pMeshHandle  = NULL;
 	hasAnimation = false;
+	lodNodeIndices.clear();
+	lodScreenCoverages.clear();
 
 	translation = sxsdk::vec3(0, 0, 0);
 	scale       = sxsdk::vec3(1, 1, 1);
@@ -100,6 +184,13 @@ void CSceneData::clear()
 	images.clear();
 	skins.clear();
 	m_nodeStack.clear();
+	m_imageHashMap.clear();
+	m_imageHashMapCount = 0;
+	m_materialHashMap.clear();
+	m_materialHandleMap.clear();
+	m_materialHashMapCount = 0;
+	m_materialNames.clear();
+	m_imageNames.clear();
 	animations.clear();
 	licenseData.clear();
 }
@@ -192,7 +283,7 @@ sxsdk::mat4 CSceneData::getNodeMatrix (const int nodeIndex, const bool unitMtoMM
 int CSceneData::appendNewMeshData ()
 {
 	const int index = (int)meshes.size();
-	meshes.push_back(CMeshData());
+	meshes.emplace_back();
 	return index;
 }
 
@@ -223,7 +314,7 @@ const CMeshData& CSceneData::getMeshData (const int meshIndex) const
 int CSceneData::beginNode (const std::string& nodeName, const sxsdk::mat4 m)
 {
 	const int nodeIndex = (int)nodes.size();
-	nodes.push_back(CNodeData());
+	nodes.emplace_back();
 	CNodeData& nodeD = nodes.back();
 	nodeD.name = nodeName;
 
@@ -241,24 +332,20 @@ int CSceneData::beginNode (const std::string& nodeName, const sxsdk::mat4 m)
 		nodeD.matrix      = sxsdk::mat4::scale(scale) * sxsdk::mat4::shear(shear) * sxsdk::mat4::rotate(rotate) * sxsdk::mat4::translate(nodeD.translation);
 	}
 
-	int prevNodeIndex = -1;
-
-	// 親ノードから、子の末尾のノード番号を取得.
+	// 親ノードの子の末尾に追加.
+	if (m_lastChildNodeIndex.size() < nodes.size()) m_lastChildNodeIndex.resize(nodes.size(), -1);
+	m_lastChildNodeIndex[nodeIndex] = -1;
 	if (nodeD.parentNodeIndex >= 0) {
 		CNodeData& parentNodeD = nodes[nodeD.parentNodeIndex];
+		const int prevNodeIndex = m_lastChildNodeIndex[nodeD.parentNodeIndex];
 
-		if (parentNodeD.childNodeIndex > 0) {
-			prevNodeIndex = parentNodeD.childNodeIndex;
-			CNodeData* pNode = &(nodes[prevNodeIndex]);
-			while ((pNode->nextNodeIndex) > 0) {
-				prevNodeIndex = pNode->nextNodeIndex;
-				pNode = &(nodes[prevNodeIndex]);
-			}
+		if (prevNodeIndex >= 0) {
+			nodes[prevNodeIndex].nextNodeIndex = nodeIndex;
 		} else {
 			parentNodeD.childNodeIndex = nodeIndex;
 		}
-
 		nodeD.prevNodeIndex = prevNodeIndex;
+		m_lastChildNodeIndex[nodeD.parentNodeIndex] = nodeIndex;
 	}
 
 	m_nodeStack.push_back(nodeIndex);
@@ -290,7 +377,11 @@ void CSceneData::endNode (const bool removeF)
 				nodes[prevNodeIndex].nextNodeIndex = -1;
 			}
 		}
+		if (parentNodeIndex >= 0 && parentNodeIndex < (int)m_lastChildNodeIndex.size()) {
+			if (m_lastChildNodeIndex[parentNodeIndex] == nodeIndex) m_lastChildNodeIndex[parentNodeIndex] = prevNodeIndex;
+		}
 		nodes.pop_back();
+		if (m_lastChildNodeIndex.size() > nodes.size()) m_lastChildNodeIndex.resize(nodes.size());
 	}
 }
 
@@ -388,6 +479,550 @@ void CSceneData::mergeLastTwoMeshes ()
 	meshes.pop_back();
 }
 
+/**
+ * 内容が同一のメッシュを1つにまとめ、複数のノードから共有して参照する.
+ * スキンを持つメッシュは対象外.
+ * @return 削除したメッシュ数.
+ */
+int CSceneData::shareSameMeshes ()
+{
+	const size_t meshesCou = meshes.size();
+	if (meshesCou <= 1) return 0;
+
+	// スキンで参照されているメッシュ.
+	std::vector<bool> skinMeshList(meshesCou, false);
+	for (size_t i = 0; i < skins.size(); ++i) {
+		const int meshIndex = skins[i].meshIndex;
+		if (meshIndex >= 0 && meshIndex < (int)meshesCou) skinMeshList[meshIndex] = true;
+	}
+
+	// 先頭から順に、同一のメッシュがすでにあればそれを参照し、なければ前詰めして残す.
+	std::vector<int> meshIndexList(meshesCou, -1);		// 元のメッシュ番号 => 新しいメッシュ番号.
+	std::unordered_multimap<uint64_t, int> meshHashMap;	// メッシュのハッシュ値 => 新しいメッシュ番号.
+	int newMeshesCou = 0;
+	for (size_t meshLoop = 0; meshLoop < meshesCou; ++meshLoop) {
+		const CMeshData& meshD = meshes[meshLoop];
+		bool hasSkin = skinMeshList[meshLoop];
+		for (size_t i = 0; i < meshD.primitives.size() && !hasSkin; ++i) {
+			if (!meshD.primitives[i].skinJointsHandle.empty() || !meshD.primitives[i].skinWeights.empty()) hasSkin = true;
+		}
+
+		uint64_t hash = 0;
+		if (!hasSkin && !meshD.primitives.empty()) {
+			hash = meshD.calcContentHash();
+			auto range = meshHashMap.equal_range(hash);
+			for (auto iter = range.first; iter != range.second; ++iter) {
+				if (meshes[iter->second].isSameContent(meshD)) {
+					meshIndexList[meshLoop] = iter->second;
+					break;
+				}
+			}
+			if (meshIndexList[meshLoop] >= 0) continue;
+		}
+
+		meshIndexList[meshLoop] = newMeshesCou;
+		if (newMeshesCou != (int)meshLoop) meshes[newMeshesCou] = std::move(meshes[meshLoop]);
+		if (!hasSkin && !meshes[newMeshesCou].primitives.empty()) meshHashMap.insert(std::make_pair(hash, newMeshesCou));
+		newMeshesCou++;
+	}
+	if (newMeshesCou == (int)meshesCou) return 0;
+	meshes.resize(newMeshesCou);
+
+	// ノード/スキンから参照するメッシュ番号を置き換え.
+	for (size_t i = 0; i < nodes.size(); ++i) {
+		CNodeData& nodeD = nodes[i];
+		if (nodeD.meshIndex >= 0 && nodeD.meshIndex < (int)meshesCou) nodeD.meshIndex = meshIndexList[nodeD.meshIndex];
+	}
+	for (size_t i = 0; i < skins.size(); ++i) {
+		CSkinData& skinD = skins[i];
+		if (skinD.meshIndex >= 0 && skinD.meshIndex < (int)meshesCou) skinD.meshIndex = meshIndexList[skinD.meshIndex];
+	}
+
+	return (int)meshesCou - newMeshesCou;
+}
+
+/**
+ * 静的なメッシュを、マテリアルごとに1つのメッシュにまとめる.
+ * @param[in] maxVerticesCount  まとめたメッシュの最大頂点数.
+ * @return まとめたメッシュ数.
+ */
+int CSceneData::batchStaticMeshes (const int maxVerticesCount)
+{
+	const size_t nodesCou  = nodes.size();
+	const size_t meshesCou = meshes.size();
+	if (nodesCou == 0 || meshesCou == 0) return 0;
+
+	// アニメーションするノード、ボーンとスキンのジョイントとして使用するノード.
+	// これらの子ノードも動くものとする (親ノードは子ノードより前に格納されている).
+	std::vector<bool> dynamicNodeList(nodesCou, false);
+	for (size_t i = 0; i < animations.channelData.size(); ++i) {
+		const int nodeIndex = animations.channelData[i].targetNodeIndex;
+		if (nodeIndex >= 0 && nodeIndex < (int)nodesCou) dynamicNodeList[nodeIndex] = true;
+	}
+	for (size_t i = 0; i < skins.size(); ++i) {
+		for (size_t j = 0; j < skins[i].joints.size(); ++j) {
+			const int nodeIndex = skins[i].joints[j];
+			if (nodeIndex >= 0 && nodeIndex < (int)nodesCou) dynamicNodeList[nodeIndex] = true;
+		}
+	}
+	for (size_t i = 0; i < nodesCou; ++i) {
+		const CNodeData& nodeD = nodes[i];
+		if (nodeD.isBone || nodeD.hasAnimation) dynamicNodeList[i] = true;
+		if (nodeD.parentNodeIndex >= 0 && nodeD.parentNodeIndex < (int)i && dynamicNodeList[nodeD.parentNodeIndex]) dynamicNodeList[i] = true;
+	}
+
+	// メッシュごとの、参照するノード数.
+	std::vector<int> meshRefCount(meshesCou, 0);
+	for (size_t i = 0; i < nodesCou; ++i) {
+		const int meshIndex = nodes[i].meshIndex;
+		if (meshIndex >= 0 && meshIndex < (int)meshesCou) meshRefCount[meshIndex]++;
+	}
+
+	// スキン/Morph Targetsを持たず、1つのノードからのみ参照されるメッシュか.
+	auto isStaticMesh = [&](const int meshIndex) -> bool {
+		if (meshRefCount[meshIndex] != 1) return false;
+		const CMeshData& meshD = meshes[meshIndex];
+		if (meshD.primitives.empty()) return false;
+		for (size_t primLoop = 0; primLoop < meshD.primitives.size(); ++primLoop) {
+			const CPrimitiveData& primD = meshD.primitives[primLoop];
+			const CPrimitiveData& srcPrimD = (primLoop > 0 && primD.vertices.empty()) ? meshD.primitives[0] : primD;
+			if (srcPrimD.vertices.empty() || primD.triangleIndices.empty()) return false;
+			if (!srcPrimD.skinWeights.empty() || !srcPrimD.skinJoints.empty() || !srcPrimD.skinJointsHandle.empty()) return false;
+			if (!srcPrimD.morphTargets.morphTargetsData.empty()) return false;
+		}
+		return true;
+	};
+
+	// 頂点はルートノードのローカル座標に変換する.
+	const sxsdk::mat4 rootWLMat = inv(getLocalToWorldMatrix(0));
+
+	std::vector<CPrimitiveData> batchList;
+	std::unordered_map<int64_t, int> curBatchMap;		// マテリアル番号と頂点属性 => 追加先のbatchListの番号.
+	std::vector<bool> removeMeshList(meshesCou, false);
+	std::vector<int> vIndexList;
+
+	for (size_t nodeLoop = 0; nodeLoop < nodesCou; ++nodeLoop) {
+		CNodeData& nodeD = nodes[nodeLoop];
+		const int meshIndex = nodeD.meshIndex;
+		if (meshIndex < 0 || meshIndex >= (int)meshesCou) continue;
+		if (dynamicNodeList[nodeLoop] || nodeD.skinIndex >= 0) continue;
+		if (!isStaticMesh(meshIndex)) continue;
+
+		const sxsdk::mat4 mat    = getLocalToWorldMatrix((int)nodeLoop) * rootWLMat;
+		const sxsdk::mat4 invMat = inv(mat);
+		const bool flipFace = (calcDeterminant3(mat) < 0.0f);
+
+		const CMeshData& meshD = meshes[meshIndex];
+		for (size_t primLoop = 0; primLoop < meshD.primitives.size(); ++primLoop) {
+			// Mesh内のPrimitiveで頂点情報を共有している場合、頂点は0番目のPrimitiveが持つ.
+			const CPrimitiveData& primD = meshD.primitives[primLoop];
+			const CPrimitiveData& srcPrimD = (primLoop > 0 && primD.vertices.empty()) ? meshD.primitives[0] : primD;
+
+			const size_t vCou = srcPrimD.vertices.size();
+			const bool hasNormals = (srcPrimD.normals.size() == vCou);
+			const bool hasUV0     = (srcPrimD.uv0.size() == vCou);
+			const bool hasUV1     = (srcPrimD.uv1.size() == vCou);
+			const bool hasColor0  = (srcPrimD.color0.size() == vCou);
+
+			// 三角形から参照されている頂点のみを、参照順に格納する.
+			vIndexList.assign(vCou, -1);
+			int usedVersCou = 0;
+			for (const int vIndex : primD.triangleIndices) {
+				if (vIndexList[vIndex] < 0) vIndexList[vIndex] = usedVersCou++;
+			}
+
+			// 同一のマテリアルと頂点属性を持つものをまとめる.
+			// 最大頂点数を超える場合は、新しいメッシュに格納する.
+			const int attrMask = (hasNormals ? 1 : 0) | (hasUV0 ? 2 : 0) | (hasUV1 ? 4 : 0) | (hasColor0 ? 8 : 0);
+			const int64_t key = ((int64_t)(primD.materialIndex + 1) << 4) | (int64_t)attrMask;
+			auto iter = curBatchMap.find(key);
+			if (iter == curBatchMap.end() || (int)batchList[iter->second].vertices.size() + usedVersCou > maxVerticesCount) {
+				curBatchMap[key] = (int)batchList.size();
+				batchList.emplace_back();
+				batchList.back().materialIndex = primD.materialIndex;
+			}
+			CPrimitiveData& dstPrimD = batchList[curBatchMap[key]];
+
+			const size_t vOffset = dstPrimD.vertices.size();
+			dstPrimD.vertices.resize(vOffset + usedVersCou);
+			if (hasNormals) dstPrimD.normals.resize(vOffset + usedVersCou);
+			if (hasUV0) dstPrimD.uv0.resize(vOffset + usedVersCou);
+			if (hasUV1) dstPrimD.uv1.resize(vOffset + usedVersCou);
+			if (hasColor0) dstPrimD.color0.resize(vOffset + usedVersCou);
+
+			for (size_t i = 0; i < vCou; ++i) {
+				if (vIndexList[i] < 0) continue;
+				const size_t dstIndex = vOffset + vIndexList[i];
+				const sxsdk::vec4 v4 = sxsdk::vec4(srcPrimD.vertices[i], 1) * mat;
+				dstPrimD.vertices[dstIndex] = sxsdk::vec3(v4.x, v4.y, v4.z);
+				if (hasNormals) dstPrimD.normals[dstIndex] = transformNormal(srcPrimD.normals[i], invMat);
+				if (hasUV0) dstPrimD.uv0[dstIndex] = srcPrimD.uv0[i];
+				if (hasUV1) dstPrimD.uv1[dstIndex] = srcPrimD.uv1[i];
+				if (hasColor0) dstPrimD.color0[dstIndex] = srcPrimD.color0[i];
+			}
+
+			const size_t triIndicesCou = primD.triangleIndices.size();
+			const size_t iOffset = dstPrimD.triangleIndices.size();
+			dstPrimD.triangleIndices.resize(iOffset + triIndicesCou);
+			for (size_t i = 0; i + 2 < triIndicesCou; i += 3) {
+				const int i0 = (int)vOffset + vIndexList[primD.triangleIndices[i + 0]];
+				const int i1 = (int)vOffset + vIndexList[primD.triangleIndices[i + 1]];
+				const int i2 = (int)vOffset + vIndexList[primD.triangleIndices[i + 2]];
+				dstPrimD.triangleIndices[iOffset + i + 0] = i0;
+				dstPrimD.triangleIndices[iOffset + i + 1] = flipFace ? i2 : i1;
+				dstPrimD.triangleIndices[iOffset + i + 2] = flipFace ? i1 : i2;
+			}
+		}
+
+		removeMeshList[meshIndex] = true;
+		nodeD.meshIndex = -1;
+	}
+	if (batchList.empty()) return 0;
+
+	// まとめたメッシュを削除して前詰め.
+	{
+		std::vector<int> meshIndexList(meshesCou, -1);
+		int newMeshesCou = 0;
+		for (size_t i = 0; i < meshesCou; ++i) {
+			if (removeMeshList[i]) continue;
+			meshIndexList[i] = newMeshesCou;
+			if (newMeshesCou != (int)i) meshes[newMeshesCou] = std::move(meshes[i]);
+			newMeshesCou++;
+		}
+		meshes.resize(newMeshesCou);
+
+		for (size_t i = 0; i < nodesCou; ++i) {
+			CNodeData& nodeD = nodes[i];
+			if (nodeD.meshIndex >= 0 && nodeD.meshIndex < (int)meshesCou) nodeD.meshIndex = meshIndexList[nodeD.meshIndex];
+		}
+		for (size_t i = 0; i < skins.size(); ++i) {
+			CSkinData& skinD = skins[i];
+			if (skinD.meshIndex >= 0 && skinD.meshIndex < (int)meshesCou) skinD.meshIndex = meshIndexList[skinD.meshIndex];
+		}
+	}
+
+	// まとめたメッシュごとに、ルートノードの子としてノードを追加.
+	const int batchCou = (int)batchList.size();
+	for (int i = 0; i < batchCou; ++i) {
+		const std::string name = std::string("static_batch_") + std::to_string(i);
+		const int meshIndex = appendNewMeshData();
+		CMeshData& meshD = meshes[meshIndex];
+		meshD.name = name;
+		meshD.primitives.push_back(std::move(batchList[i]));
+		meshD.primitives.back().name = name;
+
+		m_nodeStack.push_back(0);
+		const int nodeIndex = beginNode(name);
+		endNode();
+		m_nodeStack.pop_back();
+		nodes[nodeIndex].meshIndex = meshIndex;
+	}
+
+	return batchCou;
+}
+
+/**
+ * 変換のみを持つ静的なノードを削除し、ノード階層を浅くする.
+ * @return 削除したノード数.
+ */
+int CSceneData::flattenHierarchy ()
+{
+	const size_t nodesCou = nodes.size();
+	if (nodesCou <= 1) return 0;
+	const float fMin = (float)(1e-4);
+
+	// 変換行列が変わると困るノード (アニメーション/ボーン/スキンのジョイント/スケルトン).
+	std::vector<bool> fixedNodeList(nodesCou, false);
+	for (size_t i = 0; i < animations.channelData.size(); ++i) {
+		const int nodeIndex = animations.channelData[i].targetNodeIndex;
+		if (nodeIndex >= 0 && nodeIndex < (int)nodesCou) fixedNodeList[nodeIndex] = true;
+	}
+	for (size_t i = 0; i < skins.size(); ++i) {
+		const CSkinData& skinD = skins[i];
+		for (size_t j = 0; j < skinD.joints.size(); ++j) {
+			const int nodeIndex = skinD.joints[j];
+			if (nodeIndex >= 0 && nodeIndex < (int)nodesCou) fixedNodeList[nodeIndex] = true;
+		}
+		if (skinD.skeletonID >= 0 && skinD.skeletonID < (int)nodesCou) fixedNodeList[skinD.skeletonID] = true;
+	}
+	for (size_t i = 0; i < nodesCou; ++i) {
+		if (nodes[i].isBone || nodes[i].hasAnimation) fixedNodeList[i] = true;
+	}
+
+	// 削除するノード.
+	// アニメーションなどを持つノードの親を削除すると、子のローカル座標が変わるため残す.
+	std::vector<bool> removeNodeList(nodesCou, false);
+	for (size_t i = 1; i < nodesCou; ++i) {
+		const CNodeData& nodeD = nodes[i];
+		if (fixedNodeList[i] || nodeD.meshIndex >= 0 || nodeD.skinIndex >= 0) continue;
+		if (!MathUtil::isZero(nodeD.shear, fMin)) continue;
+		if (!MathUtil::isZero(nodeD.scale.x - nodeD.scale.y, fMin) || !MathUtil::isZero(nodeD.scale.y - nodeD.scale.z, fMin)) continue;
+		removeNodeList[i] = true;
+	}
+	for (size_t i = 0; i < nodesCou; ++i) {
+		const int parentIndex = nodes[i].parentNodeIndex;
+		if (fixedNodeList[i] && parentIndex >= 0 && parentIndex < (int)nodesCou) removeNodeList[parentIndex] = false;
+	}
+
+	// 削除するノードの、残る親ノードまでの変換行列と残る親ノード番号 (親ノードは子ノードより前に格納されている).
+	std::vector<sxsdk::mat4> removedMatrixList(nodesCou, sxsdk::mat4::identity);
+	std::vector<int> parentIndexList(nodesCou, -1);
+	for (size_t i = 0; i < nodesCou; ++i) {
+		CNodeData& nodeD = nodes[i];
+		const int parentIndex = nodeD.parentNodeIndex;
+		const bool parentRemoved = (parentIndex >= 0 && parentIndex < (int)i && removeNodeList[parentIndex]);
+		parentIndexList[i] = parentRemoved ? parentIndexList[parentIndex] : parentIndex;
+
+		if (removeNodeList[i]) {
+			removedMatrixList[i] = parentRemoved ? (nodeD.getMatrix() * removedMatrixList[parentIndex]) : nodeD.getMatrix();
+			continue;
+		}
+		if (!parentRemoved) continue;
+
+		// 削除する親ノードの変換を、このノードに反映.
+		const sxsdk::mat4 m = nodeD.getMatrix() * removedMatrixList[parentIndex];
+		sxsdk::vec3 scale ,shear, rotate, trans;
+		m.unmatrix(scale, shear, rotate, trans);
+		nodeD.translation = trans;
+		nodeD.scale       = scale;
+		nodeD.rotation    = sxsdk::quaternion_class(rotate);
+		nodeD.shear       = shear;
+		nodeD.matrix      = sxsdk::mat4::scale(scale) * sxsdk::mat4::shear(shear) * sxsdk::mat4::rotate(rotate) * sxsdk::mat4::translate(trans);
+	}
+
+	// ノードを前詰め.
+	std::vector<int> nodeIndexList(nodesCou, -1);		// 元のノード番号 => 新しいノード番号.
+	int newNodesCou = 0;
+	for (size_t i = 0; i < nodesCou; ++i) {
+		if (!removeNodeList[i]) nodeIndexList[i] = newNodesCou++;
+	}
+	if (newNodesCou == (int)nodesCou) return 0;
+
+	for (size_t i = 0; i < nodesCou; ++i) {
+		const int newIndex = nodeIndexList[i];
+		if (newIndex < 0) continue;
+		const int parentIndex = parentIndexList[i];
+		if (newIndex != (int)i) nodes[newIndex] = std::move(nodes[i]);
+		nodes[newIndex].parentNodeIndex = (parentIndex >= 0) ? nodeIndexList[parentIndex] : -1;
+	}
+	nodes.resize(newNodesCou);
+
+	// 親子/兄弟のノード番号を作り直す (子ノードはノード番号順).
+	m_lastChildNodeIndex.assign(newNodesCou, -1);
+	for (int i = 0; i < newNodesCou; ++i) {
+		CNodeData& nodeD = nodes[i];
+		nodeD.childNodeIndex = -1;
+		nodeD.prevNodeIndex  = -1;
+		nodeD.nextNodeIndex  = -1;
+		const int parentIndex = nodeD.parentNodeIndex;
+		if (parentIndex < 0) continue;
+
+		const int prevNodeIndex = m_lastChildNodeIndex[parentIndex];
+		if (prevNodeIndex >= 0) {
+			nodes[prevNodeIndex].nextNodeIndex = i;
+		} else {
+			nodes[parentIndex].childNodeIndex = i;
+		}
+		nodeD.prevNodeIndex = prevNodeIndex;
+		m_lastChildNodeIndex[parentIndex] = i;
+	}
+
+	// スキン/アニメーションから参照するノード番号を置き換え.
+	for (size_t i = 0; i < skins.size(); ++i) {
+		CSkinData& skinD = skins[i];
+		for (size_t j = 0; j < skinD.joints.size(); ++j) {
+			if (skinD.joints[j] >= 0 && skinD.joints[j] < (int)nodesCou) skinD.joints[j] = nodeIndexList[skinD.joints[j]];
+		}
+		if (skinD.skeletonID >= 0 && skinD.skeletonID < (int)nodesCou) skinD.skeletonID = nodeIndexList[skinD.skeletonID];
+	}
+	for (size_t i = 0; i < animations.channelData.size(); ++i) {
+		CAnimChannelData& channelD = animations.channelData[i];
+		if (channelD.targetNodeIndex >= 0 && channelD.targetNodeIndex < (int)nodesCou) channelD.targetNodeIndex = nodeIndexList[channelD.targetNodeIndex];
+	}
+
+	return (int)nodesCou - newNodesCou;
+}
+
+/**
+ * アニメーションしない末端のメッシュノードに対して、LODのメッシュとノードを作成する.
+ * LODのノードはシーン階層に含まれずスキンのジョイント階層と対応付けられないため、スキンを持つ場合は作成しない.
+ * @return 作成したLODのメッシュ数.
+ */
+int CSceneData::generateLODs (const std::vector<float>& ratios)
+{
+	const int nodesCou  = (int)nodes.size();
+	const int meshesCou = (int)meshes.size();
+	if (ratios.empty() || nodesCou == 0 || meshesCou == 0) return 0;
+
+	// アニメーションのターゲットとなるノード.
+	std::vector<bool> animatedList(nodesCou, false);
+	for (size_t i = 0; i < animations.channelData.size(); ++i) {
+		const int nodeIndex = animations.channelData[i].targetNodeIndex;
+		if (nodeIndex >= 0 && nodeIndex < nodesCou) animatedList[nodeIndex] = true;
+	}
+
+	// スキンを持つノードから参照されるメッシュ.
+	std::vector<bool> skinnedMeshList(meshesCou, false);
+	for (int i = 0; i < nodesCou; ++i) {
+		const CNodeData& nodeD = nodes[i];
+		if (nodeD.meshIndex >= 0 && nodeD.meshIndex < meshesCou && nodeD.skinIndex >= 0) skinnedMeshList[nodeD.meshIndex] = true;
+	}
+
+	// LODを割り当てるノード (子を持たず、アニメーションせず、スキンを持たないメッシュのノード).
+	std::vector<int> targetNodes;
+	std::vector<int> meshLODIndex(meshesCou, -1);
+	std::vector<int> srcMeshList;
+	for (int i = 0; i < nodesCou; ++i) {
+		const CNodeData& nodeD = nodes[i];
+		if (nodeD.meshIndex < 0 || nodeD.meshIndex >= meshesCou) continue;
+		if (nodeD.childNodeIndex >= 0 || animatedList[i] || nodeD.isBone || nodeD.hasAnimation) continue;
+		if (nodeD.skinIndex >= 0 || skinnedMeshList[nodeD.meshIndex]) continue;
+		targetNodes.push_back(i);
+		if (meshLODIndex[nodeD.meshIndex] < 0) {
+			meshLODIndex[nodeD.meshIndex] = (int)srcMeshList.size();
+			srcMeshList.push_back(nodeD.meshIndex);
+		}
+	}
+	if (srcMeshList.empty()) return 0;
+
+	// メッシュごとに並列にLODを作成.
+	// 失敗した場合は、そのメッシュのLODは作成しない.
+	const size_t lodCou = ratios.size();
+	std::vector< std::vector<CMeshData> > lodMeshesList(srcMeshList.size());
+	std::vector< std::vector<float> > lodRatiosList(srcMeshList.size());
+	CThreadPool::getInstance().parallelFor((int)srcMeshList.size(), [&](const int i) {
+		try {
+			const CMeshData& meshD = meshes[srcMeshList[i]];
+			for (size_t j = 0; j < lodCou; ++j) {
+				CMeshData lodMeshD;
+				if (!MeshOptimizer::simplifyMesh(meshD, ratios[j], lodMeshD)) continue;
+				lodMeshesList[i].push_back(std::move(lodMeshD));
+				lodRatiosList[i].push_back(ratios[j]);
+			}
+		} catch (...) {
+			lodMeshesList[i].clear();
+			lodRatiosList[i].clear();
+		}
+	});
+
+	// LODのメッシュを追加.
+	std::vector<int> lodMeshStartIndex(srcMeshList.size(), -1);
+	int lodMeshesCou = 0;
+	for (size_t i = 0; i < srcMeshList.size(); ++i) {
+		std::vector<CMeshData>& lodMeshes = lodMeshesList[i];
+		if (lodMeshes.empty()) continue;
+		lodMeshStartIndex[i] = (int)meshes.size();
+		const std::string name = meshes[srcMeshList[i]].name;
+		for (size_t j = 0; j < lodMeshes.size(); ++j) {
+			const std::string lodName = name + std::string("_LOD") + std::to_string(j + 1);
+			const int meshIndex = appendNewMeshData();
+			meshes[meshIndex] = std::move(lodMeshes[j]);
+			meshes[meshIndex].name = lodName;
+			for (size_t k = 0; k < meshes[meshIndex].primitives.size(); ++k) meshes[meshIndex].primitives[k].name = lodName;
+			lodMeshesCou++;
+		}
+	}
+
+	// LODのノードを追加.
+	// LODのノードは親を持たず、元のノードと同じ変換を持つ.
+	// 画面占有率は、LODの三角形数の割合の半分を切り替えの目安とする.
+	for (size_t i = 0; i < targetNodes.size(); ++i) {
+		const int nodeIndex = targetNodes[i];
+		const int srcIndex  = meshLODIndex[nodes[nodeIndex].meshIndex];
+		if (lodMeshStartIndex[srcIndex] < 0) continue;
+		const std::vector<float>& lodRatios = lodRatiosList[srcIndex];
+
+		nodes[nodeIndex].lodNodeIndices.clear();
+		nodes[nodeIndex].lodScreenCoverages.clear();
+		for (size_t j = 0; j < lodRatios.size(); ++j) {
+			CNodeData lodNodeD;
+			{
+				const CNodeData& nodeD = nodes[nodeIndex];
+				lodNodeD.name        = nodeD.name + std::string("_LOD") + std::to_string(j + 1);
+				lodNodeD.translation = nodeD.translation;
+				lodNodeD.scale       = nodeD.scale;
+				lodNodeD.rotation    = nodeD.rotation;
+				lodNodeD.shear       = nodeD.shear;
+				lodNodeD.matrix      = nodeD.matrix;
+				lodNodeD.meshIndex   = lodMeshStartIndex[srcIndex] + (int)j;
+			}
+			const int lodNodeIndex = (int)nodes.size();
+			nodes.push_back(lodNodeD);
+			m_lastChildNodeIndex.push_back(-1);
+
+			nodes[nodeIndex].lodNodeIndices.push_back(lodNodeIndex);
+			nodes[nodeIndex].lodScreenCoverages.push_back(lodRatios[j] * 0.5f);
+		}
+		nodes[nodeIndex].lodScreenCoverages.push_back(0.0f);
+	}
+
+	return lodMeshesCou;
+}
+
+/**
+ * 法線マップを持つマテリアルのPrimitiveに、接線(TANGENT)を格納する.
+ * @return 接線を格納したPrimitive数.
+ */
+int CSceneData::generateTangents ()
+{
+	const int materialsCou = (int)materials.size();
+
+	// 頂点情報を持つPrimitiveごとに、接線を計算する三角形のリストを作成.
+	// 頂点を共有している場合(1番目以降のPrimitiveの頂点が空)は、0番目のPrimitiveにまとめる.
+	class CTangentTask
+	{
+	public:
+		CPrimitiveData* pPrimitive;
+		std::vector<std::vector<int>*> indicesList;
+		int texCoord;
+		bool result;
+	};
+	std::vector<CTangentTask> taskList;
+
+	for (size_t meshLoop = 0; meshLoop < meshes.size(); ++meshLoop) {
+		CMeshData& meshD = meshes[meshLoop];
+		const size_t primCou = meshD.primitives.size();
+		for (size_t primLoop = 0; primLoop < primCou; ++primLoop) {
+			CPrimitiveData& primD = meshD.primitives[primLoop];
+			if (primD.vertices.empty()) continue;
+
+			CTangentTask task;
+			task.pPrimitive = &primD;
+			task.texCoord   = -1;
+			task.result     = false;
+			for (size_t i = primLoop; i < primCou; ++i) {
+				CPrimitiveData& primD2 = meshD.primitives[i];
+				if (i != primLoop && (primLoop != 0 || !primD2.vertices.empty())) continue;
+
+				const int materialIndex = primD2.materialIndex;
+				if (materialIndex < 0 || materialIndex >= materialsCou) continue;
+				const CMaterialData& materialD = materials[materialIndex];
+				if (materialD.normalImageIndex < 0) continue;
+
+				// 頂点を共有するPrimitiveで法線マップのUVが異なる場合は、先に見つかったものを使用.
+				if (task.texCoord < 0) task.texCoord = materialD.normalTexCoord;
+				task.indicesList.push_back(&(primD2.triangleIndices));
+			}
+			if (task.indicesList.empty()) continue;
+			taskList.push_back(task);
+		}
+	}
+	if (taskList.empty()) return 0;
+
+	CThreadPool::getInstance().parallelFor((int)taskList.size(), [&](const int i) {
+		try {
+			CTangentTask& task = taskList[i];
+			task.result = TangentGenerator::generateTangents(*(task.pPrimitive), task.indicesList, task.texCoord);
+		} catch (...) { }
+	});
+
+	int cou = 0;
+	for (size_t i = 0; i < taskList.size(); ++i) {
+		if (taskList[i].result) cou++;
+	}
+	return cou;
+}
+
 /**
  * 同一のマテリアルがあるか調べる.
  * @param[in] materialData  マテリアル情報.
@@ -396,12 +1031,37 @@ void CSceneData::mergeLastTwoMeshes ()
  */
 int CSceneData::findSameMaterial (const CMaterialData& materialData)
 {
-	const size_t mCou = materials.size();
+	m_updateMaterialHashMap();
+
+	// 先頭に近いものを優先するため、候補のうち最小のインデックスを採用する.
 	int index = -1;
-	for (size_t i = 0; i < mCou; ++i) {
-		if (materials[i].isSame(materialData)) {
-			index = (int)i;
-			break;
+	auto checkMaterial = [&](const int i) {
+		if (index >= 0 && index < i) return;
+		if (materials[i].isSame(materialData)) index = i;
+	};
+
+	// 同一のマスターサーフェスを参照するもの.
+	if (materialData.shadeMasterSurface) {
+		auto iter = m_materialHandleMap.find(materialData.shadeMasterSurface->get_handle());
+		if (iter != m_materialHandleMap.end()) checkMaterial(iter->second);
+	}
+
+	// ハッシュ値が一致し、色が許容誤差内に入りうるもの.
+	// 色の各要素は、許容誤差の範囲が重なる量子化セル(最大2つ)をすべて探す.
+	const uint64_t structureHash = materialData.calcStructureHash();
+	const float colors[3] = { materialData.baseColorFactor.red, materialData.baseColorFactor.green, materialData.baseColorFactor.blue };
+	int cellMin[3], cellMax[3];
+	for (int j = 0; j < 3; ++j) {
+		cellMin[j] = (int)floorf((colors[j] - MATERIAL_COLOR_TOLERANCE) / MATERIAL_COLOR_CELL_SIZE);
+		cellMax[j] = (int)floorf((colors[j] + MATERIAL_COLOR_TOLERANCE) / MATERIAL_COLOR_CELL_SIZE);
+	}
+	int cell[3];
+	for (cell[0] = cellMin[0]; cell[0] <= cellMax[0]; ++cell[0]) {
+		for (cell[1] = cellMin[1]; cell[1] <= cellMax[1]; ++cell[1]) {
+			for (cell[2] = cellMin[2]; cell[2] <= cellMax[2]; ++cell[2]) {
+				auto range = m_materialHashMap.equal_range(m_calcMaterialKey(structureHash, cell));
+				for (auto iter = range.first; iter != range.second; ++iter) checkMaterial(iter->second);
+			}
 		}
 	}
 	return index;
@@ -415,18 +1075,64 @@ int CSceneData::findSameMaterial (const CMaterialData& materialData)
  */
 int CSceneData::findSameMaterial (sxsdk::master_surface_class* masterSurface)
 {
-	void* mHandle = masterSurface->get_handle();
+	m_updateMaterialHashMap();
+	auto iter = m_materialHandleMap.find(masterSurface->get_handle());
+	return (iter != m_materialHandleMap.end()) ? (iter->second) : -1;
+}
+
+/**
+ * マテリアルのハッシュ値と色から、検索用のキーを計算.
+ */
+uint64_t CSceneData::m_calcMaterialKey (const uint64_t structureHash, const int colorCell[3]) const
+{
+	uint64_t key = structureHash;
+	for (int i = 0; i < 3; ++i) key = HashUtil::combineHash64(key, (uint64_t)(int64_t)colorCell[i]);
+	return key;
+}
+
+/**
+ * materialsに追加された要素をm_materialHashMap/m_materialHandleMapに登録.
+ * materialsは外部から直接push_backされるため、検索時に差分を登録する.
+ */
+void CSceneData::m_updateMaterialHashMap ()
+{
 	const size_t mCou = materials.size();
-	int index = -1;
-	for (size_t i = 0; i < mCou; ++i) {
-		if (!materials[i].shadeMasterSurface) continue;
-		void* mHandle2 = materials[i].shadeMasterSurface->get_handle();
-		if (mHandle == mHandle2) {
-			index = (int)i;
-			break;
+	if (m_materialHashMapCount > mCou) {
+		m_materialHashMap.clear();
+		m_materialHandleMap.clear();
+		m_materialHashMapCount = 0;
+	}
+	for (size_t i = m_materialHashMapCount; i < mCou; ++i) {
+		const CMaterialData& matD = materials[i];
+		int cell[3];
+		cell[0] = (int)floorf(matD.baseColorFactor.red   / MATERIAL_COLOR_CELL_SIZE);
+		cell[1] = (int)floorf(matD.baseColorFactor.green / MATERIAL_COLOR_CELL_SIZE);
+		cell[2] = (int)floorf(matD.baseColorFactor.blue  / MATERIAL_COLOR_CELL_SIZE);
+		m_materialHashMap.insert(std::pair<uint64_t, int>(m_calcMaterialKey(matD.calcStructureHash(), cell), (int)i));
+
+		if (matD.shadeMasterSurface) {
+			void* handle = matD.shadeMasterSurface->get_handle();
+			if (m_materialHandleMap.find(handle) == m_materialHandleMap.end()) m_materialHandleMap[handle] = (int)i;
 		}
 	}
-	return index;
+	m_materialHashMapCount = mCou;
+}
+
+/**
+ * materials/imagesに追加された要素の名前を登録.
+ * materials/imagesは外部から直接push_backされるため、名前の取得時に差分を登録する.
+ */
+void CSceneData::m_updateNameRegistry ()
+{
+	if (m_materialNames.getRegisteredCount() > materials.size()) m_materialNames.clear();
+	for (size_t i = m_materialNames.getRegisteredCount(); i < materials.size(); ++i) {
+		m_materialNames.add(materials[i].name);
+	}
+
+	if (m_imageNames.getRegisteredCount() > images.size()) m_imageNames.clear();
+	for (size_t i = m_imageNames.getRegisteredCount(); i < images.size(); ++i) {
+		m_imageNames.add(StringUtil::getFileName(images[i].name, false));
+	}
 }
 
 /**
@@ -437,17 +1143,56 @@ int CSceneData::findSameMaterial (sxsdk::master_surface_class* masterSurface)
  */
 int CSceneData::findSameImage (const CImageData& imageData)
 {
-	const size_t iCou = images.size();
-	int index = -1;
-	for (size_t i = 0; i < iCou; ++i) {
-		if (images[i].isSame(imageData)) {
-			index = (int)i;
-			break;
+	// RGBAを持たない場合は、すべてのイメージと比較.
+	if (imageData.imageRGBAData.empty()) {
+		const size_t iCou = images.size();
+		for (size_t i = 0; i < iCou; ++i) {
+			if (images[i].isSame(imageData)) return (int)i;
 		}
+		return -1;
+	}
+
+	// 画像サイズとハッシュ値が一致するものだけを比較.
+	m_updateImageHashMap();
+	const uint64_t key = m_calcImageKey(imageData);
+	int index = -1;
+	auto range = m_imageHashMap.equal_range(key);
+	for (auto iter = range.first; iter != range.second; ++iter) {
+		const int i = iter->second;
+		if (index >= 0 && index < i) continue;		// 線形探索時と同じく、先頭に近いものを優先.
+		if (images[i].isSame(imageData)) index = i;
 	}
 	return index;
 }
 
+/**
+ * 画像サイズとRGBAのハッシュ値から、検索用のキーを計算.
+ */
+uint64_t CSceneData::m_calcImageKey (const CImageData& imageData) const
+{
+	uint64_t key = HashUtil::combineHash64(imageData.imageRGBAHash, (uint64_t)imageData.width);
+	key = HashUtil::combineHash64(key, (uint64_t)imageData.height);
+	return key;
+}
+
+/**
+ * imagesに追加された要素をm_imageHashMapに登録.
+ * imagesは外部から直接push_backされるため、検索時に差分を登録する.
+ */
+void CSceneData::m_updateImageHashMap ()
+{
+	const size_t iCou = images.size();
+	if (m_imageHashMapCount > iCou) {
+		m_imageHashMap.clear();
+		m_imageHashMapCount = 0;
+	}
+	for (size_t i = m_imageHashMapCount; i < iCou; ++i) {
+		if (images[i].imageRGBAData.empty()) continue;
+		m_imageHashMap.insert(std::pair<uint64_t, int>(m_calcImageKey(images[i]), (int)i));
+	}
+	m_imageHashMapCount = iCou;
+}
+
 /**
  * 他とかぶらないユニークなイメージ名を取得.
  * @param[in] name  格納したいイメージ名.
@@ -455,7 +1200,7 @@ int CSceneData::findSameImage (const CImageData& imageData)
  */
 std::string CSceneData::getUniqueImageName (const std::string& name)
 {
-	const size_t imgCou = images.size();
+	m_updateNameRegistry();
 
 	// 「red_05.shdsfc: 0」「red_05.shdsfc: 1」のような名前の場合、異なる名前として通ってしまうため「.」より後は判断材料にしない.
 
@@ -466,38 +1211,11 @@ std::string CSceneData::getUniqueImageName (const std::string& name)
 	const std::string fName    = StringUtil::getFileName(name2, false);
 	const std::string fExtName = StringUtil::getFileExtension(name2);
 
-	bool findF = false;
-	for (size_t i = 0; i < imgCou; ++i) {
-		const CImageData& imgD = images[i];
-		const std::string fName2 = StringUtil::getFileName(imgD.name, false);
-		if (fName2 == fName) {
-			findF = true;
-			break;
-		}
-	}
-	if (!findF) return name2;
-
-	std::string newName = "";
-	int iCou = 1;
-	while (true) {
-		findF = false;
-		std::string name3 = fName + std::string("_") + std::to_string(iCou);
-		for (size_t i = 0; i < imgCou; ++i) {
-			const CImageData& imgD = images[i];
-			const std::string fName2 = StringUtil::getFileName(imgD.name, false);
-			if (fName2 == name3) {
-				findF = true;
-				break;
-			}
-		}
-		if (!findF) {
-			newName = name3;
-			if (fExtName != "") newName += std::string(".") + fExtName;
-			break;
-		}
-		iCou++;
-	}
+	const std::string fName2 = m_imageNames.getUniqueName(fName);
+	if (fName2 == fName) return name2;
 
+	std::string newName = fName2;
+	if (fExtName != "") newName += std::string(".") + fExtName;
 	return newName;
 }
 
@@ -508,40 +1226,8 @@ std::string CSceneData::getUniqueImageName (const std::string& name)
  */
 std::string CSceneData::getUniqueMaterialName (const std::string& name)
 {
-	const size_t mCou = materials.size();
-
-	const std::string newName0 = StringUtil::convAsFileName(name);
-
-	bool findF = false;
-	for (size_t i = 0; i < mCou; ++i) {
-		const CMaterialData& matD = materials[i];
-		if (matD.name == newName0) {
-			findF = true;
-			break;
-		}
-	}
-	if (!findF) return newName0;
-
-	std::string newName = "";
-	int iCou = 1;
-	while (true) {
-		findF = false;
-		const std::string name2 = newName0 + std::string("_") + std::to_string(iCou);
-		for (size_t i = 0; i < mCou; ++i) {
-			const CMaterialData& matD = materials[i];
-			if (matD.name == name2) {
-				findF = true;
-				break;
-			}
-		}
-		if (!findF) {
-			newName = name2;
-			break;
-		}
-		iCou++;
-	}
-
-	return newName;
+	m_updateNameRegistry();
+	return m_materialNames.getUniqueName(StringUtil::convAsFileName(name));
 }
 
 /**
@@ -13,6 +13,40 @@
 
 #include <vector>
 #include <string>
+#include <unordered_map>
+#include <unordered_set>
+
+//---------------------------------------------.
+/**
+ * ユニークな名前を割り当てるための、登録済みの名前の管理.
+ */
+class CUniqueNameRegistry
+{
+private:
+	std::unordered_set<std::string> m_names;			// 登録済みの名前.
+	std::unordered_map<std::string, int> m_nextSuffix;	// 名前ごとの、次に試す連番.
+	size_t m_registeredCount;							// 登録した要素数.
+
+public:
+	CUniqueNameRegistry ();
+
+	void clear ();
+
+	/**
+	 * 名前を登録.
+	 */
+	void add (const std::string& name);
+
+	/**
+	 * 登録した要素数.
+	 */
+	size_t getRegisteredCount () const { return m_registeredCount; }
+
+	/**
+	 * 名前が登録済みでない場合はそのまま返し、登録済みの場合は「name_1」「name_2」.. のうち未登録のものを返す.
+	 */
+	std::string getUniqueName (const std::string& name);
+};
 
 //---------------------------------------------.
 /**
@@ -40,12 +74,17 @@ public:
 	bool isEndBone;					// スキンが割り当てられていない終端ノードの場合.
 
 	void* pShapeHandle;				// Import/Export時のShade3Dでの形状のhandleの参照 (パートまたはボーン).
+	void* pMeshHandle;				// Import時にこのノードで生成したポリゴンメッシュのhandle.
 
 	bool hasAnimation;				// インポート時にアニメーションを持つ場合true（isBone=false時はボールジョイントとする）.
 
+	std::vector<int> lodNodeIndices;		// LODとして切り替えるノード番号 (MSFT_lod).
+	std::vector<float> lodScreenCoverages;	// LODを切り替える画面占有率 (lodNodeIndices.size() + 1個).
+
 public:
 	CNodeData ();
 	CNodeData (const CNodeData& v);
+	CNodeData (CNodeData&& v) = default;
 	~CNodeData ();
 
     CNodeData& operator = (const CNodeData &v) {
@@ -64,10 +103,14 @@ public:
 		this->isBone          = v.isBone;
 		this->isEndBone       = v.isEndBone;
 		this->pShapeHandle    = v.pShapeHandle;
+		this->pMeshHandle     = v.pMeshHandle;
 		this->hasAnimation    = v.hasAnimation;
+		this->lodNodeIndices     = v.lodNodeIndices;
+		this->lodScreenCoverages = v.lodScreenCoverages;
 
 		return (*this);
     }
+	CNodeData& operator = (CNodeData &&v) = default;
 
 	void clear ();
 
@@ -85,6 +128,17 @@ class CSceneData
 {
 private:
 	std::vector<int> m_nodeStack;			// ノードを格納する際の階層構造のためのスタック.
+	std::vector<int> m_lastChildNodeIndex;	// ノードを格納する際の、各ノードの末尾の子ノード番号.
+
+	std::unordered_multimap<uint64_t, int> m_imageHashMap;	// 画像サイズとRGBAのハッシュ値から、imagesのインデックスを引く.
+	size_t m_imageHashMapCount;								// m_imageHashMapに登録済みのimagesの要素数.
+
+	std::unordered_multimap<uint64_t, int> m_materialHashMap;	// マテリアルのハッシュ値から、materialsのインデックスを引く.
+	std::unordered_map<void*, int> m_materialHandleMap;			// マスターサーフェスのハンドルから、materialsのインデックスを引く.
+	size_t m_materialHashMapCount;								// m_materialHashMapに登録済みのmaterialsの要素数.
+
+	CUniqueNameRegistry m_materialNames;		// materialsのマテリアル名.
+	CUniqueNameRegistry m_imageNames;			// imagesのイメージ名 (拡張子を除く).
 
 public:
 	bool isVRM;								// VRM形式の場合はtrue.
@@ -117,7 +171,32 @@ public:
 	CLicenseData licenseData;				// VRMで定義されているライセンスデータなど.
 
 private:
+	/**
+	 * 画像サイズとRGBAのハッシュ値から、検索用のキーを計算.
+	 */
+	uint64_t m_calcImageKey (const CImageData& imageData) const;
 
+	/**
+	 * imagesに追加された要素をm_imageHashMapに登録.
+	 */
+	void m_updateImageHashMap ();
+
+	/**
+	 * マテリアルのハッシュ値と色から、検索用のキーを計算.
+	 * @param[in] structureHash  CMaterialData::calcStructureHash()の値.
+	 * @param[in] colorCell      baseColorFactorの各要素を量子化した値.
+	 */
+	uint64_t m_calcMaterialKey (const uint64_t structureHash, const int colorCell[3]) const;
+
+	/**
+	 * materialsに追加された要素をm_materialHashMap/m_materialHandleMapに登録.
+	 */
+	void m_updateMaterialHashMap ();
+
+	/**
+	 * materials/imagesに追加された要素の名前を登録.
+	 */
+	void m_updateNameRegistry ();
 
 public:
 	CSceneData ();
@@ -192,6 +271,48 @@ public:
 	 */
 	void mergeLastTwoMeshes ();
 
+	/**
+	 * 内容が同一のメッシュを1つにまとめ、複数のノードから共有して参照する.
+	 * 複製/リンクされた形状は同じglTFのMeshを参照するようになる.
+	 * スキンを持つメッシュは頂点がワールド座標で格納されているため対象外.
+	 * @return 削除したメッシュ数.
+	 */
+	int shareSameMeshes ();
+
+	/**
+	 * 静的なメッシュ(スキン/Morph Targets/アニメーションの影響を受けないもの)を、マテリアルごとに1つのメッシュにまとめる.
+	 * 頂点はルートノードのローカル座標に変換し、まとめたメッシュはルートノードの子ノードに割り当てる.
+	 * 元のノードは、メッシュを持たないノードとして残る.
+	 * @param[in] maxVerticesCount  まとめたメッシュの最大頂点数.
+	 * @return まとめたメッシュ数.
+	 */
+	int batchStaticMeshes (const int maxVerticesCount);
+
+	/**
+	 * 変換のみを持つ静的なノードを削除し、その変換行列を子ノードに反映してノード階層を浅くする.
+	 * メッシュ/スキン/アニメーションを持つノード、ボーンとスキンのジョイントとして使用するノード、ルートノードは残す.
+	 * 子ノードの変換がせん断を持たないように、均等スケールでせん断のないノードのみを対象とする.
+	 * @return 削除したノード数.
+	 */
+	int flattenHierarchy ();
+
+	/**
+	 * アニメーションしない末端のメッシュノードに対して、三角形数を削減したLODのメッシュとノードを作成する (MSFT_lod).
+	 * LODのノードはシーンに含めず、元のノードのlodNodeIndicesから参照する.
+	 * スキンを持つノードと、スキンを持つノードから参照されるメッシュは対象外.
+	 * メッシュの削減はメッシュごとに並列に行う.
+	 * @param[in] ratios  LODごとの、元の三角形数に対する割合 (大きい順).
+	 * @return 作成したLODのメッシュ数.
+	 */
+	int generateLODs (const std::vector<float>& ratios);
+
+	/**
+	 * 法線マップを持つマテリアルのPrimitiveに、接線(TANGENT)を格納する.
+	 * 頂点を共有するPrimitive単位で並列に計算する.
+	 * @return 接線を格納したPrimitive数 (頂点情報を持つもの).
+	 */
+	int generateTangents ();
+
 	/**
 	 * 現在処理中のカレントノード番号を取得.
 	 */
@@ -3,8 +3,14 @@
  */
 #include "Shade3DUtil.h"
 #include "MathUtil.h"
+#include "ImageResampler.h"
+
+#include <algorithm>
 
 namespace {
+	// 画素をまとめて格納する際の、1回あたりの最大サイズ (bytes).
+	const size_t SET_IMAGE_BAND_MAX_BYTES = 4 * 1024 * 1024;
+
 	/**
 	 * 再帰的にボーンのルートを探す.
 	 */
@@ -212,6 +218,33 @@ sxsdk::master_image_class* Shade3DUtil::getMasterImageFromImage (sxsdk::scene_in
 	return NULL;
 }
 
+/**
+ * 指定の名前のマスターイメージ形状を取得.
+ * @param[in] scene  シーンクラス.
+ * @param[in] name   マスターイメージ名.
+ * @return マスターイメージが存在する場合はその形状のポインタ.
+ */
+sxsdk::shape_class* Shade3DUtil::findMasterImageShape (sxsdk::scene_interface* scene, const std::string& name)
+{
+	if (name == "") return NULL;
+
+	// マスターイメージパートを取得.
+	sxsdk::shape_class* pMasterImagePart = findMasteImagePart(scene);
+	if (!pMasterImagePart || !(pMasterImagePart->has_son())) return NULL;
+
+	try {
+		sxsdk::shape_class* pS = pMasterImagePart->get_son();
+		while (pS->has_bro()) {
+			pS = pS->get_bro();
+			if (!pS) break;
+			if (pS->get_type() != sxsdk::enums::master_image) continue;
+			if (std::string(pS->get_name()) == name) return pS;
+		}
+	} catch (...) { }
+
+	return NULL;
+}
+
 /**
  * ボーンのルートを取得.
  * @param[in]  rootShape     検索を開始するルート.
@@ -606,15 +639,17 @@ compointer<sxsdk::image_interface> Shade3DUtil::duplicateImageWithAlpha (sxsdk::
 		compointer<sxsdk::image_interface> image2(image->duplicate_image());
 		const int wid = image->get_size().x;
 		const int hei = image->get_size().y;
-		std::vector<sxsdk::rgba_class> lineD;
+		std::vector<sx::rgba8_class> lineD;
 		lineD.resize(wid);
 
+		// アルファ値は0-255の範囲で乗算する.
+		const int iAlpha = std::min(std::max((int)(alpha * 256.0f + 0.5f), 0), 256);
 		for (int y = 0; y < hei; ++y) {
-			image2->get_pixels_rgba_float(0, y, wid, 1, &(lineD[0]));
+			image2->get_pixels_rgba(0, y, wid, 1, &(lineD[0]));
 			for (int x = 0; x < wid; ++x) {
-				lineD[x].alpha *= alpha;
+				lineD[x].alpha = (unsigned char)(((int)lineD[x].alpha * iAlpha + 128) >> 8);
 			}
-			image2->set_pixels_rgba_float(0, y, wid, 1, &(lineD[0]));
+			image2->set_pixels_rgba(0, y, wid, 1, &(lineD[0]));
 		}
 		return image2;
 
@@ -632,14 +667,13 @@ namespace {
 			bool hasAlpha = false;
 			const int wid = image->get_size().x;
 			const int hei = image->get_size().y;
-			std::vector<sxsdk::rgba_class> lineD;
+			std::vector<sx::rgba8_class> lineD;
 			lineD.resize(wid);
 
 			for (int y = 0; y < hei; ++y) {
-				image->get_pixels_rgba_float(0, y, wid, 1, &(lineD[0]));
+				image->get_pixels_rgba(0, y, wid, 1, &(lineD[0]));
 				for (int x = 0; x < wid; ++x) {
-					const float a = lineD[x].alpha;
-					if (!MathUtil::isZero(a - 1.0f)) {
+					if (lineD[x].alpha != 255) {
 						hasAlpha = true;
 						break;
 					}
@@ -674,110 +708,111 @@ bool Shade3DUtil::hasImageAlpha (sxsdk::image_interface* image)
 	return ::m_hasImageAlpha(image);
 }
 
+namespace {
+	/**
+	 * 画像を指定のサイズにリサイズ.
+	 * 画素を1度だけ読み込み、ImageResamplerで拡大縮小したものを新しいイメージに格納する.
+	 */
+	sxsdk::image_interface* m_resizeImage (sxsdk::scene_interface* scene, sxsdk::image_interface* image, const sx::vec<int,2>& size) {
+		if (!image || size.x <= 0 || size.y <= 0) return NULL;
+
+		sxsdk::image_interface* retImage = NULL;
+		try {
+			std::vector<unsigned char> srcRGBA;
+			int srcWidth, srcHeight;
+			if (!Shade3DUtil::getImageRGBA8(image, srcRGBA, srcWidth, srcHeight)) return NULL;
+
+			std::vector<unsigned char> dstRGBA((size_t)size.x * (size_t)size.y * 4);
+			if (!ImageResampler::resize(&(srcRGBA[0]), srcWidth, srcHeight, &(dstRGBA[0]), size.x, size.y)) return NULL;
+			std::vector<unsigned char>().swap(srcRGBA);
+
+			retImage = scene->create_image_interface(size);
+			Shade3DUtil::setImageRGBA8(retImage, &(dstRGBA[0]), size.x, size.y);
+			retImage->update();
+
+		} catch (...) { }
+
+		return retImage;
+	}
+}
+
 /**
  * 画像を指定のサイズにリサイズ。アルファも考慮（image->duplicate_imageはアルファを考慮しないため）.
+ * アルファを乗算済みの色として補間するため、半透明の境界が暗くならない.
  * @param[in] image  元の画像.
  * @param[in] size   変更するサイズ.
  */
 compointer<sxsdk::image_interface> Shade3DUtil::resizeImageWithAlpha (sxsdk::scene_interface* scene, sxsdk::image_interface* image, const sx::vec<int,2>& size)
 {
-	// アルファを持たない場合はimage->duplicate_imageを使用.
-	if (!::m_hasImageAlpha(image)) {
-		return compointer<sxsdk::image_interface>(image->duplicate_image(&size));
-	}
+	return compointer<sxsdk::image_interface>(::m_resizeImage(scene, image, size));
+}
 
-	compointer<sxsdk::image_interface> retImage;
-	try {
-		// Alpha要素をいったんRedに入れて、sizeの大きさにリサイズ.
-		const sx::vec<int,2> orgSize = image->get_size();
-		compointer<sxsdk::image_interface> alphaImage(scene->create_image_interface(orgSize));
-		{
-			const int wid = image->get_size().x;
-			const int hei = image->get_size().y;
-			std::vector<sxsdk::rgba_class> lineD, lineD2;
-			lineD.resize(wid);
-			lineD2.resize(wid, sxsdk::rgba_class(0, 0, 0, 1));
-			for (int y = 0; y < hei; ++y) {
-				image->get_pixels_rgba_float(0, y, wid, 1, &(lineD[0]));
-				for (int x = 0; x < wid; ++x) lineD2[x].red = lineD[x].alpha;
-				alphaImage->set_pixels_rgba_float(0, y, wid, 1, &(lineD2[0]));
-			}
-		}
-		alphaImage->update();
-		compointer<sxsdk::image_interface> alphaImage2(alphaImage->duplicate_image(&size));
+/**
+ * compointerを使用せずにイメージをリサイズ.
+ */
+sxsdk::image_interface* Shade3DUtil::resizeImageWithAlphaNotCom (sxsdk::scene_interface* scene, sxsdk::image_interface* image, const sx::vec<int,2>& size)
+{
+	return ::m_resizeImage(scene, image, size);
+}
 
-		// imageをsizeの大きさにリサイズし、アルファも更新.
-		retImage = compointer<sxsdk::image_interface>(image->duplicate_image(&size));
-		{
-			const int wid = size.x;
-			const int hei = size.y;
-			std::vector<sxsdk::rgba_class> lineD, lineD2;
-			lineD.resize(wid);
-			lineD2.resize(wid);
-			for (int y = 0; y < hei; ++y) {
-				retImage->get_pixels_rgba_float(0, y, wid, 1, &(lineD[0]));
-				alphaImage2->get_pixels_rgba_float(0, y, wid, 1, &(lineD2[0]));
+/**
+ * 画像のピクセルを1ピクセルRGBA(4バイト)で取得.
+ */
+bool Shade3DUtil::getImageRGBA8 (sxsdk::image_interface* image, std::vector<unsigned char>& rgbaData, int& width, int& height)
+{
+	rgbaData.clear();
+	width = height = 0;
+	if (!image || !(image->has_image())) return false;
 
-				for (int x = 0; x < wid; ++x) lineD[x].alpha = lineD2[x].red;
-				retImage->set_pixels_rgba_float(0, y, wid, 1, &(lineD[0]));
+	try {
+		width  = image->get_size().x;
+		height = image->get_size().y;
+		if (width <= 0 || height <= 0) return false;
+
+		rgbaData.resize((size_t)width * (size_t)height * 4);
+		std::vector<sx::rgba8_class> colLines;
+		colLines.resize(width);
+
+		size_t iPos = 0;
+		for (int y = 0; y < height; ++y) {
+			image->get_pixels_rgba(0, y, width, 1, &(colLines[0]));
+			for (int x = 0; x < width; ++x) {
+				const sx::rgba8_class& col = colLines[x];
+				rgbaData[iPos + 0] = col.red;
+				rgbaData[iPos + 1] = col.green;
+				rgbaData[iPos + 2] = col.blue;
+				rgbaData[iPos + 3] = col.alpha;
+				iPos += 4;
 			}
 		}
-		retImage->update();
+		return true;
 
 	} catch (...) { }
 
-	return retImage;
+	rgbaData.clear();
+	width = height = 0;
+	return false;
 }
 
 /**
- * compointerを使用せずにイメージをリサイズ.
+ * 1ピクセルRGBA(4バイト)の画素を画像に格納.
  */
-sxsdk::image_interface* Shade3DUtil::resizeImageWithAlphaNotCom (sxsdk::scene_interface* scene, sxsdk::image_interface* image, const sx::vec<int,2>& size)
+bool Shade3DUtil::setImageRGBA8 (sxsdk::image_interface* image, const unsigned char* rgbaData, const int width, const int height)
 {
-	// アルファを持たない場合はimage->duplicate_imageを使用.
-	if (!::m_hasImageAlpha(image)) {
-		return image->duplicate_image(&size);
-	}
+	if (!image || !rgbaData || width <= 0 || height <= 0) return false;
 
-	sxsdk::image_interface* retImage = NULL;
 	try {
-		// Alpha要素をいったんRedに入れて、sizeの大きさにリサイズ.
-		const sx::vec<int,2> orgSize = image->get_size();
-		compointer<sxsdk::image_interface> alphaImage(scene->create_image_interface(orgSize));
-		{
-			const int wid = image->get_size().x;
-			const int hei = image->get_size().y;
-			std::vector<sxsdk::rgba_class> lineD, lineD2;
-			lineD.resize(wid);
-			lineD2.resize(wid, sxsdk::rgba_class(0, 0, 0, 1));
-			for (int y = 0; y < hei; ++y) {
-				image->get_pixels_rgba_float(0, y, wid, 1, &(lineD[0]));
-				for (int x = 0; x < wid; ++x) lineD2[x].red = lineD[x].alpha;
-				alphaImage->set_pixels_rgba_float(0, y, wid, 1, &(lineD2[0]));
-			}
-		}
-		alphaImage->update();
-		compointer<sxsdk::image_interface> alphaImage2(alphaImage->duplicate_image(&size));
+		if (image->get_size().x < width || image->get_size().y < height) return false;
 
-		// imageをsizeの大きさにリサイズし、アルファも更新.
-		retImage = image->duplicate_image(&size);
-		{
-			const int wid = size.x;
-			const int hei = size.y;
-			std::vector<sxsdk::rgba_class> lineD, lineD2;
-			lineD.resize(wid);
-			lineD2.resize(wid);
-			for (int y = 0; y < hei; ++y) {
-				retImage->get_pixels_rgba_float(0, y, wid, 1, &(lineD[0]));
-				alphaImage2->get_pixels_rgba_float(0, y, wid, 1, &(lineD2[0]));
-
-				for (int x = 0; x < wid; ++x) lineD[x].alpha = lineD2[x].red;
-				retImage->set_pixels_rgba_float(0, y, wid, 1, &(lineD[0]));
-			}
+		// sx::rgba8_classはR/G/B/Aの順に並ぶため、まとめて格納する.
+		const int bandRows = std::max(1, std::min(height, (int)(SET_IMAGE_BAND_MAX_BYTES / ((size_t)width * 4))));
+		for (int y = 0; y < height; y += bandRows) {
+			const int rowsCou = std::min(bandRows, height - y);
+			image->set_pixels_rgba(0, y, width, rowsCou, reinterpret_cast<const sx::rgba8_class*>(rgbaData + (size_t)y * (size_t)width * 4));
 		}
-		retImage->update();
+		return true;
 
 	} catch (...) { }
 
-	return retImage;
+	return false;
 }
@@ -47,6 +47,14 @@ namespace Shade3DUtil
 	 */
 	sxsdk::master_image_class* getMasterImageFromImage (sxsdk::scene_interface* scene, sxsdk::image_interface* image);
 
+	/**
+	 * 指定の名前のマスターイメージ形状を取得.
+	 * @param[in] scene  シーンクラス.
+	 * @param[in] name   マスターイメージ名.
+	 * @return マスターイメージが存在する場合はその形状のポインタ.
+	 */
+	sxsdk::shape_class* findMasterImageShape (sxsdk::scene_interface* scene, const std::string& name);
+
 	/**
 	 * ボーンのルートを取得.
 	 * @param[in]  rootShape     検索を開始するルート.
@@ -168,6 +176,24 @@ namespace Shade3DUtil
 	 */
 	sxsdk::image_interface* resizeImageWithAlphaNotCom (sxsdk::scene_interface* scene, sxsdk::image_interface* image, const sx::vec<int,2>& size);
 
+	/**
+	 * 画像のピクセルを1ピクセルRGBA(4バイト)で取得.
+	 * @param[in]  image     画像.
+	 * @param[out] rgbaData  RGBAの配列.
+	 * @param[out] width     画像の幅.
+	 * @param[out] height    画像の高さ.
+	 */
+	bool getImageRGBA8 (sxsdk::image_interface* image, std::vector<unsigned char>& rgbaData, int& width, int& height);
+
+	/**
+	 * 1ピクセルRGBA(4バイト)の画素を画像に格納.
+	 * @param[in] image     画像 (width x height以上のサイズであること).
+	 * @param[in] rgbaData  RGBAの配列.
+	 * @param[in] width     幅.
+	 * @param[in] height    高さ.
+	 */
+	bool setImageRGBA8 (sxsdk::image_interface* image, const unsigned char* rgbaData, const int width, const int height);
+
 }
 
 #endif
@@ -21,6 +21,7 @@ public:
 public:
 	CSkinData ();
 	CSkinData (const CSkinData& v);
+	CSkinData (CSkinData&& v) = default;
 	~CSkinData ();
 
     CSkinData& operator = (const CSkinData &v) {
@@ -31,6 +32,7 @@ public:
 		this->joints              = v.joints;
 		return (*this);
     }
+	CSkinData& operator = (CSkinData &&v) = default;
 
 	void clear ();
 };
@@ -45,6 +45,12 @@ void StreamCtrl::saveImportDialogParam (sxsdk::shade_interface& shade, const CIm
 			stream->write_int(iDat);
 		}
 
+		// GLTF_IMPORTER_DLG_STREAM_VERSION_102.
+		{
+			iDat = data.keepImageSource ? 1 : 0;
+			stream->write_int(iDat);
+		}
+
 	} catch (...) { }
 }
 
@@ -86,6 +92,12 @@ void StreamCtrl::loadImportDialogParam (sxsdk::shade_interface& shade, CImportDl
 				data.convertColorFromLinear = iDat ? true : false;
 			}
 		}
+		if (iVersion >= GLTF_IMPORTER_DLG_STREAM_VERSION_102) {
+			{
+				stream->read_int(iDat);
+				data.keepImageSource = iDat ? true : false;
+			}
+		}
 
 	} catch (...) { }
 }
@@ -188,6 +200,45 @@ void StreamCtrl::saveExportDialogParam (sxsdk::shade_interface& shade, const CEx
 			stream->write_int(iDat);
 		}
 
+		// ver.0.2.5.3 - .
+		{
+			stream->write_int(data.pngCompressionLevel);
+			stream->write_int(data.jpegQuality);
+		}
+
+		// ver.0.2.5.4 - .
+		{
+			iDat = data.staticBatching ? 1 : 0;
+			stream->write_int(iDat);
+			stream->write_int(data.staticBatchingMaxVertices);
+		}
+
+		// ver.0.2.5.5 - .
+		{
+			iDat = data.flattenHierarchy ? 1 : 0;
+			stream->write_int(iDat);
+		}
+
+		// ver.0.2.5.6 - .
+		{
+			iDat = data.generateLODs ? 1 : 0;
+			stream->write_int(iDat);
+			for (int i = 0; i < 3; ++i) stream->write_int(data.lodRatios[i]);
+		}
+
+		// ver.0.2.5.7 - .
+		{
+			iDat = data.useBakeDiskCache ? 1 : 0;
+			stream->write_int(iDat);
+		}
+
+		// ver.0.2.5.8 - .
+		{
+			iDat = data.bakeStreaming ? 1 : 0;
+			stream->write_int(iDat);
+			stream->write_int(data.bakeMemoryBudget);
+		}
+
 	} catch (...) { }
 }
 
@@ -289,6 +340,45 @@ void StreamCtrl::loadExportDialogParam (sxsdk::shade_interface& shade, CExportDl
 			data.separateOpacityAndTransmission = iDat ? true : false;
 		}
 
+		// ver.0.2.5.3 - .
+		if (iVersion >= GLTF_EXPORTER_DLG_STREAM_VERSION_106) {
+			stream->read_int(data.pngCompressionLevel);
+			stream->read_int(data.jpegQuality);
+		}
+
+		// ver.0.2.5.4 - .
+		if (iVersion >= GLTF_EXPORTER_DLG_STREAM_VERSION_107) {
+			stream->read_int(iDat);
+			data.staticBatching = iDat ? true : false;
+			stream->read_int(data.staticBatchingMaxVertices);
+		}
+
+		// ver.0.2.5.5 - .
+		if (iVersion >= GLTF_EXPORTER_DLG_STREAM_VERSION_108) {
+			stream->read_int(iDat);
+			data.flattenHierarchy = iDat ? true : false;
+		}
+
+		// ver.0.2.5.6 - .
+		if (iVersion >= GLTF_EXPORTER_DLG_STREAM_VERSION_109) {
+			stream->read_int(iDat);
+			data.generateLODs = iDat ? true : false;
+			for (int i = 0; i < 3; ++i) stream->read_int(data.lodRatios[i]);
+		}
+
+		// ver.0.2.5.7 - .
+		if (iVersion >= GLTF_EXPORTER_DLG_STREAM_VERSION_10A) {
+			stream->read_int(iDat);
+			data.useBakeDiskCache = iDat ? true : false;
+		}
+
+		// ver.0.2.5.8 - .
+		if (iVersion >= GLTF_EXPORTER_DLG_STREAM_VERSION_10B) {
+			stream->read_int(iDat);
+			data.bakeStreaming = iDat ? true : false;
+			stream->read_int(data.bakeMemoryBudget);
+		}
+
 	} catch (...) { }
 }
 
@@ -596,3 +686,70 @@ bool StreamCtrl::loadAlphaModeMaterialParam (sxsdk::surface_class* surface, CAlp
 	} catch (...) { }
 	return false;
 }
+
+/**
+ * インポート時の元画像の情報をマスターイメージに保存.
+ */
+void StreamCtrl::saveImageSourceData (sxsdk::shape_class& shape, const CImageSourceData& data)
+{
+	try {
+		compointer<sxsdk::stream_interface> stream(shape.create_attribute_stream_interface_with_uuid(GLTF_IMPORTER_INTERFACE_ID));
+		if (!stream) return;
+		stream->set_pointer(0);
+		stream->set_size(0);
+
+		int iVersion = GLTF_IMAGE_SOURCE_STREAM_VERSION;
+		char szStr[68];
+		stream->write_int(iVersion);
+		{
+			memset(szStr, 0, 64);
+			memcpy(szStr, &(data.mimeType[0]), std::min((int)data.mimeType.length(), 62));
+			stream->write(64, szStr);
+		}
+		stream->write_int(data.width);
+		stream->write_int(data.height);
+		stream->write(8, (char *)&(data.dataHash));
+		stream->write(8, (char *)&(data.pixelsHash));
+
+		const int dataSize = (int)data.imageDatas.size();
+		stream->write_int(dataSize);
+		if (dataSize > 0) stream->write(dataSize, (char *)&(data.imageDatas[0]));
+
+	} catch (...) { }
+}
+
+/**
+ * マスターイメージからインポート時の元画像の情報を読み込み.
+ */
+bool StreamCtrl::loadImageSourceData (sxsdk::shape_class& shape, CImageSourceData& data, const bool loadImageDatas)
+{
+	data.clear();
+	try {
+		compointer<sxsdk::stream_interface> stream(shape.get_attribute_stream_interface_with_uuid(GLTF_IMPORTER_INTERFACE_ID));
+		if (!stream) return false;
+		stream->set_pointer(0);
+
+		int iVersion;
+		char szStr[68];
+		stream->read_int(iVersion);
+		{
+			stream->read(64, szStr);
+			data.mimeType = std::string(szStr);
+		}
+		stream->read_int(data.width);
+		stream->read_int(data.height);
+		stream->read(8, (char *)&(data.dataHash));
+		stream->read(8, (char *)&(data.pixelsHash));
+
+		int dataSize = 0;
+		stream->read_int(dataSize);
+		if (dataSize <= 0) return false;
+		if (loadImageDatas) {
+			data.imageDatas.resize(dataSize);
+			stream->read(dataSize, (char *)&(data.imageDatas[0]));
+		}
+
+		return true;
+	} catch (...) { }
+	return false;
+}
@@ -65,6 +65,17 @@ namespace StreamCtrl
 	bool loadAlphaModeMaterialParam (sxsdk::surface_interface* surface, CAlphaModeMaterialData& data);
 	bool loadAlphaModeMaterialParam (sxsdk::surface_class* surface, CAlphaModeMaterialData& data);
 
+	/**
+	 * インポート時の元画像の情報をマスターイメージに保存.
+	 */
+	void saveImageSourceData (sxsdk::shape_class& shape, const CImageSourceData& data);
+
+	/**
+	 * マスターイメージからインポート時の元画像の情報を読み込み.
+	 * @param[in]  loadImageDatas  falseの場合は画像のバイト列は読み込まず、サイズとハッシュ値のみを取得.
+	 */
+	bool loadImageSourceData (sxsdk::shape_class& shape, CImageSourceData& data, const bool loadImageDatas = true);
+
 }
 
 #endif
@@ -0,0 +1,184 @@
+﻿/**
+ * 法線マップ用の接線(TANGENT)の計算.
+ */
+#include "TangentGenerator.h"
+
+#include <algorithm>
+#include <math.h>
+
+namespace {
+	/**
+	 * 法線に垂直な成分を取り出して正規化.
+	 * @return 長さが0の場合はfalse.
+	 */
+	bool projectToPlane (const sxsdk::vec3& v, const sxsdk::vec3& n, sxsdk::vec3& retV) {
+		const float d = v.x * n.x + v.y * n.y + v.z * n.z;
+		const sxsdk::vec3 v2 = v - n * d;
+		const float len = sqrtf(v2.x * v2.x + v2.y * v2.y + v2.z * v2.z);
+		if (len <= 1e-20f) return false;
+		retV = v2 * (1.0f / len);
+		return true;
+	}
+
+	/**
+	 * 頂点を末尾に複製.
+	 * 頂点ごとの情報と、Morph Targetsの参照も複製する.
+	 * @return 複製した頂点番号.
+	 */
+	int duplicateVertex (CPrimitiveData& primitiveD, const int vIndex) {
+		const size_t versCou = primitiveD.vertices.size();
+		const int newIndex = (int)versCou;
+		primitiveD.vertices.push_back(primitiveD.vertices[vIndex]);
+		if (primitiveD.normals.size() == versCou) primitiveD.normals.push_back(primitiveD.normals[vIndex]);
+		if (primitiveD.uv0.size() == versCou) primitiveD.uv0.push_back(primitiveD.uv0[vIndex]);
+		if (primitiveD.uv1.size() == versCou) primitiveD.uv1.push_back(primitiveD.uv1[vIndex]);
+		if (primitiveD.color0.size() == versCou) primitiveD.color0.push_back(primitiveD.color0[vIndex]);
+		if (primitiveD.skinWeights.size() == versCou) primitiveD.skinWeights.push_back(primitiveD.skinWeights[vIndex]);
+		if (primitiveD.skinJoints.size() == versCou) primitiveD.skinJoints.push_back(primitiveD.skinJoints[vIndex]);
+		if (primitiveD.skinJointsHandle.size() == versCou) primitiveD.skinJointsHandle.push_back(primitiveD.skinJointsHandle[vIndex]);
+
+		std::vector<COneMorphTargetData>& targets = primitiveD.morphTargets.morphTargetsData;
+		for (size_t i = 0; i < targets.size(); ++i) {
+			COneMorphTargetData& targetD = targets[i];
+			const size_t cou = targetD.vIndices.size();
+			for (size_t j = 0; j < cou; ++j) {
+				if (targetD.vIndices[j] != vIndex) continue;
+				targetD.vIndices.push_back(newIndex);
+				if (targetD.position.size() == cou) targetD.position.push_back(targetD.position[j]);
+				if (targetD.normal.size() == cou) targetD.normal.push_back(targetD.normal[j]);
+				if (targetD.tangent.size() == cou) targetD.tangent.push_back(targetD.tangent[j]);
+				break;
+			}
+		}
+		return newIndex;
+	}
+}
+
+/**
+ * 三角形から頂点ごとの接線を計算し、primitiveD.tangentsに格納.
+ */
+bool TangentGenerator::generateTangents (CPrimitiveData& primitiveD, const std::vector<std::vector<int>*>& indicesList, const int texCoord)
+{
+	const std::vector<sxsdk::vec2>& uvs = (texCoord == 1) ? primitiveD.uv1 : primitiveD.uv0;
+	const size_t srcVersCou = primitiveD.vertices.size();
+	if (srcVersCou == 0 || primitiveD.normals.size() != srcVersCou || uvs.size() != srcVersCou) return false;
+
+	for (size_t i = 0; i < indicesList.size(); ++i) {
+		const std::vector<int>& indices = *(indicesList[i]);
+		if ((indices.size() % 3) != 0) return false;
+		for (size_t j = 0; j < indices.size(); ++j) {
+			if (indices[j] < 0 || indices[j] >= (int)srcVersCou) return false;
+		}
+	}
+
+	// 三角形ごとに、UV空間でのU方向(dP/du)と向きを計算.
+	// glTFのUVは左上原点であるため、Vを反転して法線マップ(+Yが上)の向きに合わせる.
+	std::vector<sxsdk::vec3> triTangents;
+	std::vector<char> triOrients;			// 1 : UVの向きが保たれる、-1 : 反転、0 : UVが縮退.
+	for (size_t i = 0; i < indicesList.size(); ++i) {
+		const std::vector<int>& indices = *(indicesList[i]);
+		for (size_t j = 0; j < indices.size(); j += 3) {
+			const int i0 = indices[j + 0];
+			const int i1 = indices[j + 1];
+			const int i2 = indices[j + 2];
+			const sxsdk::vec3 d1 = primitiveD.vertices[i1] - primitiveD.vertices[i0];
+			const sxsdk::vec3 d2 = primitiveD.vertices[i2] - primitiveD.vertices[i0];
+			const float t21x = uvs[i1].x - uvs[i0].x;
+			const float t21y = -(uvs[i1].y - uvs[i0].y);
+			const float t31x = uvs[i2].x - uvs[i0].x;
+			const float t31y = -(uvs[i2].y - uvs[i0].y);
+
+			const float signedAreaSTx2 = t21x * t31y - t21y * t31x;
+			const float fS = (signedAreaSTx2 > 0.0f) ? 1.0f : -1.0f;
+			sxsdk::vec3 vOs = (d1 * t31y - d2 * t21y) * fS;
+			const float lenOs = sqrtf(vOs.x * vOs.x + vOs.y * vOs.y + vOs.z * vOs.z);
+			if (fabsf(signedAreaSTx2) <= 1e-20f || lenOs <= 1e-20f) {
+				triTangents.push_back(sxsdk::vec3(0, 0, 0));
+				triOrients.push_back(0);
+			} else {
+				triTangents.push_back(vOs * (1.0f / lenOs));
+				triOrients.push_back((signedAreaSTx2 > 0.0f) ? 1 : -1);
+			}
+		}
+	}
+
+	// 頂点ごとの、UVの向きが保たれる三角形/反転した三角形の数.
+	std::vector<int> positiveCount(srcVersCou, 0);
+	std::vector<int> negativeCount(srcVersCou, 0);
+	{
+		size_t triIndex = 0;
+		for (size_t i = 0; i < indicesList.size(); ++i) {
+			const std::vector<int>& indices = *(indicesList[i]);
+			for (size_t j = 0; j < indices.size(); j += 3, ++triIndex) {
+				for (int k = 0; k < 3; ++k) {
+					if (triOrients[triIndex] > 0) positiveCount[indices[j + k]]++;
+					else if (triOrients[triIndex] < 0) negativeCount[indices[j + k]]++;
+				}
+			}
+		}
+	}
+
+	// 両方の向きの三角形から参照される頂点は複製し、反転した三角形は複製した頂点を参照する.
+	std::vector<int> mirrorIndex(srcVersCou, -1);
+	for (size_t i = 0; i < srcVersCou; ++i) {
+		if (positiveCount[i] > 0 && negativeCount[i] > 0) mirrorIndex[i] = duplicateVertex(primitiveD, (int)i);
+	}
+	{
+		size_t triIndex = 0;
+		for (size_t i = 0; i < indicesList.size(); ++i) {
+			std::vector<int>& indices = *(indicesList[i]);
+			for (size_t j = 0; j < indices.size(); j += 3, ++triIndex) {
+				if (triOrients[triIndex] >= 0) continue;
+				for (int k = 0; k < 3; ++k) {
+					const int vIndex = indices[j + k];
+					if (vIndex < (int)srcVersCou && mirrorIndex[vIndex] >= 0) indices[j + k] = mirrorIndex[vIndex];
+				}
+			}
+		}
+	}
+
+	// 頂点の法線に垂直な接線を、頂点での三角形の角度で重み付けして加算.
+	const size_t versCou = primitiveD.vertices.size();
+	std::vector<sxsdk::vec3> sumTangents(versCou, sxsdk::vec3(0, 0, 0));
+	std::vector<char> vertexOrients(versCou, 0);
+	{
+		size_t triIndex = 0;
+		for (size_t i = 0; i < indicesList.size(); ++i) {
+			const std::vector<int>& indices = *(indicesList[i]);
+			for (size_t j = 0; j < indices.size(); j += 3, ++triIndex) {
+				if (triOrients[triIndex] == 0) continue;
+				for (int k = 0; k < 3; ++k) {
+					const int vIndex = indices[j + k];
+					const int prevIndex = indices[j + ((k + 2) % 3)];
+					const int nextIndex = indices[j + ((k + 1) % 3)];
+					const sxsdk::vec3 n = primitiveD.normals[vIndex];
+
+					sxsdk::vec3 t, e1, e2;
+					if (!projectToPlane(triTangents[triIndex], n, t)) continue;
+					if (!projectToPlane(primitiveD.vertices[nextIndex] - primitiveD.vertices[vIndex], n, e1)) continue;
+					if (!projectToPlane(primitiveD.vertices[prevIndex] - primitiveD.vertices[vIndex], n, e2)) continue;
+					const float cosV = std::min(std::max(e1.x * e2.x + e1.y * e2.y + e1.z * e2.z, -1.0f), 1.0f);
+					const float angle = acosf(cosV);
+
+					sumTangents[vIndex] = sumTangents[vIndex] + t * angle;
+					vertexOrients[vIndex] = triOrients[triIndex];
+				}
+			}
+		}
+	}
+
+	// 接線を正規化. 接線が求まらない頂点は、法線に垂直な任意の向きとする.
+	primitiveD.tangents.resize(versCou);
+	for (size_t i = 0; i < versCou; ++i) {
+		const sxsdk::vec3& n = primitiveD.normals[i];
+		sxsdk::vec3 t;
+		if (!projectToPlane(sumTangents[i], n, t)) {
+			if (!projectToPlane(sxsdk::vec3(1, 0, 0), n, t)) {
+				if (!projectToPlane(sxsdk::vec3(0, 0, 1), n, t)) t = sxsdk::vec3(1, 0, 0);
+			}
+		}
+		primitiveD.tangents[i] = sxsdk::vec4(t.x, t.y, t.z, (vertexOrients[i] < 0) ? -1.0f : 1.0f);
+	}
+
+	return true;
+}
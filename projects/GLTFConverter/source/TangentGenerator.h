@@ -0,0 +1,27 @@
+﻿/**
+ * 法線マップ用の接線(TANGENT)の計算.
+ * MikkTSpace (Morten S. Mikkelsen, "Simulation of Wrinkled Surfaces Revisited") と同じ手順で頂点ごとの接線を求める.
+ * Shade3DのAPIは使用していないため、Primitiveごとに複数スレッドから同時に呼び出すことができる.
+ */
+#ifndef _TANGENTGENERATOR_H
+#define _TANGENTGENERATOR_H
+
+#include "MeshData.h"
+
+#include <vector>
+
+namespace TangentGenerator {
+	/**
+	 * 三角形から頂点ごとの接線を計算し、primitiveD.tangentsに格納.
+	 * 接線のwは従法線の向き (bitangent = cross(normal, tangent.xyz) * w).
+	 * UVの向きが反転した三角形とそうでない三角形が頂点を共有する場合は、頂点を複製して分ける.
+	 * @param[in,out] primitiveD   頂点情報を持つPrimitive.
+	 * @param[in,out] indicesList  primitiveDの頂点を参照する三角形の頂点インデックスのリスト (接線を計算する三角形のみ).
+	 *                             複製した頂点を参照するように置き換えられる.
+	 * @param[in]     texCoord     接線の計算に使用するUV (0 or 1).
+	 * @return 接線を計算した場合はtrue.
+	 */
+	bool generateTangents (CPrimitiveData& primitiveD, const std::vector<std::vector<int>*>& indicesList, const int texCoord);
+}
+
+#endif
@@ -0,0 +1,129 @@
+﻿/**
+ * 簡易スレッドプール.
+ */
+#include "ThreadPool.h"
+
+#include <algorithm>
+
+namespace {
+	// このスレッドがparallelForのfuncを実行中か.
+	thread_local bool t_inParallelFor = false;
+}
+
+CThreadPool::CThreadPool (const int threadsCou) : m_count(0), m_nextIndex(0), m_finishedCount(0), m_generation(0), m_terminate(false)
+{
+	int cou = threadsCou;
+	if (cou <= 0) cou = std::max((int)std::thread::hardware_concurrency() - 1, 1);
+	m_threads.reserve(cou);
+	for (int i = 0; i < cou; ++i) {
+		m_threads.push_back(std::thread(&CThreadPool::m_workerLoop, this));
+	}
+}
+
+CThreadPool::~CThreadPool ()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_terminate = true;
+	}
+	m_wakeCond.notify_all();
+	for (size_t i = 0; i < m_threads.size(); ++i) {
+		if (m_threads[i].joinable()) m_threads[i].join();
+	}
+}
+
+/**
+ * 共有のスレッドプールを取得.
+ */
+CThreadPool& CThreadPool::getInstance ()
+{
+	static CThreadPool pool;
+	return pool;
+}
+
+/**
+ * 未処理のインデックスを取得して処理を行う.
+ */
+int CThreadPool::m_runTasks (std::unique_lock<std::mutex>& lock)
+{
+	int cou = 0;
+	while (m_nextIndex < m_count) {
+		const int index = m_nextIndex++;
+		lock.unlock();
+		const bool prevInParallelFor = t_inParallelFor;
+		t_inParallelFor = true;
+		try {
+			m_func(index);
+			t_inParallelFor = prevInParallelFor;
+		} catch (...) {
+			t_inParallelFor = prevInParallelFor;
+			lock.lock();
+			if (!m_exception) m_exception = std::current_exception();
+
+			// 残りは処理しない.
+			cou += m_count - m_nextIndex;
+			m_nextIndex = m_count;
+			lock.unlock();
+		}
+		lock.lock();
+		cou++;
+	}
+	return cou;
+}
+
+/**
+ * ワーカースレッドの処理.
+ */
+void CThreadPool::m_workerLoop ()
+{
+	int generation = 0;
+	std::unique_lock<std::mutex> lock(m_mutex);
+	while (true) {
+		m_wakeCond.wait(lock, [&]() { return m_terminate || (generation != m_generation && m_nextIndex < m_count); });
+		if (m_terminate) break;
+		generation = m_generation;
+
+		const int cou = m_runTasks(lock);
+		m_finishedCount += cou;
+		if (m_finishedCount >= m_count) m_doneCond.notify_all();
+	}
+}
+
+/**
+ * 0 - (count - 1)のインデックスでfuncを並列に実行し、すべて終わるまで待つ.
+ */
+void CThreadPool::parallelFor (const int count, const std::function<void (const int)>& func)
+{
+	if (count <= 0) return;
+	if (count == 1 || m_threads.empty() || t_inParallelFor) {
+		for (int i = 0; i < count; ++i) func(i);
+		return;
+	}
+
+	// 複数スレッドからの同時呼び出しは順番に処理する.
+	static std::mutex callMutex;
+	std::lock_guard<std::mutex> callLock(callMutex);
+
+	std::unique_lock<std::mutex> lock(m_mutex);
+	m_func          = func;
+	m_count         = count;
+	m_nextIndex     = 0;
+	m_finishedCount = 0;
+	m_exception     = nullptr;
+	m_generation++;
+	m_wakeCond.notify_all();
+
+	m_finishedCount += m_runTasks(lock);
+	m_doneCond.wait(lock, [&]() { return m_finishedCount >= m_count; });
+
+	m_func  = nullptr;
+	m_count = 0;
+	m_nextIndex = 0;
+
+	if (m_exception) {
+		std::exception_ptr e = m_exception;
+		m_exception = nullptr;
+		lock.unlock();
+		std::rethrow_exception(e);
+	}
+}
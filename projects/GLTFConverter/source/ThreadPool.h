@@ -0,0 +1,69 @@
+﻿/**
+ * 簡易スレッドプール.
+ * Shade3DのAPIはメインスレッド以外から呼び出さないこと.
+ */
+#ifndef _THREADPOOL_H
+#define _THREADPOOL_H
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <exception>
+
+class CThreadPool
+{
+private:
+	std::vector<std::thread> m_threads;
+	std::mutex m_mutex;
+	std::condition_variable m_wakeCond;			///< ワーカーに処理開始を通知.
+	std::condition_variable m_doneCond;			///< 呼び出し元に処理完了を通知.
+
+	std::function<void (const int)> m_func;		///< 実行中の処理.
+	int m_count;								///< 処理の総数.
+	int m_nextIndex;							///< 次に処理するインデックス.
+	int m_finishedCount;						///< 処理が終わった数.
+	int m_generation;							///< parallelForの呼び出しごとに加算.
+	std::exception_ptr m_exception;				///< 処理中に最初に発生した例外.
+	bool m_terminate;
+
+	/**
+	 * ワーカースレッドの処理.
+	 */
+	void m_workerLoop ();
+
+	/**
+	 * 未処理のインデックスを取得して処理を行う.
+	 * 例外が発生した場合は、それを保持して残りのインデックスを処理済みとする.
+	 * @return 処理した数 (スキップした数を含む).
+	 */
+	int m_runTasks (std::unique_lock<std::mutex>& lock);
+
+public:
+	/**
+	 * @param[in] threadsCou  ワーカースレッド数 (0の場合はCPUのコア数 - 1).
+	 */
+	CThreadPool (const int threadsCou = 0);
+	~CThreadPool ();
+
+	/**
+	 * 共有のスレッドプールを取得.
+	 */
+	static CThreadPool& getInstance ();
+
+	/**
+	 * 呼び出し元を含めたスレッド数.
+	 */
+	int getThreadsCount () const { return (int)m_threads.size() + 1; }
+
+	/**
+	 * 0 - (count - 1)のインデックスでfuncを並列に実行し、すべて終わるまで待つ.
+	 * 呼び出し元のスレッドも処理に参加する.
+	 * funcの中から呼び出された場合 (入れ子の呼び出し) は、デッドロックしないようにそのスレッドで順番に実行する.
+	 * funcで例外が発生した場合は残りの処理を中断し、実行中の処理が終わってから最初の例外を呼び出し元で投げ直す.
+	 */
+	void parallelFor (const int count, const std::function<void (const int)>& func);
+};
+
+#endif
@@ -0,0 +1,465 @@
+﻿/**
+ * テクスチャを行のまとまり(バンド)ごとにベイクし、完成した行から順に出力する.
+ * 参照するイメージは「ライン」(回転なしの場合は行、90度回転の場合は列) 単位で読み込み、.
+ * ラインの方向(縦)の補間 => ライン上(横)の補間の順に、ImageResamplerで分離して拡大縮小する.
+ */
+#include "TileBaker.h"
+#include "ImageResampler.h"
+#include "ThreadPool.h"
+
+#include <string.h>
+#include <stdint.h>
+#include <algorithm>
+
+namespace {
+	// 90度回転時に、列を読み込む際の1度に読み込む列数.
+	const int ROTATE_READ_COLUMNS = 16;
+
+	/**
+	 * 1つのイメージの参照方法と、バンドごとに読み込んだライン.
+	 */
+	class CSamplingPlan
+	{
+	private:
+		TileBaker::CTileSource* m_source;
+		bool m_flipColor;
+		bool m_rotate90;
+		int m_srcWidth, m_srcHeight;
+		int m_lineLength;						// 1ラインの画素数.
+		int m_linesCount;						// イメージのライン数.
+
+		ImageResampler::CAxisWeights m_lineWeights;		// 出力の行 => ライン.
+		ImageResampler::CAxisWeights m_pixelWeights;	// 出力のx => ライン上の位置.
+
+		std::vector<int> m_lineSlots;			// ライン => m_lineStoreでの位置 (読み込んでいない場合は-1).
+		std::vector<unsigned char> m_lineStore;	// 読み込んだラインの画素.
+		std::vector<char> m_lineHasAlpha;		// 読み込んだラインに、Alphaが255でない画素があるか.
+		std::vector<int> m_loadedLines;			// 読み込んだライン.
+
+		/**
+		 * 指定の出力の行範囲で必要なラインを、昇順でlinesに格納.
+		 */
+		void m_collectLines (const int y0, const int rowsCou, std::vector<char>& marks, std::vector<int>& lines) const {
+			lines.clear();
+			marks.assign(m_linesCount, 0);
+			for (int y = y0; y < y0 + rowsCou; ++y) {
+				const int iEnd = m_lineWeights.starts[y + 1];
+				for (int i = m_lineWeights.starts[y]; i < iEnd; ++i) {
+					const int line = m_lineWeights.indices[i];
+					if (!marks[line]) {
+						marks[line] = 1;
+						lines.push_back(line);
+					}
+				}
+			}
+			std::sort(lines.begin(), lines.end());
+		}
+
+	public:
+		CSamplingPlan () : m_source(0), m_flipColor(false), m_rotate90(false), m_srcWidth(0), m_srcHeight(0), m_lineLength(0), m_linesCount(0) { }
+
+		bool isValid () const { return (m_source != 0); }
+		bool getFlipColor () const { return m_flipColor; }
+		int getLineLength () const { return m_lineLength; }
+
+		/**
+		 * 出力サイズに対するウエイトを計算.
+		 * 90度回転は、出力の(u, v)で回転前の(v, 1 - u)を参照する (CImagesBlend::m_duplicateImageと同じ向き).
+		 */
+		bool init (const TileBaker::CTileSampling& sampling, const int width, const int height) {
+			m_source = 0;
+			if (!sampling.source) return false;
+			m_srcWidth  = sampling.source->getWidth();
+			m_srcHeight = sampling.source->getHeight();
+			if (m_srcWidth <= 0 || m_srcHeight <= 0) return false;
+
+			m_flipColor = sampling.flipColor;
+			m_rotate90  = sampling.rotate90;
+			if (!m_rotate90) {
+				m_lineLength = m_srcWidth;
+				m_linesCount = m_srcHeight;
+				m_lineWeights.build(height, m_srcHeight, sampling.repeatV, sampling.flipV, sampling.filter);
+				m_pixelWeights.build(width, m_srcWidth, sampling.repeatU, sampling.flipH, sampling.filter);
+			} else {
+				m_lineLength = m_srcHeight;
+				m_linesCount = m_srcWidth;
+				m_lineWeights.build(height, m_srcWidth, sampling.repeatU, sampling.flipH, sampling.filter);
+				m_pixelWeights.build(width, m_srcHeight, sampling.repeatV, !sampling.flipV, sampling.filter);
+			}
+			m_source = sampling.source;
+			return true;
+		}
+
+		/**
+		 * 指定の出力の行範囲で読み込むラインのメモリ (bytes).
+		 */
+		size_t calcLinesMemory (const int y0, const int rowsCou, std::vector<char>& marks, std::vector<int>& lines) const {
+			if (!m_source) return 0;
+			m_collectLines(y0, rowsCou, marks, lines);
+			size_t size = lines.size() * (size_t)m_lineLength * 4;
+			if (m_rotate90) size += (size_t)ROTATE_READ_COLUMNS * (size_t)m_srcHeight * 4;
+			return size;
+		}
+
+		/**
+		 * 指定の出力の行範囲で必要なラインを読み込む.
+		 */
+		bool loadLines (const int y0, const int rowsCou) {
+			if (!m_source) return true;
+
+			std::vector<char> marks;
+			m_collectLines(y0, rowsCou, marks, m_loadedLines);
+			const int linesCou = (int)m_loadedLines.size();
+			const size_t lineBytes = (size_t)m_lineLength * 4;
+
+			m_lineSlots.assign(m_linesCount, -1);
+			m_lineStore.resize((size_t)linesCou * lineBytes);
+			for (int i = 0; i < linesCou; ++i) m_lineSlots[m_loadedLines[i]] = i;
+
+			std::vector<unsigned char> columns;
+			int i = 0;
+			while (i < linesCou) {
+				// 連続するラインはまとめて読み込む.
+				int runCou = 1;
+				while (i + runCou < linesCou && m_loadedLines[i + runCou] == m_loadedLines[i] + runCou) runCou++;
+
+				if (!m_rotate90) {
+					if (!m_source->readPixels(0, m_loadedLines[i], m_srcWidth, runCou, &(m_lineStore[(size_t)i * lineBytes]))) return false;
+				} else {
+					// 列を読み込み、ラインとして並べ替える.
+					columns.resize((size_t)ROTATE_READ_COLUMNS * lineBytes);
+					for (int j0 = 0; j0 < runCou; j0 += ROTATE_READ_COLUMNS) {
+						const int colsCou = std::min(ROTATE_READ_COLUMNS, runCou - j0);
+						if (!m_source->readPixels(m_loadedLines[i + j0], 0, colsCou, m_srcHeight, &(columns[0]))) return false;
+						for (int j = 0; j < colsCou; ++j) {
+							unsigned char* pDst = &(m_lineStore[(size_t)(i + j0 + j) * lineBytes]);
+							const unsigned char* pSrc = &(columns[(size_t)j * 4]);
+							for (int y = 0; y < m_srcHeight; ++y) {
+								memcpy(pDst, pSrc, 4);
+								pDst += 4;
+								pSrc += (size_t)colsCou * 4;
+							}
+						}
+					}
+				}
+				i += runCou;
+			}
+			m_lineHasAlpha.resize(linesCou);
+			for (int i = 0; i < linesCou; ++i) {
+				m_lineHasAlpha[i] = ImageResampler::hasAlpha(&(m_lineStore[(size_t)i * lineBytes]), (size_t)m_lineLength) ? 1 : 0;
+			}
+			return true;
+		}
+
+		/**
+		 * 読み込んだラインを解放.
+		 */
+		void releaseLines () {
+			std::vector<unsigned char>().swap(m_lineStore);
+			std::vector<int>().swap(m_lineSlots);
+			std::vector<char>().swap(m_lineHasAlpha);
+			m_loadedLines.clear();
+		}
+
+		/**
+		 * 出力のy行目を計算.
+		 * @param[in]  y        出力の行.
+		 * @param[in]  width    出力の幅.
+		 * @param[out] dst      出力の画素.
+		 * @param[in]  accLine  作業用 (ラインの画素数 x 4).
+		 */
+		void sampleRow (const int y, const int width, unsigned char* dst, float* accLine) const {
+			const size_t lineBytes = (size_t)m_lineLength * 4;
+			const int iStart = m_lineWeights.starts[y];
+			const int tapsCou = m_lineWeights.getTapsCount(y);
+
+			if (tapsCou == 1 && m_pixelWeights.identity) {
+				memcpy(dst, &(m_lineStore[(size_t)m_lineSlots[m_lineWeights.indices[iStart]] * lineBytes]), (size_t)width * 4);
+			} else {
+				// 参照するラインがアルファを持つ場合は、乗算済みの色で補間 (行ごとに判定するため、バンドの分け方によらず同じ結果になる).
+				// 画素を混ぜない行は、乗算/除算の誤差が出ないようにそのまま補間する.
+				bool premultiply = false;
+				if (!(tapsCou == 1 && m_pixelWeights.singleTap)) {
+					for (int i = iStart; i < iStart + tapsCou; ++i) {
+						if (m_lineHasAlpha[m_lineSlots[m_lineWeights.indices[i]]]) premultiply = true;
+					}
+				}
+
+				std::fill(accLine, accLine + m_lineLength * 4, 0.0f);
+				for (int i = iStart; i < iStart + tapsCou; ++i) {
+					const unsigned char* line = &(m_lineStore[(size_t)m_lineSlots[m_lineWeights.indices[i]] * lineBytes]);
+					ImageResampler::accumulateLine(line, m_lineLength, m_lineWeights.weights[i], premultiply, accLine);
+				}
+				ImageResampler::resampleLine(accLine, m_pixelWeights, width, premultiply, dst);
+			}
+			if (m_flipColor) ImageKernels::invertColor(dst, width);
+		}
+	};
+
+	/**
+	 * レイヤごとの参照方法.
+	 */
+	class CLayerPlan
+	{
+	public:
+		CSamplingPlan image;
+		CSamplingPlan weightImage;
+	};
+
+	/**
+	 * 参照方法を準備.
+	 */
+	bool initLayerPlans (const int width, const int height, const std::vector<TileBaker::CTileBakeLayer>& layers, std::vector<CLayerPlan>& plans) {
+		plans.clear();
+		plans.resize(layers.size());
+		for (size_t i = 0; i < layers.size(); ++i) {
+			if (!plans[i].image.init(layers[i].image, width, height)) return false;
+			if (layers[i].weightImage.source) {
+				if (!plans[i].weightImage.init(layers[i].weightImage, width, height)) return false;
+			}
+		}
+		return true;
+	}
+
+	/**
+	 * 1バンドを並列に処理する際のまとまりの数.
+	 */
+	int getChunksCount (const int rowsCou) {
+		return std::max(1, std::min(rowsCou, CThreadPool::getInstance().getThreadsCount()));
+	}
+
+	/**
+	 * 指定のバンドの行数での作業用メモリの見積もり.
+	 */
+	size_t calcBandMemory (const int width, const int height, const std::vector<CLayerPlan>& plans, const int bandRows) {
+		const int chunksCou = getChunksCount(bandRows);
+		int maxLineLength = 0;
+		for (size_t i = 0; i < plans.size(); ++i) {
+			maxLineLength = std::max(maxLineLength, plans[i].image.getLineLength());
+			maxLineLength = std::max(maxLineLength, plans[i].weightImage.getLineLength());
+		}
+
+		// 出力のバンド + スレッドごとの作業用.
+		size_t size = (size_t)bandRows * (size_t)width * 4;
+		size += (size_t)chunksCou * ((size_t)maxLineLength * 4 * sizeof(float) + (size_t)width * 4 * 2);
+
+		// レイヤは1つずつ処理するため、読み込むラインはバンド/レイヤごとの最大.
+		std::vector<char> marks;
+		std::vector<int> lines;
+		size_t maxLinesSize = 0;
+		for (int y0 = 0; y0 < height; y0 += bandRows) {
+			const int rowsCou = std::min(bandRows, height - y0);
+			for (size_t i = 0; i < plans.size(); ++i) {
+				const size_t linesSize = plans[i].image.calcLinesMemory(y0, rowsCou, marks, lines) + plans[i].weightImage.calcLinesMemory(y0, rowsCou, marks, lines);
+				maxLinesSize = std::max(maxLinesSize, linesSize);
+			}
+		}
+		return size + maxLinesSize;
+	}
+
+	/**
+	 * packで、指定のバンドの行数での作業用メモリの見積もり.
+	 * 3つのイメージのラインは同時に読み込む.
+	 */
+	size_t calcPackBandMemory (const int width, const int height, const std::vector<CSamplingPlan>& plans, const int bandRows) {
+		const int chunksCou = getChunksCount(bandRows);
+		int maxLineLength = 0;
+		for (size_t i = 0; i < plans.size(); ++i) maxLineLength = std::max(maxLineLength, plans[i].getLineLength());
+
+		// 出力のバンド + スレッドごとの作業用.
+		size_t size = (size_t)bandRows * (size_t)width * 4;
+		size += (size_t)chunksCou * ((size_t)maxLineLength * 4 * sizeof(float) + (size_t)width * 4 * plans.size());
+
+		std::vector<char> marks;
+		std::vector<int> lines;
+		size_t maxLinesSize = 0;
+		for (int y0 = 0; y0 < height; y0 += bandRows) {
+			const int rowsCou = std::min(bandRows, height - y0);
+			size_t linesSize = 0;
+			for (size_t i = 0; i < plans.size(); ++i) linesSize += plans[i].calcLinesMemory(y0, rowsCou, marks, lines);
+			maxLinesSize = std::max(maxLinesSize, linesSize);
+		}
+		return size + maxLinesSize;
+	}
+}
+
+/**
+ * メモリ上のRGBAから、指定範囲の画素を取得.
+ */
+bool TileBaker::CTileSourceRGBA::readPixels (const int x, const int y, const int width, const int height, unsigned char* rgbaData)
+{
+	if (!m_rgbaData || x < 0 || y < 0 || x + width > m_width || y + height > m_height) return false;
+	for (int iy = 0; iy < height; ++iy) {
+		memcpy(rgbaData + (size_t)iy * (size_t)width * 4, m_rgbaData + ((size_t)(y + iy) * (size_t)m_width + (size_t)x) * 4, (size_t)width * 4);
+	}
+	return true;
+}
+
+/**
+ * 関数から、指定範囲の画素を取得.
+ */
+bool TileBaker::CTileSourceFunc::readPixels (const int x, const int y, const int width, const int height, unsigned char* rgbaData)
+{
+	if (!m_func || x < 0 || y < 0 || x + width > m_width || y + height > m_height) return false;
+	for (int iy = 0; iy < height; ++iy) {
+		for (int ix = 0; ix < width; ++ix) {
+			m_func(x + ix, y + iy, rgbaData);
+			rgbaData += 4;
+		}
+	}
+	return true;
+}
+
+/**
+ * bakeで、指定の行数のバンドで処理する場合の作業用メモリの見積もり (bytes).
+ */
+size_t TileBaker::estimateMemory (const int width, const int height, const std::vector<CTileBakeLayer>& layers, const int bandRows)
+{
+	if (width <= 0 || height <= 0 || bandRows <= 0) return 0;
+	std::vector<CLayerPlan> plans;
+	if (!initLayerPlans(width, height, layers, plans)) return 0;
+	return calcBandMemory(width, height, plans, bandRows);
+}
+
+/**
+ * レイヤを合成したテクスチャを、上から順にバンドごとに出力する.
+ */
+bool TileBaker::bake (const int width, const int height, const std::vector<CTileBakeLayer>& layers, const size_t memoryBudget,
+	const std::function<bool (const int y, const int rowsCou, const unsigned char* rgbaData)>& writeRows)
+{
+	if (width <= 0 || height <= 0 || layers.empty()) return false;
+
+	std::vector<CLayerPlan> plans;
+	if (!initLayerPlans(width, height, layers, plans)) return false;
+
+	// 上限に収まるまでバンドの行数を半分にする.
+	int bandRows = height;
+	while (bandRows > 1 && calcBandMemory(width, height, plans, bandRows) > memoryBudget) {
+		bandRows = (bandRows + 1) / 2;
+	}
+
+	int maxLineLength = 0;
+	for (size_t i = 0; i < plans.size(); ++i) {
+		maxLineLength = std::max(maxLineLength, plans[i].image.getLineLength());
+		maxLineLength = std::max(maxLineLength, plans[i].weightImage.getLineLength());
+	}
+
+	const size_t rowBytes = (size_t)width * 4;
+	std::vector<unsigned char> bandPixels(rowBytes * (size_t)bandRows);
+
+	for (int y0 = 0; y0 < height; y0 += bandRows) {
+		const int rowsCou = std::min(bandRows, height - y0);
+
+		for (size_t li = 0; li < layers.size(); ++li) {
+			const CTileBakeLayer& layer = layers[li];
+			CLayerPlan& plan = plans[li];
+			if (!plan.image.loadLines(y0, rowsCou) || !plan.weightImage.loadLines(y0, rowsCou)) return false;
+
+			ImageKernels::CBlendParam8 blendParam8(layer.blendParam);
+			const bool useWeight = plan.weightImage.isValid();
+
+			// 行はまとまりごとに独立して処理するため、スレッド数によらず同じ結果になる.
+			const int chunksCou = getChunksCount(rowsCou);
+			CThreadPool::getInstance().parallelFor(chunksCou, [&](const int chunk) {
+				const int iy0 = (int)(((int64_t)rowsCou * chunk) / chunksCou);
+				const int iy1 = (int)(((int64_t)rowsCou * (chunk + 1)) / chunksCou);
+
+				std::vector<float> accLine((size_t)std::max(maxLineLength, 1) * 4);
+				std::vector<unsigned char> pixels(rowBytes);
+				std::vector<unsigned char> weightPixels(useWeight ? rowBytes : 0);
+
+				for (int iy = iy0; iy < iy1; ++iy) {
+					const int y = y0 + iy;
+					unsigned char* dst = &(bandPixels[(size_t)iy * rowBytes]);
+
+					plan.image.sampleRow(y, width, &(pixels[0]), &(accLine[0]));
+					if (useWeight) plan.weightImage.sampleRow(y, width, &(weightPixels[0]), &(accLine[0]));
+
+					if (layer.useGrayscale) ImageKernels::convertToGrayscale(&(pixels[0]), width, layer.grayscaleChannel);
+					if (layer.fillAlpha) ImageKernels::fillAlpha(&(pixels[0]), width, (unsigned char)255);
+					if (layer.invertColor) ImageKernels::invertColor(&(pixels[0]), width);
+
+					ImageKernels::CBlendParam8 rowBlendParam = blendParam8;
+					rowBlendParam.basePixels   = (li > 0) ? dst : NULL;
+					rowBlendParam.weightPixels = useWeight ? &(weightPixels[0]) : NULL;
+					ImageKernels::blendPixels(&(pixels[0]), width, rowBlendParam);
+
+					memcpy(dst, &(pixels[0]), rowBytes);
+				}
+			});
+
+			plan.image.releaseLines();
+			plan.weightImage.releaseLines();
+		}
+
+		if (!writeRows(y0, rowsCou, &(bandPixels[0]))) return false;
+	}
+	return true;
+}
+
+/**
+ * 3つのイメージのチャンネルを出力のR/G/Bにパックしたテクスチャを、上から順にバンドごとに出力する.
+ */
+bool TileBaker::pack (const int width, const int height, const CTilePackChannel& red, const CTilePackChannel& green, const CTilePackChannel& blue, const size_t memoryBudget,
+	const std::function<bool (const int y, const int rowsCou, const unsigned char* rgbaData)>& writeRows)
+{
+	if (width <= 0 || height <= 0) return false;
+
+	const CTilePackChannel* channels[3] = { &red, &green, &blue };
+	std::vector<CSamplingPlan> plans(3);
+	for (int i = 0; i < 3; ++i) {
+		if (channels[i]->image.source && !plans[i].init(channels[i]->image, width, height)) return false;
+	}
+
+	// 上限に収まるまでバンドの行数を半分にする.
+	int bandRows = height;
+	while (bandRows > 1 && calcPackBandMemory(width, height, plans, bandRows) > memoryBudget) {
+		bandRows = (bandRows + 1) / 2;
+	}
+
+	int maxLineLength = 0;
+	for (int i = 0; i < 3; ++i) maxLineLength = std::max(maxLineLength, plans[i].getLineLength());
+
+	const size_t rowBytes = (size_t)width * 4;
+	std::vector<unsigned char> bandPixels(rowBytes * (size_t)bandRows);
+
+	for (int y0 = 0; y0 < height; y0 += bandRows) {
+		const int rowsCou = std::min(bandRows, height - y0);
+		for (int i = 0; i < 3; ++i) {
+			if (!plans[i].loadLines(y0, rowsCou)) return false;
+		}
+
+		// 行はまとまりごとに独立して処理するため、スレッド数によらず同じ結果になる.
+		const int chunksCou = getChunksCount(rowsCou);
+		CThreadPool::getInstance().parallelFor(chunksCou, [&](const int chunk) {
+			const int iy0 = (int)(((int64_t)rowsCou * chunk) / chunksCou);
+			const int iy1 = (int)(((int64_t)rowsCou * (chunk + 1)) / chunksCou);
+
+			std::vector<float> accLine((size_t)std::max(maxLineLength, 1) * 4);
+			std::vector<unsigned char> pixels[3];
+			ImageKernels::CPackChannel packChannels[3];
+			for (int i = 0; i < 3; ++i) {
+				packChannels[i].channel = channels[i]->channel;
+				packChannels[i].invert  = channels[i]->invert;
+				packChannels[i].value   = channels[i]->value;
+				if (plans[i].isValid()) {
+					pixels[i].resize(rowBytes);
+					packChannels[i].pixels = &(pixels[i][0]);
+				}
+			}
+
+			for (int iy = iy0; iy < iy1; ++iy) {
+				const int y = y0 + iy;
+				for (int i = 0; i < 3; ++i) {
+					if (plans[i].isValid()) plans[i].sampleRow(y, width, &(pixels[i][0]), &(accLine[0]));
+				}
+				ImageKernels::packChannels(&(bandPixels[(size_t)iy * rowBytes]), width, packChannels[0], packChannels[1], packChannels[2]);
+			}
+		});
+
+		for (int i = 0; i < 3; ++i) plans[i].releaseLines();
+
+		if (!writeRows(y0, rowsCou, &(bandPixels[0]))) return false;
+	}
+	return true;
+}
@@ -0,0 +1,203 @@
+﻿/**
+ * テクスチャを行のまとまり(バンド)ごとにベイクし、完成した行から順に出力する.
+ * 中間のイメージを全解像度で保持せず、参照するイメージもバンドに必要な行(列)だけを読み込むため、.
+ * 使用するメモリはテクスチャサイズによらず、指定の上限に収まる.
+ * Shade3DのAPIは使用していないため、メモリ上の画素や関数で与えたイメージでもベイクできる.
+ */
+#ifndef _TILEBAKER_H
+#define _TILEBAKER_H
+
+#include "ImageKernels.h"
+#include "ImageResampler.h"
+
+#include <vector>
+#include <functional>
+#include <stddef.h>
+
+namespace TileBaker {
+	/**
+	 * ベイクで参照するイメージ.
+	 * readPixelsはベイクを呼び出したスレッドからのみ呼ばれる.
+	 */
+	class CTileSource
+	{
+	public:
+		virtual ~CTileSource () { }
+
+		virtual int getWidth () const = 0;
+		virtual int getHeight () const = 0;
+
+		/**
+		 * 指定範囲の画素を取得.
+		 * @param[in]  x, y      左上の位置.
+		 * @param[in]  width     幅.
+		 * @param[in]  height    高さ.
+		 * @param[out] rgbaData  1ピクセルRGBA(4バイト)の画素 (width x height).
+		 */
+		virtual bool readPixels (const int x, const int y, const int width, const int height, unsigned char* rgbaData) = 0;
+	};
+
+	/**
+	 * メモリ上のRGBAを参照するイメージ (画素は複製しない).
+	 */
+	class CTileSourceRGBA : public CTileSource
+	{
+	private:
+		const unsigned char* m_rgbaData;
+		int m_width, m_height;
+
+	public:
+		CTileSourceRGBA (const unsigned char* rgbaData, const int width, const int height) : m_rgbaData(rgbaData), m_width(width), m_height(height) { }
+
+		virtual int getWidth () const { return m_width; }
+		virtual int getHeight () const { return m_height; }
+		virtual bool readPixels (const int x, const int y, const int width, const int height, unsigned char* rgbaData);
+	};
+
+	/**
+	 * ピクセルごとに関数で色を与えるイメージ.
+	 * 大きなサイズのテクスチャを、メモリを確保せずに確認する場合に使用.
+	 */
+	class CTileSourceFunc : public CTileSource
+	{
+	private:
+		std::function<void (const int x, const int y, unsigned char* rgba)> m_func;
+		int m_width, m_height;
+
+	public:
+		CTileSourceFunc (const int width, const int height, const std::function<void (const int x, const int y, unsigned char* rgba)>& func) : m_func(func), m_width(width), m_height(height) { }
+
+		virtual int getWidth () const { return m_width; }
+		virtual int getHeight () const { return m_height; }
+		virtual bool readPixels (const int x, const int y, const int width, const int height, unsigned char* rgbaData);
+	};
+
+	/**
+	 * イメージの参照方法 (CImagesBlend::m_duplicateImageと同じ指定).
+	 */
+	class CTileSampling
+	{
+	public:
+		CTileSource* source;			// 参照するイメージ. NULLの場合は使用しない.
+		bool flipColor;					// 色反転.
+		bool flipH;						// 左右反転.
+		bool flipV;						// 上下反転.
+		bool rotate90;					// 90度回転.
+		int repeatU;					// 繰り返し回数U.
+		int repeatV;					// 繰り返し回数V.
+		ImageResampler::FILTER_TYPE filter;		// 拡大縮小のフィルタ.
+
+	public:
+		CTileSampling () {
+			clear();
+		}
+
+		void clear () {
+			source    = 0;
+			flipColor = false;
+			flipH     = false;
+			flipV     = false;
+			rotate90  = false;
+			repeatU   = 1;
+			repeatV   = 1;
+			filter    = ImageResampler::DEFAULT_FILTER;
+		}
+	};
+
+	/**
+	 * 合成する1つのレイヤ.
+	 * 先頭のレイヤはblendParam.baseColorに、以降のレイヤはそれまでの合成結果に合成する.
+	 */
+	class CTileBakeLayer
+	{
+	public:
+		CTileSampling image;						// 重ねるイメージ.
+		CTileSampling weightImage;					// 「マット」のイメージ (Rを使用).
+		bool useGrayscale;							// grayscaleChannelのチャンネルでグレースケールにする.
+		ImageKernels::CHANNEL_TYPE grayscaleChannel;
+		bool fillAlpha;								// Alphaを1にする.
+		bool invertColor;							// RGBを反転 (1 - RGB).
+		ImageKernels::CBlendParam blendParam;		// 合成のパラメータ (basePixels/weightPixelsは使用しない).
+
+	public:
+		CTileBakeLayer () {
+			clear();
+		}
+
+		void clear () {
+			image.clear();
+			weightImage.clear();
+			useGrayscale     = false;
+			grayscaleChannel = ImageKernels::channel_red;
+			fillAlpha        = false;
+			invertColor      = false;
+			blendParam.clear();
+		}
+	};
+
+	/**
+	 * packで、出力の1チャンネルに格納する値.
+	 */
+	class CTilePackChannel
+	{
+	public:
+		CTileSampling image;						// 参照するイメージ. image.sourceがNULLの場合はvalueを使用.
+		ImageKernels::CHANNEL_TYPE channel;			// 参照するチャンネル.
+		bool invert;								// 値を反転 (255 - 値).
+		unsigned char value;						// イメージがない場合の値.
+
+	public:
+		CTilePackChannel () {
+			clear();
+		}
+
+		void clear () {
+			image.clear();
+			channel = ImageKernels::channel_red;
+			invert  = false;
+			value   = 255;
+		}
+	};
+
+	/**
+	 * ベイクで使用するメモリの既定の上限 (bytes).
+	 */
+	const size_t DEFAULT_MEMORY_BUDGET = 256 * 1024 * 1024;
+
+	/**
+	 * レイヤを合成したテクスチャを、上から順にバンドごとに出力する.
+	 * 参照するイメージは、CTileSampling::filterで出力サイズに合わせて拡大縮小する (アルファを持つ場合は乗算済みの色で補間).
+	 * 画素の演算は複数スレッドで行うが、結果はスレッド数によらず同じになる.
+	 * @param[in] width         出力する幅.
+	 * @param[in] height        出力する高さ.
+	 * @param[in] layers        合成するレイヤ.
+	 * @param[in] memoryBudget  作業用に使用するメモリの上限 (bytes). 1行分も収まらない場合は1行ずつ処理する.
+	 * @param[in] writeRows     完成した行を受け取る. y行目からrowsCou行分の1ピクセルRGBA(4バイト)の画素が渡される. falseを返すと中断.
+	 * @return 最後まで出力できた場合はtrue.
+	 */
+	bool bake (const int width, const int height, const std::vector<CTileBakeLayer>& layers, const size_t memoryBudget,
+		const std::function<bool (const int y, const int rowsCou, const unsigned char* rgbaData)>& writeRows);
+
+	/**
+	 * bakeで、指定の行数のバンドで処理する場合の作業用メモリの見積もり (bytes).
+	 */
+	size_t estimateMemory (const int width, const int height, const std::vector<CTileBakeLayer>& layers, const int bandRows);
+
+	/**
+	 * 3つのイメージのチャンネルを出力のR/G/Bにパックしたテクスチャ (Alphaは255) を、上から順にバンドごとに出力する.
+	 * glTFのOcclusion(R)/Roughness(G)/Metallic(B)のテクスチャの作成で使用.
+	 * 参照するイメージはbakeと同じく、バンドに必要なラインのみを読み込んで出力サイズに拡大縮小する.
+	 * @param[in] width         出力する幅.
+	 * @param[in] height        出力する高さ.
+	 * @param[in] red           Rに格納する値.
+	 * @param[in] green         Gに格納する値.
+	 * @param[in] blue          Bに格納する値.
+	 * @param[in] memoryBudget  作業用に使用するメモリの上限 (bytes). 1行分も収まらない場合は1行ずつ処理する.
+	 * @param[in] writeRows     完成した行を受け取る (bakeと同じ).
+	 * @return 最後まで出力できた場合はtrue.
+	 */
+	bool pack (const int width, const int height, const CTilePackChannel& red, const CTilePackChannel& green, const CTilePackChannel& blue, const size_t memoryBudget,
+		const std::function<bool (const int y, const int rowsCou, const unsigned char* rgbaData)>& writeRows);
+}
+
+#endif
@@ -164,7 +164,7 @@ namespace {
 				if (pc == NULL) return false;
 
 				// 展開されたメッシュ情報をmeshDataListに格納.
-				meshDataList.push_back(glTFToolKit::DecompressMeshData());
+				meshDataList.emplace_back();
 				glTFToolKit::DecompressMeshData& dstMeshData = meshDataList.back();
 				dstMeshData.meshIndex      = (int)mLoop;
 				dstMeshData.primitiveIndex = (int)primLoop;
@@ -33,6 +33,7 @@ namespace glTFToolKit {
 	public:
 		DecompressMeshData ();
 		DecompressMeshData (const DecompressMeshData& v);
+		DecompressMeshData (DecompressMeshData&& v) = default;
 		~DecompressMeshData ();
 
 		DecompressMeshData& operator = (const DecompressMeshData &v) {
@@ -50,6 +51,7 @@ namespace glTFToolKit {
 			this->tangents = v.tangents;
 			return (*this);
 		}
+		DecompressMeshData& operator = (DecompressMeshData &&v) = default;
 
 		void clear();
 	};
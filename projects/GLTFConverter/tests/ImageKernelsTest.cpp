@@ -0,0 +1,242 @@
+﻿/**
+ * ImageKernelsのテスト.
+ * スカラーの参照実装とSIMD(SSE2/NEON)の実装で、結果がビット単位で一致することを確認する.
+ */
+#include "ImageKernels.h"
+
+#include <vector>
+#include <string>
+#include <random>
+#include <stdio.h>
+#include <string.h>
+
+namespace {
+	// テストする画素数 (SIMDの端数処理も確認するため、4/8の倍数にしない).
+	const int PIXELS_COUNT = 1027;
+
+	int g_failedCount = 0;
+	int g_testsCount  = 0;
+
+	std::mt19937 g_random(12345);
+
+	/**
+	 * ランダムなRGBA(float)の画素 (0.0 - 1.0).
+	 */
+	std::vector<float> createRandomPixels (const int count) {
+		std::uniform_real_distribution<float> dist(0.0f, 1.0f);
+		std::vector<float> pixels(count * 4);
+		for (size_t i = 0; i < pixels.size(); ++i) pixels[i] = dist(g_random);
+
+		// 0.0/1.0ちょうどの値も含める.
+		for (int i = 0; i < count; i += 7) pixels[i * 4 + (i % 4)] = (i & 8) ? 1.0f : 0.0f;
+		return pixels;
+	}
+
+	/**
+	 * ランダムなRGBA(8bit)の画素.
+	 */
+	std::vector<unsigned char> createRandomPixels8 (const int count) {
+		std::uniform_int_distribution<int> dist(0, 255);
+		std::vector<unsigned char> pixels(count * 4);
+		for (size_t i = 0; i < pixels.size(); ++i) pixels[i] = (unsigned char)dist(g_random);
+		for (int i = 0; i < count; i += 7) pixels[i * 4 + (i % 4)] = (i & 8) ? 255 : 0;
+		return pixels;
+	}
+
+	/**
+	 * srcをコピーした画素にfuncを、スカラー/SIMDのそれぞれで実行して結果を比較.
+	 */
+	template<typename T, typename F> void checkSame (const std::string& name, const std::vector<T>& src, F func) {
+		std::vector<T> scalarPixels = src;
+		std::vector<T> simdPixels   = src;
+
+		ImageKernels::setUseSIMD(false);
+		func(&(scalarPixels[0]));
+		ImageKernels::setUseSIMD(true);
+		func(&(simdPixels[0]));
+
+		g_testsCount++;
+		if (memcmp(&(scalarPixels[0]), &(simdPixels[0]), sizeof(T) * src.size()) != 0) {
+			size_t pos = 0;
+			while (pos < src.size() && memcmp(&(scalarPixels[pos]), &(simdPixels[pos]), sizeof(T)) == 0) pos++;
+			printf("FAILED : %s (pixel %d, element %d)\n", name.c_str(), (int)(pos / 4), (int)(pos % 4));
+			g_failedCount++;
+		}
+	}
+
+	const char* getBlendTypeName (const ImageKernels::BLEND_TYPE blendType) {
+		switch (blendType) {
+		case ImageKernels::blend_none:				return "none";
+		case ImageKernels::blend_normal:			return "normal";
+		case ImageKernels::blend_multiply:			return "multiply";
+		case ImageKernels::blend_multiply_legacy:	return "multiply_legacy";
+		case ImageKernels::blend_add:				return "add";
+		case ImageKernels::blend_sub:				return "sub";
+		case ImageKernels::blend_min:				return "min";
+		case ImageKernels::blend_max:				return "max";
+		}
+		return "";
+	}
+
+	const ImageKernels::BLEND_TYPE g_blendTypes[] = {
+		ImageKernels::blend_none, ImageKernels::blend_normal, ImageKernels::blend_multiply, ImageKernels::blend_multiply_legacy,
+		ImageKernels::blend_add, ImageKernels::blend_sub, ImageKernels::blend_min, ImageKernels::blend_max,
+	};
+
+	const ImageKernels::CHANNEL_TYPE g_channelTypes[] = {
+		ImageKernels::channel_red, ImageKernels::channel_green, ImageKernels::channel_blue, ImageKernels::channel_alpha, ImageKernels::channel_average,
+	};
+
+	/**
+	 * floatの画素の演算.
+	 */
+	void testFloatKernels () {
+		const std::vector<float> pixels       = createRandomPixels(PIXELS_COUNT);
+		const std::vector<float> basePixels   = createRandomPixels(PIXELS_COUNT);
+		const std::vector<float> weightPixels = createRandomPixels(PIXELS_COUNT);
+
+		for (const ImageKernels::CHANNEL_TYPE channel : g_channelTypes) {
+			checkSame("float grayscale " + std::to_string((int)channel), pixels, [&](float* p) {
+				ImageKernels::convertToGrayscale(p, PIXELS_COUNT, channel);
+			});
+		}
+		checkSame(std::string("float fillAlpha"), pixels, [&](float* p) {
+			ImageKernels::fillAlpha(p, PIXELS_COUNT, 0.25f);
+		});
+		checkSame(std::string("float invertColor"), pixels, [&](float* p) {
+			ImageKernels::invertColor(p, PIXELS_COUNT);
+		});
+
+		for (const ImageKernels::BLEND_TYPE blendType : g_blendTypes) {
+			for (int i = 0; i < 4; ++i) {
+				ImageKernels::CBlendParam param;
+				param.blendType    = blendType;
+				param.basePixels   = (i & 1) ? &(basePixels[0]) : NULL;
+				param.weightPixels = (i & 2) ? &(weightPixels[0]) : NULL;
+				param.weight       = 0.7f;
+				param.baseColor[0] = 0.2f;
+				param.baseColor[1] = 0.4f;
+				param.baseColor[2] = 0.6f;
+				param.fillColor[0] = 0.9f;
+				param.fillColor[1] = 0.5f;
+				param.fillColor[2] = 0.1f;
+
+				const std::string name = std::string("float blend ") + getBlendTypeName(blendType) + ((i & 1) ? " base" : "") + ((i & 2) ? " weight" : "");
+				checkSame(name, pixels, [&](float* p) {
+					ImageKernels::blendPixels(p, PIXELS_COUNT, param);
+				});
+			}
+		}
+
+		for (int i = 0; i < 2; ++i) {
+			checkSame(std::string("float blendNormal") + (i ? " weight" : ""), pixels, [&](float* p) {
+				ImageKernels::blendNormalPixels(p, &(basePixels[0]), i ? &(weightPixels[0]) : NULL, 0.8f, PIXELS_COUNT);
+			});
+		}
+	}
+
+	/**
+	 * 8bitの画素の演算.
+	 */
+	void test8bitKernels () {
+		const std::vector<unsigned char> pixels       = createRandomPixels8(PIXELS_COUNT);
+		const std::vector<unsigned char> basePixels   = createRandomPixels8(PIXELS_COUNT);
+		const std::vector<unsigned char> weightPixels = createRandomPixels8(PIXELS_COUNT);
+
+		for (const ImageKernels::CHANNEL_TYPE channel : g_channelTypes) {
+			checkSame("8bit grayscale " + std::to_string((int)channel), pixels, [&](unsigned char* p) {
+				ImageKernels::convertToGrayscale(p, PIXELS_COUNT, channel);
+			});
+		}
+		checkSame(std::string("8bit fillAlpha"), pixels, [&](unsigned char* p) {
+			ImageKernels::fillAlpha(p, PIXELS_COUNT, (unsigned char)64);
+		});
+		checkSame(std::string("8bit invertColor"), pixels, [&](unsigned char* p) {
+			ImageKernels::invertColor(p, PIXELS_COUNT);
+		});
+
+		for (const ImageKernels::BLEND_TYPE blendType : g_blendTypes) {
+			for (int i = 0; i < 4; ++i) {
+				ImageKernels::CBlendParam8 param;
+				param.blendType    = blendType;
+				param.basePixels   = (i & 1) ? &(basePixels[0]) : NULL;
+				param.weightPixels = (i & 2) ? &(weightPixels[0]) : NULL;
+				param.weight       = 180;
+				param.baseColor[0] = 50;
+				param.baseColor[1] = 100;
+				param.baseColor[2] = 150;
+				param.fillColor[0] = 230;
+				param.fillColor[1] = 128;
+				param.fillColor[2] = 25;
+
+				const std::string name = std::string("8bit blend ") + getBlendTypeName(blendType) + ((i & 1) ? " base" : "") + ((i & 2) ? " weight" : "");
+				checkSame(name, pixels, [&](unsigned char* p) {
+					ImageKernels::blendPixels(p, PIXELS_COUNT, param);
+				});
+			}
+		}
+	}
+
+	/**
+	 * R/G/Bへのチャンネルのパック.
+	 */
+	void testPackChannels () {
+		const std::vector<unsigned char> src0 = createRandomPixels8(PIXELS_COUNT);
+		const std::vector<unsigned char> src1 = createRandomPixels8(PIXELS_COUNT);
+		const std::vector<unsigned char> src2 = createRandomPixels8(PIXELS_COUNT);
+		const std::vector<unsigned char> dst(PIXELS_COUNT * 4, 0);
+
+		for (const ImageKernels::CHANNEL_TYPE channel : g_channelTypes) {
+			for (int i = 0; i < 8; ++i) {
+				// R : src0の指定チャンネル、G : src1 (もしくは固定値)、B : src2のBlue.
+				ImageKernels::CPackChannel red, green, blue;
+				red.pixels    = &(src0[0]);
+				red.channel   = channel;
+				red.invert    = (i & 1) ? true : false;
+				green.pixels  = (i & 2) ? NULL : &(src1[0]);
+				green.channel = ImageKernels::channel_green;
+				green.value   = 77;
+				green.invert  = (i & 4) ? true : false;
+				blue.pixels   = &(src2[0]);
+				blue.channel  = ImageKernels::channel_blue;
+
+				const std::string name = "packChannels " + std::to_string((int)channel) + " " + std::to_string(i);
+				checkSame(name, dst, [&](unsigned char* p) {
+					ImageKernels::packChannels(p, PIXELS_COUNT, red, green, blue);
+				});
+
+				// 参照の値とも比較.
+				std::vector<unsigned char> result = dst;
+				ImageKernels::packChannels(&(result[0]), PIXELS_COUNT, red, green, blue);
+				bool same = true;
+				for (int x = 0; x < PIXELS_COUNT && same; ++x) {
+					const unsigned char* s = &(src0[x * 4]);
+					int r = (channel == ImageKernels::channel_average) ? (((int)s[0] + (int)s[1] + (int)s[2] + 1) / 3) : (int)s[(int)channel];
+					if (red.invert) r = 255 - r;
+					int g = 77;
+					if (green.pixels) g = green.invert ? (255 - (int)src1[x * 4 + 1]) : (int)src1[x * 4 + 1];
+					const int b = src2[x * 4 + 2];
+					const unsigned char* d = &(result[x * 4]);
+					same = (d[0] == r && d[1] == g && d[2] == b && d[3] == 255);
+				}
+				g_testsCount++;
+				if (!same) {
+					printf("FAILED : %s (reference)\n", name.c_str());
+					g_failedCount++;
+				}
+			}
+		}
+	}
+}
+
+int main ()
+{
+	if (!ImageKernels::hasSIMD()) printf("SIMD is not available. Only the scalar implementation is tested.\n");
+
+	testFloatKernels();
+	test8bitKernels();
+	testPackChannels();
+
+	printf("ImageKernelsTest : %d / %d passed.\n", g_testsCount - g_failedCount, g_testsCount);
+	return (g_failedCount == 0) ? 0 : 1;
+}
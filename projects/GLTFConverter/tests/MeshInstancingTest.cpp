@@ -0,0 +1,249 @@
+﻿/**
+ * MeshInstancingのテスト.
+ * 形状の生成を記録するだけのCMeshInstanceHostで、以下を確認する.
+ * - プリミティブのマージは、メッシュごとに1回だけ行われる.
+ * - 同じメッシュを参照する後続のノードには、最初に生成したノードが渡される.
+ * - スキンは、スキンを持つノードごとにそのノードで生成した形状に1回だけ割り当てられる.
+ * - マージ結果は、スキンで使用しなければ最後の参照ノードの生成後に破棄され、すべて1回ずつ破棄される.
+ */
+#include "MeshInstancing.h"
+
+#include <vector>
+#include <string>
+#include <stdio.h>
+#include <stdint.h>
+
+namespace {
+	int g_failedCount = 0;
+	int g_testsCount  = 0;
+
+	void check (const bool result, const std::string& name) {
+		g_testsCount++;
+		if (!result) {
+			printf("FAILED : %s\n", name.c_str());
+			g_failedCount++;
+		}
+	}
+
+	/**
+	 * 呼び出しを記録する.
+	 */
+	class CRecordingHost : public MeshInstancing::CMeshInstanceHost
+	{
+	public:
+		enum CALL_TYPE {
+			call_merge,
+			call_release,
+			call_create,
+			call_bind,
+		};
+
+		class CCall
+		{
+		public:
+			CALL_TYPE type;
+			int nodeIndex;
+			int meshIndex;
+			int masterNodeIndex;
+			int skinIndex;
+			void* meshHandle;
+
+		public:
+			CCall (const CALL_TYPE type, const int nodeIndex, const int meshIndex, const int masterNodeIndex = -1, const int skinIndex = -1, void* meshHandle = NULL)
+				: type(type), nodeIndex(nodeIndex), meshIndex(meshIndex), masterNodeIndex(masterNodeIndex), skinIndex(skinIndex), meshHandle(meshHandle) { }
+		};
+
+		std::vector<CCall> calls;
+		std::vector<char> merged;				// メッシュごとに、マージ結果を保持しているか.
+		std::vector<int> failedMeshes;			// マージに失敗するメッシュ.
+		std::vector<int> failedCreateNodes;		// 形状の生成に失敗するノード.
+
+	public:
+		CRecordingHost (const int meshesCou) : merged(meshesCou, 0) { }
+
+		virtual bool mergeMesh (const int meshIndex) {
+			calls.push_back(CCall(call_merge, -1, meshIndex));
+			for (size_t i = 0; i < failedMeshes.size(); ++i) {
+				if (failedMeshes[i] == meshIndex) return false;
+			}
+			merged[meshIndex] = 1;
+			return true;
+		}
+
+		virtual void releaseMergedMesh (const int meshIndex) {
+			calls.push_back(CCall(call_release, -1, meshIndex));
+			merged[meshIndex] = 0;
+		}
+
+		virtual void* createNodeMesh (const int nodeIndex, const int meshIndex, const int masterNodeIndex) {
+			// マージ結果を保持している場合のみ生成できる.
+			void* handle = NULL;
+			if (merged[meshIndex]) handle = (void *)(intptr_t)(1000 + nodeIndex);
+			for (size_t i = 0; i < failedCreateNodes.size(); ++i) {
+				if (failedCreateNodes[i] == nodeIndex) handle = NULL;
+			}
+			calls.push_back(CCall(call_create, nodeIndex, meshIndex, masterNodeIndex, -1, handle));
+			return handle;
+		}
+
+		virtual void bindSkin (const int nodeIndex, const int meshIndex, const int skinIndex, void* meshHandle) {
+			// スキンの割り当てではマージ結果を参照する.
+			check(merged[meshIndex] != 0, "bindSkin : merged data of mesh " + std::to_string(meshIndex));
+			calls.push_back(CCall(call_bind, nodeIndex, meshIndex, -1, skinIndex, meshHandle));
+		}
+
+		int count (const CALL_TYPE type, const int nodeIndex, const int meshIndex) const {
+			int cou = 0;
+			for (size_t i = 0; i < calls.size(); ++i) {
+				if (calls[i].type != type) continue;
+				if (nodeIndex >= 0 && calls[i].nodeIndex != nodeIndex) continue;
+				if (meshIndex >= 0 && calls[i].meshIndex != meshIndex) continue;
+				cou++;
+			}
+			return cou;
+		}
+
+		const CCall* find (const CALL_TYPE type, const int nodeIndex, const int meshIndex) const {
+			for (size_t i = 0; i < calls.size(); ++i) {
+				if (calls[i].type != type) continue;
+				if (nodeIndex >= 0 && calls[i].nodeIndex != nodeIndex) continue;
+				if (meshIndex >= 0 && calls[i].meshIndex != meshIndex) continue;
+				return &calls[i];
+			}
+			return NULL;
+		}
+	};
+
+	/**
+	 * ノードを順番に生成し、スキンを割り当ててからマージ結果を破棄する (インポート時と同じ順番).
+	 */
+	void runImport (MeshInstancing::CMeshInstancePlan& plan, CRecordingHost& host, const std::vector<int>& nodeMeshIndices, const std::vector<int>& nodeSkinIndices, const int meshesCou) {
+		plan.init(nodeMeshIndices, nodeSkinIndices, meshesCou);
+		for (size_t i = 0; i < nodeMeshIndices.size(); ++i) plan.createNodeMesh(host, (int)i);
+		plan.bindSkins(host);
+		plan.releaseMergedMeshes(host);
+	}
+}
+
+int main ()
+{
+	// 多数のノードで共有するメッシュ (スキンなし).
+	{
+		const int meshesCou = 3;
+		const int nodesCou  = 1000;
+		std::vector<int> nodeMeshIndices(nodesCou, -1);
+		std::vector<int> nodeSkinIndices(nodesCou, -1);
+		for (int i = 1; i < nodesCou; ++i) nodeMeshIndices[i] = (i % 10 == 0) ? -1 : (i % 3);
+
+		MeshInstancing::CMeshInstancePlan plan;
+		CRecordingHost host(meshesCou);
+		runImport(plan, host, nodeMeshIndices, nodeSkinIndices, meshesCou);
+
+		for (int m = 0; m < meshesCou; ++m) {
+			const std::string name = "instances, mesh " + std::to_string(m);
+			check(host.count(CRecordingHost::call_merge, -1, m) == 1, name + " : merged once");
+			check(host.count(CRecordingHost::call_release, -1, m) == 1, name + " : released once");
+
+			// 最後の参照ノードの生成直後に破棄される.
+			int lastNode = -1;
+			for (int i = 0; i < nodesCou; ++i) if (nodeMeshIndices[i] == m) lastNode = i;
+			size_t releasePos = 0, lastCreatePos = 0;
+			for (size_t i = 0; i < host.calls.size(); ++i) {
+				if (host.calls[i].type == CRecordingHost::call_release && host.calls[i].meshIndex == m) releasePos = i;
+				if (host.calls[i].type == CRecordingHost::call_create && host.calls[i].nodeIndex == lastNode) lastCreatePos = i;
+			}
+			check(releasePos == lastCreatePos + 1, name + " : released after the last node");
+		}
+
+		// メッシュを持つノードごとに1回だけ生成し、後続のノードには最初のノードが渡される.
+		bool createdOnce = true;
+		bool masterNodes = true;
+		bool handles = true;
+		for (int i = 0; i < nodesCou; ++i) {
+			const int m = nodeMeshIndices[i];
+			const int cou = host.count(CRecordingHost::call_create, i, -1);
+			if (m < 0) {
+				if (cou != 0) createdOnce = false;
+				continue;
+			}
+			if (cou != 1) createdOnce = false;
+			const int firstNode = (m == 0) ? 3 : m;
+			const CRecordingHost::CCall* call = host.find(CRecordingHost::call_create, i, -1);
+			if (call && call->masterNodeIndex != ((i == firstNode) ? -1 : firstNode)) masterNodes = false;
+			if (plan.getNodeMeshHandle(i) != (void *)(intptr_t)(1000 + i)) handles = false;
+		}
+		check(createdOnce, "instances : created once per node");
+		check(masterNodes, "instances : master node");
+		check(handles, "instances : node mesh handles");
+		check(host.count(CRecordingHost::call_bind, -1, -1) == 0, "instances : no skin bindings");
+	}
+
+	// スキンを持つノードで共有するメッシュ.
+	{
+		const int meshesCou = 3;
+		const int meshIndices[] = { -1, 0, 0, 1, 0, 2, -1, 1 };
+		const int skinIndices[] = { -1, 0, 1, -1, 0, -1, 2, -1 };
+		const std::vector<int> nodeMeshIndices(meshIndices, meshIndices + 8);
+		const std::vector<int> nodeSkinIndices(skinIndices, skinIndices + 8);
+
+		MeshInstancing::CMeshInstancePlan plan;
+		CRecordingHost host(meshesCou);
+		runImport(plan, host, nodeMeshIndices, nodeSkinIndices, meshesCou);
+
+		for (int m = 0; m < meshesCou; ++m) {
+			check(host.count(CRecordingHost::call_merge, -1, m) == 1, "skin : mesh " + std::to_string(m) + " merged once");
+			check(host.count(CRecordingHost::call_release, -1, m) == 1, "skin : mesh " + std::to_string(m) + " released once");
+		}
+
+		// スキンを持つノードごとに、そのノードの形状へ1回だけ割り当てる.
+		const int skinNodes[] = { 1, 2, 4 };
+		for (const int nodeIndex : skinNodes) {
+			const std::string name = "skin : node " + std::to_string(nodeIndex);
+			check(host.count(CRecordingHost::call_bind, nodeIndex, -1) == 1, name + " bound once");
+			const CRecordingHost::CCall* call = host.find(CRecordingHost::call_bind, nodeIndex, -1);
+			check(call && call->skinIndex == skinIndices[nodeIndex] && call->meshIndex == 0, name + " skin index");
+			check(call && call->meshHandle == (void *)(intptr_t)(1000 + nodeIndex), name + " mesh handle");
+		}
+		check(host.count(CRecordingHost::call_bind, -1, -1) == 3, "skin : bindings count");
+
+		// スキンで使用しないメッシュは、スキンの割り当て前に破棄される.
+		const CRecordingHost::CCall* firstBind = host.find(CRecordingHost::call_bind, -1, -1);
+		bool releasedBefore = false;
+		for (size_t i = 0; i < host.calls.size() && &host.calls[i] != firstBind; ++i) {
+			if (host.calls[i].type == CRecordingHost::call_release && host.calls[i].meshIndex == 1) releasedBefore = true;
+		}
+		check(releasedBefore, "skin : mesh without skin released before binding");
+	}
+
+	// マージや形状の生成に失敗する場合.
+	{
+		const int meshesCou = 2;
+		const int meshIndices[] = { -1, 0, 1, 0, 1, 0 };
+		const int skinIndices[] = { -1, 0, 0, 0, -1, -1 };
+		const std::vector<int> nodeMeshIndices(meshIndices, meshIndices + 6);
+		const std::vector<int> nodeSkinIndices(skinIndices, skinIndices + 6);
+
+		MeshInstancing::CMeshInstancePlan plan;
+		CRecordingHost host(meshesCou);
+		host.failedMeshes.push_back(1);
+		host.failedCreateNodes.push_back(1);
+		runImport(plan, host, nodeMeshIndices, nodeSkinIndices, meshesCou);
+
+		// マージに失敗したメッシュは再試行せず、形状も生成しない.
+		check(host.count(CRecordingHost::call_merge, -1, 1) == 1, "failure : merge not retried");
+		check(host.count(CRecordingHost::call_create, -1, 1) == 0, "failure : no mesh without merged data");
+		check(host.count(CRecordingHost::call_release, -1, 1) == 0, "failure : failed merge not released");
+
+		// 形状の生成に失敗したノードにはスキンを割り当てず、次のノードが最初のノードになる.
+		check(host.count(CRecordingHost::call_bind, 1, -1) == 0, "failure : no binding without mesh");
+		check(host.count(CRecordingHost::call_bind, 3, -1) == 1, "failure : binding of instance");
+		const CRecordingHost::CCall* call3 = host.find(CRecordingHost::call_create, 3, -1);
+		const CRecordingHost::CCall* call5 = host.find(CRecordingHost::call_create, 5, -1);
+		check(call3 && call3->masterNodeIndex == -1, "failure : master after failed node");
+		check(call5 && call5->masterNodeIndex == 3, "failure : instance master");
+		check(host.count(CRecordingHost::call_release, -1, 0) == 1, "failure : released once");
+	}
+
+	printf("MeshInstancingTest : %d / %d passed.\n", g_testsCount - g_failedCount, g_testsCount);
+	return (g_failedCount == 0) ? 0 : 1;
+}
@@ -0,0 +1,92 @@
+﻿/**
+ * CThreadPoolのテスト.
+ * 入れ子の呼び出しと、funcから例外が投げられた場合の動作を確認する.
+ */
+#include "ThreadPool.h"
+
+#include <vector>
+#include <atomic>
+#include <stdexcept>
+#include <stdio.h>
+
+namespace {
+	int g_failedCount = 0;
+	int g_testsCount  = 0;
+
+	void check (const bool result, const char* name) {
+		g_testsCount++;
+		if (!result) {
+			printf("FAILED : %s\n", name);
+			g_failedCount++;
+		}
+	}
+
+	/**
+	 * parallelForの中からparallelForを呼び出す (ワーカースレッド/呼び出し元のスレッドの両方で実行される).
+	 */
+	void testNested () {
+		CThreadPool& pool = CThreadPool::getInstance();
+		const int outerCou = 64;
+		const int innerCou = 100;
+		std::vector<int> sums(outerCou, 0);
+		pool.parallelFor(outerCou, [&](const int i) {
+			std::vector<int> values(innerCou, 0);
+			pool.parallelFor(innerCou, [&](const int j) {
+				values[j] = j;
+			});
+			for (int j = 0; j < innerCou; ++j) sums[i] += values[j];
+		});
+
+		bool same = true;
+		for (int i = 0; i < outerCou; ++i) same = same && (sums[i] == (innerCou * (innerCou - 1)) / 2);
+		check(same, "nested parallelFor");
+	}
+
+	/**
+	 * funcから投げられた例外が呼び出し元に届き、その後もプールが使えること.
+	 */
+	void testException () {
+		CThreadPool& pool = CThreadPool::getInstance();
+		bool allCaught = true;
+		for (int loop = 0; loop < 100; ++loop) {
+			bool caught = false;
+			try {
+				pool.parallelFor(500, [&](const int i) {
+					if (i == loop * 5) throw std::runtime_error("test");
+				});
+			} catch (std::runtime_error&) {
+				caught = true;
+			}
+			allCaught = allCaught && caught;
+		}
+		check(allCaught, "exception is rethrown");
+
+		// 入れ子の呼び出しの中で投げられた例外.
+		bool caught = false;
+		try {
+			pool.parallelFor(16, [&](const int i) {
+				pool.parallelFor(16, [&](const int j) {
+					if (i == 3 && j == 7) throw std::runtime_error("test");
+				});
+			});
+		} catch (std::runtime_error&) {
+			caught = true;
+		}
+		check(caught, "exception in nested parallelFor is rethrown");
+
+		std::atomic<int> count(0);
+		pool.parallelFor(1000, [&](const int) {
+			count++;
+		});
+		check(count == 1000, "pool is usable after exception");
+	}
+}
+
+int main ()
+{
+	testNested();
+	testException();
+
+	printf("ThreadPoolTest : %d / %d passed.\n", g_testsCount - g_failedCount, g_testsCount);
+	return (g_failedCount == 0) ? 0 : 1;
+}
@@ -0,0 +1,330 @@
+﻿/**
+ * TileBakerのテスト.
+ * 関数で与えたイメージをベイクし、以下を確認する.
+ * - バンドの行数 (メモリの上限) とスレッド数によらず、結果が同じになる.
+ * - ImageResampler::resizeで全体を拡大縮小し、ImageKernelsで合成した結果と同じになる.
+ * packも同様に、ImageResampler::resizeとImageKernels::packChannelsの結果と比較する.
+ */
+#include "TileBaker.h"
+#include "ImageResampler.h"
+#include "ImageKernels.h"
+#include "ThreadPool.h"
+
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+
+namespace {
+	int g_failedCount = 0;
+	int g_testsCount  = 0;
+
+	void check (const bool result, const std::string& name) {
+		g_testsCount++;
+		if (!result) {
+			printf("FAILED : %s\n", name.c_str());
+			g_failedCount++;
+		}
+	}
+
+	/**
+	 * 位置から決まる疑似乱数.
+	 */
+	unsigned char hashValue (const int x, const int y, const int seed) {
+		uint32_t h = (uint32_t)x * 73856093u ^ (uint32_t)y * 19349663u ^ (uint32_t)seed * 83492791u;
+		h ^= h >> 13;
+		h *= 0x5bd1e995u;
+		h ^= h >> 15;
+		return (unsigned char)(h & 0xff);
+	}
+
+	/**
+	 * テスト用のイメージ.
+	 * グラデーションにノイズを加えたもの. alphaRowsが0より大きい場合は、alphaRows行ごとに半透明の行を含める.
+	 */
+	TileBaker::CTileSourceFunc createSource (const int width, const int height, const int seed, const int alphaRows) {
+		return TileBaker::CTileSourceFunc(width, height, [=](const int x, const int y, unsigned char* rgba) {
+			rgba[0] = (unsigned char)((x * 255) / std::max(1, width - 1));
+			rgba[1] = (unsigned char)((y * 255) / std::max(1, height - 1));
+			rgba[2] = hashValue(x, y, seed);
+			rgba[3] = (alphaRows > 0 && (y % alphaRows) == 0) ? hashValue(y, x, seed + 1) : 255;
+		});
+	}
+
+	/**
+	 * イメージ全体のRGBAを取得.
+	 */
+	std::vector<unsigned char> readAll (TileBaker::CTileSource* source) {
+		std::vector<unsigned char> rgba((size_t)source->getWidth() * (size_t)source->getHeight() * 4);
+		source->readPixels(0, 0, source->getWidth(), source->getHeight(), &(rgba[0]));
+		return rgba;
+	}
+
+	/**
+	 * 指定のメモリの上限でベイク.
+	 * @param[in] singleThread  trueの場合は、parallelForの中から呼び出して1スレッドで処理する.
+	 */
+	std::vector<unsigned char> bakeAll (const int width, const int height, const std::vector<TileBaker::CTileBakeLayer>& layers, const size_t memoryBudget, const bool singleThread, int* pBandsCount = NULL) {
+		std::vector<unsigned char> result((size_t)width * (size_t)height * 4, 0);
+		int bandsCou = 0;
+		bool ret = false;
+		auto bakeFunc = [&]() {
+			ret = TileBaker::bake(width, height, layers, memoryBudget, [&](const int y, const int rowsCou, const unsigned char* rgbaData) {
+				memcpy(&(result[(size_t)y * (size_t)width * 4]), rgbaData, (size_t)rowsCou * (size_t)width * 4);
+				bandsCou++;
+				return true;
+			});
+		};
+		if (singleThread) {
+			// parallelForの中からの呼び出しは、そのスレッドで順番に処理される.
+			CThreadPool::getInstance().parallelFor(2, [&](const int i) {
+				if (i == 0) bakeFunc();
+			});
+		} else {
+			bakeFunc();
+		}
+		if (!ret) result.clear();
+		if (pBandsCount) *pBandsCount = bandsCou;
+		return result;
+	}
+
+	/**
+	 * 参照方法の指定で、イメージ全体を出力サイズに拡大縮小.
+	 */
+	std::vector<unsigned char> resizeSampling (const TileBaker::CTileSampling& sampling, const int width, const int height) {
+		const std::vector<unsigned char> srcRGBA = readAll(sampling.source);
+		ImageResampler::CResampleParam param;
+		param.filter   = sampling.filter;
+		param.flipH    = sampling.flipH;
+		param.flipV    = sampling.flipV;
+		param.rotate90 = sampling.rotate90;
+		param.repeatU  = sampling.repeatU;
+		param.repeatV  = sampling.repeatV;
+
+		std::vector<unsigned char> dstRGBA((size_t)width * (size_t)height * 4);
+		ImageResampler::resize(&(srcRGBA[0]), sampling.source->getWidth(), sampling.source->getHeight(), &(dstRGBA[0]), width, height, param);
+		if (sampling.flipColor) ImageKernels::invertColor(&(dstRGBA[0]), width * height);
+		return dstRGBA;
+	}
+
+	/**
+	 * TileBakerを使用せずに、ImageResampler/ImageKernelsで同じ処理を行う.
+	 */
+	std::vector<unsigned char> bakeReference (const int width, const int height, const std::vector<TileBaker::CTileBakeLayer>& layers) {
+		const size_t rowBytes = (size_t)width * 4;
+		std::vector<unsigned char> result(rowBytes * (size_t)height, 0);
+		for (size_t li = 0; li < layers.size(); ++li) {
+			const TileBaker::CTileBakeLayer& layer = layers[li];
+			std::vector<unsigned char> pixels = resizeSampling(layer.image, width, height);
+			std::vector<unsigned char> weightPixels;
+			if (layer.weightImage.source) weightPixels = resizeSampling(layer.weightImage, width, height);
+
+			for (int y = 0; y < height; ++y) {
+				unsigned char* p = &(pixels[(size_t)y * rowBytes]);
+				unsigned char* dst = &(result[(size_t)y * rowBytes]);
+				if (layer.useGrayscale) ImageKernels::convertToGrayscale(p, width, layer.grayscaleChannel);
+				if (layer.fillAlpha) ImageKernels::fillAlpha(p, width, (unsigned char)255);
+				if (layer.invertColor) ImageKernels::invertColor(p, width);
+
+				ImageKernels::CBlendParam8 blendParam(layer.blendParam);
+				blendParam.basePixels   = (li > 0) ? dst : NULL;
+				blendParam.weightPixels = weightPixels.empty() ? NULL : &(weightPixels[(size_t)y * rowBytes]);
+				ImageKernels::blendPixels(p, width, blendParam);
+				memcpy(dst, p, rowBytes);
+			}
+		}
+		return result;
+	}
+
+	/**
+	 * レイヤの構成と出力サイズを指定してテスト.
+	 */
+	void testLayers (const std::string& name, const int width, const int height, const std::vector<TileBaker::CTileBakeLayer>& layers) {
+		int bandsCou = 0;
+		const std::vector<unsigned char> result = bakeAll(width, height, layers, (size_t)1 << 30, false, &bandsCou);
+		check(!result.empty() && bandsCou == 1, name + " : bake");
+		if (result.empty()) return;
+
+		// メモリの上限を変えて、バンドの行数を変える (1の場合は1行ずつ).
+		const size_t budgets[] = { 1, TileBaker::estimateMemory(width, height, layers, 3), TileBaker::estimateMemory(width, height, layers, height / 2 + 1) };
+		for (const size_t budget : budgets) {
+			const std::vector<unsigned char> result2 = bakeAll(width, height, layers, budget, false, &bandsCou);
+			check(result2 == result && bandsCou > 1, name + " : budget " + std::to_string(budget) + " (" + std::to_string(bandsCou) + " bands)");
+		}
+
+		// 1スレッドで処理.
+		check(bakeAll(width, height, layers, (size_t)1 << 30, true) == result, name + " : single thread");
+		check(bakeAll(width, height, layers, 1, true) == result, name + " : single thread, 1 row bands");
+
+		// 全体を拡大縮小して合成した結果と比較.
+		check(bakeReference(width, height, layers) == result, name + " : reference");
+	}
+
+	/**
+	 * 指定のメモリの上限でパック.
+	 * @param[in] singleThread  trueの場合は、parallelForの中から呼び出して1スレッドで処理する.
+	 */
+	std::vector<unsigned char> packAll (const int width, const int height, const TileBaker::CTilePackChannel* channels, const size_t memoryBudget, const bool singleThread, int* pBandsCount = NULL) {
+		std::vector<unsigned char> result((size_t)width * (size_t)height * 4, 0);
+		int bandsCou = 0;
+		bool ret = false;
+		auto packFunc = [&]() {
+			ret = TileBaker::pack(width, height, channels[0], channels[1], channels[2], memoryBudget, [&](const int y, const int rowsCou, const unsigned char* rgbaData) {
+				memcpy(&(result[(size_t)y * (size_t)width * 4]), rgbaData, (size_t)rowsCou * (size_t)width * 4);
+				bandsCou++;
+				return true;
+			});
+		};
+		if (singleThread) {
+			CThreadPool::getInstance().parallelFor(2, [&](const int i) {
+				if (i == 0) packFunc();
+			});
+		} else {
+			packFunc();
+		}
+		if (!ret) result.clear();
+		if (pBandsCount) *pBandsCount = bandsCou;
+		return result;
+	}
+
+	/**
+	 * TileBakerを使用せずに、ImageResampler/ImageKernelsでパックする.
+	 */
+	std::vector<unsigned char> packReference (const int width, const int height, const TileBaker::CTilePackChannel* channels) {
+		const size_t rowBytes = (size_t)width * 4;
+		std::vector<unsigned char> pixels[3];
+		for (int i = 0; i < 3; ++i) {
+			if (channels[i].image.source) pixels[i] = resizeSampling(channels[i].image, width, height);
+		}
+
+		std::vector<unsigned char> result(rowBytes * (size_t)height, 0);
+		for (int y = 0; y < height; ++y) {
+			ImageKernels::CPackChannel packChannels[3];
+			for (int i = 0; i < 3; ++i) {
+				packChannels[i].channel = channels[i].channel;
+				packChannels[i].invert  = channels[i].invert;
+				packChannels[i].value   = channels[i].value;
+				if (!pixels[i].empty()) packChannels[i].pixels = &(pixels[i][(size_t)y * rowBytes]);
+			}
+			ImageKernels::packChannels(&(result[(size_t)y * rowBytes]), width, packChannels[0], packChannels[1], packChannels[2]);
+		}
+		return result;
+	}
+
+	/**
+	 * パックする要素と出力サイズを指定してテスト.
+	 */
+	void testPack (const std::string& name, const int width, const int height, const TileBaker::CTilePackChannel* channels) {
+		int bandsCou = 0;
+		const std::vector<unsigned char> result = packAll(width, height, channels, (size_t)1 << 30, false, &bandsCou);
+		check(!result.empty() && bandsCou == 1, name + " : pack");
+		if (result.empty()) return;
+
+		// メモリの上限を変えて、バンドの行数を変える (1の場合は1行ずつ).
+		const size_t budgets[] = { 1, (size_t)width * (size_t)height * 2 };
+		for (const size_t budget : budgets) {
+			const std::vector<unsigned char> result2 = packAll(width, height, channels, budget, false, &bandsCou);
+			check(result2 == result && bandsCou > 1, name + " : budget " + std::to_string(budget) + " (" + std::to_string(bandsCou) + " bands)");
+		}
+
+		// 1スレッドで処理.
+		check(packAll(width, height, channels, 1, true) == result, name + " : single thread, 1 row bands");
+
+		// 全体を拡大縮小してパックした結果と比較.
+		check(packReference(width, height, channels) == result, name + " : reference");
+	}
+}
+
+int main ()
+{
+	TileBaker::CTileSourceFunc sourceA = createSource(61, 47, 1, 0);
+	TileBaker::CTileSourceFunc sourceB = createSource(33, 90, 2, 0);
+	TileBaker::CTileSourceFunc sourceC = createSource(128, 128, 3, 0);
+	TileBaker::CTileSourceFunc sourceAlpha = createSource(40, 52, 4, 5);
+
+	// 1レイヤ、拡大/縮小/同じサイズ.
+	{
+		std::vector<TileBaker::CTileBakeLayer> layers(1);
+		layers[0].image.source = &sourceA;
+		testLayers("single layer, downscale", 50, 41, layers);
+		testLayers("single layer, upscale", 97, 83, layers);
+
+		layers[0].image.flipH     = true;
+		layers[0].image.flipV     = true;
+		layers[0].image.flipColor = true;
+		testLayers("single layer, flip", 61, 47, layers);
+	}
+
+	// フィルタごと、90度回転と繰り返し.
+	{
+		const ImageResampler::FILTER_TYPE filters[] = { ImageResampler::filter_box, ImageResampler::filter_triangle, ImageResampler::filter_lanczos3, ImageResampler::filter_mitchell };
+		for (const ImageResampler::FILTER_TYPE filter : filters) {
+			std::vector<TileBaker::CTileBakeLayer> layers(1);
+			layers[0].image.source   = &sourceB;
+			layers[0].image.filter   = filter;
+			layers[0].image.rotate90 = true;
+			layers[0].image.repeatU  = 2;
+			layers[0].image.repeatV  = 3;
+			testLayers("rotate90 repeat, filter " + std::to_string((int)filter), 64, 45, layers);
+		}
+	}
+
+	// 複数レイヤ、マット、合成方法、グレースケール.
+	{
+		std::vector<TileBaker::CTileBakeLayer> layers(3);
+		layers[0].image.source = &sourceA;
+		layers[0].blendParam.blendType = ImageKernels::blend_normal;
+
+		layers[1].image.source          = &sourceB;
+		layers[1].image.rotate90        = true;
+		layers[1].weightImage.source    = &sourceC;
+		layers[1].weightImage.flipColor = true;
+		layers[1].useGrayscale          = true;
+		layers[1].grayscaleChannel      = ImageKernels::channel_average;
+		layers[1].blendParam.blendType  = ImageKernels::blend_multiply;
+
+		layers[2].image.source          = &sourceC;
+		layers[2].image.filter          = ImageResampler::filter_box;
+		layers[2].image.flipV           = true;
+		layers[2].fillAlpha             = true;
+		layers[2].invertColor           = true;
+		layers[2].blendParam.blendType  = ImageKernels::blend_add;
+		layers[2].blendParam.weight     = 0.5f;
+		testLayers("multi layer", 70, 59, layers);
+	}
+
+	// Alphaを持つ行を含むイメージ.
+	{
+		std::vector<TileBaker::CTileBakeLayer> layers(2);
+		layers[0].image.source = &sourceAlpha;
+		layers[1].image.source = &sourceA;
+		layers[1].weightImage.source = &sourceAlpha;
+		layers[1].blendParam.blendType = ImageKernels::blend_max;
+		testLayers("alpha", 29, 77, layers);
+	}
+
+	// Occlusion(R)/Roughness(G)/Metallic(B)のパック.
+	{
+		TileBaker::CTilePackChannel channels[3];
+		channels[0].image.source = &sourceA;
+		channels[1].image.source = &sourceB;
+		channels[1].channel      = ImageKernels::channel_average;
+		channels[2].image.source = &sourceC;
+		channels[2].image.flipV  = true;
+		channels[2].invert       = true;
+		testPack("pack, resize", 80, 66, channels);
+		testPack("pack, same size", 128, 128, channels);
+
+		// イメージがない要素は値を使用.
+		channels[0].image.source = NULL;
+		channels[0].value        = 200;
+		channels[2].image.source = &sourceAlpha;
+		channels[2].channel      = ImageKernels::channel_alpha;
+		testPack("pack, value", 45, 37, channels);
+	}
+
+	printf("TileBakerTest : %d / %d passed.\n", g_testsCount - g_failedCount, g_testsCount);
+	return (g_failedCount == 0) ? 0 : 1;
+}